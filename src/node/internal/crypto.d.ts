@@ -34,6 +34,8 @@ export function getHkdf(hash: string, key: ArrayLike, salt: ArrayLike, info: Arr
 // pbkdf2
 export function getPbkdf(password: ArrayLike, salt: ArrayLike, iterations: number, keylen: number,
                          digest: string): ArrayBuffer;
+export function getPbkdfAsync(password: ArrayLike, salt: ArrayLike, iterations: number,
+                              keylen: number, digest: string): Promise<ArrayBuffer>;
 
 // Keys
 export function exportKey(key: CryptoKey, options?: InnerExportOptions): KeyExportResult;
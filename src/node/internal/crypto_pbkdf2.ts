@@ -68,7 +68,7 @@ export function pbkdf2(password: ArrayLike, salt: ArrayLike, iterations: number,
 
   new Promise<ArrayBuffer>((res, rej) => {
     try {
-      res(cryptoImpl.getPbkdf(password, salt, iterations, keylen, digest));
+      res(cryptoImpl.getPbkdfAsync(password, salt, iterations, keylen, digest));
     } catch(err) {
       rej(err);
     }
@@ -872,6 +872,27 @@ kj::Array<jsg::Ref<api::WebSocket>> DurableObjectState::getWebSockets(
   return kj::Array<jsg::Ref<api::WebSocket>>();
 }
 
+uint DurableObjectState::broadcastWebSocketMessage(
+    jsg::Lock& js,
+    kj::OneOf<kj::Array<byte>, kj::String> message,
+    jsg::Optional<BroadcastOptions> options) {
+  auto& a = KJ_REQUIRE_NONNULL(IoContext::current().getActor());
+  KJ_IF_MAYBE(manager, a.getHibernationManager()) {
+    kj::Maybe<kj::StringPtr> tag;
+    kj::Maybe<WebSocket&> except;
+    KJ_IF_MAYBE(o, options) {
+      KJ_IF_MAYBE(t, o->tag) {
+        tag = *t;
+      }
+      KJ_IF_MAYBE(ws, o->except) {
+        except = **ws;
+      }
+    }
+    return manager->broadcast(js, kj::mv(message), tag, except);
+  }
+  return 0;
+}
+
 void DurableObjectState::setWebSocketAutoResponse(
       jsg::Optional<jsg::Ref<WebSocketRequestResponsePair>> maybeReqResp) {
   auto& a = KJ_REQUIRE_NONNULL(IoContext::current().getActor());
@@ -447,6 +447,26 @@ public:
   // Disconnected WebSockets are automatically removed from the list.
   kj::Array<jsg::Ref<api::WebSocket>> getWebSockets(jsg::Lock& js, jsg::Optional<kj::String> tag);
 
+  struct BroadcastOptions {
+    // Only send to WebSockets accepted with this tag.
+    jsg::Optional<kj::String> tag;
+
+    // Don't send to this WebSocket, e.g. the one the message came from.
+    jsg::Optional<jsg::Ref<WebSocket>> except;
+
+    JSG_STRUCT(tag, except);
+  };
+
+  // Sends `message` to every accepted WebSocket (or, with `options.tag`, those with the tag),
+  // without waking WebSockets which are hibernating. Equivalent to calling send() on each of the
+  // WebSockets returned by getWebSockets(), but all hibernating recipients share one copy of the
+  // message. Returns the number of WebSockets the message was sent to.
+  //
+  // A recipient which falls too far behind on broadcast messages is disconnected rather than
+  // buffered without limit; its webSocketClose() handler is then invoked as usual.
+  uint broadcastWebSocketMessage(jsg::Lock& js, kj::OneOf<kj::Array<byte>, kj::String> message,
+      jsg::Optional<BroadcastOptions> options);
+
   // Sets an object-wide websocket auto response message for a specific
   // request string. All websockets belonging to the same object must
   // reply to the request with the matching response, then store the timestamp at which
@@ -476,6 +496,7 @@ public:
       //   useful to apps in actual production? It's a convenient way to bail out when you discover
       //   your state is inconsistent.
       JSG_METHOD(abort);
+      JSG_METHOD(broadcastWebSocketMessage);
     }
 
     JSG_TS_ROOT();
@@ -500,6 +521,7 @@ private:
 #define EW_ACTOR_STATE_ISOLATE_TYPES                     \
   api::ActorState,                                       \
   api::DurableObjectState,                               \
+  api::DurableObjectState::BroadcastOptions,             \
   api::DurableObjectTransaction,                         \
   api::DurableObjectStorage,                             \
   api::DurableObjectStorage::TransactionOptions,         \
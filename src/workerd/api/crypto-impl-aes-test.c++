@@ -170,5 +170,79 @@ KJ_TEST("AES-CTR key wrap") {
   });
 }
 
+KJ_TEST("AES streaming ciphers match one-shot encrypt/decrypt") {
+  jsg::test::Evaluator<CryptoContext, CryptoIsolate> e(v8System);
+  CryptoIsolate &cryptoIsolate = e.getIsolate();
+  jsg::V8StackScope stackScope;
+  CryptoIsolate::Lock isolateLock(cryptoIsolate, stackScope);
+  auto isolate = isolateLock.v8Isolate;
+  auto& js = jsg::Lock::from(isolate);
+
+  auto message = kj::heapArray<kj::byte>(1000);
+  for (auto i: kj::indices(message)) message[i] = i * 7;
+
+  // Chunk sizes that straddle block and tag boundaries.
+  constexpr size_t chunkSizes[] = { 1, 15, 3, 16, 40, 0, 129 };
+
+  auto feed = [&](CryptoKey::Impl::Cipher& cipher, kj::ArrayPtr<const kj::byte> input) {
+    kj::Vector<kj::byte> output;
+    size_t pos = 0;
+    for (size_t i = 0; pos < input.size(); i++) {
+      auto size = kj::min(chunkSizes[i % kj::size(chunkSizes)], input.size() - pos);
+      output.addAll(cipher.update(input.slice(pos, pos + size)));
+      pos += size;
+    }
+    output.addAll(cipher.finish());
+    return output.releaseAsArray();
+  };
+
+  for (kj::StringPtr name: { "AES-GCM"_kj, "AES-CBC"_kj }) {
+    KJ_CONTEXT(name);
+
+    SubtleCrypto::ImportKeyAlgorithm importAlgorithm = {
+        .name = kj::str(name),
+    };
+    auto key = CryptoKey::Impl::importAes(
+        js, name, "raw", kj::heapArray<kj::byte>(32), kj::mv(importAlgorithm), false,
+        {kj::str("encrypt"), kj::str("decrypt")});
+
+    auto params = [&]() {
+      SubtleCrypto::EncryptAlgorithm algorithm;
+      algorithm.name = kj::str(name);
+      algorithm.iv = kj::heapArray<kj::byte>(16);
+      if (name == "AES-GCM") {
+        algorithm.additionalData = kj::heapArray<kj::byte>({1, 2, 3});
+      }
+      return algorithm;
+    };
+
+    for (auto size: { size_t(0), size_t(15), message.size() }) {
+      KJ_CONTEXT(size);
+      auto input = message.slice(0, size);
+
+      auto expected = key->encrypt(params(), input);
+      auto cipherText = feed(*key->newEncryptCipher(params()), input);
+      KJ_EXPECT(cipherText == expected);
+
+      if (name == "AES-GCM") {
+        // Nothing can be released before the tag is checked, so there's no streaming decryption.
+        KJ_EXPECT(key->decrypt(params(), cipherText).asPtr() == input);
+        KJ_EXPECT_THROW_MESSAGE("AES-GCM cannot be decrypted as a stream",
+            key->newDecryptCipher(params()));
+        continue;
+      }
+
+      auto plainText = feed(*key->newDecryptCipher(params()), cipherText);
+      KJ_EXPECT(plainText.asPtr() == input);
+
+      // AES-CBC ciphertext that isn't a whole number of blocks is only noticed when the stream is
+      // finished.
+      cipherText = kj::heapArray(cipherText.slice(0, cipherText.size() - 1));
+      KJ_EXPECT_THROW_MESSAGE("Decryption failed",
+          feed(*key->newDecryptCipher(params()), cipherText));
+    }
+  }
+}
+
 }  // namespace
 }  // namespace workerd::api
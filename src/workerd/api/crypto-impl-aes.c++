@@ -94,6 +94,84 @@ int decryptFinalHelper(kj::StringPtr algorithm, size_t inputLength,
       outputLength, " for ", algorithm);
 }
 
+// Implements EncryptionStream for AES-GCM and AES-CBC, and DecryptionStream for AES-CBC, on top
+// of a cipher context that has already been initialized with the key, IV, and any additional data.
+class AesStreamCipher final: public CryptoKey::Impl::Cipher {
+public:
+  // `tagSize` is the AES-GCM tag length in bytes when encrypting, or 0 for AES-CBC.
+  AesStreamCipher(kj::StringPtr algorithmName,
+                  std::unique_ptr<EVP_CIPHER_CTX, void(*)(EVP_CIPHER_CTX*)> cipherCtx,
+                  bool encrypting, size_t tagSize)
+      : algorithmName(algorithmName), cipherCtx(kj::mv(cipherCtx)), encrypting(encrypting),
+        tagSize(tagSize) {
+    KJ_ASSERT(encrypting || tagSize == 0, "AES-GCM can't be decrypted as a stream");
+    // Block modes may emit up to one more block than they were given, when input buffered by an
+    // earlier call completes a block.
+    auto blockSize = EVP_CIPHER_CTX_block_size(this->cipherCtx.get());
+    blockSlack = blockSize > 1 ? blockSize : 0;
+  }
+
+  kj::Array<kj::byte> update(kj::ArrayPtr<const kj::byte> input) override {
+    KJ_REQUIRE(!finished, "cipher already finished");
+    inputSize += input.size();
+
+    auto output = kj::heapArray<kj::byte>(input.size() + blockSlack);
+    auto size = cipherUpdate(input, output);
+    return trim(kj::mv(output), size);
+  }
+
+  kj::Array<kj::byte> finish() override {
+    KJ_REQUIRE(!finished, "cipher already finished");
+    finished = true;
+
+    if (encrypting) {
+      auto output = kj::heapArray<kj::byte>(blockSlack + tagSize);
+      int size = 0;
+      OSSLCALL(EVP_EncryptFinal_ex(cipherCtx.get(), output.begin(), &size));
+      if (tagSize > 0) {
+        OSSLCALL(EVP_CIPHER_CTX_ctrl(cipherCtx.get(), EVP_CTRL_GCM_GET_TAG,
+                                     tagSize, output.begin() + size));
+        size += tagSize;
+      }
+      return trim(kj::mv(output), size);
+    }
+
+    auto output = kj::heapArray<kj::byte>(blockSlack);
+    auto size = decryptFinalHelper(algorithmName, inputSize, outputSize,
+        cipherCtx.get(), output.begin());
+    return trim(kj::mv(output), size);
+  }
+
+private:
+  kj::StringPtr algorithmName;
+  std::unique_ptr<EVP_CIPHER_CTX, void(*)(EVP_CIPHER_CTX*)> cipherCtx;
+  bool encrypting;
+  size_t tagSize;
+  size_t blockSlack;
+  bool finished = false;
+
+  // Totals, for error messages.
+  size_t inputSize = 0;
+  size_t outputSize = 0;
+
+  size_t cipherUpdate(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<kj::byte> output) {
+    if (input.size() == 0) return 0;
+    JSG_REQUIRE(input.size() < INT_MAX, DOMOperationError, "Input is too large to encrypt.");
+
+    int size = 0;
+    OSSLCALL(EVP_CipherUpdate(cipherCtx.get(), output.begin(), &size,
+                              input.begin(), input.size()));
+    KJ_ASSERT(size >= 0 && size <= output.size(), "buffer overrun");
+    outputSize += size;
+    return size;
+  }
+
+  static kj::Array<kj::byte> trim(kj::Array<kj::byte> output, size_t size) {
+    if (size == output.size()) return kj::mv(output);
+    return output.slice(0, size).attach(kj::mv(output));
+  }
+};
+
 // NOTE: The OpenSSL calls to implement AES-GCM and AES-CBC are quite similar. If you update one
 //   algorithm's encrypt() or decrypt() implementation, it'd be worth reviewing the other
 //   algorithm's implementation as well.
@@ -307,6 +385,45 @@ private:
 
     return plainText;
   }
+
+  kj::Own<Cipher> newEncryptCipher(SubtleCrypto::EncryptAlgorithm&& algorithm) const override {
+    kj::ArrayPtr<kj::byte> iv = JSG_REQUIRE_NONNULL(algorithm.iv, TypeError,
+        "Missing field \"iv\" in \"algorithm\".");
+    JSG_REQUIRE(iv.size() != 0, DOMOperationError, "AES-GCM IV must not be empty.");
+
+    int tagLength = algorithm.tagLength.orDefault(128);
+    validateAesGcmTagLength(tagLength);
+
+    auto additionalData = algorithm.additionalData.orDefault(kj::Array<kj::byte>()).asPtr();
+
+    auto cipherCtx = makeCipherContext();
+    KJ_ASSERT(cipherCtx.get() != nullptr);
+
+    auto type = lookupAesGcmType(keyData.size() * 8);
+
+    // Same setup as encrypt() above.
+    OSSLCALL(EVP_EncryptInit_ex(cipherCtx.get(), type, nullptr, nullptr, nullptr));
+    OSSLCALL(EVP_CIPHER_CTX_ctrl(cipherCtx.get(), EVP_CTRL_GCM_SET_IVLEN,
+                                 iv.size(), nullptr));
+    OSSLCALL(EVP_EncryptInit_ex(cipherCtx.get(), nullptr, nullptr, keyData.begin(),
+                                iv.begin()));
+
+    if (additionalData.size() > 0) {
+      int dummy;
+      OSSLCALL(EVP_EncryptUpdate(cipherCtx.get(), nullptr, &dummy,
+                                 additionalData.begin(), additionalData.size()));
+    }
+
+    return kj::heap<AesStreamCipher>(getAlgorithmName(), kj::mv(cipherCtx), true, tagLength / 8);
+  }
+
+  kj::Own<Cipher> newDecryptCipher(SubtleCrypto::EncryptAlgorithm&& algorithm) const override {
+    // The tag can only be checked once all of the ciphertext has been seen, so a stream would
+    // have to hand out plaintext that might turn out to be forged, or else buffer all of it.
+    JSG_FAIL_REQUIRE(DOMNotSupportedError, "AES-GCM cannot be decrypted as a stream, because "
+        "none of the plaintext can be trusted until the whole message has been authenticated. "
+        "Use crypto.subtle.decrypt() instead.");
+  }
 };
 
 class AesCbcKey final: public AesKeyBase {
@@ -388,8 +505,36 @@ private:
         cipherCtx.get(), plainText.begin() + plainSize);
     KJ_ASSERT(plainSize <= plainText.size());
 
-    // TODO(perf): Avoid this copy, see comment in the encrypt implementation functions.
-    return kj::heapArray(plainText.begin(), plainSize);
+    // The padding length is only known once the last block has been decrypted, so the buffer was
+    // sized for the worst case. Trim it without copying; the spare bytes (at most two blocks) are
+    // freed along with the plaintext once V8 releases the ArrayBuffer backed by it.
+    return plainText.slice(0, plainSize).attach(kj::mv(plainText));
+  }
+
+  kj::Own<Cipher> newEncryptCipher(SubtleCrypto::EncryptAlgorithm&& algorithm) const override {
+    return newCipher(kj::mv(algorithm), true);
+  }
+
+  kj::Own<Cipher> newDecryptCipher(SubtleCrypto::EncryptAlgorithm&& algorithm) const override {
+    return newCipher(kj::mv(algorithm), false);
+  }
+
+  kj::Own<Cipher> newCipher(SubtleCrypto::EncryptAlgorithm&& algorithm, bool encrypting) const {
+    kj::ArrayPtr<kj::byte> iv = JSG_REQUIRE_NONNULL(algorithm.iv, TypeError,
+        "Missing field \"iv\" in \"algorithm\".");
+
+    JSG_REQUIRE(iv.size() == 16, DOMOperationError, "AES-CBC IV must be 16 bytes long (provided ",
+        iv.size(), " bytes).");
+
+    auto cipherCtx = makeCipherContext();
+    KJ_ASSERT(cipherCtx.get() != nullptr);
+
+    auto type = lookupAesCbcType(keyData.size() * 8);
+
+    OSSLCALL(EVP_CipherInit_ex(cipherCtx.get(), type, nullptr, keyData.begin(),
+                               iv.begin(), encrypting ? 1 : 0));
+
+    return kj::heap<AesStreamCipher>(getAlgorithmName(), kj::mv(cipherCtx), encrypting, 0);
   }
 };
 
@@ -450,9 +595,8 @@ protected:
 
     const auto& cipher = lookupAesType(keyData.size());
 
-    kj::Vector<kj::byte> result;
     // The output of AES-CTR is the same size as the input.
-    result.resize(data.size());
+    auto result = kj::heapArray<kj::byte>(data.size());
 
     auto numCounterValues = newBignum();
     JSG_REQUIRE(BN_lshift(numCounterValues.get(), BN_value_one(), counterBitLength),
@@ -483,7 +627,7 @@ protected:
     if (BN_cmp(numBlocksUntilReset.get(), numOutputBlocks.get()) >= 0) {
       // If the counter doesn't need any wrapping, can evaluate this as a single call.
       process(&cipher, data, counter, result.asPtr());
-      return result.releaseAsArray();
+      return result;
     }
 
     // Need this to be done in 2 parts using the current counter block and then resetting the
@@ -507,7 +651,7 @@ protected:
     process(&cipher, data.slice(inputSizePart1, data.size()), counter, result.slice(
         inputSizePart1, result.size()));
 
-    return result.releaseAsArray();
+    return result;
   }
 
 private:
@@ -671,7 +815,7 @@ CryptoKeyUsageSet validateAesUsages(CryptoKeyUsageSet::Context ctx, kj::StringPt
 
 }  // namespace
 
-kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair> CryptoKey::Impl::generateAes(
+jsg::Promise<kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair>> CryptoKey::Impl::generateAes(
       jsg::Lock& js, kj::StringPtr normalizedName,
       SubtleCrypto::GenerateKeyAlgorithm&& algorithm, bool extractable,
       kj::ArrayPtr<const kj::String> keyUsages) {
@@ -709,7 +853,8 @@ kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair> CryptoKey::Impl::generateAes(
     JSG_FAIL_REQUIRE(DOMNotSupportedError, normalizedName, " key generation not supported.");
   }
 
-  return jsg::alloc<CryptoKey>(kj::mv(keyImpl));
+  return js.resolvedPromise<kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair>>(
+      jsg::alloc<CryptoKey>(kj::mv(keyImpl)));
 }
 
 kj::Own<CryptoKey::Impl> CryptoKey::Impl::importAes(
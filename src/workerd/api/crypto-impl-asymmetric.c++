@@ -247,6 +247,63 @@ public:
   kj::Array<kj::byte> sign(
       SubtleCrypto::SignAlgorithm&& algorithm,
       kj::ArrayPtr<const kj::byte> data) const override {
+    auto type = prepareSign(algorithm);
+    return signatureSslToWebCrypto(digestSign(keyData.get(), type, data,
+        [&](EVP_PKEY_CTX* pctx) { addSalt(pctx, algorithm); }));
+  }
+
+  bool verify(
+      SubtleCrypto::SignAlgorithm&& algorithm,
+      kj::ArrayPtr<const kj::byte> signature, kj::ArrayPtr<const kj::byte> data) const override {
+    JSG_REQUIRE(keyType == "public", DOMInvalidAccessError,
+        "Asymmetric verification requires a public key.");
+
+    auto sslSignature = signatureWebCryptoToSsl(signature);
+
+    auto type = lookupDigestAlgorithm(chooseHash(algorithm.hash)).second;
+
+    auto digestCtx = OSSL_NEW(EVP_MD_CTX);
+
+    OSSLCALL(EVP_DigestVerifyInit(digestCtx.get(), nullptr, type, nullptr, keyData.get()));
+    addSalt(digestCtx->pctx, algorithm);
+    // No-op call unless CryptoKey is RsaPss
+    OSSLCALL(EVP_DigestVerifyUpdate(digestCtx.get(), data.begin(), data.size()));
+    // EVP_DigestVerifyFinal() returns 1 on success, 0 on invalid signature, and any other value
+    // indicates "a more serious error".
+    auto result = EVP_DigestVerifyFinal(digestCtx.get(), sslSignature.begin(), sslSignature.size());
+    JSG_REQUIRE(result == 0 || result == 1, InternalDOMOperationError,
+        "Unexpected return code from digest verify", getAlgorithmName());
+    if (result == 0) {
+      ERR_clear_error();
+    }
+    return !!result;
+  }
+
+  kj::StringPtr getType() const override { return keyType; }
+
+  EVP_PKEY* getEvpPkey() const { return keyData.get(); }
+
+  bool equals(const CryptoKey::Impl& other) const override final {
+    if (this == &other) return true;
+    KJ_IF_MAYBE(otherImpl, kj::dynamicDowncastIfAvailable<const AsymmetricKey>(other)) {
+      // EVP_PKEY_cmp will return 1 if the inputs match, 0 if they don't match,
+      // -1 if the key types are different, and -2 if the operation is not supported.
+      // We only really care about the first two cases.
+      return EVP_PKEY_cmp(keyData.get(), otherImpl->keyData.get()) == 1;
+    }
+    return false;
+  }
+
+protected:
+  // Returns a new reference to the key's EVP_PKEY. OpenSSL's reference counting is atomic, so
+  // unlike the key itself, this can be handed to another thread.
+  kj::Own<EVP_PKEY> addRefEvpPkey() const {
+    EVP_PKEY_up_ref(keyData.get());
+    return kj::Own<EVP_PKEY>(keyData.get(), SslDisposer<EVP_PKEY, &EVP_PKEY_free>::INSTANCE);
+  }
+
+  // Validates the arguments to sign() and returns the digest to sign with.
+  const EVP_MD* prepareSign(const SubtleCrypto::SignAlgorithm& algorithm) const {
     JSG_REQUIRE(keyType == "private", DOMInvalidAccessError,
         "Asymmetric signing requires a private key.");
 
@@ -279,10 +336,17 @@ public:
           "key too small for signing with given digest and salt length");
     }
 
+    return type;
+  }
+
+  // Signs `data` with `pkey`, returning the signature in OpenSSL's format. `addSalt` is called to
+  // configure the signing context. Uses nothing but its arguments, so it can run off-thread.
+  static kj::Array<kj::byte> digestSign(EVP_PKEY* pkey, const EVP_MD* type,
+      kj::ArrayPtr<const kj::byte> data, kj::FunctionParam<void(EVP_PKEY_CTX*)> addSalt) {
     auto digestCtx = OSSL_NEW(EVP_MD_CTX);
 
-    OSSLCALL(EVP_DigestSignInit(digestCtx.get(), nullptr, type, nullptr, keyData.get()));
-    addSalt(digestCtx->pctx, algorithm);
+    OSSLCALL(EVP_DigestSignInit(digestCtx.get(), nullptr, type, nullptr, pkey));
+    addSalt(digestCtx->pctx);
     // No-op call unless CryptoKey is RsaPss
     OSSLCALL(EVP_DigestSignUpdate(digestCtx.get(), data.begin(), data.size()));
     size_t signatureSize = 0;
@@ -296,49 +360,7 @@ public:
       signature = kj::heapArray<kj::byte>(signature.slice(0, signatureSize));
     }
 
-    return signatureSslToWebCrypto(kj::mv(signature));
-  }
-
-  bool verify(
-      SubtleCrypto::SignAlgorithm&& algorithm,
-      kj::ArrayPtr<const kj::byte> signature, kj::ArrayPtr<const kj::byte> data) const override {
-    JSG_REQUIRE(keyType == "public", DOMInvalidAccessError,
-        "Asymmetric verification requires a public key.");
-
-    auto sslSignature = signatureWebCryptoToSsl(signature);
-
-    auto type = lookupDigestAlgorithm(chooseHash(algorithm.hash)).second;
-
-    auto digestCtx = OSSL_NEW(EVP_MD_CTX);
-
-    OSSLCALL(EVP_DigestVerifyInit(digestCtx.get(), nullptr, type, nullptr, keyData.get()));
-    addSalt(digestCtx->pctx, algorithm);
-    // No-op call unless CryptoKey is RsaPss
-    OSSLCALL(EVP_DigestVerifyUpdate(digestCtx.get(), data.begin(), data.size()));
-    // EVP_DigestVerifyFinal() returns 1 on success, 0 on invalid signature, and any other value
-    // indicates "a more serious error".
-    auto result = EVP_DigestVerifyFinal(digestCtx.get(), sslSignature.begin(), sslSignature.size());
-    JSG_REQUIRE(result == 0 || result == 1, InternalDOMOperationError,
-        "Unexpected return code from digest verify", getAlgorithmName());
-    if (result == 0) {
-      ERR_clear_error();
-    }
-    return !!result;
-  }
-
-  kj::StringPtr getType() const override { return keyType; }
-
-  EVP_PKEY* getEvpPkey() const { return keyData.get(); }
-
-  bool equals(const CryptoKey::Impl& other) const override final {
-    if (this == &other) return true;
-    KJ_IF_MAYBE(otherImpl, kj::dynamicDowncastIfAvailable<const AsymmetricKey>(other)) {
-      // EVP_PKEY_cmp will return 1 if the inputs match, 0 if they don't match,
-      // -1 if the key types are different, and -2 if the operation is not supported.
-      // We only really care about the first two cases.
-      return EVP_PKEY_cmp(keyData.get(), otherImpl->keyData.get()) == 1;
-    }
-    return false;
+    return signature;
   }
 
 private:
@@ -533,9 +555,34 @@ public:
     : AsymmetricKey(kj::mv(keyData), keyType, extractable, usages),
       keyAlgorithm(kj::mv(keyAlgorithm)) {}
 
+  jsg::Promise<kj::Array<kj::byte>> signAsync(jsg::Lock& js,
+      SubtleCrypto::SignAlgorithm&& algorithm, kj::Array<const kj::byte> data) const override {
+    // An RSA private key operation is slow enough (milliseconds for large keys) to be worth
+    // running off-thread. prepareSign() has checked the PSS salt length, so only its value needs
+    // to come along.
+    auto type = prepareSign(algorithm);
+    kj::Maybe<int> pssSaltLength;
+    if (getAlgorithmName() == "RSA-PSS") {
+      pssSaltLength = KJ_ASSERT_NONNULL(algorithm.saltLength);
+    }
+    return runOffThread(js, [pkey = addRefEvpPkey(), type, pssSaltLength,
+                             data = kj::heapArray<kj::byte>(data)]() mutable {
+      return digestSign(pkey.get(), type, data, [&](EVP_PKEY_CTX* pctx) {
+        KJ_IF_MAYBE(salt, pssSaltLength) {
+          setPssSaltLength(pctx, *salt);
+        }
+      });
+    });
+  }
+
 protected:
   CryptoKey::RsaKeyAlgorithm keyAlgorithm;
 
+  static void setPssSaltLength(EVP_PKEY_CTX* pctx, int salt) {
+    OSSLCALL(EVP_PKEY_CTX_set_rsa_padding(pctx, RSA_PKCS1_PSS_PADDING));
+    OSSLCALL(EVP_PKEY_CTX_set_rsa_pss_saltlen(pctx, salt));
+  }
+
 private:
   static kj::Array<kj::byte> bigNumToArray(const BIGNUM& n) {
     kj::Vector<kj::byte> result(BN_num_bytes(&n));
@@ -690,8 +737,7 @@ public:
         "Failed to provide salt for RSA-PSS key operation which requires a salt");
     JSG_REQUIRE(salt >= 0, DOMDataError, "SaltLength for RSA-PSS must be non-negative (provided ",
         salt, ").");
-    OSSLCALL(EVP_PKEY_CTX_set_rsa_padding(pctx, RSA_PKCS1_PSS_PADDING));
-    OSSLCALL(EVP_PKEY_CTX_set_rsa_pss_saltlen(pctx, salt));
+    setPssSaltLength(pctx, salt);
   }
 
 private:
@@ -980,9 +1026,15 @@ void validateRsaParams(jsg::Lock& js, int modulusLength, kj::ArrayPtr<kj::byte>
   }
 }
 
+// The result of generateRsa()'s off-thread half.
+struct GeneratedRsaKeys {
+  kj::Own<EVP_PKEY> privateKey;
+  kj::Own<EVP_PKEY> publicKey;
+};
+
 } // namespace
 
-kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair> CryptoKey::Impl::generateRsa(
+jsg::Promise<kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair>> CryptoKey::Impl::generateRsa(
     jsg::Lock& js, kj::StringPtr normalizedName,
     SubtleCrypto::GenerateKeyAlgorithm&& algorithm, bool extractable,
     kj::ArrayPtr<const kj::String> keyUsages) {
@@ -1020,15 +1072,6 @@ kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair> CryptoKey::Impl::generateRsa(
   auto bnExponent = OSSLCALL_OWN(BIGNUM, BN_bin2bn(publicExponent.begin(),
       publicExponent.size(), nullptr), InternalDOMOperationError, "Error setting up RSA keygen.");
 
-  auto rsaPrivateKey = OSSL_NEW(RSA);
-  OSSLCALL(RSA_generate_key_ex(rsaPrivateKey, modulusLength, bnExponent.get(), 0));
-  auto privateEvpPKey = OSSL_NEW(EVP_PKEY);
-  OSSLCALL(EVP_PKEY_set1_RSA(privateEvpPKey.get(), rsaPrivateKey.get()));
-  kj::Own<RSA> rsaPublicKey = OSSLCALL_OWN(RSA, RSAPublicKey_dup(rsaPrivateKey.get()),
-      InternalDOMOperationError, "Error finalizing RSA keygen", internalDescribeOpensslErrors());
-  auto publicEvpPKey = OSSL_NEW(EVP_PKEY);
-  OSSLCALL(EVP_PKEY_set1_RSA(publicEvpPKey.get(), rsaPublicKey));
-
   auto keyAlgorithm = CryptoKey::RsaKeyAlgorithm {
     .name = normalizedName,
     .modulusLength = static_cast<uint16_t>(modulusLength),
@@ -1036,8 +1079,24 @@ kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair> CryptoKey::Impl::generateRsa(
     .hash = KeyAlgorithm { normalizedHashName }
   };
 
-  return generateRsaPair(normalizedName, kj::mv(privateEvpPKey), kj::mv(publicEvpPKey),
-      kj::mv(keyAlgorithm), extractable, usages);
+  // Finding the primes takes anywhere from milliseconds to seconds depending on the modulus
+  // length (and luck), so it happens off-thread. Only the CryptoKeys are created under the lock.
+  return runOffThread(js, [modulusLength, bnExponent = kj::mv(bnExponent)]() {
+    auto rsaPrivateKey = OSSL_NEW(RSA);
+    OSSLCALL(RSA_generate_key_ex(rsaPrivateKey, modulusLength, bnExponent.get(), 0));
+    auto privateEvpPKey = OSSL_NEW(EVP_PKEY);
+    OSSLCALL(EVP_PKEY_set1_RSA(privateEvpPKey.get(), rsaPrivateKey.get()));
+    kj::Own<RSA> rsaPublicKey = OSSLCALL_OWN(RSA, RSAPublicKey_dup(rsaPrivateKey.get()),
+        InternalDOMOperationError, "Error finalizing RSA keygen", internalDescribeOpensslErrors());
+    auto publicEvpPKey = OSSL_NEW(EVP_PKEY);
+    OSSLCALL(EVP_PKEY_set1_RSA(publicEvpPKey.get(), rsaPublicKey));
+    return GeneratedRsaKeys { kj::mv(privateEvpPKey), kj::mv(publicEvpPKey) };
+  }).then(js, [normalizedName, keyAlgorithm = kj::mv(keyAlgorithm), extractable, usages]
+              (jsg::Lock& js, GeneratedRsaKeys keys) mutable
+              -> kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair> {
+    return generateRsaPair(normalizedName, kj::mv(keys.privateKey), kj::mv(keys.publicKey),
+        kj::mv(keyAlgorithm), extractable, usages);
+  });
 }
 
 kj::Own<EVP_PKEY> rsaJwkReader(SubtleCrypto::JsonWebKey&& keyDataJwk) {
@@ -1833,7 +1892,7 @@ kj::Own<EVP_PKEY> ellipticJwkReader(int curveId, SubtleCrypto::JsonWebKey&& keyD
   return evpPkey;
 }
 
-kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair> CryptoKey::Impl::generateEcdsa(
+jsg::Promise<kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair>> CryptoKey::Impl::generateEcdsa(
     jsg::Lock& js, kj::StringPtr normalizedName,
     SubtleCrypto::GenerateKeyAlgorithm&& algorithm, bool extractable,
     kj::ArrayPtr<const kj::String> keyUsages) {
@@ -1843,8 +1902,8 @@ kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair> CryptoKey::Impl::generateEcdsa(
   auto privateKeyUsages = usages & CryptoKeyUsageSet::privateKeyMask();
   auto publicKeyUsages = usages & CryptoKeyUsageSet::publicKeyMask();
 
-  return EllipticKey::generateElliptic(normalizedName, kj::mv(algorithm), extractable,
-      privateKeyUsages, publicKeyUsages);
+  return js.resolvedPromise(EllipticKey::generateElliptic(normalizedName, kj::mv(algorithm),
+      extractable, privateKeyUsages, publicKeyUsages));
 }
 
 kj::Own<CryptoKey::Impl> CryptoKey::Impl::importEcdsa(
@@ -1890,14 +1949,15 @@ kj::Own<CryptoKey::Impl> CryptoKey::Impl::importEcdsa(
                                usages);
 }
 
-kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair> CryptoKey::Impl::generateEcdh(
+jsg::Promise<kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair>> CryptoKey::Impl::generateEcdh(
     jsg::Lock& js, kj::StringPtr normalizedName,
     SubtleCrypto::GenerateKeyAlgorithm&& algorithm, bool extractable,
     kj::ArrayPtr<const kj::String> keyUsages) {
   auto usages =
       CryptoKeyUsageSet::validate(normalizedName, CryptoKeyUsageSet::Context::generate, keyUsages,
                                   CryptoKeyUsageSet::derivationKeyMask());
-  return EllipticKey::generateElliptic(normalizedName, kj::mv(algorithm), extractable, usages, {});
+  return js.resolvedPromise(EllipticKey::generateElliptic(
+      normalizedName, kj::mv(algorithm), extractable, usages, {}));
 }
 
 kj::Own<CryptoKey::Impl> CryptoKey::Impl::importEcdh(
@@ -2254,7 +2314,7 @@ kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair> EdDsaKeyBase::generateKey(
 
 }  // namespace
 
-kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair> CryptoKey::Impl::generateEddsa(
+jsg::Promise<kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair>> CryptoKey::Impl::generateEddsa(
     jsg::Lock& js, kj::StringPtr normalizedName,
     SubtleCrypto::GenerateKeyAlgorithm&& algorithm, bool extractable,
     kj::ArrayPtr<const kj::String> keyUsages) {
@@ -2273,8 +2333,9 @@ kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair> CryptoKey::Impl::generateEddsa(
         "EDDSA curve \"", namedCurve, "\" isn't supported.");
   }
 
-  return EdDsaKey::generateKey(normalizedName, normalizedName == "X25519" ? NID_X25519 :
-                               NID_ED25519, privateKeyUsages, publicKeyUsages, extractable);
+  return js.resolvedPromise(EdDsaKey::generateKey(normalizedName,
+      normalizedName == "X25519" ? NID_X25519 : NID_ED25519,
+      privateKeyUsages, publicKeyUsages, extractable));
 }
 
 kj::Own<CryptoKey::Impl> CryptoKey::Impl::importEddsa(
@@ -111,7 +111,7 @@ void zeroOutTrailingKeyBits(kj::Array<kj::byte>& keyDataArray, int keyBitLength)
 
 }  // namespace
 
-kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair> CryptoKey::Impl::generateHmac(
+jsg::Promise<kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair>> CryptoKey::Impl::generateHmac(
       jsg::Lock& js, kj::StringPtr normalizedName,
       SubtleCrypto::GenerateKeyAlgorithm&& algorithm, bool extractable,
       kj::ArrayPtr<const kj::String> keyUsages) {
@@ -137,8 +137,9 @@ kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair> CryptoKey::Impl::generateHmac(
   auto keyAlgorithm = CryptoKey::HmacKeyAlgorithm{normalizedName, {normalizedHashName},
                                                   static_cast<uint16_t>(length)};
 
-  return jsg::alloc<CryptoKey>(kj::heap<HmacKey>(kj::mv(keyDataArray),
-      kj::mv(keyAlgorithm), extractable, usages));
+  return js.resolvedPromise<kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair>>(
+      jsg::alloc<CryptoKey>(kj::heap<HmacKey>(kj::mv(keyDataArray),
+          kj::mv(keyAlgorithm), extractable, usages)));
 }
 
 kj::Own<CryptoKey::Impl> CryptoKey::Impl::importHmac(
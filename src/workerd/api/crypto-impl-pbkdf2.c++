@@ -16,9 +16,15 @@ public:
         keyData(kj::mv(keyData)), keyAlgorithm(kj::mv(keyAlgorithm)) {}
 
 private:
-  kj::Array<kj::byte> deriveBits(
-      SubtleCrypto::DeriveKeyAlgorithm&& algorithm,
-      kj::Maybe<uint32_t> maybeLength) const override {
+  struct DeriveParams {
+    const EVP_MD* hashType;
+    kj::ArrayPtr<kj::byte> salt;
+    int iterations;
+    uint32_t length;
+  };
+
+  DeriveParams validateDeriveParams(
+      const SubtleCrypto::DeriveKeyAlgorithm& algorithm, kj::Maybe<uint32_t> maybeLength) const {
     kj::StringPtr hashName = api::getAlgorithmName(JSG_REQUIRE_NONNULL(algorithm.hash, TypeError,
         "Missing field \"hash\" in \"algorithm\"."));
     auto hashType = lookupDigestAlgorithm(hashName).second;
@@ -45,6 +51,11 @@ private:
     JSG_REQUIRE(iterations <= 100000, DOMNotSupportedError,
         "PBKDF2 iteration counts above 100000 are not supported (requested ", iterations, ").");
 
+    return { hashType, salt, iterations, length };
+  }
+
+  static kj::Array<kj::byte> derive(kj::ArrayPtr<const kj::byte> keyData,
+      kj::ArrayPtr<const kj::byte> salt, int iterations, const EVP_MD* hashType, uint32_t length) {
     auto output = kj::heapArray<kj::byte>(length / 8);
     OSSLCALL(PKCS5_PBKDF2_HMAC(keyData.asChars().begin(), keyData.size(),
                                salt.begin(), salt.size(),
@@ -52,6 +63,27 @@ private:
     return kj::mv(output);
   }
 
+  kj::Array<kj::byte> deriveBits(
+      SubtleCrypto::DeriveKeyAlgorithm&& algorithm,
+      kj::Maybe<uint32_t> maybeLength) const override {
+    auto params = validateDeriveParams(algorithm, maybeLength);
+    return derive(keyData, params.salt, params.iterations, params.hashType, params.length);
+  }
+
+  jsg::Promise<kj::Array<kj::byte>> deriveBitsAsync(jsg::Lock& js,
+      SubtleCrypto::DeriveKeyAlgorithm&& algorithm,
+      kj::Maybe<uint32_t> maybeLength) const override {
+    auto params = validateDeriveParams(algorithm, maybeLength);
+    // A hundred thousand iterations take long enough to stall the isolate, so run them
+    // off-thread, on copies of the key and salt.
+    return runOffThread(js, [keyData = kj::heapArray<kj::byte>(keyData),
+                             salt = kj::heapArray<kj::byte>(params.salt),
+                             iterations = params.iterations, hashType = params.hashType,
+                             length = params.length]() {
+      return derive(keyData, salt, iterations, hashType, length);
+    });
+  }
+
   // TODO(bug): Possibly by mistake, PBKDF2 was historically not on the allow list of
   //   algorithms in exportKey(). Later, the allow list was removed, instead assuming that any
   //   alogorithm which implemented this method must be allowed. To maintain exactly the
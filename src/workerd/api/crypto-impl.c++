@@ -10,6 +10,7 @@
 #include <openssl/ec.h>
 #include <openssl/rsa.h>
 #include <openssl/crypto.h>
+#include <thread>
 
 namespace workerd::api {
 namespace {
@@ -173,6 +174,16 @@ kj::String internalDescribeOpensslErrors() {
   return errorsToString(consumeAllOpensslErrors().releaseAsArray(), "."_kj);
 }
 
+ThreadPool& getCryptoThreadPool() {
+  // A handful of threads is enough to keep slow operations from queueing behind each other
+  // without letting crypto crowd out the isolate threads. Deliberately never destroyed, so that
+  // exit doesn't wait on (or race with OpenSSL's cleanup against) an operation in progress.
+  static ThreadPool& pool = *new ThreadPool({
+    .threadCount = kj::max(1u, kj::min(std::thread::hardware_concurrency(), 4u)),
+  });
+  return pool;
+}
+
 std::pair<kj::StringPtr, const EVP_MD*> lookupDigestAlgorithm(kj::StringPtr algorithm) {
   static const std::map<kj::StringPtr, const EVP_MD*, CiLess> registeredAlgorithms{
     {"SHA-1", EVP_sha1()},
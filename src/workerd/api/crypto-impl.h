@@ -9,9 +9,12 @@
 
 #include "crypto.h"
 #include <workerd/api/util.h>
+#include <workerd/io/io-context.h>
+#include <workerd/util/thread-pool.h>
 #include <kj/encoding.h>
 #include <openssl/evp.h>
 #include <openssl/bio.h>
+#include <openssl/err.h>
 
 // Wrap calls to OpenSSL's EVP_* interface (and similar APIs) in this macro to
 // deal with errors.
@@ -114,7 +117,8 @@ public:
   static ImportFunc importEddsa;
   static ImportFunc importRsaRaw;
 
-  using GenerateFunc = kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair>(
+  // Returns a promise because generating some keys (RSA) is slow enough to be done off-thread.
+  using GenerateFunc = jsg::Promise<kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair>>(
       jsg::Lock& js, kj::StringPtr normalizedName,
       SubtleCrypto::GenerateKeyAlgorithm&& algorithm, bool extractable,
       kj::ArrayPtr<const kj::String> keyUsages);
@@ -144,12 +148,42 @@ public:
         getAlgorithmName(), "\".");
   }
 
+  // Incremental form of encrypt() / decrypt(), used by EncryptionStream and DecryptionStream.
+  // Feeding a message through update() in any number of pieces and then calling finish() produces
+  // the same bytes, in total, as a single encrypt() / decrypt() call over the whole message.
+  class Cipher {
+  public:
+    virtual ~Cipher() noexcept(false) {}
+
+    // Returns whatever output is ready. This may be shorter or longer than `input`, since block
+    // modes buffer partial blocks and authenticated modes hold back what might be the tag.
+    virtual kj::Array<kj::byte> update(kj::ArrayPtr<const kj::byte> input) = 0;
+
+    // Returns the remaining output. Throws if decryption or authentication fails.
+    virtual kj::Array<kj::byte> finish() = 0;
+  };
+
+  virtual kj::Own<Cipher> newEncryptCipher(SubtleCrypto::EncryptAlgorithm&& algorithm) const {
+    JSG_FAIL_REQUIRE(DOMNotSupportedError, "Streaming encryption is not implemented for \"",
+        getAlgorithmName(), "\".");
+  }
+  virtual kj::Own<Cipher> newDecryptCipher(SubtleCrypto::EncryptAlgorithm&& algorithm) const {
+    JSG_FAIL_REQUIRE(DOMNotSupportedError, "Streaming decryption is not implemented for \"",
+        getAlgorithmName(), "\".");
+  }
+
   virtual kj::Array<kj::byte> sign(
       SubtleCrypto::SignAlgorithm&& algorithm,
       kj::ArrayPtr<const kj::byte> data) const {
     JSG_FAIL_REQUIRE(DOMNotSupportedError, "The sign operation is not implemented for \"",
         getAlgorithmName(), "\".");
   }
+  // Like sign(), but for keys whose signing is expensive enough (RSA) that it runs off-thread
+  // with runOffThread(). `data` is owned so that it can be handed to another thread.
+  virtual jsg::Promise<kj::Array<kj::byte>> signAsync(jsg::Lock& js,
+      SubtleCrypto::SignAlgorithm&& algorithm, kj::Array<const kj::byte> data) const {
+    return js.resolvedPromise(sign(kj::mv(algorithm), data));
+  }
   virtual bool verify(
       SubtleCrypto::SignAlgorithm&& algorithm, kj::ArrayPtr<const kj::byte> signature,
       kj::ArrayPtr<const kj::byte> data) const {
@@ -163,6 +197,12 @@ public:
         "The deriveKey and deriveBits operations are not implemented for \"",
         getAlgorithmName(), "\".");
   }
+  // Like deriveBits(), but for keys whose derivation is expensive enough (PBKDF2) that it runs
+  // off-thread with runOffThread().
+  virtual jsg::Promise<kj::Array<kj::byte>> deriveBitsAsync(jsg::Lock& js,
+      SubtleCrypto::DeriveKeyAlgorithm&& algorithm, kj::Maybe<uint32_t> length) const {
+    return js.resolvedPromise(deriveBits(kj::mv(algorithm), length));
+  }
 
   virtual kj::Array<kj::byte> wrapKey(SubtleCrypto::EncryptAlgorithm&& algorithm,
       kj::ArrayPtr<const kj::byte> unwrappedKey) const {
@@ -315,6 +355,83 @@ static inline T integerCeilDivision(T a, T b) {
   return a == 0 ? 0 : 1 + (a - 1) / b;
 }
 
+// The pool that runOffThread() uses, shared by every isolate in the process.
+ThreadPool& getCryptoThreadPool();
+
+// How many runOffThread() operations one request may have on the pool at once. Any more run
+// synchronously, so that a request issuing many of them can't keep the pool to itself.
+constexpr uint MAX_OFF_THREAD_OPERATIONS_PER_REQUEST = 2;
+
+// Runs `func` on the crypto thread pool, so that a slow operation (PBKDF2, RSA key generation and
+// signing) doesn't hold the isolate lock and stall every other request on the isolate, and
+// resolves with its result back under the lock. The thread CPU time `func` consumes is charged to
+// the current request's limits. When the request already has MAX_OFF_THREAD_OPERATIONS_PER_REQUEST
+// operations in flight, or the pool's queue is full, `func` runs synchronously instead, where its
+// time is counted like any other JavaScript execution.
+//
+// `func` runs without the isolate lock and may outlive the call that started it, so it must own
+// copies of everything it uses: no references to keys, algorithm structs or JavaScript buffers.
+// It must validate nothing that depends on the lock; do that before calling runOffThread().
+//
+// In a Durable Object the wait holds the input lock, so no other event is delivered to the object
+// until the result is back, exactly as if `func` had run synchronously. Only other isolates and
+// other objects' requests get to use the thread in the meantime; the object's own ordering
+// guarantees are unchanged.
+//
+// Outside of a request (e.g. at startup) `func` just runs synchronously.
+template <typename Func, typename T = kj::_::ReturnType<Func, void>>
+jsg::Promise<T> runOffThread(jsg::Lock& js, Func&& func) {
+  if (!IoContext::hasCurrent()) {
+    return js.evalNow([&]() { return func(); });
+  }
+
+  auto& context = IoContext::current();
+  kj::Own<void> slot;
+  KJ_IF_MAYBE(claimed, context.tryClaimOffThreadSlot(MAX_OFF_THREAD_OPERATIONS_PER_REQUEST)) {
+    slot = kj::mv(*claimed);
+  } else {
+    return js.evalNow([&]() { return func(); });
+  }
+
+  struct Outcome {
+    kj::Maybe<T> value;
+    kj::Maybe<kj::Exception> exception;
+
+    // Null if `func` ran inline, in which case the caller's own CPU accounting already saw it.
+    kj::Maybe<kj::Duration> offThreadCpuTime;
+  };
+
+  auto promise = getCryptoThreadPool().run([func = kj::fwd<Func>(func)]() mutable {
+    // Each thread has its own OpenSSL error queue; leave the pool's threads' queues empty.
+    ClearErrorOnReturn clearErrors;
+    Outcome outcome;
+    auto start = threadCpuTime();
+    KJ_IF_MAYBE(exception, kj::runCatchingExceptions([&]() { outcome.value = func(); })) {
+      outcome.exception = kj::mv(*exception);
+    }
+    if (ThreadPool::onPoolThread()) {
+      outcome.offThreadCpuTime = threadCpuTime() - start;
+    }
+    return outcome;
+  }).attach(kj::mv(slot));
+
+  auto finish = [](jsg::Lock&, Outcome outcome) {
+    KJ_IF_MAYBE(cpuTime, outcome.offThreadCpuTime) {
+      IoContext::current().getLimitEnforcer().chargeCpuTime(*cpuTime);
+    }
+    KJ_IF_MAYBE(exception, outcome.exception) {
+      kj::throwFatalException(kj::mv(*exception));
+    }
+    return kj::mv(KJ_ASSERT_NONNULL(outcome.value));
+  };
+
+  if (context.getActor() != nullptr) {
+    return context.awaitIoWithInputLock(js, kj::mv(promise), kj::mv(finish));
+  } else {
+    return context.awaitIo(js, kj::mv(promise), kj::mv(finish));
+  }
+}
+
 kj::Own<EVP_PKEY> ellipticJwkReader(int curveId, SubtleCrypto::JsonWebKey&& keyDataJwk);
 kj::Own<EVP_PKEY> rsaJwkReader(SubtleCrypto::JsonWebKey&& keyDataJwk);
 
@@ -0,0 +1,45 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+import * as assert from 'node:assert'
+
+async function derive() {
+  const key = await crypto.subtle.importKey(
+      "raw", new TextEncoder().encode("password"), "PBKDF2", false, ["deriveBits"]);
+  return crypto.subtle.deriveBits(
+      { name: "PBKDF2", hash: "SHA-256", salt: new Uint8Array(16), iterations: 100000 },
+      key, 256);
+}
+
+export class DurableObjectExample {
+  constructor(state, env) {
+    this.status = "idle";
+  }
+
+  async fetch(request) {
+    if (new URL(request.url).pathname == "/derive") {
+      // PBKDF2 runs on the crypto thread pool. The input gate must stay closed meanwhile, so the
+      // request below can't observe the intermediate state.
+      this.status = "deriving";
+      const bits = await derive();
+      assert.equal(bits.byteLength, 32);
+      this.status = "done";
+    }
+    return new Response(this.status);
+  }
+}
+
+export default {
+  async test(ctrl, env, ctx) {
+    let obj = env.ns.get(env.ns.idFromName("A"));
+    let first = obj.fetch("http://foo/derive");
+    let second = obj.fetch("http://foo/status");
+
+    assert.equal(await (await first).text(), "done");
+    assert.equal(await (await second).text(), "done");
+
+    // Outside of a Durable Object the result is the same.
+    assert.deepEqual(new Uint8Array(await derive()), new Uint8Array(await derive()));
+  }
+}
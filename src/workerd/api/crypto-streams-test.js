@@ -0,0 +1,70 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+import * as assert from 'node:assert';
+
+// Writes `data` to `stream` in pieces of `chunkSize` bytes and returns everything it outputs.
+async function pipe(stream, data, chunkSize) {
+  const writer = stream.writable.getWriter();
+  const written = (async () => {
+    for (let i = 0; i < data.byteLength; i += chunkSize) {
+      await writer.write(data.subarray(i, i + chunkSize));
+    }
+    await writer.close();
+  })();
+  const [output] = await Promise.all([new Response(stream.readable).arrayBuffer(), written]);
+  return new Uint8Array(output);
+}
+
+function makeInput(size) {
+  const input = new Uint8Array(size);
+  for (let i = 0; i < size; i++) input[i] = (i * 7) % 251;
+  return input;
+}
+
+export const encryptionStreamMatchesSubtle = {
+  async test() {
+    for (const name of ['AES-GCM', 'AES-CBC']) {
+      const key = await crypto.subtle.importKey(
+          'raw', new Uint8Array(32), name, false, ['encrypt', 'decrypt']);
+      const algorithm = { name, iv: new Uint8Array(16) };
+      for (const size of [0, 15, 1000]) {
+        const input = makeInput(size);
+        const expected = new Uint8Array(await crypto.subtle.encrypt(algorithm, key, input));
+        const cipherText = await pipe(new crypto.EncryptionStream(algorithm, key), input, 7);
+        assert.deepStrictEqual(cipherText, expected, `${name} ${size}`);
+      }
+    }
+  }
+};
+
+export const decryptionStreamRoundTripsCbc = {
+  async test() {
+    const key = await crypto.subtle.importKey(
+        'raw', new Uint8Array(32), 'AES-CBC', false, ['encrypt', 'decrypt']);
+    const algorithm = { name: 'AES-CBC', iv: new Uint8Array(16) };
+    const input = makeInput(1000);
+    const cipherText = new Uint8Array(await crypto.subtle.encrypt(algorithm, key, input));
+
+    const plainText = await pipe(new crypto.DecryptionStream(algorithm, key), cipherText, 33);
+    assert.deepStrictEqual(plainText, input);
+
+    // Ciphertext that isn't a whole number of blocks errors the stream once it ends.
+    await assert.rejects(
+        pipe(new crypto.DecryptionStream(algorithm, key), cipherText.subarray(1), 33),
+        { name: 'OperationError' });
+  }
+};
+
+export const decryptionStreamRejectsGcm = {
+  async test() {
+    const key = await crypto.subtle.importKey(
+        'raw', new Uint8Array(32), 'AES-GCM', false, ['encrypt', 'decrypt']);
+    const algorithm = { name: 'AES-GCM', iv: new Uint8Array(12) };
+    assert.throws(() => new crypto.DecryptionStream(algorithm, key), {
+      name: 'NotSupportedError',
+      message: /AES-GCM cannot be decrypted as a stream/,
+    });
+  }
+};
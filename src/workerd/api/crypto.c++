@@ -9,6 +9,7 @@
 #include <openssl/err.h>
 #include <workerd/jsg/jsg.h>
 #include "util.h"
+#include "streams/internal.h"
 #include <workerd/io/io-context.h>
 #include <workerd/util/uuid.h>
 #include <set>
@@ -334,7 +335,7 @@ jsg::Promise<kj::Array<kj::byte>> SubtleCrypto::sign(
 
   return js.evalNow([&] {
     validateOperation(key, algorithm.name, CryptoKeyUsageSet::sign());
-    return key.impl->sign(kj::mv(algorithm), data);
+    return key.impl->signAsync(js, kj::mv(algorithm), kj::mv(data));
   });
 }
 
@@ -393,22 +394,24 @@ jsg::Promise<kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair>> SubtleCrypto::genera
     JSG_REQUIRE(algoImpl.generateFunc != nullptr, DOMNotSupportedError,
         "Unrecognized key generation algorithm \"", algorithm.name, "\" requested.");
 
-    auto cryptoKeyOrPair = algoImpl.generateFunc(js, algoImpl.name, kj::mv(algorithm), extractable,
-                                                 keyUsages);
-    KJ_SWITCH_ONEOF(cryptoKeyOrPair) {
-      KJ_CASE_ONEOF(cryptoKey, jsg::Ref<CryptoKey>) {
-        if (keyUsages.size() == 0) {
-          auto type = cryptoKey->getType();
-          JSG_REQUIRE(type != "secret" && type != "private", DOMSyntaxError,
-              "Secret/private CryptoKeys must have at least one usage.");
+    return algoImpl.generateFunc(js, algoImpl.name, kj::mv(algorithm), extractable, keyUsages)
+        .then(js, [usageCount = keyUsages.size()](jsg::Lock& js,
+            kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair> cryptoKeyOrPair) {
+      KJ_SWITCH_ONEOF(cryptoKeyOrPair) {
+        KJ_CASE_ONEOF(cryptoKey, jsg::Ref<CryptoKey>) {
+          if (usageCount == 0) {
+            auto type = cryptoKey->getType();
+            JSG_REQUIRE(type != "secret" && type != "private", DOMSyntaxError,
+                "Secret/private CryptoKeys must have at least one usage.");
+          }
+        }
+        KJ_CASE_ONEOF(keyPair, CryptoKeyPair) {
+          JSG_REQUIRE(keyPair.privateKey->getUsageSet().size() != 0, DOMSyntaxError,
+            "Attempt to generate asymmetric keys with no valid private key usages.");
         }
       }
-      KJ_CASE_ONEOF(keyPair, CryptoKeyPair) {
-        JSG_REQUIRE(keyPair.privateKey->getUsageSet().size() != 0, DOMSyntaxError,
-          "Attempt to generate asymmetric keys with no valid private key usages.");
-      }
-    }
-    return cryptoKeyOrPair;
+      return kj::mv(cryptoKeyOrPair);
+    });
   });
 }
 
@@ -429,13 +432,16 @@ jsg::Promise<jsg::Ref<CryptoKey>> SubtleCrypto::deriveKey(
 
     auto length = getKeyLength(derivedKeyAlgorithm);
 
-    auto secret = baseKey.impl->deriveBits(kj::mv(algorithm), length);
-
-    // TODO(perf): For conformance, importKey() makes a copy of `secret`. In this case we really
-    //   don't need to, but rather we ought to call the appropriate CryptoKey::Impl::import*()
-    //   function directly.
-    return importKeySync(
-        js, "raw", kj::mv(secret), kj::mv(derivedKeyAlgorithm), extractable, kj::mv(keyUsages));
+    return baseKey.impl->deriveBitsAsync(js, kj::mv(algorithm), length)
+        .then(js, [self = JSG_THIS, derivedKeyAlgorithm = kj::mv(derivedKeyAlgorithm),
+                   extractable, keyUsages = kj::mv(keyUsages)]
+                  (jsg::Lock& js, kj::Array<kj::byte> secret) mutable {
+      // TODO(perf): For conformance, importKey() makes a copy of `secret`. In this case we really
+      //   don't need to, but rather we ought to call the appropriate CryptoKey::Impl::import*()
+      //   function directly.
+      return self->importKeySync(
+          js, "raw", kj::mv(secret), kj::mv(derivedKeyAlgorithm), extractable, keyUsages);
+    });
   });
 }
 
@@ -456,7 +462,7 @@ jsg::Promise<kj::Array<kj::byte>> SubtleCrypto::deriveBits(
 
   return js.evalNow([&] {
     validateOperation(baseKey, algorithm.name, CryptoKeyUsageSet::deriveBits());
-    return baseKey.impl->deriveBits(kj::mv(algorithm), length);
+    return baseKey.impl->deriveBitsAsync(js, kj::mv(algorithm), length);
   });
 }
 
@@ -752,4 +758,108 @@ jsg::Ref<DigestStream> DigestStream::constructor(jsg::Lock& js, Algorithm algori
       kj::mv(jsPromise));
 }
 
+// =======================================================================================
+// EncryptionStream / DecryptionStream
+
+namespace {
+
+// Runs everything written through a CryptoKey::Impl::Cipher and forwards the output to `inner`,
+// the writable end of an identity transform whose readable end is exposed to JavaScript. Each
+// chunk is encrypted or decrypted into one buffer that is then handed to the reader.
+class CipherStreamSink final: public WritableStreamSink {
+public:
+  CipherStreamSink(kj::Own<CryptoKey::Impl::Cipher> cipher, kj::Own<WritableStreamSink> inner)
+      : cipher(kj::mv(cipher)), inner(kj::mv(inner)) {}
+
+  kj::Promise<void> write(const void* buffer, size_t size) override {
+    kj::Array<kj::byte> output;
+    KJ_IF_MAYBE(exception, kj::runCatchingExceptions([&]() {
+      output = cipher->update(kj::arrayPtr(static_cast<const kj::byte*>(buffer), size));
+    })) {
+      return fail(kj::mv(*exception));
+    }
+    if (output.size() == 0) return kj::READY_NOW;
+    auto promise = inner->write(output.begin(), output.size());
+    return promise.attach(kj::mv(output));
+  }
+
+  kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const byte>> pieces) override {
+    kj::Vector<kj::Array<kj::byte>> outputs(pieces.size());
+    KJ_IF_MAYBE(exception, kj::runCatchingExceptions([&]() {
+      for (auto& piece: pieces) {
+        auto output = cipher->update(piece);
+        if (output.size() > 0) outputs.add(kj::mv(output));
+      }
+    })) {
+      return fail(kj::mv(*exception));
+    }
+    if (outputs.empty()) return kj::READY_NOW;
+    auto ptrs = KJ_MAP(output, outputs) -> kj::ArrayPtr<const kj::byte> { return output; };
+    auto promise = inner->write(ptrs);
+    return promise.attach(kj::mv(outputs), kj::mv(ptrs));
+  }
+
+  kj::Promise<void> end() override {
+    kj::Array<kj::byte> output;
+    KJ_IF_MAYBE(exception, kj::runCatchingExceptions([&]() {
+      output = cipher->finish();
+    })) {
+      return fail(kj::mv(*exception));
+    }
+    if (output.size() == 0) return inner->end();
+    auto promise = inner->write(output.begin(), output.size());
+    return promise.attach(kj::mv(output)).then([this]() { return inner->end(); });
+  }
+
+  void abort(kj::Exception reason) override {
+    inner->abort(kj::mv(reason));
+  }
+
+private:
+  kj::Own<CryptoKey::Impl::Cipher> cipher;
+  kj::Own<WritableStreamSink> inner;
+
+  // Errors the readable side as well, so that whoever is reading sees why the stream stopped.
+  kj::Promise<void> fail(kj::Exception exception) {
+    inner->abort(kj::cp(exception));
+    return kj::mv(exception);
+  }
+};
+
+template <typename T>
+jsg::Ref<T> newCipherStream(kj::Own<CryptoKey::Impl::Cipher> cipher) {
+  auto readableSide = kj::refcounted<IdentityTransformStreamImpl>();
+  auto writableSide = kj::heap<CipherStreamSink>(kj::mv(cipher), kj::addRef(*readableSide));
+
+  auto& ioContext = IoContext::current();
+
+  return jsg::alloc<T>(
+      jsg::alloc<ReadableStream>(ioContext, kj::mv(readableSide)),
+      jsg::alloc<WritableStream>(ioContext, kj::mv(writableSide)));
+}
+
+}  // namespace
+
+jsg::Ref<EncryptionStream> EncryptionStream::constructor(jsg::Lock& js,
+    kj::OneOf<kj::String, SubtleCrypto::EncryptAlgorithm> algorithmParam,
+    jsg::Ref<CryptoKey> key) {
+  auto algorithm = interpretAlgorithmParam(kj::mv(algorithmParam));
+
+  auto checkErrorsOnFinish = webCryptoOperationBegin(__func__, algorithm);
+
+  validateOperation(*key, algorithm.name, CryptoKeyUsageSet::encrypt());
+  return newCipherStream<EncryptionStream>(key->impl->newEncryptCipher(kj::mv(algorithm)));
+}
+
+jsg::Ref<DecryptionStream> DecryptionStream::constructor(jsg::Lock& js,
+    kj::OneOf<kj::String, SubtleCrypto::EncryptAlgorithm> algorithmParam,
+    jsg::Ref<CryptoKey> key) {
+  auto algorithm = interpretAlgorithmParam(kj::mv(algorithmParam));
+
+  auto checkErrorsOnFinish = webCryptoOperationBegin(__func__, algorithm);
+
+  validateOperation(*key, algorithm.name, CryptoKeyUsageSet::decrypt());
+  return newCipherStream<DecryptionStream>(key->impl->newDecryptCipher(kj::mv(algorithm)));
+}
+
 }  // namespace workerd::api
@@ -259,6 +259,8 @@ private:
   kj::Own<Impl> impl;
 
   friend class SubtleCrypto;
+  friend class EncryptionStream;
+  friend class DecryptionStream;
   friend class EllipticKey;
   friend class EdDsaKeyBase;
   friend class node::CryptoImpl;
@@ -637,6 +639,45 @@ private:
   }
 };
 
+// EncryptionStream and DecryptionStream are non-standard extensions that apply an AES CryptoKey to
+// streaming data, in the same way that CompressionStream applies a compression format. The bytes
+// read from the readable side are the same as the result of a single crypto.subtle.encrypt() /
+// decrypt() call over everything written, but large bodies don't need to be buffered in full
+// first.
+//
+// EncryptionStream supports AES-GCM and AES-CBC. DecryptionStream supports only AES-CBC: an AES-GCM
+// tag can't be checked until the whole ciphertext has been written, and a stream would have to
+// emit plaintext before then. Constructing one for AES-GCM throws a NotSupportedError.
+class EncryptionStream: public TransformStream {
+public:
+  using TransformStream::TransformStream;
+
+  static jsg::Ref<EncryptionStream> constructor(jsg::Lock& js,
+      kj::OneOf<kj::String, SubtleCrypto::EncryptAlgorithm> algorithm,
+      jsg::Ref<CryptoKey> key);
+
+  JSG_RESOURCE_TYPE(EncryptionStream) {
+    JSG_INHERIT(TransformStream);
+
+    JSG_TS_OVERRIDE(extends TransformStream<ArrayBuffer | ArrayBufferView, Uint8Array>);
+  }
+};
+
+class DecryptionStream: public TransformStream {
+public:
+  using TransformStream::TransformStream;
+
+  static jsg::Ref<DecryptionStream> constructor(jsg::Lock& js,
+      kj::OneOf<kj::String, SubtleCrypto::EncryptAlgorithm> algorithm,
+      jsg::Ref<CryptoKey> key);
+
+  JSG_RESOURCE_TYPE(DecryptionStream) {
+    JSG_INHERIT(TransformStream);
+
+    JSG_TS_OVERRIDE(extends TransformStream<ArrayBuffer | ArrayBufferView, Uint8Array>);
+  }
+};
+
 // =======================================================================================
 // Crypto
 
@@ -662,6 +703,8 @@ public:
     JSG_METHOD(randomUUID);
 
     JSG_NESTED_TYPE(DigestStream);
+    JSG_NESTED_TYPE(EncryptionStream);
+    JSG_NESTED_TYPE(DecryptionStream);
 
     JSG_TS_OVERRIDE({
       getRandomValues<
@@ -702,6 +745,8 @@ private:
   api::CryptoKey::EllipticKeyAlgorithm,               \
   api::CryptoKey::ArbitraryKeyAlgorithm,              \
   api::CryptoKey::AsymmetricKeyDetails,               \
-  api::DigestStream
+  api::DigestStream,                                  \
+  api::EncryptionStream,                              \
+  api::DecryptionStream
 
 }  // namespace workerd::api
@@ -12,6 +12,7 @@
 #include <workerd/io/io-context.h>
 #include <kj/encoding.h>
 #include <kj/compat/http.h>
+#include <kj/table.h>
 
 namespace workerd::api {
 
@@ -63,6 +64,134 @@ static void parseListMetadata(jsg::Lock& js,
 
 constexpr auto FLPROD_405_HEADER = "CF-KV-FLPROD-405"_kj;
 
+// Keeps the results of get()s that specified `cacheTtl`. A later get() for the same key is served
+// from memory if the entry was fetched within that get()'s own `cacheTtl`, which is the same
+// staleness the caller already accepts from KV's edge caches. Writes made through the binding
+// invalidate the key immediately; writes made elsewhere become visible once the entry is older
+// than the reader's `cacheTtl`.
+//
+// Only values that get() buffers anyway ("text", "arrayBuffer" and "json") are cached. Entries are
+// evicted oldest-first to stay within MAX_ENTRIES and MAX_BYTES.
+class KvNamespace::ReadCache {
+public:
+  static constexpr size_t MAX_ENTRIES = 1000;
+  static constexpr size_t MAX_BYTES = 4 * 1024 * 1024;
+  // Larger values are never cached, so that one big value can't flush everything else.
+  static constexpr size_t MAX_ENTRY_BYTES = 256 * 1024;
+
+  static bool canCache(kj::StringPtr type) {
+    return type == "text" || type == "arrayBuffer" || type == "json";
+  }
+
+  struct Entry {
+    kj::String key;
+    // Null if the key was not found.
+    kj::Maybe<kj::Array<byte>> value;
+    kj::Maybe<kj::String> metadata;
+    kj::Date fetchedAt;
+
+    size_t size() const {
+      size_t result = key.size();
+      KJ_IF_MAYBE(v, value) { result += v->size(); }
+      KJ_IF_MAYBE(m, metadata) { result += m->size(); }
+      return result;
+    }
+  };
+
+  // Identifies a read that missed the cache, so that its result can be added to the cache when it
+  // arrives unless a write has happened in the meantime.
+  struct Ticket {
+    kj::String key;
+    kj::Date requestedAt;
+    uint64_t generation;
+  };
+
+  // Returns the entry for `key` if it was fetched no more than `maxAge` before `now`.
+  kj::Maybe<Entry&> find(kj::StringPtr key, kj::Date now, kj::Duration maxAge) {
+    KJ_IF_MAYBE(entry, entries.find(key)) {
+      if (now - entry->fetchedAt <= maxAge) {
+        return *entry;
+      }
+    }
+    return nullptr;
+  }
+
+  Ticket startFill(kj::StringPtr key, kj::Date now) {
+    return { kj::str(key), now, generation };
+  }
+
+  void fill(Ticket ticket, kj::Maybe<kj::Array<byte>> value, kj::Maybe<kj::String> metadata) {
+    if (ticket.generation != generation) {
+      // A write went through this binding while the read was in flight, so the result may
+      // predate it.
+      return;
+    }
+
+    remove(ticket.key);
+
+    Entry entry { kj::mv(ticket.key), kj::mv(value), kj::mv(metadata), ticket.requestedAt };
+    auto size = entry.size();
+    if (size > MAX_ENTRY_BYTES) return;
+
+    while (entries.size() >= MAX_ENTRIES || totalBytes + size > MAX_BYTES) {
+      auto& oldest = *entries.ordered<kj::InsertionOrderIndex>().begin();
+      totalBytes -= oldest.size();
+      entries.erase(oldest);
+    }
+
+    totalBytes += size;
+    entries.insert(kj::mv(entry));
+  }
+
+  // Called when the binding writes `key`, both before the write is sent and once it completes.
+  void invalidate(kj::StringPtr key) {
+    ++generation;
+    remove(key);
+  }
+
+private:
+  struct EntryCallbacks {
+    kj::StringPtr keyForRow(const Entry& entry) const { return entry.key; }
+    bool matches(const Entry& entry, kj::StringPtr key) const { return entry.key == key; }
+    uint hashCode(kj::StringPtr key) const { return kj::hashCode(key); }
+  };
+
+  kj::Table<Entry, kj::HashIndex<EntryCallbacks>, kj::InsertionOrderIndex> entries {
+    EntryCallbacks(), {}
+  };
+  size_t totalBytes = 0;
+
+  // Incremented by every write, so that fill() can tell whether a write raced with the read.
+  uint64_t generation = 0;
+
+  void remove(kj::StringPtr key) {
+    KJ_IF_MAYBE(entry, entries.find(key)) {
+      totalBytes -= entry->size();
+      entries.erase(*entry);
+    }
+  }
+};
+
+// Converts a value that was read in full into the result type get() was asked for. `type` must be
+// one that ReadCache::canCache() accepts.
+static KvNamespace::GetResult valueToGetResult(
+    jsg::Lock& js, kj::StringPtr type, kj::ArrayPtr<const byte> value) {
+  if (type == "text") {
+    return KvNamespace::GetResult(kj::str(value.asChars()));
+  } else if (type == "arrayBuffer") {
+    return KvNamespace::GetResult(kj::heapArray(value));
+  } else if (type == "json") {
+    return KvNamespace::GetResult(jsg::JsRef(js, jsg::JsValue::fromJson(js, value.asChars())));
+  }
+  KJ_UNREACHABLE;
+}
+
+KvNamespace::KvNamespace(kj::Array<AdditionalHeader> additionalHeaders, uint subrequestChannel)
+    : additionalHeaders(kj::mv(additionalHeaders)), subrequestChannel(subrequestChannel),
+      readCache(kj::heap<ReadCache>()) {}
+
+KvNamespace::~KvNamespace() noexcept(false) {}
+
 kj::Own<kj::HttpClient> KvNamespace::getHttpClient(
     IoContext& context,
     kj::HttpHeaders& headers,
@@ -123,10 +252,11 @@ jsg::Promise<KvNamespace::GetWithMetadataResult> KvNamespace::getWithMetadata(
   kj::Url url;
   url.scheme = kj::str("https");
   url.host = kj::str("fake-host");
-  url.path.add(kj::mv(name));
+  url.path.add(kj::str(name));
   url.query.add(kj::Url::QueryParam { kj::str("urlencoded"), kj::str("true") });
 
   kj::Maybe<kj::String> type;
+  kj::Maybe<kj::Duration> maxCacheAge;
   KJ_IF_MAYBE(oneOfOptions, options) {
     KJ_SWITCH_ONEOF(*oneOfOptions) {
       KJ_CASE_ONEOF(t, kj::String) {
@@ -138,8 +268,38 @@ jsg::Promise<KvNamespace::GetWithMetadataResult> KvNamespace::getWithMetadata(
         }
         KJ_IF_MAYBE(cacheTtl, options.cacheTtl) {
           url.query.add(kj::Url::QueryParam { kj::str("cache_ttl"), kj::str(*cacheTtl) });
+          if (*cacheTtl > 0) {
+            maxCacheAge = *cacheTtl * kj::SECONDS;
+          }
+        }
+      }
+    }
+  }
+
+  auto typeName =
+      type.map([](const kj::String& s) -> kj::StringPtr { return s; })
+          .orDefault("text");
+
+  kj::Maybe<ReadCache::Ticket> cacheTicket;
+  KJ_IF_MAYBE(maxAge, maxCacheAge) {
+    if (ReadCache::canCache(typeName)) {
+      auto now = context.now();
+      KJ_IF_MAYBE(entry, readCache->find(name, now, *maxAge)) {
+        KvNamespace::GetResult value;
+        KJ_IF_MAYBE(v, entry->value) {
+          value = valueToGetResult(js, typeName, *v);
+        }
+        kj::Maybe<jsg::JsRef<jsg::JsValue>> meta;
+        KJ_IF_MAYBE(m, entry->metadata) {
+          meta = jsg::JsRef(js, jsg::JsValue::fromJson(js, *m));
         }
+        return js.resolvedPromise(KvNamespace::GetWithMetadataResult {
+          .value = kj::mv(value),
+          .metadata = kj::mv(meta),
+          .cacheStatus = jsg::JsRef<jsg::JsValue>(js, js.strIntern("HIT"_kj)),
+        });
       }
+      cacheTicket = readCache->startFill(name, now);
     }
   }
 
@@ -151,7 +311,8 @@ jsg::Promise<KvNamespace::GetWithMetadataResult> KvNamespace::getWithMetadata(
   auto request = client->request(kj::HttpMethod::GET, urlStr, headers);
   return context.awaitIo(js,
       kj::mv(request.response),
-      [type = kj::mv(type), &context, client = kj::mv(client)]
+      [type = kj::mv(type), &context, client = kj::mv(client), self = JSG_THIS,
+       cacheTicket = kj::mv(cacheTicket)]
           (jsg::Lock& js, kj::HttpClient::Response&& response) mutable
           -> jsg::Promise<KvNamespace::GetWithMetadataResult> {
 
@@ -161,6 +322,9 @@ jsg::Promise<KvNamespace::GetWithMetadataResult> KvNamespace::getWithMetadata(
         });
 
     if (response.statusCode == 404 || response.statusCode == 410) {
+      KJ_IF_MAYBE(ticket, cacheTicket) {
+        self->readCache->fill(kj::mv(*ticket), nullptr, nullptr);
+      }
       return js.resolvedPromise(KvNamespace::GetWithMetadataResult {
         .value = nullptr,
         .metadata = nullptr,
@@ -187,7 +351,20 @@ jsg::Promise<KvNamespace::GetWithMetadataResult> KvNamespace::getWithMetadata(
 
     jsg::Promise<KvNamespace::GetResult> result = nullptr;
 
-    if (typeName == "stream") {
+    KJ_IF_MAYBE(ticket, cacheTicket) {
+      // Read the raw bytes so that they can be cached, then convert them like the uncached paths
+      // below do.
+      result = context.awaitIo(js,
+          stream->readAllBytes(context.getLimitEnforcer().getBufferingLimit())
+              .attach(kj::mv(stream)),
+          [typeName = kj::str(typeName), self = kj::mv(self), ticket = kj::mv(*ticket),
+           metadata = maybeMeta.map([](kj::String& m) { return kj::str(m); })]
+          (jsg::Lock& js, kj::Array<byte> bytes) mutable {
+        auto result = valueToGetResult(js, typeName, bytes);
+        self->readCache->fill(kj::mv(ticket), kj::mv(bytes), kj::mv(metadata));
+        return result;
+      });
+    } else if (typeName == "stream") {
       result = js.resolvedPromise(KvNamespace::GetResult(
           jsg::alloc<ReadableStream>(context, kj::mv(stream))));
     } else if (typeName == "text") {
@@ -310,13 +487,14 @@ jsg::Promise<void> KvNamespace::put(
     const jsg::TypeHandler<KvNamespace::PutSupportedTypes>& putTypeHandler) {
   return js.evalNow([&] {
     validateKeyName("PUT", name);
+    readCache->invalidate(name);
 
     auto& context = IoContext::current();
 
     kj::Url url;
     url.scheme = kj::str("https");
     url.host = kj::str("fake-host");
-    url.path.add(kj::mv(name));
+    url.path.add(kj::str(name));
     url.query.add(kj::Url::QueryParam { kj::str("urlencoded"), kj::str("true") });
 
     kj::HttpHeaders headers(context.getHeaderTable());
@@ -418,13 +596,19 @@ jsg::Promise<void> KvNamespace::put(
       });
     });
 
-    return context.awaitIo(js, kj::mv(promise));
+    // Invalidate again once the write has landed, in case a read that started after the write
+    // was sent cached the old value.
+    return context.awaitIo(js, kj::mv(promise),
+        [self = JSG_THIS, name = kj::mv(name)](jsg::Lock&) {
+      self->readCache->invalidate(name);
+    });
   });
 }
 
 jsg::Promise<void> KvNamespace::delete_(jsg::Lock& js, kj::String name) {
   return js.evalNow([&] {
     validateKeyName("DELETE", name);
+    readCache->invalidate(name);
 
     auto& context = IoContext::current();
 
@@ -443,7 +627,10 @@ jsg::Promise<void> KvNamespace::delete_(jsg::Lock& js, kj::String name) {
       }).attach(kj::mv(client));
     });
 
-    return context.awaitIo(js, kj::mv(promise));
+    return context.awaitIo(js, kj::mv(promise),
+        [self = JSG_THIS, name = kj::mv(name)](jsg::Lock&) {
+      self->readCache->invalidate(name);
+    });
   });
 }
 
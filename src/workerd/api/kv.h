@@ -22,8 +22,8 @@ public:
   // `subrequestChannel` is what to pass to IoContext::getHttpClient() to get an HttpClient
   // representing this namespace.
   // `additionalHeaders` is what gets appended to every outbound request.
-  explicit KvNamespace(kj::Array<AdditionalHeader> additionalHeaders, uint subrequestChannel)
-      : additionalHeaders(kj::mv(additionalHeaders)), subrequestChannel(subrequestChannel) {}
+  explicit KvNamespace(kj::Array<AdditionalHeader> additionalHeaders, uint subrequestChannel);
+  ~KvNamespace() noexcept(false);
 
   struct GetOptions {
     jsg::Optional<kj::String> type;
@@ -171,6 +171,12 @@ protected:
 private:
   kj::Array<AdditionalHeader> additionalHeaders;
   uint subrequestChannel;
+
+  // Results of recent get()s that specified `cacheTtl`, kept so that hot keys can be served
+  // without a subrequest. A binding object lives as long as its isolate's global scope, so the
+  // cache is shared by every request the isolate handles. See kv.c++.
+  class ReadCache;
+  kj::Own<ReadCache> readCache;
 };
 
 #define EW_KV_ISOLATE_TYPES                 \
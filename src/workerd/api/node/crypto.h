@@ -112,6 +112,9 @@ public:
   // Pbkdf2
   kj::Array<kj::byte> getPbkdf(kj::Array<kj::byte> password, kj::Array<kj::byte> salt,
                                uint32_t num_iterations, uint32_t keylen, kj::String name);
+  // Like getPbkdf(), but derives the key on a background thread.
+  jsg::Promise<kj::Array<kj::byte>> getPbkdfAsync(jsg::Lock& js, kj::Array<kj::byte> password,
+      kj::Array<kj::byte> salt, uint32_t num_iterations, uint32_t keylen, kj::String name);
 
   // Keys
   struct KeyExportOptions {
@@ -195,6 +198,7 @@ public:
     JSG_METHOD(getHkdf);
     // Pbkdf2
     JSG_METHOD(getPbkdf);
+    JSG_METHOD(getPbkdfAsync);
     // Keys
     JSG_METHOD(exportKey);
     JSG_METHOD(equals);
@@ -10,8 +10,10 @@
 
 namespace workerd::api::node {
 
-kj::Array<kj::byte> CryptoImpl::getPbkdf(kj::Array<kj::byte> password,
-kj::Array<kj::byte> salt, uint32_t num_iterations, uint32_t keylen, kj::String name) {
+namespace {
+// Checks the arguments shared by getPbkdf() and getPbkdfAsync(), returning the digest to use.
+const EVP_MD* validatePbkdf(kj::ArrayPtr<const kj::byte> password,
+    kj::ArrayPtr<const kj::byte> salt, uint32_t num_iterations, kj::StringPtr name) {
   // Should not be needed based on current memory limits, still good to have
   JSG_REQUIRE(password.size() <= INT32_MAX, RangeError, "Pbkdf2 failed: password is too large");
   JSG_REQUIRE(salt.size() <= INT32_MAX, RangeError, "Pbkdf2 failed: salt is too large");
@@ -24,7 +26,12 @@ kj::Array<kj::byte> salt, uint32_t num_iterations, uint32_t keylen, kj::String n
   const EVP_MD* digest = EVP_get_digestbyname(name.begin());
   JSG_REQUIRE(digest != nullptr, TypeError, "Invalid Pbkdf2 digest: ", name,
               internalDescribeOpensslErrors());
+  return digest;
+}
 
+kj::Array<kj::byte> pbkdf(kj::ArrayPtr<const kj::byte> password,
+    kj::ArrayPtr<const kj::byte> salt, uint32_t num_iterations, uint32_t keylen,
+    const EVP_MD* digest) {
   // Both pass and salt may be zero length here.
   auto buf = kj::heapArray<byte>(keylen);
   OSSLCALL(PKCS5_PBKDF2_HMAC((const char *)password.begin(),
@@ -37,5 +44,26 @@ kj::Array<kj::byte> salt, uint32_t num_iterations, uint32_t keylen, kj::String n
                         buf.begin()));
   return buf;
 }
+}  // namespace
+
+kj::Array<kj::byte> CryptoImpl::getPbkdf(kj::Array<kj::byte> password,
+kj::Array<kj::byte> salt, uint32_t num_iterations, uint32_t keylen, kj::String name) {
+  auto digest = validatePbkdf(password, salt, num_iterations, name);
+  return pbkdf(password, salt, num_iterations, keylen, digest);
+}
+
+jsg::Promise<kj::Array<kj::byte>> CryptoImpl::getPbkdfAsync(jsg::Lock& js,
+    kj::Array<kj::byte> password, kj::Array<kj::byte> salt, uint32_t num_iterations,
+    uint32_t keylen, kj::String name) {
+  auto digest = validatePbkdf(password, salt, num_iterations, name);
+  // Used by the callback form of pbkdf2(), which doesn't need the result right away, so the
+  // iterations run off-thread rather than stalling the isolate. The buffers may be views of
+  // JavaScript memory, so the pool works on copies.
+  return runOffThread(js, [password = kj::heapArray<kj::byte>(password),
+                           salt = kj::heapArray<kj::byte>(salt),
+                           num_iterations, keylen, digest]() {
+    return pbkdf(password, salt, num_iterations, keylen, digest);
+  });
+}
 
 }  // namespace workerd::api::node
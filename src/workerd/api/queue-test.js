@@ -7,6 +7,22 @@ import { Buffer } from "node:buffer";
 
 let serializedBody;
 
+// Parses the body of a sendBatch() request made with the `queue_binary_batch` flag.
+function parseBinaryBatch(buffer) {
+  const messages = [];
+  let offset = 0;
+  while (offset < buffer.length) {
+    const length = buffer.readUInt32LE(offset);
+    const typeLength = buffer.readUInt8(offset + 4);
+    offset += 5;
+    const contentType = buffer.toString("latin1", offset, offset + typeLength) || undefined;
+    offset += typeLength;
+    messages.push({ body: buffer.subarray(offset, offset + length), contentType });
+    offset += length;
+  }
+  return messages;
+}
+
 export default {
   // Producer receiver (from `env.QUEUE`)
   async fetch(request, env, ctx) {
@@ -31,23 +47,25 @@ export default {
         assert.fail(`Unexpected format: ${JSON.stringify(format)}`);
       }
     } else if (pathname === "/batch") {
-      const body = await request.json();
+      const messages = request.headers.get("X-Batch-Fmt") === "binary"
+          ? parseBinaryBatch(Buffer.from(await request.arrayBuffer()))
+          : (await request.json())?.messages?.map(
+              ({ body, contentType }) => ({ body: Buffer.from(body, "base64"), contentType }));
 
-      assert.strictEqual(typeof body, "object");
-      assert(Array.isArray(body?.messages));
-      assert.strictEqual(body.messages.length, 4);
+      assert(Array.isArray(messages));
+      assert.strictEqual(messages.length, 4);
 
-      assert.strictEqual(body.messages[0].contentType, "text");
-      assert.strictEqual(Buffer.from(body.messages[0].body, "base64").toString(), "def");
+      assert.strictEqual(messages[0].contentType, "text");
+      assert.strictEqual(messages[0].body.toString(), "def");
 
-      assert.strictEqual(body.messages[1].contentType, "bytes");
-      assert.deepStrictEqual(Buffer.from(body.messages[1].body, "base64"), Buffer.from([4, 5, 6]));
+      assert.strictEqual(messages[1].contentType, "bytes");
+      assert.deepStrictEqual(messages[1].body, Buffer.from([4, 5, 6]));
 
-      assert.strictEqual(body.messages[2].contentType, "json");
-      assert.deepStrictEqual(JSON.parse(Buffer.from(body.messages[2].body, "base64")), [7, 8, {b: 9}]);
+      assert.strictEqual(messages[2].contentType, "json");
+      assert.deepStrictEqual(JSON.parse(messages[2].body), [7, 8, {b: 9}]);
 
-      assert.strictEqual(body.messages[3].contentType, "v8");
-      assert(Buffer.from(body.messages[3].body, "base64").includes("value"));
+      assert.strictEqual(messages[3].contentType, "v8");
+      assert(messages[3].body.includes("value"));
     } else {
       assert.fail(`Unexpected pathname: ${JSON.stringify(pathname)}`);
     }
@@ -748,6 +748,71 @@ async function test(storage) {
   `),
     'Error: not authorized'
   )
+
+  // exec() reuses compiled statements for repeated code, which must not change its behavior.
+  {
+    sql.exec('CREATE TABLE repeated (id INTEGER PRIMARY KEY, value TEXT)')
+    for (let i = 0; i < 100; i++) {
+      sql.exec('INSERT INTO repeated VALUES (?, ?)', i, 'value' + i)
+    }
+    for (let i = 0; i < 100; i++) {
+      const rows = [...sql.exec('SELECT value FROM repeated WHERE id = ?', i)]
+      assert.deepEqual(rows, [{ value: 'value' + i }])
+    }
+
+    // Cursors over the same code can be open at once.
+    const query = 'SELECT id FROM repeated WHERE id < ? ORDER BY id'
+    const first = sql.exec(query, 3)
+    const second = sql.exec(query, 2)
+    assert.deepEqual([...second.raw()], [[0], [1]])
+    assert.deepEqual([...first.raw()], [[0], [1], [2]])
+
+    // A schema change is picked up by repeated code.
+    const columns = () =>
+      Object.keys([...sql.exec('SELECT * FROM repeated LIMIT 1')][0])
+    assert.deepEqual(columns(), ['id', 'value'])
+    sql.exec('ALTER TABLE repeated ADD COLUMN extra INTEGER')
+    assert.deepEqual(columns(), ['id', 'value', 'extra'])
+
+    // Repeated code is still checked against the authorizer every time.
+    for (let i = 0; i < 2; i++) {
+      assert.throws(
+        () => sql.exec('SELECT * FROM _cf_KV'),
+        /access to _cf_KV.key is prohibited/
+      )
+    }
+  }
+
+  // toArray() returns the remaining rows as objects, the same as iterating does.
+  {
+    const query = 'SELECT id, value, id AS value FROM repeated WHERE id < 3'
+    const cursor = sql.exec(query)
+    assert.deepEqual(cursor.toArray(), [...sql.exec(query)])
+    assert.deepEqual(cursor.toArray(), [])
+
+    const partial = sql.exec('SELECT id FROM repeated WHERE id < 3 ORDER BY id')
+    const first = partial[Symbol.iterator]().next().value
+    assert.deepEqual(first, { id: 0 })
+    assert.deepEqual(partial.toArray(), [{ id: 1 }, { id: 2 }])
+
+    // A column named __proto__ is just a column.
+    const [row] = sql.exec("SELECT 1 AS __proto__, x'00' AS blob").toArray()
+    assert.equal(Object.getPrototypeOf(row), Object.prototype)
+    assert.equal(row.__proto__, 1)
+    assert.equal(new Uint8Array(row.blob).length, 1)
+  }
+
+  // exec() caches row shapes with the statement; a schema change that keeps the number of columns
+  // but renames one still gets the new name.
+  {
+    sql.exec('CREATE TABLE renamed (oldname INTEGER)')
+    sql.exec('INSERT INTO renamed VALUES (1)')
+    const query = 'SELECT * FROM renamed'
+    assert.deepEqual(sql.exec(query).toArray(), [{ oldname: 1 }])
+    sql.exec('ALTER TABLE renamed RENAME COLUMN oldname TO newname')
+    assert.deepEqual(sql.exec(query).toArray(), [{ newname: 1 }])
+    assert.deepEqual(sql.exec(query).columnNames, ['newname'])
+  }
 }
 
 async function testIoStats(storage) {
@@ -16,6 +16,19 @@ SqlStorage::~SqlStorage() {}
 jsg::Ref<SqlStorage::Cursor> SqlStorage::exec(jsg::Lock& js, kj::String querySql,
                                               jsg::Arguments<BindingValue> bindings) {
   SqliteDatabase::Regulator& regulator = *this;
+
+  SqliteDatabase::StatementCache* cache;
+  KJ_IF_MAYBE(c, statementCache) {
+    cache = &**c;
+  } else {
+    cache = &*statementCache.emplace(IoContext::current().addObject(
+        kj::heap<SqliteDatabase::StatementCache>(*sqlite, regulator, STATEMENT_CACHE_SIZE)));
+  }
+
+  KJ_IF_MAYBE(statement, cache->find(querySql)) {
+    return jsg::alloc<Cursor>(
+        Cursor::CachedColumnNames::of(*statement), *statement, kj::mv(bindings));
+  }
   return jsg::alloc<Cursor>(*sqlite, regulator, querySql, kj::mv(bindings));
 }
 
@@ -61,6 +74,12 @@ SqlStorage::Cursor::State::State(
       bindings(kj::mv(bindingsParam)),
       query(statement.getWrapped().run(mapBindings(bindings).asPtr())) {}
 
+SqlStorage::Cursor::State::State(
+    SqliteDatabase::CachedStatement& statement, kj::Array<BindingValue> bindingsParam)
+    : dependency(kj::addRef(statement)),
+      bindings(kj::mv(bindingsParam)),
+      query(statement.getStatement().run(mapBindings(bindings).asPtr())) {}
+
 SqlStorage::Cursor::State::State(
     SqliteDatabase& db, SqliteDatabase::Regulator& regulator,
     kj::StringPtr sqlCode, kj::Array<BindingValue> bindingsParam)
@@ -78,17 +97,44 @@ SqlStorage::Cursor::~Cursor() noexcept(false) {
   }
 }
 
+SqlStorage::Cursor::CachedColumnNames& SqlStorage::Cursor::CachedColumnNames::of(
+    SqliteDatabase::CachedStatement& statement) {
+  KJ_IF_MAYBE(attachment, statement.attachment) {
+    return kj::downcast<CachedColumnNames>(**attachment);
+  }
+  auto names = kj::heap<CachedColumnNames>();
+  auto& result = *names;
+  statement.attachment = kj::mv(names);
+  return result;
+}
+
 void SqlStorage::Cursor::CachedColumnNames::ensureInitialized(
     jsg::Lock& js, SqliteDatabase::Query& source) {
-  if (names == nullptr) {
-    js.withinHandleScope([&] {
-      auto builder = kj::heapArrayBuilder<jsg::JsRef<jsg::JsString>>(source.columnCount());
-      for (auto i: kj::zeroTo(builder.capacity())) {
-        builder.add(js, js.str(source.getColumnName(i)));
-      }
-      names = builder.finish();
-    });
+  auto matches = [&]() {
+    if (shape == nullptr || names.size() != source.columnCount()) return false;
+    for (auto i: kj::zeroTo(names.size())) {
+      if (names[i] != source.getColumnName(i)) return false;
+    }
+    return true;
+  };
+  if (matches()) return;
+
+  auto builder = kj::heapArrayBuilder<kj::String>(source.columnCount());
+  for (auto i: kj::zeroTo(builder.capacity())) {
+    builder.add(kj::str(source.getColumnName(i)));
   }
+  names = builder.finish();
+
+  js.withinHandleScope([&] {
+    shape.emplace(js, KJ_MAP(name, names) -> kj::StringPtr { return name; });
+  });
+}
+
+jsg::JsObject SqlStorage::Cursor::CachedColumnNames::makeRow(
+    jsg::Lock& js, SqliteDatabase::Query& source) {
+  return KJ_ASSERT_NONNULL(shape).instantiate(js, [&](uint i) {
+    return toJs(js, getValue(source, i));
+  });
 }
 
 double SqlStorage::Cursor::getRowsRead() {
@@ -107,28 +153,40 @@ double SqlStorage::Cursor::getRowsWritten() {
   }
 }
 
+SqlStorage::Cursor::CachedColumnNames& SqlStorage::Cursor::getCachedColumnNames(
+    jsg::Lock& js, SqliteDatabase::Query& query) {
+  if (!columnNamesChecked) {
+    cachedColumnNames.ensureInitialized(js, query);
+    columnNamesChecked = true;
+  }
+  return cachedColumnNames;
+}
+
 jsg::Ref<SqlStorage::Cursor::RowIterator> SqlStorage::Cursor::rows(jsg::Lock& js) {
   KJ_IF_MAYBE(s, state) {
-    cachedColumnNames.ensureInitialized(js, (*s)->query);
+    getCachedColumnNames(js, (*s)->query);
   }
   return jsg::alloc<RowIterator>(JSG_THIS);
 }
 
-kj::Maybe<SqlStorage::Cursor::RowDict> SqlStorage::Cursor::rowIteratorNext(
+kj::Maybe<jsg::JsObject> SqlStorage::Cursor::rowIteratorNext(
     jsg::Lock& js, jsg::Ref<Cursor>& obj) {
-  auto names = obj->cachedColumnNames.get();
-  return iteratorImpl(js, obj,
-      [&](State& state, uint i, Value&& value) {
-    return RowDict::Field{
-      // A little trick here: We know there are no HandleScopes on the stack between JSG and here,
-      // so we can return a dict keyed by local handles, which avoids constructing new V8Refs here
-      // which would be relatively slower.
-      .name = names[i].getHandle(js),
-      .value = kj::mv(value)
-    };
-  }).map([&](kj::Array<RowDict::Field>&& fields) {
-    return RowDict { .fields = kj::mv(fields) };
-  });
+  KJ_IF_MAYBE(query, obj->nextRow()) {
+    return obj->getCachedColumnNames(js, *query).makeRow(js, *query);
+  }
+  return nullptr;
+}
+
+jsg::JsArray SqlStorage::Cursor::toArray(jsg::Lock& js) {
+  kj::Vector<v8::Local<v8::Value>> rows;
+  for (;;) {
+    KJ_IF_MAYBE(query, nextRow()) {
+      rows.add(getCachedColumnNames(js, *query).makeRow(js, *query));
+    } else {
+      break;
+    }
+  }
+  return jsg::JsArray(v8::Array::New(js.v8Isolate, rows.begin(), rows.size()));
 }
 
 jsg::Ref<SqlStorage::Cursor::RawIterator> SqlStorage::Cursor::raw(jsg::Lock&) {
@@ -140,8 +198,7 @@ jsg::Ref<SqlStorage::Cursor::RawIterator> SqlStorage::Cursor::raw(jsg::Lock&) {
 // for instance a `SELECT *` across a join of two tables that share a column name.
 kj::Array<jsg::JsRef<jsg::JsString>> SqlStorage::Cursor::getColumnNames(jsg::Lock& js) {
   KJ_IF_MAYBE(s, state) {
-    cachedColumnNames.ensureInitialized(js, (*s)->query);
-    return KJ_MAP(name, this->cachedColumnNames.get()) {
+    return KJ_MAP(name, getCachedColumnNames(js, (*s)->query).get()) {
       return name.addRef(js);
     };
   } else {
@@ -151,20 +208,19 @@ kj::Array<jsg::JsRef<jsg::JsString>> SqlStorage::Cursor::getColumnNames(jsg::Loc
 
 kj::Maybe<kj::Array<SqlStorage::Cursor::Value>> SqlStorage::Cursor::rawIteratorNext(
     jsg::Lock& js, jsg::Ref<Cursor>& obj) {
-  return iteratorImpl(js, obj,
-      [&](State& state, uint i, Value&& value) {
-    return kj::mv(value);
-  });
+  KJ_IF_MAYBE(query, obj->nextRow()) {
+    auto results = kj::heapArrayBuilder<Value>(query->columnCount());
+    for (auto i: kj::zeroTo(results.capacity())) {
+      results.add(getValue(*query, i));
+    }
+    return results.finish();
+  }
+  return nullptr;
 }
 
-template <typename Func>
-auto SqlStorage::Cursor::iteratorImpl(jsg::Lock& js, jsg::Ref<Cursor>& obj, Func&& func)
-    -> kj::Maybe<kj::Array<
-        decltype(func(kj::instance<State&>(), uint(), kj::instance<Value&&>()))>> {
-  using Element = decltype(func(kj::instance<State&>(), uint(), kj::instance<Value&&>()));
-
-  auto& state = *KJ_UNWRAP_OR(obj->state, {
-    if (obj->canceled) {
+kj::Maybe<SqliteDatabase::Query&> SqlStorage::Cursor::nextRow() {
+  auto& st = *KJ_UNWRAP_OR(state, {
+    if (canceled) {
       JSG_FAIL_REQUIRE(Error,
           "SQL cursor was closed because the same statement was executed again. If you need to "
           "run multiple copies of the same statement concurrently, you must create multiple "
@@ -175,51 +231,71 @@ auto SqlStorage::Cursor::iteratorImpl(jsg::Lock& js, jsg::Ref<Cursor>& obj, Func
     }
   });
 
-  if (state.isFirst) {
+  if (st.isFirst) {
     // Little hack: We don't want to call query.nextRow() at the end of this method because it
     // may invalidate the backing buffers of StringPtrs that we haven't returned to JS yet.
-    state.isFirst = false;
+    st.isFirst = false;
   } else {
-    state.query.nextRow();
+    st.query.nextRow();
   }
 
-  auto& query = state.query;
+  auto& query = st.query;
 
   if (query.isDone()) {
     // Save off row counts before the query goes away.
-    obj->rowsRead = query.getRowsRead();
-    obj->rowsWritten = query.getRowsWritten();
+    rowsRead = query.getRowsRead();
+    rowsWritten = query.getRowsWritten();
     // Clean up the query proactively.
-    obj->state = nullptr;
+    state = nullptr;
     return nullptr;
   }
 
-  auto results = kj::heapArrayBuilder<Element>(query.columnCount());
-  for (auto i: kj::zeroTo(results.capacity())) {
-    Value value;
-    KJ_SWITCH_ONEOF(query.getValue(i)) {
-      KJ_CASE_ONEOF(data, kj::ArrayPtr<const byte>) {
-        value.emplace(kj::heapArray(data));
+  return query;
+}
+
+SqlStorage::Cursor::Value SqlStorage::Cursor::getValue(
+    SqliteDatabase::Query& query, uint column) {
+  Value value;
+  KJ_SWITCH_ONEOF(query.getValue(column)) {
+    KJ_CASE_ONEOF(data, kj::ArrayPtr<const byte>) {
+      value.emplace(kj::heapArray(data));
+    }
+    KJ_CASE_ONEOF(text, kj::StringPtr) {
+      value.emplace(text);
+    }
+    KJ_CASE_ONEOF(i, int64_t) {
+      // int64 will become BigInt, but most applications won't want all their integers to be
+      // BigInt. We will coerce to a double here.
+      // TODO(someday): Allow applications to request that certain columns use BigInt.
+      value.emplace(static_cast<double>(i));
+    }
+    KJ_CASE_ONEOF(d, double) {
+      value.emplace(d);
+    }
+    KJ_CASE_ONEOF(_, decltype(nullptr)) {
+      // leave value null
+    }
+  }
+  return value;
+}
+
+jsg::JsValue SqlStorage::Cursor::toJs(jsg::Lock& js, Value value) {
+  KJ_IF_MAYBE(v, value) {
+    KJ_SWITCH_ONEOF(*v) {
+      KJ_CASE_ONEOF(data, kj::Array<byte>) {
+        return jsg::JsValue(js.wrapBytes(kj::mv(data)));
       }
       KJ_CASE_ONEOF(text, kj::StringPtr) {
-        value.emplace(text);
-      }
-      KJ_CASE_ONEOF(i, int64_t) {
-        // int64 will become BigInt, but most applications won't want all their integers to be
-        // BigInt. We will coerce to a double here.
-        // TODO(someday): Allow applications to request that certain columns use BigInt.
-        value.emplace(static_cast<double>(i));
+        return js.str(text);
       }
       KJ_CASE_ONEOF(d, double) {
-        value.emplace(d);
-      }
-      KJ_CASE_ONEOF(_, decltype(nullptr)) {
-        // leave value null
+        return js.num(d);
       }
     }
-    results.add(func(state, i, kj::mv(value)));
+    KJ_UNREACHABLE;
+  } else {
+    return js.null();
   }
-  return results.finish();
 }
 
 SqlStorage::Statement::Statement(SqliteDatabase::Statement&& statement)
@@ -52,6 +52,11 @@ private:
   IoPtr<SqliteDatabase> sqlite;
   jsg::Ref<DurableObjectStorage> storage;
 
+  // Statements for code passed to exec(), which applications tend to call with the same few
+  // queries over and over. Created on first use.
+  kj::Maybe<IoOwn<SqliteDatabase::StatementCache>> statementCache;
+  static constexpr uint STATEMENT_CACHE_SIZE = 100;
+
   kj::Maybe<uint> pageSize;
   kj::Maybe<IoOwn<SqliteDatabase::Statement>> pragmaPageCount;
   kj::Maybe<IoOwn<SqliteDatabase::Statement>> pragmaGetMaxPageCount;
@@ -101,9 +106,15 @@ public:
   double getRowsWritten();
 
   kj::Array<jsg::JsRef<jsg::JsString>> getColumnNames(jsg::Lock& js);
+
+  // Returns all remaining rows as objects, like spreading the cursor into an array, but building
+  // them in one call instead of one call per row.
+  jsg::JsArray toArray(jsg::Lock& js);
+
   JSG_RESOURCE_TYPE(Cursor, CompatibilityFlags::Reader flags) {
     JSG_ITERABLE(rows);
     JSG_METHOD(raw);
+    JSG_METHOD(toArray);
     JSG_READONLY_PROTOTYPE_PROPERTY(columnNames, getColumnNames);
     JSG_READONLY_PROTOTYPE_PROPERTY(rowsRead, getRowsRead);
     JSG_READONLY_PROTOTYPE_PROPERTY(rowsWritten, getRowsWritten);
@@ -115,23 +126,37 @@ public:
   // JSG, which does not need to make a copy.
   using Value = kj::Maybe<kj::OneOf<kj::Array<byte>, kj::StringPtr, double>>;
 
-  using RowDict = jsg::Dict<Value, jsg::JsString>;
-  JSG_ITERATOR(RowIterator, rows, RowDict, jsg::Ref<Cursor>, rowIteratorNext);
+  JSG_ITERATOR(RowIterator, rows, jsg::JsObject, jsg::Ref<Cursor>, rowIteratorNext);
   JSG_ITERATOR(RawIterator, raw, kj::Array<Value>, jsg::Ref<Cursor>, rawIteratorNext);
 
 private:
   // Helper class to cache column names for a query so that we don't have to recreate the V8
-  // strings for every row.
-  class CachedColumnNames {
-    // TODO(perf): Can we further cache the V8 object layout information for a row?
+  // strings for every row. Row objects are made from the same shape, so that they all share one
+  // hidden class.
+  //
+  // For exec(), the names are kept with the statement in the SqlStorage's statement cache, so
+  // they're built once per distinct query rather than once per call.
+  class CachedColumnNames final: public SqliteDatabase::CachedStatement::Attachment {
   public:
+    // Returns the names attached to `statement`, attaching empty ones on first use.
+    static CachedColumnNames& of(SqliteDatabase::CachedStatement& statement);
+
     // Get the cached names. ensureInitialized() must have been called previously.
-    kj::ArrayPtr<jsg::JsRef<jsg::JsString>> get() { return KJ_REQUIRE_NONNULL(names); }
+    kj::ArrayPtr<jsg::JsRef<jsg::JsString>> get() { return KJ_REQUIRE_NONNULL(shape).getNames(); }
 
+    // Builds the names from `source`'s columns, unless they already match. A prepared statement's
+    // columns can change if the schema does.
     void ensureInitialized(jsg::Lock& js, SqliteDatabase::Query& source);
 
+    // Make an object from the current row of `source`. ensureInitialized() must have been called
+    // previously for the same query.
+    jsg::JsObject makeRow(jsg::Lock& js, SqliteDatabase::Query& source);
+
   private:
-    kj::Maybe<kj::Array<jsg::JsRef<jsg::JsString>>> names;
+    kj::Maybe<jsg::JsObjectShape> shape;
+
+    // The column names `shape` was built from, to compare against later queries.
+    kj::Array<kj::String> names;
   };
 
   struct State {
@@ -148,6 +173,7 @@ private:
 
     State(kj::RefcountedWrapper<SqliteDatabase::Statement>& statement,
           kj::Array<BindingValue> bindings);
+    State(SqliteDatabase::CachedStatement& statement, kj::Array<BindingValue> bindings);
     State(SqliteDatabase& db, SqliteDatabase::Regulator& regulator,
           kj::StringPtr sqlCode, kj::Array<BindingValue> bindings);
   };
@@ -177,6 +203,10 @@ private:
   kj::Maybe<CachedColumnNames> ownCachedColumnNames;
   CachedColumnNames& cachedColumnNames;
 
+  // True once `cachedColumnNames` has been checked against this cursor's query, after which every
+  // row has the same columns.
+  bool columnNamesChecked = false;
+
   void visitForGc(jsg::GcVisitor& visitor) {
     visitor.visit(statement);
   }
@@ -184,13 +214,20 @@ private:
   static kj::Array<const SqliteDatabase::Query::ValuePtr> mapBindings(
       kj::ArrayPtr<BindingValue> values);
 
-  static kj::Maybe<RowDict> rowIteratorNext(jsg::Lock& js, jsg::Ref<Cursor>& obj);
+  static kj::Maybe<jsg::JsObject> rowIteratorNext(jsg::Lock& js, jsg::Ref<Cursor>& obj);
   static kj::Maybe<kj::Array<Value>> rawIteratorNext(jsg::Lock& js, jsg::Ref<Cursor>& obj);
-  template <typename Func>
-  static auto iteratorImpl(jsg::Lock& js, jsg::Ref<Cursor>& obj, Func&& func)
-      -> kj::Maybe<kj::Array<
-          decltype(func(kj::instance<State&>(), uint(), kj::instance<Value&&>()))>>;
 
+  // Advance to the next row and return the query positioned on it, or null if there are no more
+  // rows.
+  kj::Maybe<SqliteDatabase::Query&> nextRow();
+
+  // Returns `cachedColumnNames`, initialized for `query`.
+  CachedColumnNames& getCachedColumnNames(jsg::Lock& js, SqliteDatabase::Query& query);
+
+  static Value getValue(SqliteDatabase::Query& query, uint column);
+  static jsg::JsValue toJs(jsg::Lock& js, Value value);
+
+  friend class SqlStorage;
   friend class Statement;
 };
 
@@ -5,14 +5,28 @@
 #include "compression.h"
 #include <workerd/io/features.h>
 #include <zlib.h>
+#include <brotli/encode.h>
+#include <brotli/decode.h>
 #include <deque>
-#include <vector>
-#include <iterator>
+#include <kj/vector.h>
 
 namespace workerd::api {
 
 namespace {
 
+// Size of each chunk of compressed/decompressed output buffered between a write and the read that
+// consumes it. Large enough that zlib and brotli are called only a handful of times per chunk
+// written, rather than once per 4 KiB as they used to be.
+constexpr size_t OUTPUT_CHUNK_SIZE = 64 * 1024;
+
+// Drained output chunks are kept for reuse, up to this many, rather than being freed and
+// reallocated for the next write.
+constexpr size_t MAX_POOLED_CHUNKS = 2;
+
+// Brotli's default quality (11) is far too slow for streaming use. 6 is a similar tradeoff to
+// zlib's default level.
+constexpr int BROTLI_STREAM_QUALITY = 6;
+
 class Context {
 public:
   enum class Mode {
@@ -25,12 +39,32 @@ public:
     STRICT,
   };
 
+  enum class Flush {
+    NONE,
+    FINISH,
+  };
+
   struct Result {
+    // True if the context may be able to produce more output without more input.
     bool success = false;
-    kj::ArrayPtr<const byte> buffer;
+
+    // Number of bytes written into the output buffer.
+    size_t size = 0;
   };
 
-  explicit Context(Mode mode, kj::StringPtr format, ContextFlags flags) :
+  virtual ~Context() noexcept(false) {}
+
+  virtual void setInput(const void* in, size_t size) = 0;
+
+  // Runs the (de)compressor once over the current input, writing directly into `out`.
+  virtual Result pumpOnce(Flush flush, kj::ArrayPtr<kj::byte> out) = 0;
+
+  static kj::Own<Context> create(Mode mode, kj::StringPtr format, ContextFlags flags);
+};
+
+class ZlibContext final: public Context {
+public:
+  explicit ZlibContext(Mode mode, kj::StringPtr format, ContextFlags flags) :
       mode(mode), strictCompression(flags) {
     int result = Z_OK;
     switch (mode) {
@@ -52,7 +86,7 @@ public:
     JSG_REQUIRE(result == Z_OK, Error, "Failed to initialize compression context.");
   }
 
-  ~Context() noexcept(false) {
+  ~ZlibContext() noexcept(false) {
     switch (mode) {
       case Mode::COMPRESS:
         deflateEnd(&ctx);
@@ -63,16 +97,17 @@ public:
     }
   }
 
-  KJ_DISALLOW_COPY_AND_MOVE(Context);
+  KJ_DISALLOW_COPY_AND_MOVE(ZlibContext);
 
-  void setInput(const void* in, size_t size) {
+  void setInput(const void* in, size_t size) override {
     ctx.next_in = const_cast<byte*>(reinterpret_cast<const byte*>(in));
     ctx.avail_in = size;
   }
 
-  Result pumpOnce(int flush) {
-    ctx.next_out = buffer;
-    ctx.avail_out = sizeof(buffer);
+  Result pumpOnce(Flush flushMode, kj::ArrayPtr<kj::byte> out) override {
+    int flush = flushMode == Flush::FINISH ? Z_FINISH : Z_NO_FLUSH;
+    ctx.next_out = out.begin();
+    ctx.avail_out = out.size();
 
     int result = Z_OK;
 
@@ -96,7 +131,7 @@ public:
               "Trailing bytes after end of compressed data");
           // Same applies to closing a stream before the complete decompressed data is available.
           JSG_REQUIRE(!(flush == Z_FINISH && result == Z_BUF_ERROR &&
-              ctx.avail_out == sizeof(buffer)), TypeError,
+              ctx.avail_out == out.size()), TypeError,
               "Called close() on a decompression stream with incomplete data");
         }
         break;
@@ -106,7 +141,7 @@ public:
 
     return Result {
       .success = result == Z_OK,
-      .buffer = kj::arrayPtr(buffer, sizeof(buffer) - ctx.avail_out),
+      .size = out.size() - ctx.avail_out,
     };
   }
 
@@ -129,12 +164,98 @@ private:
 
   Mode mode;
   z_stream ctx = {};
-  kj::byte buffer[4096];
 
   // For the eponymous compatibility flag
   ContextFlags strictCompression;
 };
 
+// The "br" format, using the same brotli library as the kj brotli streams used for
+// Content-Encoding in system-streams.c++.
+class BrotliContext final: public Context {
+public:
+  explicit BrotliContext(Mode mode, ContextFlags flags) :
+      mode(mode), strictCompression(flags) {
+    switch (mode) {
+      case Mode::COMPRESS:
+        encoder = BrotliEncoderCreateInstance(nullptr, nullptr, nullptr);
+        JSG_REQUIRE(encoder != nullptr, Error, "Failed to initialize compression context.");
+        BrotliEncoderSetParameter(encoder, BROTLI_PARAM_QUALITY, BROTLI_STREAM_QUALITY);
+        break;
+      case Mode::DECOMPRESS:
+        decoder = BrotliDecoderCreateInstance(nullptr, nullptr, nullptr);
+        JSG_REQUIRE(decoder != nullptr, Error, "Failed to initialize compression context.");
+        break;
+    }
+  }
+
+  ~BrotliContext() noexcept(false) {
+    if (encoder != nullptr) BrotliEncoderDestroyInstance(encoder);
+    if (decoder != nullptr) BrotliDecoderDestroyInstance(decoder);
+  }
+
+  KJ_DISALLOW_COPY_AND_MOVE(BrotliContext);
+
+  void setInput(const void* in, size_t size) override {
+    nextIn = reinterpret_cast<const byte*>(in);
+    availIn = size;
+  }
+
+  Result pumpOnce(Flush flush, kj::ArrayPtr<kj::byte> out) override {
+    auto nextOut = out.begin();
+    size_t availOut = out.size();
+
+    switch (mode) {
+      case Mode::COMPRESS: {
+        auto op = flush == Flush::FINISH ? BROTLI_OPERATION_FINISH : BROTLI_OPERATION_PROCESS;
+        JSG_REQUIRE(BrotliEncoderCompressStream(
+            encoder, op, &availIn, &nextIn, &availOut, &nextOut, nullptr),
+            Error, "Compression failed.");
+        return Result {
+          .success = BrotliEncoderHasMoreOutput(encoder) || availIn > 0 ||
+              (flush == Flush::FINISH && !BrotliEncoderIsFinished(encoder)),
+          .size = out.size() - availOut,
+        };
+      }
+      case Mode::DECOMPRESS: {
+        auto result = BrotliDecoderDecompressStream(
+            decoder, &availIn, &nextIn, &availOut, &nextOut, nullptr);
+        JSG_REQUIRE(result != BROTLI_DECODER_RESULT_ERROR, Error, "Decompression failed.");
+
+        if (strictCompression == ContextFlags::STRICT) {
+          JSG_REQUIRE(!(result == BROTLI_DECODER_RESULT_SUCCESS && availIn > 0), TypeError,
+              "Trailing bytes after end of compressed data");
+          JSG_REQUIRE(!(flush == Flush::FINISH &&
+              result == BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT), TypeError,
+              "Called close() on a decompression stream with incomplete data");
+        }
+
+        return Result {
+          .success = result == BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT,
+          .size = out.size() - availOut,
+        };
+      }
+    }
+    KJ_UNREACHABLE;
+  }
+
+private:
+  Mode mode;
+  BrotliEncoderState* encoder = nullptr;
+  BrotliDecoderState* decoder = nullptr;
+  const byte* nextIn = nullptr;
+  size_t availIn = 0;
+
+  // For the eponymous compatibility flag
+  ContextFlags strictCompression;
+};
+
+kj::Own<Context> Context::create(Mode mode, kj::StringPtr format, ContextFlags flags) {
+  if (format == "br") {
+    return kj::heap<BrotliContext>(mode, flags);
+  }
+  return kj::heap<ZlibContext>(mode, format, flags);
+}
+
 // Uncompressed data goes in. Compressed data comes out.
 template <Context::Mode mode>
 class CompressionStreamImpl: public kj::Refcounted,
@@ -142,7 +263,7 @@ class CompressionStreamImpl: public kj::Refcounted,
                              public WritableStreamSink {
 public:
   explicit CompressionStreamImpl(kj::String format, Context::ContextFlags flags)
-      : context(mode, format, flags) {}
+      : context(Context::create(mode, format, flags)) {}
 
   // WritableStreamSink implementation ---------------------------------------------------
 
@@ -155,8 +276,8 @@ public:
         return kj::cp(exception);
       }
       KJ_CASE_ONEOF(open, Open) {
-        context.setInput(buffer, size);
-        return writeInternal(Z_NO_FLUSH);
+        context->setInput(buffer, size);
+        return writeInternal(Context::Flush::NONE);
       }
     }
     KJ_UNREACHABLE;
@@ -186,7 +307,7 @@ public:
 
   kj::Promise<void> end() override {
     state = Ended();
-    return writeInternal(Z_FINISH);
+    return writeInternal(Context::Flush::FINISH);
   }
 
   void abort(kj::Exception reason) override {
@@ -200,7 +321,7 @@ public:
     KJ_SWITCH_ONEOF(state) {
       KJ_CASE_ONEOF(ended, Ended) {
         // There might still be data in the output buffer remaining to read.
-        if (output.empty()) return size_t(0);
+        if (outputSize == 0) return size_t(0);
         return tryReadInternal(
             kj::ArrayPtr<kj::byte>(reinterpret_cast<kj::byte*>(buffer), maxBytes),
             minBytes);
@@ -229,8 +350,16 @@ private:
     kj::Own<kj::PromiseFulfiller<size_t>> promise;
   };
 
+  // A chunk of output not yet consumed by a read. Bytes [begin, end) of `data` are unread.
+  struct OutputChunk {
+    kj::Array<kj::byte> data;
+    size_t begin = 0;
+    size_t end = 0;
+  };
+
   void cancelInternal(kj::Exception reason) {
     output.clear();
+    outputSize = 0;
 
     while (!pendingReads.empty()) {
       auto pending = kj::mv(pendingReads.front());
@@ -244,22 +373,34 @@ private:
     state = kj::mv(reason);
   }
 
-  kj::Promise<size_t> tryReadInternal(kj::ArrayPtr<kj::byte> dest, size_t minBytes) {
-    const auto copyIntoBuffer = [this](kj::ArrayPtr<kj::byte> dest) {
-      auto maxBytesToCopy = kj::min(dest.size(), output.size());
-      auto src = &output[0];
-      memcpy(dest.begin(), src, maxBytesToCopy);
-      output.erase(output.begin(), output.begin() + maxBytesToCopy);
-      return maxBytesToCopy;
-    };
+  // Copy as much queued output as fits into `dest`, releasing drained chunks back to the pool.
+  size_t copyFromOutput(kj::ArrayPtr<kj::byte> dest) {
+    size_t copied = 0;
+    while (copied < dest.size() && !output.empty()) {
+      auto& chunk = output.front();
+      auto amount = kj::min(dest.size() - copied, chunk.end - chunk.begin);
+      memcpy(dest.begin() + copied, chunk.data.begin() + chunk.begin, amount);
+      chunk.begin += amount;
+      copied += amount;
+      if (chunk.begin == chunk.end) {
+        if (pool.size() < MAX_POOLED_CHUNKS) {
+          pool.add(kj::mv(chunk.data));
+        }
+        output.pop_front();
+      }
+    }
+    outputSize -= copied;
+    return copied;
+  }
 
+  kj::Promise<size_t> tryReadInternal(kj::ArrayPtr<kj::byte> dest, size_t minBytes) {
     // If the output currently contains >= minBytes, then we'll fulfill
     // the read immediately, removing as many bytes as possible from the
     // output queue.
     // If we reached the end, resolve the read immediately as well, since no
     // new data is expected.
-    if (output.size() >= minBytes || state.template is<Ended>()) {
-      return copyIntoBuffer(dest);
+    if (outputSize >= minBytes || state.template is<Ended>()) {
+      return copyFromOutput(dest);
     }
 
     // Otherwise, create a pending read.
@@ -272,8 +413,8 @@ private:
     };
 
     // If there are any bytes queued, copy as much as possible into the buffer.
-    if (output.size() > 0) {
-      pendingRead.filled = copyIntoBuffer(dest);
+    if (outputSize > 0) {
+      pendingRead.filled = copyFromOutput(dest);
     }
 
     pendingReads.push_back(kj::mv(pendingRead));
@@ -281,39 +422,83 @@ private:
     return canceler.wrap(kj::mv(promise.promise));
   }
 
-  kj::Promise<void> writeInternal(int flush) {
-    // TODO(later): This does not yet implement any backpressure. A caller can keep calling
-    // write without reading, which will continue to fill the internal buffer.
-    KJ_ASSERT(flush == Z_FINISH || state.template is<Open>());
-    Context::Result result;
-    KJ_IF_MAYBE(exception, kj::runCatchingExceptions([this, flush, &result]() {
-      result = context.pumpOnce(flush);
-    })) {
-      cancelInternal(kj::cp(*exception));
-      return kj::mv(*exception);
+  // Pick where the next output from the context should go. When a read is waiting and nothing is
+  // queued ahead of it, output is written straight into the reader's buffer, skipping the
+  // intermediate copy. Otherwise it goes into the tail chunk of the output queue.
+  kj::ArrayPtr<kj::byte> nextOutputBuffer() {
+    if (output.empty() && !pendingReads.empty()) {
+      auto& pending = pendingReads.front();
+      if (pending.promise->isWaiting()) {
+        return pending.buffer.slice(pending.filled, pending.buffer.size());
+      }
+    }
+
+    if (output.empty() || output.back().end == output.back().data.size()) {
+      kj::Array<kj::byte> data;
+      if (pool.empty()) {
+        data = kj::heapArray<kj::byte>(OUTPUT_CHUNK_SIZE);
+      } else {
+        data = kj::mv(pool.back());
+        pool.removeLast();
+      }
+      output.push_back(OutputChunk { .data = kj::mv(data) });
     }
+    auto& tail = output.back();
+    return tail.data.slice(tail.end, tail.data.size());
+  }
 
-    if (result.buffer.size() == 0) {
-      if (result.success) {
-        return writeInternal(flush);
+  // Record that `size` bytes were written into the buffer returned by nextOutputBuffer().
+  void commitOutput(size_t size) {
+    if (output.empty()) {
+      // Written directly into the front pending read.
+      auto& pending = pendingReads.front();
+      pending.filled += size;
+      if (pending.filled >= pending.minBytes) {
+        auto p = kj::mv(pending);
+        pendingReads.pop_front();
+        p.promise->fulfill(kj::mv(p.filled));
+      }
+    } else {
+      auto& tail = output.back();
+      tail.end += size;
+      outputSize += size;
+      if (tail.begin == tail.end) {
+        // Nothing was written into a fresh chunk; don't leave it sitting in the queue.
+        if (pool.size() < MAX_POOLED_CHUNKS) {
+          pool.add(kj::mv(tail.data));
+        }
+        output.pop_back();
       }
-      return maybeFulfillRead();
     }
+  }
+
+  kj::Promise<void> writeInternal(Context::Flush flush) {
+    // TODO(later): This does not yet implement any backpressure. A caller can keep calling
+    // write without reading, which will continue to fill the internal buffer.
+    KJ_ASSERT(flush == Context::Flush::FINISH || state.template is<Open>());
+    for (;;) {
+      Context::Result result;
+      auto dest = nextOutputBuffer();
+      KJ_IF_MAYBE(exception, kj::runCatchingExceptions([this, flush, dest, &result]() {
+        result = context->pumpOnce(flush, dest);
+      })) {
+        cancelInternal(kj::cp(*exception));
+        return kj::mv(*exception);
+      }
 
-    if (result.buffer.size() > 0) {
-      std::copy(result.buffer.begin(), result.buffer.end(), std::back_inserter(output));
+      commitOutput(result.size);
+
+      if (result.size == 0 && !result.success) {
+        return maybeFulfillRead();
+      }
     }
-    return writeInternal(flush);
   }
 
   // Fulfill as many pending reads as we can from the output buffer.
   kj::Promise<void> maybeFulfillRead() {
-    auto remaining = output.size();
-    auto source = output.begin();
-
     // If there are pending reads and data to be read, we'll loop through
     // the pending reads and fulfill them as much as possible.
-    while (!pendingReads.empty() && remaining > 0) {
+    while (!pendingReads.empty() && outputSize > 0) {
       auto& pending = pendingReads.front();
 
       if (!pending.promise->isWaiting()) {
@@ -336,32 +521,27 @@ private:
       }
 
       // The pending read is still viable so determine how much we can copy in.
-      auto amountToCopy = kj::min(pending.buffer.size() - pending.filled, remaining);
-      std::copy(source, source + amountToCopy, pending.buffer.begin() + pending.filled);
-      source += amountToCopy;
-      pending.filled += amountToCopy;
-      remaining -= amountToCopy;
-      output.erase(output.begin(), source);
+      pending.filled += copyFromOutput(pending.buffer.slice(pending.filled, pending.buffer.size()));
 
       // If we've met the minimum bytes requirement for the pending read, fulfill
       // the read promise.
       if (pending.filled >= pending.minBytes) {
         auto p = kj::mv(pending);
         pendingReads.pop_front();
-        p.promise->fulfill(kj::mv(pending.filled));
+        p.promise->fulfill(kj::mv(p.filled));
         continue;
       }
 
-      // If we reached this point in the loop, remaining must be 0 so that we
+      // If we reached this point in the loop, the output must be drained so that we
       // don't keep iterating through on the same pending read.
-      KJ_ASSERT(remaining == 0);
+      KJ_ASSERT(outputSize == 0);
     }
 
     if (state.template is<Ended>() && !pendingReads.empty()) {
       // We are ended and we have pending reads. Because of the loop above,
       // one of either pendingReads or output must be empty, so if we got this
-      // far, output.empty() must be true. Let's check.
-      KJ_ASSERT(output.empty());
+      // far, the output must be empty. Let's check.
+      KJ_ASSERT(outputSize == 0);
       // We need to flush any remaining reads.
       while (!pendingReads.empty()) {
         auto pending = kj::mv(pendingReads.front());
@@ -380,17 +560,30 @@ private:
   struct Open {};
 
   kj::OneOf<Open, Ended, kj::Exception> state = Open();
-  Context context;
+  kj::Own<Context> context;
 
   kj::Canceler canceler;
-  std::vector<kj::byte> output;
+  std::deque<OutputChunk> output;
+  size_t outputSize = 0;
+  kj::Vector<kj::Array<kj::byte>> pool;
   std::deque<PendingRead> pendingReads;
 };
 }  // namespace
 
-jsg::Ref<CompressionStream> CompressionStream::constructor(jsg::Lock& js, kj::String format) {
+namespace {
+void requireValidFormat(jsg::Lock& js, kj::StringPtr format) {
+  if (format == "br") {
+    JSG_REQUIRE(FeatureFlags::get(js).getBrotliContentEncoding(), TypeError,
+        "The 'br' compression format requires the brotli_content_encoding compatibility flag.");
+    return;
+  }
   JSG_REQUIRE(format == "deflate" || format == "gzip" || format == "deflate-raw", TypeError,
-               "The compression format must be either 'deflate', 'deflate-raw' or 'gzip'.");
+               "The compression format must be either 'deflate', 'deflate-raw', 'gzip' or 'br'.");
+}
+}  // namespace
+
+jsg::Ref<CompressionStream> CompressionStream::constructor(jsg::Lock& js, kj::String format) {
+  requireValidFormat(js, format);
 
   auto readableSide =
       kj::refcounted<CompressionStreamImpl<Context::Mode::COMPRESS>>(kj::mv(format),
@@ -405,8 +598,7 @@ jsg::Ref<CompressionStream> CompressionStream::constructor(jsg::Lock& js, kj::St
 }
 
 jsg::Ref<DecompressionStream> DecompressionStream::constructor(jsg::Lock& js, kj::String format) {
-  JSG_REQUIRE(format == "deflate" || format == "gzip" || format == "deflate-raw", TypeError,
-               "The compression format must be either 'deflate', 'deflate-raw' or 'gzip'.");
+  requireValidFormat(js, format);
 
   auto readableSide =
       kj::refcounted<CompressionStreamImpl<Context::Mode::DECOMPRESS>>(
@@ -4,6 +4,7 @@
 
 #include "internal.h"
 #include "readable.h"
+#include "ring-tee.h"
 #include "writable.h"
 #include <workerd/jsg/jsg.h>
 #include <kj/vector.h>
@@ -127,111 +128,6 @@ kj::Exception reasonToException(
 
 // =======================================================================================
 
-// Adapt ReadableStreamSource to kj::AsyncInputStream's interface for use with `kj::newTee()`.
-class TeeAdapter final: public kj::AsyncInputStream {
-public:
-  explicit TeeAdapter(kj::Own<ReadableStreamSource> inner)
-      : inner(kj::mv(inner)) {}
-
-  kj::Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override {
-    return inner->tryRead(buffer, minBytes, maxBytes);
-  }
-
-  kj::Maybe<uint64_t> tryGetLength() override {
-    return inner->tryGetLength(StreamEncoding::IDENTITY);
-  }
-
-private:
-  kj::Own<ReadableStreamSource> inner;
-};
-
-class TeeBranch final: public ReadableStreamSource {
-public:
-  explicit TeeBranch(kj::Own<kj::AsyncInputStream> inner)
-      : inner(kj::mv(inner)) {}
-
-  kj::Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override {
-    return inner->tryRead(buffer, minBytes, maxBytes);
-  }
-
-  kj::Promise<DeferredProxy<void>> pumpTo(WritableStreamSink& output, bool end) override {
-#ifdef KJ_NO_RTTI
-    // Yes, I'm paranoid.
-    static_assert(!KJ_NO_RTTI, "Need RTTI for correctness");
-#endif
-
-    // HACK: If `output` is another TransformStream, we don't allow pumping to it, in order to
-    //   guarantee that we can't create cycles. Note that currently TeeBranch only ever wraps
-    //   TransformStreams, never system streams.
-    JSG_REQUIRE(kj::dynamicDowncastIfAvailable<IdentityTransformStreamImpl>(output) == nullptr,
-        TypeError, "Inter-TransformStream ReadableStream.pipeTo() is not implemented.");
-
-    // It is important we actually call `inner->pumpTo()` so that `kj::newTee()` is aware of this
-    // pump operation's backpressure. So we can't use the default `ReadableStreamSource::pumpTo()`
-    // implementation, and have to implement our own.
-
-    PumpAdapter outputAdapter(output);
-    co_await inner->pumpTo(outputAdapter);
-
-    if (end) {
-      co_await output.end();
-    }
-
-    // We only use `TeeBranch` when a locally-sourced stream was tee'd (because system streams
-    // implement `tryTee()` in a different way that doesn't use `TeeBranch`). So, we know that
-    // none of the pump can be performed without the IoContext active, and thus we do not
-    // `KJ_CO_MAGIC BEGIN_DEFERRED_PROXYING`.
-    co_return;
-  }
-
-  kj::Maybe<uint64_t> tryGetLength(StreamEncoding encoding) override {
-    if (encoding == StreamEncoding::IDENTITY) {
-      return inner->tryGetLength();
-    } else {
-      return nullptr;
-    }
-  }
-
-  kj::Maybe<Tee> tryTee(uint64_t limit) override {
-    KJ_IF_MAYBE(t, inner->tryTee(limit)) {
-      auto branch = kj::heap<TeeBranch>(newTeeErrorAdapter(kj::mv(*t)));
-      auto consumed = kj::heap<TeeBranch>(kj::mv(inner));
-      return Tee{kj::mv(branch), kj::mv(consumed)};
-    }
-
-    return nullptr;
-  }
-
-  void cancel(kj::Exception reason) override {
-    // TODO(someday): What to do?
-  }
-
-private:
-  // Adapt WritableStreamSink to kj::AsyncOutputStream's interface for use in
-  // `TeeBranch::pumpTo()`. If you squint, the write logic looks very similar to TeeAdapter's
-  // read logic.
-  class PumpAdapter final: public kj::AsyncOutputStream {
-  public:
-    explicit PumpAdapter(WritableStreamSink& inner): inner(inner) {}
-
-    kj::Promise<void> write(const void* buffer, size_t size) override {
-      return inner.write(buffer, size);
-    }
-
-    kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const byte>> pieces) override {
-      return inner.write(pieces);
-    }
-
-    kj::Promise<void> whenWriteDisconnected() override {
-      KJ_UNIMPLEMENTED("whenWriteDisconnected() not expected on PumpAdapter");
-    }
-
-    WritableStreamSink& inner;
-  };
-
-  kj::Own<kj::AsyncInputStream> inner;
-};
-
 class WarnIfUnusedStream final: public ReadableStreamSource {
 public:
   explicit WarnIfUnusedStream(kj::Own<ReadableStreamSource> inner, IoContext& ioContext)
@@ -249,8 +145,8 @@ public:
     return inner->tryRead(buffer, minBytes, maxBytes);
   }
 
-  // TODO(someday): we set `wasRead` to avoid warning here, but TeeBranch might still buffer the body.
-  // We should fix it not to buffer when cancelled.
+  // Canceling a tee branch detaches it from the shared ring buffer, so the sibling branch no
+  // longer buffers on its behalf.
   void cancel(kj::Exception reason) override {
     wasRead = true;
     return inner->cancel(reason);
@@ -581,11 +477,13 @@ ReadableStreamController::Tee ReadableStreamInternalController::tee(jsg::Lock& j
         return makeTee(kj::mv(tee->branches[0]), kj::mv(tee->branches[1]));
       }
 
-      auto tee = kj::newTee(kj::heap<TeeAdapter>(kj::mv(readable)), bufferLimit);
+      auto tee = newRingTee(kj::mv(readable), RingTeeOptions {
+        .bufferLimit = bufferLimit,
+        .maxBranchLag = ioContext.getLimitEnforcer().getTeeBranchLagLimit(),
+        .observer = kj::addRef(ioContext.getMetrics()),
+      });
 
-      return makeTee(
-          kj::heap<TeeBranch>(newTeeErrorAdapter(kj::mv(tee.branches[0]))),
-          kj::heap<TeeBranch>(newTeeErrorAdapter(kj::mv(tee.branches[1]))));
+      return makeTee(kj::mv(tee.branches[0]), kj::mv(tee.branches[1]));
     }
   }
 
@@ -1840,38 +1738,26 @@ kj::Promise<size_t> IdentityTransformStreamImpl::tryRead(
     void* buffer,
     size_t minBytes,
     size_t maxBytes) {
-  size_t total = 0;
-  while (total < minBytes) {
-    // TODO(perf): tryReadInternal was written assuming minBytes would always be 1 but we've now
-    // introduced an API for user to specify a larger minBytes. For now, this is implemented as a
-    // naiive loop dispatching to the 1 byte version but would be better to bake it deeper into
-    // the implementation where it can be more efficient.
-    auto amount = co_await tryReadInternal(buffer, maxBytes);
-    KJ_ASSERT(amount <= maxBytes);
-    if (amount == 0) {
-      // EOF.
-      break;
-    }
-
-    total += amount;
-    buffer = reinterpret_cast<char*>(buffer) + amount;
-    maxBytes -= amount;
-  }
-
-  co_return total;
+  // The min-bytes contract is honored natively by readHelper()/writeHelper(), so that a single
+  // read request accumulates as many writes as needed rather than round-tripping per write.
+  return tryReadInternal(buffer, kj::max(kj::min(minBytes, maxBytes), size_t(1)), maxBytes);
 }
 
-kj::Promise<size_t> IdentityTransformStreamImpl::tryReadInternal(void* buffer, size_t maxBytes) {
-  auto promise = readHelper(kj::arrayPtr(static_cast<kj::byte*>(buffer), maxBytes));
+kj::Promise<size_t> IdentityTransformStreamImpl::tryReadInternal(
+    void* buffer,
+    size_t minBytes,
+    size_t maxBytes) {
+  auto promise = readHelper(kj::arrayPtr(static_cast<kj::byte*>(buffer), maxBytes), minBytes);
 
   KJ_IF_MAYBE(l, limit) {
-    promise = promise.then([this, &l = *l](size_t amount) -> kj::Promise<size_t> {
+    promise = promise.then([this, &l = *l, minBytes](size_t amount) -> kj::Promise<size_t> {
       if (amount > l) {
         auto exception = JSG_KJ_EXCEPTION(FAILED, TypeError,
             "Attempt to write too many bytes through a FixedLengthStream.");
         cancel(exception);
         return kj::mv(exception);
-      } else if (amount == 0 && l != 0) {
+      } else if (amount < minBytes && amount != l) {
+        // A short read means the writable side was closed.
         auto exception = JSG_KJ_EXCEPTION(FAILED, TypeError,
             "FixedLengthStream did not see all expected bytes before close().");
         cancel(exception);
@@ -1945,8 +1831,8 @@ kj::Promise<void> IdentityTransformStreamImpl::write(const void* buffer, size_t
 kj::Promise<void> IdentityTransformStreamImpl::write(
     kj::ArrayPtr<const kj::ArrayPtr<const kj::byte>> pieces) {
   KJ_UNIMPLEMENTED("IdentityTransformStreamImpl piecewise write() not currently supported");
-  // TODO(soon): This will be called by TeeBranch::pumpTo(). We disallow that anyway, since we
-  //   disallow inter-TransformStream pumping.
+  // TODO(soon): This would be called by a tee branch's pumpTo(). We disallow that anyway, since
+  //   we disallow inter-TransformStream pumping.
 }
 
 kj::Promise<void> IdentityTransformStreamImpl::end() {
@@ -1981,13 +1867,14 @@ void IdentityTransformStreamImpl::abort(kj::Exception reason) {
   // TODO(conform): Proactively put ReadableStream into Errored state.
 }
 
-kj::Promise<size_t> IdentityTransformStreamImpl::readHelper(kj::ArrayPtr<kj::byte> bytes) {
+kj::Promise<size_t> IdentityTransformStreamImpl::readHelper(
+    kj::ArrayPtr<kj::byte> bytes, size_t minBytes) {
   KJ_SWITCH_ONEOF(state) {
     KJ_CASE_ONEOF(idle, Idle) {
       // No outstanding write request, switch to ReadRequest state.
 
       auto paf = kj::newPromiseAndFulfiller<size_t>();
-      state = ReadRequest { bytes, kj::mv(paf.fulfiller) };
+      state = ReadRequest { bytes, 0, minBytes, kj::mv(paf.fulfiller) };
       return kj::mv(paf.promise);
     }
     KJ_CASE_ONEOF(request, ReadRequest) {
@@ -1995,11 +1882,20 @@ kj::Promise<size_t> IdentityTransformStreamImpl::readHelper(kj::ArrayPtr<kj::byt
     }
     KJ_CASE_ONEOF(request, WriteRequest) {
       if (bytes.size() >= request.bytes.size()) {
-        // The write buffer will entirely fit into our read buffer; fulfill both requests.
+        // The write buffer will entirely fit into our read buffer; fulfill the write request.
         memcpy(bytes.begin(), request.bytes.begin(), request.bytes.size());
         auto result = request.bytes.size();
         request.fulfiller->fulfill();
 
+        if (result < minBytes) {
+          // Not enough to satisfy the read yet. Wait for further writes to fill in the rest.
+          auto paf = kj::newPromiseAndFulfiller<size_t>();
+          state = ReadRequest {
+            bytes.slice(result, bytes.size()), result, minBytes, kj::mv(paf.fulfiller)
+          };
+          return kj::mv(paf.promise);
+        }
+
         // Switch to idle state.
         state = Idle();
 
@@ -2007,6 +1903,7 @@ kj::Promise<size_t> IdentityTransformStreamImpl::readHelper(kj::ArrayPtr<kj::byt
       }
 
       // The write buffer won't quite fit into our read buffer; fulfill only the read request.
+      // Since minBytes <= maxBytes, filling the whole read buffer always satisfies the read.
       memcpy(bytes.begin(), request.bytes.begin(), bytes.size());
       request.bytes = request.bytes.slice(bytes.size(), request.bytes.size());
       return bytes.size();
@@ -2051,8 +1948,8 @@ kj::Promise<void> IdentityTransformStreamImpl::writeHelper(kj::ArrayPtr<const kj
       }
 
       if (bytes.size() == 0) {
-        // This is a close operation.
-        request.fulfiller->fulfill(size_t(0));
+        // This is a close operation. Any bytes accumulated so far are returned as a short read.
+        request.fulfiller->fulfill(kj::cp(request.filled));
         state = StreamStates::Closed();
         return kj::READY_NOW;
       }
@@ -2060,9 +1957,15 @@ kj::Promise<void> IdentityTransformStreamImpl::writeHelper(kj::ArrayPtr<const kj
       KJ_ASSERT(request.bytes.size() > 0);
 
       if (request.bytes.size() >= bytes.size()) {
-        // Our write buffer will entirely fit into the read buffer; fulfill both requests.
+        // Our write buffer will entirely fit into the read buffer; fulfill the write request.
         memcpy(request.bytes.begin(), bytes.begin(), bytes.size());
-        request.fulfiller->fulfill(bytes.size());
+        request.filled += bytes.size();
+        if (request.filled < request.minBytes) {
+          // The read wants more; keep it pending so the next write continues filling it.
+          request.bytes = request.bytes.slice(bytes.size(), request.bytes.size());
+          return kj::READY_NOW;
+        }
+        request.fulfiller->fulfill(kj::cp(request.filled));
         state = Idle();
         return kj::READY_NOW;
       }
@@ -2070,7 +1973,7 @@ kj::Promise<void> IdentityTransformStreamImpl::writeHelper(kj::ArrayPtr<const kj
       // Our write buffer won't quite fit into the read buffer; fulfill only the read request.
       memcpy(request.bytes.begin(), bytes.begin(), request.bytes.size());
       bytes = bytes.slice(request.bytes.size(), bytes.size());
-      request.fulfiller->fulfill(request.bytes.size());
+      request.fulfiller->fulfill(request.filled + request.bytes.size());
 
       auto paf = kj::newPromiseAndFulfiller<void>();
       state = WriteRequest { bytes, kj::mv(paf.fulfiller) };
@@ -310,7 +310,7 @@ public:
 
   kj::Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override;
 
-  kj::Promise<size_t> tryReadInternal(void* buffer, size_t maxBytes);
+  kj::Promise<size_t> tryReadInternal(void* buffer, size_t minBytes, size_t maxBytes);
 
   kj::Promise<DeferredProxy<void>> pumpTo(WritableStreamSink& output, bool end) override;
 
@@ -329,7 +329,7 @@ public:
   void abort(kj::Exception reason) override;
 
 private:
-  kj::Promise<size_t> readHelper(kj::ArrayPtr<kj::byte> bytes);
+  kj::Promise<size_t> readHelper(kj::ArrayPtr<kj::byte> bytes, size_t minBytes);
 
   kj::Promise<void> writeHelper(kj::ArrayPtr<const kj::byte> bytes);
 
@@ -337,9 +337,19 @@ private:
 
   struct ReadRequest {
     kj::ArrayPtr<kj::byte> bytes;
+    // The unfilled remainder of the read buffer.
     // WARNING: `bytes` may be invalid if fulfiller->isWaiting() returns false! (This indicates the
     //   read was canceled.)
 
+    size_t filled;
+    // Number of bytes already copied into the read buffer (i.e. preceding `bytes`) by earlier
+    // writes.
+
+    size_t minBytes;
+    // The read is not fulfilled until at least this many bytes have been filled, or the writable
+    // side is closed. Writes which leave the read short of `minBytes` are fulfilled immediately,
+    // so that a single read can accumulate several writes without a round trip per write.
+
     kj::Own<kj::PromiseFulfiller<size_t>> fulfiller;
   };
 
@@ -0,0 +1,303 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "ring-tee.h"
+#include <kj/test.h>
+
+namespace workerd::api {
+namespace {
+
+// Produces the bytes 0, 1, 2, ... (mod 256) up to `size`, at most `chunkSize` per read.
+class CountingSource final: public ReadableStreamSource {
+public:
+  CountingSource(size_t size, size_t chunkSize): size(size), chunkSize(chunkSize) {}
+
+  kj::Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override {
+    ++reads;
+    auto amount = kj::min(kj::min(maxBytes, chunkSize), size - produced);
+    auto bytes = static_cast<kj::byte*>(buffer);
+    for (auto i: kj::zeroTo(amount)) {
+      bytes[i] = (produced + i) % 256;
+    }
+    produced += amount;
+    return amount;
+  }
+
+  kj::Maybe<uint64_t> tryGetLength(StreamEncoding encoding) override {
+    return uint64_t(size - produced);
+  }
+
+  void cancel(kj::Exception reason) override {
+    canceled = true;
+  }
+
+  size_t size;
+  size_t chunkSize;
+  size_t produced = 0;
+  uint reads = 0;
+  bool canceled = false;
+};
+
+// A sink whose writes don't complete until the test says so.
+class HeldSink final: public WritableStreamSink {
+public:
+  kj::Promise<void> write(const void* buffer, size_t size) override {
+    auto bytes = kj::arrayPtr(static_cast<const kj::byte*>(buffer), size);
+    received.addAll(bytes);
+    auto paf = kj::newPromiseAndFulfiller<void>();
+    pending.add(kj::mv(paf.fulfiller));
+    return kj::mv(paf.promise);
+  }
+
+  kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const kj::byte>> pieces) override {
+    KJ_UNIMPLEMENTED("not used");
+  }
+
+  kj::Promise<void> end() override {
+    ended = true;
+    return kj::READY_NOW;
+  }
+
+  void abort(kj::Exception reason) override {}
+
+  void releaseAll() {
+    auto toRelease = kj::mv(pending);
+    for (auto& fulfiller: toRelease) {
+      fulfiller->fulfill();
+    }
+  }
+
+  kj::Vector<kj::byte> received;
+  kj::Vector<kj::Own<kj::PromiseFulfiller<void>>> pending;
+  bool ended = false;
+};
+
+class PeakObserver final: public RequestObserver {
+public:
+  explicit PeakObserver(kj::Maybe<uint64_t>& peak): peak(peak) {}
+  void reportTeeBufferPeak(uint64_t bytes) override { peak = bytes; }
+
+  kj::Maybe<uint64_t>& peak;
+};
+
+void expectCounting(kj::ArrayPtr<const kj::byte> bytes, size_t start = 0) {
+  for (auto i: kj::indices(bytes)) {
+    KJ_ASSERT(bytes[i] == (start + i) % 256, i);
+  }
+}
+
+KJ_TEST("ring tee delivers the same bytes to both branches") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  auto source = kj::heap<CountingSource>(100000, 1000);
+  auto& sourceRef = *source;
+  auto tee = newRingTee(kj::mv(source));
+
+  auto& a = *tee.branches[0];
+  auto& b = *tee.branches[1];
+
+  KJ_EXPECT(KJ_ASSERT_NONNULL(a.tryGetLength(StreamEncoding::IDENTITY)) == 100000);
+
+  kj::byte bufA[4096];
+  kj::byte bufB[1500];
+  size_t offsetA = 0;
+  size_t offsetB = 0;
+  for (;;) {
+    auto amountA = a.tryRead(bufA, 1, sizeof(bufA)).wait(ws);
+    expectCounting(kj::arrayPtr(bufA, amountA), offsetA);
+    offsetA += amountA;
+
+    auto amountB = b.tryRead(bufB, sizeof(bufB), sizeof(bufB)).wait(ws);
+    expectCounting(kj::arrayPtr(bufB, amountB), offsetB);
+    offsetB += amountB;
+
+    if (amountA == 0 && amountB == 0) break;
+  }
+
+  KJ_EXPECT(offsetA == 100000);
+  KJ_EXPECT(offsetB == 100000);
+
+  // Each byte was read from the source exactly once.
+  KJ_EXPECT(sourceRef.produced == 100000);
+}
+
+KJ_TEST("ring tee reads straight through once the other branch is gone") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  kj::Maybe<uint64_t> peak;
+  auto source = kj::heap<CountingSource>(10000, 10000);
+  auto tee = newRingTee(kj::mv(source), RingTeeOptions {
+    .observer = kj::Own<RequestObserver>(kj::refcounted<PeakObserver>(peak)),
+  });
+
+  tee.branches[1]->cancel(KJ_EXCEPTION(DISCONNECTED, "canceled"));
+  tee.branches[1] = nullptr;
+
+  kj::byte buf[10000];
+  KJ_EXPECT(tee.branches[0]->tryRead(buf, sizeof(buf), sizeof(buf)).wait(ws) == 10000);
+  expectCounting(kj::arrayPtr(buf, sizeof(buf)));
+
+  tee.branches[0] = nullptr;
+  KJ_EXPECT(KJ_ASSERT_NONNULL(peak) == 0);
+}
+
+KJ_TEST("ring tee applies backpressure from a pumping branch") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  kj::Maybe<uint64_t> peak;
+  auto source = kj::heap<CountingSource>(1 << 20, 1024);
+  auto tee = newRingTee(kj::mv(source), RingTeeOptions {
+    .maxBranchLag = 4096,
+    .observer = kj::Own<RequestObserver>(kj::refcounted<PeakObserver>(peak)),
+  });
+
+  HeldSink sink;
+  auto pump = tee.branches[1]->pumpTo(sink, true);
+
+  // The fast branch may get up to 4096 bytes ahead of the pump, which is stuck on its first write.
+  kj::byte buf[1024];
+  size_t total = 0;
+  for (;;) {
+    auto promise = tee.branches[0]->tryRead(buf, 1, sizeof(buf));
+    if (!promise.poll(ws)) break;
+    auto amount = promise.wait(ws);
+    expectCounting(kj::arrayPtr(buf, amount), total);
+    total += amount;
+    KJ_ASSERT(total <= 8192);
+  }
+  KJ_EXPECT(total >= 4096);
+  KJ_EXPECT(sink.received.size() <= total);
+
+  // Letting the sink drain allows the fast branch to proceed.
+  auto promise = tee.branches[0]->tryRead(buf, 1, sizeof(buf));
+  KJ_EXPECT(!promise.poll(ws));
+  while (!promise.poll(ws)) {
+    sink.releaseAll();
+  }
+  KJ_EXPECT(promise.wait(ws) > 0);
+
+  tee.branches[0]->cancel(KJ_EXCEPTION(DISCONNECTED, "canceled"));
+  tee.branches[0] = nullptr;
+
+  while (!pump.poll(ws)) {
+    sink.releaseAll();
+  }
+  pump.wait(ws);
+  KJ_EXPECT(sink.ended);
+  KJ_EXPECT(sink.received.size() == 1 << 20);
+  expectCounting(sink.received.asPtr());
+
+  tee.branches[1] = nullptr;
+  KJ_EXPECT(KJ_ASSERT_NONNULL(peak) <= 8192);
+}
+
+KJ_TEST("ring tee errors a branch that falls past the buffer limit") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  auto source = kj::heap<CountingSource>(100000, 1000);
+  auto tee = newRingTee(kj::mv(source), RingTeeOptions { .bufferLimit = 10000 });
+
+  // Reading a branch that isn't being pumped is never blocked by its idle sibling...
+  kj::byte buf[1000];
+  size_t total = 0;
+  while (auto amount = tee.branches[0]->tryRead(buf, 1, sizeof(buf)).wait(ws)) {
+    total += amount;
+  }
+  KJ_EXPECT(total == 100000);
+
+  // ... but the sibling fails once it has fallen too far behind.
+  KJ_EXPECT_THROW_MESSAGE("tee() buffer limit exceeded",
+      tee.branches[1]->tryRead(buf, 1, sizeof(buf)).wait(ws));
+}
+
+KJ_TEST("ring tee keeps the bytes of a branch errored mid-write until the write completes") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  auto source = kj::heap<CountingSource>(100000, 1000);
+  auto tee = newRingTee(kj::mv(source), RingTeeOptions { .bufferLimit = 4096 });
+
+  HeldSink sink;
+  auto pump = tee.branches[1]->pumpTo(sink, true);
+  KJ_EXPECT(!pump.poll(ws));
+  KJ_EXPECT(sink.pending.size() == 1);
+
+  // The other branch reads until the pump, stuck on its first write, is too far behind. The pump
+  // is errored, but its write still points into the ring, so reading waits for it.
+  kj::byte buf[1000];
+  size_t total = 0;
+  for (;;) {
+    auto promise = tee.branches[0]->tryRead(buf, 1, sizeof(buf));
+    if (!promise.poll(ws)) break;
+    auto amount = promise.wait(ws);
+    expectCounting(kj::arrayPtr(buf, amount), total);
+    total += amount;
+  }
+  KJ_EXPECT(total == 4096);
+  KJ_EXPECT(sink.pending.size() == 1);
+
+  // Once the write completes the pump reports the error, and the other branch carries on.
+  sink.releaseAll();
+  KJ_EXPECT_THROW_MESSAGE("tee() buffer limit exceeded", pump.wait(ws));
+  expectCounting(sink.received.asPtr());
+
+  while (auto amount = tee.branches[0]->tryRead(buf, 1, sizeof(buf)).wait(ws)) {
+    expectCounting(kj::arrayPtr(buf, amount), total);
+    total += amount;
+  }
+  KJ_EXPECT(total == 100000);
+}
+
+KJ_TEST("ring tee returns immediately from zero-byte reads") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  auto source = kj::heap<CountingSource>(1000, 1000);
+  auto& sourceRef = *source;
+  auto tee = newRingTee(kj::mv(source));
+
+  kj::byte buf[1];
+  KJ_EXPECT(tee.branches[0]->tryRead(buf, 0, 0).wait(ws) == 0);
+  KJ_EXPECT(sourceRef.reads == 0);
+}
+
+KJ_TEST("ring tee can be teed again") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  auto source = kj::heap<CountingSource>(3000, 1000);
+  auto tee = newRingTee(kj::mv(source));
+
+  kj::byte buf[3000];
+  KJ_EXPECT(tee.branches[0]->tryRead(buf, 1000, 1000).wait(ws) == 1000);
+
+  auto inner = KJ_ASSERT_NONNULL(tee.branches[0]->tryTee(kj::maxValue));
+  for (auto& branch: inner.branches) {
+    KJ_EXPECT(branch->tryRead(buf, 2000, 2000).wait(ws) == 2000);
+    expectCounting(kj::arrayPtr(buf, 2000), 1000);
+  }
+  KJ_EXPECT(tee.branches[1]->tryRead(buf, 3000, 3000).wait(ws) == 3000);
+  expectCounting(kj::arrayPtr(buf, sizeof(buf)));
+}
+
+KJ_TEST("canceling every ring tee branch cancels the source") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  auto source = kj::heap<CountingSource>(3000, 1000);
+  auto& sourceRef = *source;
+  auto tee = newRingTee(kj::mv(source));
+
+  tee.branches[0]->cancel(KJ_EXCEPTION(DISCONNECTED, "canceled"));
+  KJ_EXPECT(!sourceRef.canceled);
+  tee.branches[1]->cancel(KJ_EXCEPTION(DISCONNECTED, "canceled"));
+  KJ_EXPECT(sourceRef.canceled);
+}
+
+}  // namespace
+}  // namespace workerd::api
@@ -0,0 +1,452 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "ring-tee.h"
+#include "internal.h"
+#include <workerd/api/util.h>
+#include <kj/vector.h>
+
+namespace workerd::api {
+
+namespace {
+
+// The ring buffer starts out small and doubles as needed. It never shrinks, but it only ever
+// grows when the slowest live branch is more than its current capacity behind the fastest.
+constexpr size_t INITIAL_RING_CAPACITY = 16 * 1024;
+
+// Upper bound on a single read from the inner stream, so that one pull doesn't force the ring to
+// grow far past what any branch has asked for.
+constexpr size_t MAX_PULL_SIZE = 64 * 1024;
+
+class RingTee final: public kj::Refcounted {
+public:
+  struct Cursor {
+    // Absolute offset, in bytes from the start of the inner stream, of the next byte this branch
+    // will read.
+    uint64_t offset;
+
+    // True while the branch has a pumpTo() in progress. Only pumping branches exert backpressure
+    // on the others.
+    bool pumping = false;
+
+    // True while pump() has a write in flight that points into the ring at `offset`.
+    bool writing = false;
+
+    // Set if this branch fell so far behind that it exceeded the buffer limit.
+    kj::Maybe<kj::Exception> error;
+  };
+
+  RingTee(kj::Own<ReadableStreamSource> inner, RingTeeOptions options)
+      : inner(kj::mv(inner)),
+        bufferLimit(options.bufferLimit),
+        maxBranchLag(options.maxBranchLag),
+        observer(kj::mv(options.observer)) {}
+
+  ~RingTee() noexcept(false) {
+    KJ_IF_MAYBE(o, observer) {
+      (*o)->reportTeeBufferPeak(peakBuffered);
+    }
+  }
+
+  void attach(Cursor& cursor) {
+    cursors.add(&cursor);
+  }
+
+  void detach(Cursor& cursor) {
+    for (auto& c: cursors) {
+      if (c == &cursor) {
+        c = cursors.back();
+        cursors.removeLast();
+        break;
+      }
+    }
+    // The detached branch may have been the one holding the start of the buffer, or exerting
+    // backpressure.
+    wakeAll();
+  }
+
+  bool hasBranches() { return cursors.size() > 0; }
+
+  kj::Promise<size_t> read(Cursor& cursor, kj::ArrayPtr<kj::byte> dest, size_t minBytes);
+
+  kj::Promise<void> pump(Cursor& cursor, WritableStreamSink& output);
+
+  kj::Maybe<uint64_t> tryGetLength(Cursor& cursor, StreamEncoding encoding) {
+    KJ_IF_MAYBE(length, inner->tryGetLength(encoding)) {
+      return *length + (endOffset - cursor.offset);
+    }
+    return nullptr;
+  }
+
+  void cancel(kj::Exception reason) {
+    inner->cancel(kj::mv(reason));
+  }
+
+private:
+  kj::Own<ReadableStreamSource> inner;
+  uint64_t bufferLimit;
+  uint64_t maxBranchLag;
+  kj::Maybe<kj::Own<RequestObserver>> observer;
+
+  kj::Vector<Cursor*> cursors;
+
+  // The ring holds bytes [startOffset(), endOffset), stored at `offset % ring.size()`.
+  kj::Array<kj::byte> ring;
+  uint64_t endOffset = 0;
+  uint64_t peakBuffered = 0;
+
+  bool eof = false;
+  kj::Maybe<kj::Exception> failure;
+
+  // True while a read from `inner` is outstanding. Only one branch pulls at a time; the others
+  // wait for it and then read the result out of the ring.
+  bool pulling = false;
+
+  // Number of in-flight writes pointing directly into `ring` (from pump()). While nonzero, a
+  // grown-out-of ring is kept alive in `retired` instead of being freed.
+  uint pins = 0;
+  kj::Vector<kj::Array<kj::byte>> retired;
+
+  kj::Vector<kj::Own<kj::PromiseFulfiller<void>>> waiters;
+
+  uint64_t startOffset() {
+    uint64_t result = endOffset;
+    for (auto cursor: cursors) {
+      // A branch that was errored mid-write still needs its bytes until the write completes.
+      if (cursor->error == nullptr || cursor->writing) {
+        result = kj::min(result, cursor->offset);
+      }
+    }
+    return result;
+  }
+
+  // Returns a promise which resolves the next time some branch makes progress, a pull finishes,
+  // or a branch is attached/detached.
+  kj::Promise<void> waitForChange() {
+    auto paf = kj::newPromiseAndFulfiller<void>();
+    waiters.add(kj::mv(paf.fulfiller));
+    return kj::mv(paf.promise);
+  }
+
+  void wakeAll() {
+    if (waiters.empty()) return;
+    auto toWake = kj::mv(waiters);
+    for (auto& waiter: toWake) {
+      waiter->fulfill();
+    }
+  }
+
+  void unpin() {
+    if (--pins == 0) {
+      retired.clear();
+    }
+  }
+
+  void copyOut(uint64_t offset, kj::ArrayPtr<kj::byte> dest) {
+    auto pos = offset % ring.size();
+    auto first = kj::min(dest.size(), ring.size() - pos);
+    memcpy(dest.begin(), ring.begin() + pos, first);
+    memcpy(dest.begin() + first, ring.begin(), dest.size() - first);
+  }
+
+  // Make sure the ring has free space, growing it if it's full. Growth preserves absolute offsets
+  // by re-laying out the live bytes at their new `offset % size` positions.
+  void ensureSpace() {
+    auto start = startOffset();
+    if (ring.size() > 0 && endOffset - start < ring.size()) return;
+
+    auto newRing = kj::heapArray<kj::byte>(kj::max(ring.size() * 2, INITIAL_RING_CAPACITY));
+    for (uint64_t offset = start; offset < endOffset;) {
+      auto pos = offset % newRing.size();
+      auto amount = kj::min(endOffset - offset, newRing.size() - pos);
+      copyOut(offset, newRing.slice(pos, pos + amount));
+      offset += amount;
+    }
+
+    if (pins > 0) {
+      retired.add(kj::mv(ring));
+    }
+    ring = kj::mv(newRing);
+  }
+
+  // Returns how many bytes may be read from `inner` on behalf of `reader` right now, erroring any
+  // branch that would be pushed past `bufferLimit`. Zero means `reader` must wait for a pumping
+  // branch to catch up.
+  uint64_t pullAllowance(Cursor& reader) {
+    uint64_t allowance = kj::maxValue;
+    for (auto cursor: cursors) {
+      if (cursor == &reader) continue;
+
+      uint64_t lag = endOffset - cursor->offset;
+      if (cursor->error != nullptr) {
+        // An errored branch that is still writing out of the ring keeps its bytes buffered, so
+        // don't let the ring grow past the limit on its account; wait for the write instead.
+        if (cursor->writing) {
+          allowance = kj::min(allowance, lag >= bufferLimit ? 0 : bufferLimit - lag);
+        }
+        continue;
+      }
+      if (lag >= bufferLimit) {
+        cursor->error = JSG_KJ_EXCEPTION(FAILED, TypeError, TEE_BUFFER_LIMIT_EXCEEDED_MESSAGE);
+        continue;
+      }
+      allowance = kj::min(allowance, bufferLimit - lag);
+
+      if (cursor->pumping) {
+        allowance = kj::min(allowance, lag >= maxBranchLag ? 0 : maxBranchLag - lag);
+      }
+    }
+    return allowance;
+  }
+
+  // Wait until there are bytes in the ring past `cursor`, or the inner stream has ended or
+  // failed, pulling from `inner` if necessary.
+  kj::Promise<void> fill(Cursor& cursor);
+
+  kj::Promise<void> pull(uint64_t allowance);
+
+  void recordPull(size_t amount) {
+    if (amount == 0) {
+      eof = true;
+    } else {
+      endOffset += amount;
+      peakBuffered = kj::max(peakBuffered, endOffset - startOffset());
+    }
+  }
+};
+
+kj::Promise<void> RingTee::fill(Cursor& cursor) {
+  for (;;) {
+    if (cursor.offset < endOffset || eof || failure != nullptr || cursor.error != nullptr) {
+      co_return;
+    }
+
+    if (pulling) {
+      co_await waitForChange();
+      continue;
+    }
+
+    auto allowance = pullAllowance(cursor);
+    if (allowance == 0) {
+      // Backpressure from a pumping branch.
+      co_await waitForChange();
+      continue;
+    }
+
+    co_await pull(allowance);
+  }
+}
+
+kj::Promise<void> RingTee::pull(uint64_t allowance) {
+  pulling = true;
+  KJ_DEFER({
+    pulling = false;
+    wakeAll();
+  });
+
+  ensureSpace();
+  auto pos = endOffset % ring.size();
+  auto startPos = startOffset() % ring.size();
+  size_t space = (endOffset == startOffset() || pos >= startPos)
+      ? ring.size() - pos : startPos - pos;
+  space = kj::min(space, kj::min(allowance, MAX_PULL_SIZE));
+
+  co_await inner->tryRead(ring.begin() + pos, 1, space).then([this](size_t amount) {
+    recordPull(amount);
+  }, [this](kj::Exception&& exception) {
+    failure = kj::mv(exception);
+  });
+}
+
+kj::Promise<size_t> RingTee::read(Cursor& cursor, kj::ArrayPtr<kj::byte> dest, size_t minBytes) {
+  size_t total = 0;
+  for (;;) {
+    KJ_IF_MAYBE(e, cursor.error) {
+      if (total > 0) co_return total;
+      kj::throwFatalException(kj::cp(*e));
+    }
+
+    if (cursor.offset < endOffset) {
+      auto amount = kj::min(endOffset - cursor.offset, dest.size() - total);
+      copyOut(cursor.offset, dest.slice(total, total + amount));
+      cursor.offset += amount;
+      total += amount;
+      wakeAll();
+      if (total >= minBytes) co_return total;
+      continue;
+    }
+
+    KJ_IF_MAYBE(e, failure) {
+      if (total > 0) co_return total;
+      kj::throwFatalException(kj::cp(*e));
+    }
+    if (eof) co_return total;
+
+    if (cursors.size() == 1 && !pulling) {
+      // We're the only branch left and have caught up, so nobody else needs these bytes: read
+      // straight into the caller's buffer without going through the ring.
+      pulling = true;
+      KJ_DEFER({
+        pulling = false;
+        wakeAll();
+      });
+      auto remaining = dest.slice(total, dest.size());
+      auto amount = co_await inner->tryRead(
+          remaining.begin(), kj::max(minBytes - total, size_t(1)), remaining.size());
+      if (amount == 0) {
+        eof = true;
+      } else {
+        endOffset += amount;
+        cursor.offset += amount;
+      }
+      total += amount;
+      if (total >= minBytes || amount == 0) co_return total;
+      continue;
+    }
+
+    co_await fill(cursor);
+  }
+}
+
+kj::Promise<void> RingTee::pump(Cursor& cursor, WritableStreamSink& output) {
+  cursor.pumping = true;
+  KJ_DEFER({
+    cursor.pumping = false;
+    wakeAll();
+  });
+
+  for (;;) {
+    co_await fill(cursor);
+
+    KJ_IF_MAYBE(e, cursor.error) {
+      kj::throwFatalException(kj::cp(*e));
+    }
+
+    if (cursor.offset < endOffset) {
+      // Write straight out of the ring. The bytes can't be overwritten while we wait, since our
+      // cursor holds the start of the buffer in place (even if the branch is errored meanwhile),
+      // and `pins` keeps the storage alive even if the ring is reallocated.
+      auto pos = cursor.offset % ring.size();
+      auto amount = kj::min(endOffset - cursor.offset, ring.size() - pos);
+      ++pins;
+      cursor.writing = true;
+      KJ_DEFER({
+        cursor.writing = false;
+        unpin();
+      });
+      co_await output.write(ring.begin() + pos, amount);
+      cursor.offset += amount;
+      wakeAll();
+      continue;
+    }
+
+    KJ_IF_MAYBE(e, failure) {
+      kj::throwFatalException(kj::cp(*e));
+    }
+    if (eof) co_return;
+  }
+}
+
+class RingTeeBranch final: public ReadableStreamSource {
+public:
+  RingTeeBranch(kj::Own<RingTee> tee, uint64_t offset)
+      : tee(kj::mv(tee)), cursor { .offset = offset } {
+    this->tee->attach(cursor);
+  }
+
+  ~RingTeeBranch() noexcept(false) {
+    detach();
+  }
+
+  kj::Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override {
+    if (maxBytes == 0) return size_t(0);
+    return requireTee().read(cursor,
+        kj::arrayPtr(static_cast<kj::byte*>(buffer), maxBytes),
+        kj::max(kj::min(minBytes, maxBytes), size_t(1)));
+  }
+
+  kj::Promise<DeferredProxy<void>> pumpTo(WritableStreamSink& output, bool end) override {
+#ifdef KJ_NO_RTTI
+    // Yes, I'm paranoid.
+    static_assert(!KJ_NO_RTTI, "Need RTTI for correctness");
+#endif
+
+    // HACK: If `output` is another TransformStream, we don't allow pumping to it, in order to
+    //   guarantee that we can't create cycles.
+    JSG_REQUIRE(kj::dynamicDowncastIfAvailable<IdentityTransformStreamImpl>(output) == nullptr,
+        TypeError, "Inter-TransformStream ReadableStream.pipeTo() is not implemented.");
+
+    // We implement our own pump so that the tee knows this branch is being pumped and can apply
+    // backpressure to the other branches accordingly.
+    co_await requireTee().pump(cursor, output);
+
+    if (end) {
+      co_await output.end();
+    }
+
+    // As with TeeBranch, ring tees are only used for locally-sourced streams, so none of the
+    // pump can be performed without the IoContext active.
+    co_return;
+  }
+
+  kj::Maybe<uint64_t> tryGetLength(StreamEncoding encoding) override {
+    if (encoding != StreamEncoding::IDENTITY) return nullptr;
+    KJ_IF_MAYBE(t, tee) {
+      return (*t)->tryGetLength(cursor, encoding);
+    }
+    return nullptr;
+  }
+
+  kj::Maybe<Tee> tryTee(uint64_t limit) override {
+    // Add two cursors at our current position to the same ring, and give up our own.
+    auto& t = requireTee();
+    auto offset = cursor.offset;
+    Tee result {
+      kj::heap<RingTeeBranch>(kj::addRef(t), offset),
+      kj::heap<RingTeeBranch>(kj::addRef(t), offset),
+    };
+    detach();
+    return kj::mv(result);
+  }
+
+  void cancel(kj::Exception reason) override {
+    KJ_IF_MAYBE(t, tee) {
+      auto ring = kj::mv(*t);
+      tee = nullptr;
+      ring->detach(cursor);
+      if (!ring->hasBranches()) {
+        // All branches have been canceled, so the source should be too.
+        ring->cancel(kj::mv(reason));
+      }
+    }
+  }
+
+private:
+  kj::Maybe<kj::Own<RingTee>> tee;
+  RingTee::Cursor cursor;
+
+  RingTee& requireTee() {
+    return *KJ_REQUIRE_NONNULL(tee, "tee branch has already been consumed");
+  }
+
+  void detach() {
+    KJ_IF_MAYBE(t, tee) {
+      (*t)->detach(cursor);
+      tee = nullptr;
+    }
+  }
+};
+
+}  // namespace
+
+ReadableStreamSource::Tee newRingTee(kj::Own<ReadableStreamSource> inner,
+                                     RingTeeOptions options) {
+  auto tee = kj::refcounted<RingTee>(kj::mv(inner), kj::mv(options));
+  return ReadableStreamSource::Tee {
+    kj::heap<RingTeeBranch>(kj::addRef(*tee), 0),
+    kj::heap<RingTeeBranch>(kj::addRef(*tee), 0),
+  };
+}
+
+}  // namespace workerd::api
@@ -0,0 +1,39 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+// A tee() implementation for ReadableStreamSources in which all branches share one ring buffer.
+
+#include "common.h"
+#include <workerd/io/observer.h>
+
+namespace workerd::api {
+
+struct RingTeeOptions {
+  // No branch may ever fall more than this many bytes behind the furthest-ahead branch. If
+  // reading further would exceed this, the lagging branches are errored, as with `kj::newTee()`.
+  uint64_t bufferLimit = kj::maxValue;
+
+  // While a lagging branch has a pumpTo() in progress, other branches may read at most this many
+  // bytes ahead of it; beyond that, their reads wait for the pump to catch up. Branches that are
+  // not being pumped do not exert backpressure, since there's no guarantee they will ever be
+  // read (e.g. the body of a cloned Response that is only read after the original).
+  uint64_t maxBranchLag = kj::maxValue;
+
+  // If provided, receives the peak number of bytes buffered over the lifetime of the tee when the
+  // tee is destroyed.
+  kj::Maybe<kj::Own<RequestObserver>> observer;
+};
+
+// Tee `inner` into two branches which read from a single shared ring buffer. Each chunk read
+// from `inner` is stored exactly once, no matter how many branches still need it, and each branch
+// keeps its own read cursor into the buffer. The buffer holds only the bytes between the slowest
+// and fastest live branches.
+//
+// Branches returned by this function implement `tryTee()` by adding another cursor to the same
+// shared buffer, so teeing a branch does not stack another layer of buffering.
+ReadableStreamSource::Tee newRingTee(kj::Own<ReadableStreamSource> inner,
+                                     RingTeeOptions options = {});
+
+}  // namespace workerd::api
@@ -3002,8 +3002,7 @@ private:
           }
 
           if constexpr (kj::isSameType<T, ByteReadable>()) {
-            jsg::BackingStore backing = bufferSource.detach(js);
-            return backing.asArrayPtr().attach(kj::mv(backing));
+            return bufferSource.detach(js).release();
           } else if constexpr (kj::isSameType<T, ValueReadable>()) {
             // We do not detach in this case because, as bad as an idea as it is,
             // the stream spec does allow a single typedarray/arraybuffer instance
@@ -42,3 +42,94 @@ export const arrayBufferOfReadable = {
     assert.equal(10_000, read.byteLength);
   }
 }
+
+export const readAtLeastIdentityTransform = {
+  async test() {
+    const { readable, writable } = new IdentityTransformStream();
+    const writer = writable.getWriter();
+    const reader = readable.getReader({ mode: 'byob' });
+
+    // A single pending readAtLeast() should accumulate several small writes.
+    const read = reader.readAtLeast(8, new Uint8Array(16));
+    await writer.write(new Uint8Array([1, 2, 3]));
+    await writer.write(new Uint8Array([4, 5, 6]));
+    const lastWrite = writer.write(new Uint8Array([7, 8, 9, 10]));
+    const result = await read;
+    assert.ok(!result.done);
+    assert.deepStrictEqual(result.value, new Uint8Array([1, 2, 3, 4, 5, 6, 7, 8, 9, 10]));
+    await lastWrite;
+
+    // A close before minBytes is reached yields a short read, then EOF.
+    const shortRead = reader.readAtLeast(8, new Uint8Array(16));
+    await writer.write(new Uint8Array([11, 12]));
+    await writer.close();
+    const short = await shortRead;
+    assert.ok(!short.done);
+    assert.deepStrictEqual(short.value, new Uint8Array([11, 12]));
+    assert.ok((await reader.read(new Uint8Array(1))).done);
+  }
+};
+
+export const readAtLeastFixedLengthStream = {
+  async test() {
+    const { readable, writable } = new FixedLengthStream(6);
+    const writer = writable.getWriter();
+    const reader = readable.getReader({ mode: 'byob' });
+
+    const read = reader.readAtLeast(6, new Uint8Array(6));
+    await writer.write(new Uint8Array([1, 2]));
+    await writer.write(new Uint8Array([3, 4]));
+    await writer.write(new Uint8Array([5, 6]));
+    const result = await read;
+    assert.deepStrictEqual(result.value, new Uint8Array([1, 2, 3, 4, 5, 6]));
+    await writer.close();
+    assert.ok((await reader.read(new Uint8Array(1))).done);
+  }
+};
+
+async function roundTrip(format, input) {
+  const cs = new CompressionStream(format);
+  const cw = cs.writable.getWriter();
+  cw.write(input);
+  cw.close();
+  const compressed = new Uint8Array(await new Response(cs.readable).arrayBuffer());
+
+  const ds = new DecompressionStream(format);
+  const dw = ds.writable.getWriter();
+  dw.write(compressed);
+  dw.close();
+  return new Uint8Array(await new Response(ds.readable).arrayBuffer());
+}
+
+export const compressionRoundTrip = {
+  async test() {
+    // Large enough, and incompressible enough, to span several internal output chunks.
+    const input = new Uint8Array(512 * 1024);
+    let x = 1;
+    for (let i = 0; i < input.length; i++) {
+      x = (x * 1103515245 + 12345) & 0x7fffffff;
+      input[i] = (i % 7 == 0) ? (x >> 16) : i % 251;
+    }
+    for (const format of ['gzip', 'deflate', 'deflate-raw', 'br']) {
+      const output = await roundTrip(format, input);
+      assert.strictEqual(output.byteLength, input.byteLength, format);
+      assert.deepStrictEqual(output, input, format);
+    }
+  }
+};
+
+export const brotliReadAtLeast = {
+  async test() {
+    const cs = new CompressionStream('br');
+    const cw = cs.writable.getWriter();
+    cw.write(new TextEncoder().encode('hello world '.repeat(1000)));
+    cw.close();
+
+    const ds = new DecompressionStream('br');
+    cs.readable.pipeTo(ds.writable);
+    const reader = ds.readable.getReader({ mode: 'byob' });
+    const result = await reader.readAtLeast(12000, new Uint8Array(12000));
+    assert.strictEqual(result.value.byteLength, 12000);
+    assert.strictEqual(new TextDecoder().decode(result.value), 'hello world '.repeat(1000));
+  }
+};
@@ -0,0 +1,86 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+// Timeouts scheduled in the same turn share a deadline, since Date.now() doesn't advance within a
+// turn, so the ones below run together as one batch.
+
+function assertEqual(a, b) {
+  if (a !== b) {
+    throw new Error(a + " !== " + b);
+  }
+}
+
+function sleep(ms) {
+  return new Promise(resolve => setTimeout(resolve, ms));
+}
+
+export default {
+  async test(ctrl, env, ctx) {
+    // Timeouts with the same deadline run in the order they were set.
+    {
+      const order = [];
+      await new Promise(resolve => {
+        for (let i = 0; i < 5; i++) {
+          setTimeout(() => {
+            order.push(i);
+            if (i == 4) resolve();
+          }, 5);
+        }
+      });
+      assertEqual(order.join(), "0,1,2,3,4");
+    }
+
+    // A callback can clear a timeout due at the same time that hasn't run yet.
+    {
+      const ran = [];
+      await new Promise(resolve => {
+        let later;
+        setTimeout(() => {
+          ran.push("first");
+          clearTimeout(later);
+        }, 5);
+        later = setTimeout(() => ran.push("later"), 5);
+        setTimeout(() => {
+          ran.push("last");
+          resolve();
+        }, 5);
+      });
+      assertEqual(ran.join(), "first,last");
+    }
+
+    // A callback that throws doesn't stop the rest of its batch.
+    {
+      const ran = [];
+      await new Promise(resolve => {
+        setTimeout(() => {
+          ran.push("throws");
+          throw new Error("expected error from timers-test");
+        }, 5);
+        setTimeout(() => {
+          ran.push("after");
+          resolve();
+        }, 5);
+      });
+      assertEqual(ran.join(), "throws,after");
+    }
+
+    // Intervals are rescheduled relative to when they ran, until cleared.
+    {
+      const times = [];
+      await new Promise(resolve => {
+        const id = setInterval(() => {
+          times.push(Date.now());
+          if (times.length == 3) {
+            clearInterval(id);
+            resolve();
+          }
+        }, 2);
+      });
+      await sleep(10);
+      assertEqual(times.length, 3);
+      assertEqual(times[1] - times[0] >= 2, true);
+      assertEqual(times[2] - times[1] >= 2, true);
+    }
+  }
+}
@@ -99,12 +99,7 @@ auto translateTeeErrors(Func&& f) -> decltype(kj::fwd<Func>(f)()) {
   } catch (...) {
     auto exception = kj::getCaughtExceptionAsKj();
     KJ_IF_MAYBE(e, translateKjException(exception, {
-      { "tee buffer size limit exceeded"_kj,
-        "ReadableStream.tee() buffer limit exceeded. This error usually occurs when a Request or "
-        "Response with a large body is cloned, then only one of the clones is read, forcing "
-        "the Workers runtime to buffer the entire body in memory. To fix this issue, remove "
-        "unnecessary calls to Request/Response.clone() and ReadableStream.tee(), and always read "
-        "clones/tees in parallel."_kj },
+      { "tee buffer size limit exceeded"_kj, TEE_BUFFER_LIMIT_EXCEEDED_MESSAGE },
     })) {
       kj::throwFatalException(kj::mv(*e));
     }
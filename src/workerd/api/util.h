@@ -83,6 +83,14 @@ kj::Maybe<kj::Exception> translateKjException(
 
 // =======================================================================================
 
+// The JS-visible message for a tee branch that fell too far behind its siblings.
+constexpr kj::StringPtr TEE_BUFFER_LIMIT_EXCEEDED_MESSAGE =
+    "ReadableStream.tee() buffer limit exceeded. This error usually occurs when a Request or "
+    "Response with a large body is cloned, then only one of the clones is read, forcing "
+    "the Workers runtime to buffer the entire body in memory. To fix this issue, remove "
+    "unnecessary calls to Request/Response.clone() and ReadableStream.tee(), and always read "
+    "clones/tees in parallel."_kj;
+
 // Wrap the given stream in an adapter which translates kj::newTee()-specific exceptions into
 // JS-visible exceptions.
 kj::Own<kj::AsyncInputStream> newTeeErrorAdapter(kj::Own<kj::AsyncInputStream> inner);
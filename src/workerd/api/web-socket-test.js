@@ -0,0 +1,46 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+function assertEqual(a, b) {
+  if (a !== b) {
+    throw new Error(a + " !== " + b);
+  }
+}
+
+function sleep(ms) {
+  return new Promise(resolve => setTimeout(resolve, ms));
+}
+
+export default {
+  async test(ctrl, env, ctx) {
+    const [client, server] = Object.values(new WebSocketPair());
+    server.accept();
+    assertEqual(server.bufferedAmount, 0);
+
+    // The client end isn't reading yet, so the sends stay queued.
+    server.send("hello");
+    server.send(new Uint8Array(10));
+    assertEqual(server.bufferedAmount, 15);
+    await sleep(5);
+    assertEqual(server.bufferedAmount, 15);
+
+    const received = [];
+    const done = new Promise(resolve => {
+      client.addEventListener("message", event => {
+        received.push(event.data);
+        if (received.length == 2) resolve();
+      });
+    });
+    client.accept();
+    await done;
+    assertEqual(received[0], "hello");
+    assertEqual(received[1].byteLength, 10);
+
+    // The pump notes the last write as done just after the client has read it.
+    for (let i = 0; i < 10 && server.bufferedAmount > 0; i++) {
+      await sleep(1);
+    }
+    assertEqual(server.bufferedAmount, 0);
+  }
+}
@@ -520,10 +520,12 @@ void WebSocket::send(jsg::Lock& js, kj::OneOf<kj::Array<byte>, kj::String> messa
   auto msg = [&]() -> kj::WebSocket::Message {
     KJ_SWITCH_ONEOF(message) {
       KJ_CASE_ONEOF(text, kj::String) {
+        native.bufferedAmount += text.size();
         return kj::mv(text);
         break;
       }
       KJ_CASE_ONEOF(data, kj::Array<byte>) {
+        native.bufferedAmount += data.size();
         return kj::mv(data);
         break;
       }
@@ -606,6 +608,10 @@ int WebSocket::getReadyState() {
   return READY_STATE_OPEN;
 }
 
+uint32_t WebSocket::getBufferedAmount() {
+  return static_cast<uint32_t>(kj::min(farNative->bufferedAmount, uint32_t(kj::maxValue)));
+}
+
 bool WebSocket::isAccepted() {
   return farNative->state.is<Accepted>();
 }
@@ -769,6 +775,7 @@ kj::Promise<void> WebSocket::pump(
     // Either we were already through all our outgoing messages or we experienced failure/
     // cancellation and cannot send these anyway.
     outgoingMessages.clear();
+    native.bufferedAmount = 0;
   });
 
   while (outgoingMessages.size() > 0) {
@@ -782,10 +789,12 @@ kj::Promise<void> WebSocket::pump(
     KJ_SWITCH_ONEOF(gatedMessage.message) {
       KJ_CASE_ONEOF(text, kj::String) {
         co_await ws.send(text);
+        native.bufferedAmount -= text.size();
         break;
       }
       KJ_CASE_ONEOF(data, kj::Array<byte>) {
         co_await ws.send(data);
+        native.bufferedAmount -= data.size();
         break;
       }
       KJ_CASE_ONEOF(close, kj::WebSocket::Close) {
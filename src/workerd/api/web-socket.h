@@ -276,11 +276,14 @@ public:
   kj::Promise<DeferredProxy<void>> couple(kj::Own<kj::WebSocket> other);
 
   // Extract the kj::WebSocket from this api::WebSocket (if applicable). The kj::WebSocket will be
-  // owned elsewhere, but the api::WebSocket will retain a reference.
-  kj::Own<kj::WebSocket> acceptAsHibernatable() {
+  // owned elsewhere, but the api::WebSocket will retain a reference. `wrap` is given the
+  // kj::WebSocket and returns the (possibly wrapped) websocket that the api::WebSocket should
+  // refer to from now on, which is then returned to the caller.
+  template <typename Func>
+  auto acceptAsHibernatable(Func&& wrap) {
     KJ_IF_MAYBE(hibernatable, farNative->state.tryGet<AwaitingAcceptanceOrCoupling>()) {
       // We can only request hibernation if we have not called accept.
-      auto ws = kj::mv(hibernatable->ws);
+      auto ws = wrap(kj::mv(hibernatable->ws));
       // We pass a reference to the kj::WebSocket for the api::WebSocket to refer to when calling
       // `send()` or `close()`.
       farNative->state.init<Accepted>(
@@ -403,6 +406,10 @@ public:
 
   int getReadyState();
 
+  // Bytes of data passed to send() which haven't been written to the connection yet, saturating at
+  // the largest value the property can hold.
+  uint32_t getBufferedAmount();
+
   bool isAccepted();
   bool isReleased();
 
@@ -434,11 +441,13 @@ public:
     // prototype.
     if (flags.getJsgPropertyOnPrototypeTemplate()) {
       JSG_READONLY_PROTOTYPE_PROPERTY(readyState, getReadyState);
+      JSG_READONLY_PROTOTYPE_PROPERTY(bufferedAmount, getBufferedAmount);
       JSG_READONLY_PROTOTYPE_PROPERTY(url, getUrl);
       JSG_READONLY_PROTOTYPE_PROPERTY(protocol, getProtocol);
       JSG_READONLY_PROTOTYPE_PROPERTY(extensions, getExtensions);
     } else {
       JSG_READONLY_INSTANCE_PROPERTY(readyState, getReadyState);
+      JSG_READONLY_INSTANCE_PROPERTY(bufferedAmount, getBufferedAmount);
       JSG_READONLY_INSTANCE_PROPERTY(url, getUrl);
       JSG_READONLY_INSTANCE_PROPERTY(protocol, getProtocol);
       JSG_READONLY_INSTANCE_PROPERTY(extensions, getExtensions);
@@ -619,6 +628,10 @@ private:
     // Have we detected that the peer has stopped accepting messages? We may want to clean up more
     // proactively in this case.
     bool outgoingAborted = false;
+
+    // Bytes of text and binary messages which are queued in outgoingMessages or being written.
+    // Reported to JavaScript as `bufferedAmount`.
+    size_t bufferedAmount = 0;
   };
 
   // The underlying native WebSocket (or a promise that will emplace one).
@@ -0,0 +1,198 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "hibernation-manager.h"
+#include <workerd/tests/test-fixture.h>
+#include <kj/test.h>
+
+namespace workerd {
+namespace {
+
+// None of these tests expect events to be dispatched. A websocket that is disconnected tries to
+// dispatch a close event, which fails here, so it's simply never delivered.
+class NullLoopback final: public Worker::Actor::Loopback {
+public:
+  kj::Own<WorkerInterface> getWorker(IoChannelFactory::SubrequestMetadata metadata) override {
+    KJ_UNIMPLEMENTED("not used by this test");
+  }
+
+  kj::Own<Loopback> addRef() override {
+    return kj::heap<NullLoopback>();
+  }
+};
+
+struct BroadcastTest {
+  kj::AsyncIoContext io = kj::setupAsyncIo();
+  TestFixture fixture = TestFixture({ .waitScope = io.waitScope });
+  kj::Own<HibernationManagerImpl> manager =
+      kj::heap<HibernationManagerImpl>(kj::heap<NullLoopback>(), 0);
+
+  // The client end of each accepted websocket, in the order they were accepted.
+  kj::Vector<kj::Own<kj::WebSocket>> clients;
+
+  ~BroadcastTest() noexcept(false) {
+    // Active websockets are JavaScript objects, which must be released under the lock.
+    fixture.runInIoContext([&](const TestFixture::Environment& env) {
+      manager->hibernateWebSockets(env.lock);
+    });
+    manager = nullptr;
+  }
+
+  jsg::Ref<api::WebSocket> accept(kj::ArrayPtr<const kj::StringPtr> tags) {
+    auto pipe = kj::newWebSocketPipe();
+    clients.add(kj::mv(pipe.ends[1]));
+    auto ws = jsg::alloc<api::WebSocket>(kj::mv(pipe.ends[0]), api::WebSocket::REMOTE);
+    auto ownTags = KJ_MAP(tag, tags) { return kj::str(tag); };
+    manager->acceptWebSocket(ws.addRef(), ownTags);
+    return ws;
+  }
+
+  kj::String receiveText(uint client) {
+    auto message = clients[client]->receive().wait(io.waitScope);
+    return kj::mv(message.get<kj::String>());
+  }
+
+  bool hasMessage(uint client) {
+    auto promise = clients[client]->receive();
+    return promise.poll(io.waitScope);
+  }
+};
+
+// For use within a request, where we can't wait().
+kj::Promise<void> expectMessages(kj::WebSocket& client, kj::Array<kj::StringPtr> expected) {
+  for (auto text: expected) {
+    auto message = co_await client.receive();
+    KJ_EXPECT(message.get<kj::String>() == text);
+  }
+}
+
+KJ_TEST("HibernationManager broadcast() keeps each websocket's messages in order") {
+  BroadcastTest test;
+
+  test.fixture.runInIoContext([&](const TestFixture::Environment& env) {
+    test.accept(nullptr);
+    test.accept(nullptr);
+    test.manager->hibernateWebSockets(env.lock);
+
+    // Nobody is reading yet, so these all queue up behind the first.
+    KJ_EXPECT(test.manager->broadcast(env.js, kj::str("one"), nullptr, nullptr) == 2);
+    KJ_EXPECT(test.manager->broadcast(env.js, kj::str("two"), nullptr, nullptr) == 2);
+
+    // Sends by the application on a websocket that was woken up go through the same queue.
+    auto woken = test.manager->getWebSockets(env.js, nullptr);
+    for (auto& ws: woken) {
+      ws->send(env.js, kj::str("three"));
+    }
+    KJ_EXPECT(test.manager->broadcast(env.js, kj::str("four"), nullptr, nullptr) == 2);
+
+    // The application's sends only proceed while its request is running, so receive within it.
+    auto received = KJ_MAP(client, test.clients) {
+      return expectMessages(*client, kj::arr("one"_kj, "two"_kj, "three"_kj, "four"_kj));
+    };
+    return kj::joinPromises(kj::mv(received)).then([&context = env.context, &test]() {
+      return context.run([&test](Worker::Lock& lock) {
+        test.manager->hibernateWebSockets(lock);
+      });
+    });
+  });
+}
+
+KJ_TEST("HibernationManager broadcast() waits for a write whose successor was canceled") {
+  BroadcastTest test;
+
+  test.fixture.runInIoContext([&](const TestFixture::Environment& env) {
+    test.accept(nullptr);
+    test.manager->hibernateWebSockets(env.lock);
+  });
+
+  test.fixture.runInIoContext([&](const TestFixture::Environment& env) {
+    // Nobody is reading, so the first broadcast is stuck writing. The application's send waits
+    // behind it, and the second broadcast behind that.
+    KJ_EXPECT(test.manager->broadcast(env.js, kj::str("one"), nullptr, nullptr) == 1);
+    auto woken = test.manager->getWebSockets(env.js, nullptr);
+    woken[0]->send(env.js, kj::str("two"));
+    KJ_EXPECT(test.manager->broadcast(env.js, kj::str("three"), nullptr, nullptr) == 1);
+    test.manager->hibernateWebSockets(env.lock);
+  });
+
+  // The application's send was canceled along with its IoContext, but the second broadcast still
+  // waited for the first rather than writing at the same time.
+  KJ_EXPECT(test.receiveText(0) == "one");
+  KJ_EXPECT(test.receiveText(0) == "three");
+}
+
+KJ_TEST("HibernationManager broadcast() disconnects only websockets that fall too far behind") {
+  BroadcastTest test;
+
+  test.fixture.runInIoContext([&](const TestFixture::Environment& env) {
+    test.accept(nullptr);
+    test.accept(nullptr);
+    test.manager->hibernateWebSockets(env.lock);
+  });
+
+  // Client 0 never reads, client 1 keeps up. A websocket may have 1MB of broadcasts queued.
+  size_t chunk = 400 * 1024;
+  uint sent = 0;
+  for (auto i: kj::zeroTo(4)) {
+    sent = test.fixture.runInIoContext([&](const TestFixture::Environment& env) {
+      return test.manager->broadcast(env.js, kj::repeat('x', chunk), nullptr, nullptr);
+    });
+    KJ_EXPECT(test.receiveText(1).size() == chunk, i);
+  }
+
+  // The third message would have put client 0 over the limit, so it was disconnected instead, and
+  // the rest went only to client 1.
+  KJ_EXPECT(sent == 1);
+  KJ_EXPECT_THROW(DISCONNECTED, test.clients[0]->receive().wait(test.io.waitScope));
+
+  test.fixture.runInIoContext([&](const TestFixture::Environment& env) {
+    KJ_EXPECT(test.manager->broadcast(env.js, kj::str("still here"), nullptr, nullptr) == 1);
+  });
+  KJ_EXPECT(test.receiveText(1) == "still here");
+}
+
+KJ_TEST("HibernationManager broadcast() skips closed and untagged websockets") {
+  BroadcastTest test;
+  kj::StringPtr red[] = { "red"_kj };
+  kj::StringPtr blue[] = { "blue"_kj };
+
+  test.fixture.runInIoContext([&](const TestFixture::Environment& env) {
+    auto sender = test.accept(red);
+    test.accept(red);
+    test.accept(blue);
+    auto closed = test.accept(red);
+    closed->close(env.js, 1000, kj::str("bye"));
+
+    // Awake: the closed websocket, the blue one, and the excluded sender don't get the message.
+    KJ_EXPECT(test.manager->broadcast(env.js, kj::str("awake"), "red"_kj, *sender) == 1);
+    KJ_EXPECT(test.manager->broadcast(env.js, kj::str("all"), nullptr, nullptr) == 3);
+
+    auto received = kj::arr(
+        expectMessages(*test.clients[0], kj::arr("all"_kj)),
+        expectMessages(*test.clients[1], kj::arr("awake"_kj, "all"_kj)),
+        expectMessages(*test.clients[2], kj::arr("all"_kj)),
+        test.clients[3]->receive().then([](kj::WebSocket::Message message) {
+          KJ_EXPECT(message.is<kj::WebSocket::Close>());
+        }));
+    return kj::joinPromises(kj::mv(received)).then([&context = env.context, &test]() {
+      return context.run([&test](Worker::Lock& lock) {
+        test.manager->hibernateWebSockets(lock);
+      });
+    });
+  });
+
+  // Hibernating: the closed websocket still doesn't get anything.
+  test.fixture.runInIoContext([&](const TestFixture::Environment& env) {
+    KJ_EXPECT(test.manager->broadcast(env.js, kj::str("asleep"), "red"_kj, nullptr) == 2);
+    KJ_EXPECT(test.manager->broadcast(env.js, kj::str("blue"), "blue"_kj, nullptr) == 1);
+    KJ_EXPECT(test.manager->broadcast(env.js, kj::str("none"), "green"_kj, nullptr) == 0);
+  });
+  KJ_EXPECT(test.receiveText(0) == "asleep");
+  KJ_EXPECT(test.receiveText(1) == "asleep");
+  KJ_EXPECT(test.receiveText(2) == "blue");
+  KJ_EXPECT(!test.hasMessage(3));
+}
+
+}  // namespace
+}  // namespace workerd
@@ -98,6 +98,78 @@ kj::Vector<jsg::Ref<api::WebSocket>> HibernationManagerImpl::getWebSockets(
   return kj::mv(matches);
 }
 
+uint HibernationManagerImpl::broadcast(
+    jsg::Lock& js,
+    kj::OneOf<kj::Array<byte>, kj::String> payload,
+    kj::Maybe<kj::StringPtr> maybeTag,
+    kj::Maybe<api::WebSocket&> except) {
+  auto message = kj::refcounted<SharedMessage>(kj::mv(payload));
+
+  // Like api::WebSocket::send(), we can't let the message out until the output gate allows it, but
+  // there's no need to wait on the gate separately for every websocket.
+  kj::Maybe<kj::ForkedPromise<void>> outputLock;
+  KJ_IF_MAYBE(lock, IoContext::current().waitForOutputLocksIfNecessary()) {
+    outputLock = lock->fork();
+  }
+
+  uint count = 0;
+  KJ_IF_MAYBE(tag, maybeTag) {
+    KJ_IF_MAYBE(item, tagToWs.find(*tag)) {
+      auto& list = *((*item)->list);
+      for (auto& entry: list) {
+        auto& hibWS = KJ_REQUIRE_NONNULL(entry.hibWS);
+        if (broadcastTo(js, hibWS, *message, outputLock, except)) {
+          ++count;
+        }
+      }
+    }
+  } else {
+    for (auto& hibWS : allWs) {
+      if (broadcastTo(js, *hibWS, *message, outputLock, except)) {
+        ++count;
+      }
+    }
+  }
+  return count;
+}
+
+bool HibernationManagerImpl::broadcastTo(
+    jsg::Lock& js,
+    HibernatableWebSocket& hib,
+    SharedMessage& message,
+    kj::Maybe<kj::ForkedPromise<void>>& outputLock,
+    kj::Maybe<api::WebSocket&> except) {
+  KJ_SWITCH_ONEOF(hib.activeOrPackage) {
+    KJ_CASE_ONEOF(active, jsg::Ref<api::WebSocket>) {
+      KJ_IF_MAYBE(e, except) {
+        if (e == active.get()) {
+          return false;
+        }
+      }
+      if (active->getReadyState() != api::WebSocket::READY_STATE_OPEN) {
+        return false;
+      }
+      // The websocket is awake, so send like the application would. This keeps the message in
+      // order with anything the application has already sent on it.
+      active->send(js, message.clone());
+      return true;
+    }
+    KJ_CASE_ONEOF(package, api::WebSocket::HibernationPackage) {
+      if (package.closedOutgoingConnection) {
+        return false;
+      }
+      KJ_IF_MAYBE(ws, hib.ws) {
+        kj::Maybe<kj::Promise<void>> lock;
+        KJ_IF_MAYBE(l, outputLock) {
+          lock = l->addBranch();
+        }
+        return (*ws)->queueSend(kj::addRef(message), kj::mv(lock));
+      }
+    }
+  }
+  return false;
+}
+
 void HibernationManagerImpl::setWebSocketAutoResponse(
     jsg::Ref<api::WebSocketRequestResponsePair> reqResp) {
   autoResponsePair = kj::mv(reqResp);
@@ -207,7 +279,8 @@ kj::Promise<void> HibernationManagerImpl::readLoop(HibernatableWebSocket& hib) {
               // autoResponseTimestamp on the active websocket.
               (*active)->setAutoResponseTimestamp(hib.autoResponseTimestamp);
             }
-            ws.send((*reqResp)->getResponse().asArray());
+            ws.queueSend(kj::refcounted<SharedMessage>(kj::str((*reqResp)->getResponse())),
+                nullptr);
             skip = true;
             // If we've sent an auto response message, we should not unhibernate or deliver the
             // received message to the actor
@@ -254,4 +327,144 @@ kj::Promise<void> HibernationManagerImpl::readLoop(HibernatableWebSocket& hib) {
   }
 }
 
+size_t HibernationManagerImpl::SharedMessage::size() {
+  KJ_SWITCH_ONEOF(payload) {
+    KJ_CASE_ONEOF(text, kj::String) {
+      return text.size();
+    }
+    KJ_CASE_ONEOF(data, kj::Array<byte>) {
+      return data.size();
+    }
+  }
+  KJ_UNREACHABLE;
+}
+
+kj::Promise<void> HibernationManagerImpl::SharedMessage::sendTo(kj::WebSocket& ws) {
+  KJ_SWITCH_ONEOF(payload) {
+    KJ_CASE_ONEOF(text, kj::String) {
+      return ws.send(text.asArray());
+    }
+    KJ_CASE_ONEOF(data, kj::Array<byte>) {
+      return ws.send(kj::ArrayPtr<const byte>(data));
+    }
+  }
+  KJ_UNREACHABLE;
+}
+
+kj::OneOf<kj::Array<byte>, kj::String> HibernationManagerImpl::SharedMessage::clone() {
+  KJ_SWITCH_ONEOF(payload) {
+    KJ_CASE_ONEOF(text, kj::String) {
+      return kj::str(text);
+    }
+    KJ_CASE_ONEOF(data, kj::Array<byte>) {
+      return kj::heapArray<byte>(data);
+    }
+  }
+  KJ_UNREACHABLE;
+}
+
+bool HibernationManagerImpl::QueuedSendWebSocket::queueSend(
+    kj::Own<SharedMessage> message, kj::Maybe<kj::Promise<void>> outputLock) {
+  if (aborted) {
+    return false;
+  }
+  auto size = message->size();
+  if (backlog > 0 && backlog + size > BACKLOG_LIMIT) {
+    // The peer isn't keeping up. Rather than buffering messages for it without bound, drop the
+    // connection; the read loop will fail and dispatch a close event to the application.
+    aborted = true;
+    inner->abort();
+    return false;
+  }
+  backlog += size;
+  backgroundSends.add(sendQueued(kj::mv(message), kj::mv(outputLock)));
+  return true;
+}
+
+kj::Promise<void> HibernationManagerImpl::QueuedSendWebSocket::sendQueued(
+    kj::Own<SharedMessage> message, kj::Maybe<kj::Promise<void>> outputLock) {
+  KJ_DEFER(backlog -= message->size());
+  // Take our place in line before waiting on the output lock, so that the message stays in order
+  // with writes started after it.
+  co_await serialize([&]() -> kj::Promise<void> {
+    KJ_IF_MAYBE(lock, outputLock) {
+      return kj::mv(*lock).then([&]() { return message->sendTo(*inner); });
+    }
+    return message->sendTo(*inner);
+  });
+}
+
+kj::Promise<void> HibernationManagerImpl::QueuedSendWebSocket::serialize(
+    kj::Function<kj::Promise<void>()> write) {
+  auto paf = kj::newPromiseAndFulfiller<kj::Promise<void>>();
+  auto previous = kj::mv(lastWrite).fork();
+  lastWrite = kj::mv(paf.promise);
+  bool started = false;
+  KJ_DEFER({
+    // If we're canceled before our turn, e.g. because the pump of an api::WebSocket was torn down
+    // with its IoContext, the writes queued behind us must still wait for the ones ahead of us.
+    paf.fulfiller->fulfill(started ? kj::Promise<void>(kj::READY_NOW) : previous.addBranch());
+  });
+  co_await previous.addBranch();
+  started = true;
+  co_await write();
+}
+
+kj::Promise<void> HibernationManagerImpl::QueuedSendWebSocket::send(
+    kj::ArrayPtr<const byte> message) {
+  return serialize([this, message]() { return inner->send(message); });
+}
+
+kj::Promise<void> HibernationManagerImpl::QueuedSendWebSocket::send(
+    kj::ArrayPtr<const char> message) {
+  return serialize([this, message]() { return inner->send(message); });
+}
+
+kj::Promise<void> HibernationManagerImpl::QueuedSendWebSocket::close(
+    uint16_t code, kj::StringPtr reason) {
+  return serialize([this, code, reason]() { return inner->close(code, reason); });
+}
+
+kj::Promise<void> HibernationManagerImpl::QueuedSendWebSocket::disconnect() {
+  return serialize([this]() { return inner->disconnect(); });
+}
+
+void HibernationManagerImpl::QueuedSendWebSocket::abort() {
+  aborted = true;
+  inner->abort();
+}
+
+kj::Promise<void> HibernationManagerImpl::QueuedSendWebSocket::whenAborted() {
+  return inner->whenAborted();
+}
+
+kj::Promise<kj::WebSocket::Message> HibernationManagerImpl::QueuedSendWebSocket::receive(
+    size_t maxSize) {
+  return inner->receive(maxSize);
+}
+
+kj::Promise<void> HibernationManagerImpl::QueuedSendWebSocket::pumpTo(kj::WebSocket& other) {
+  return inner->pumpTo(other);
+}
+
+kj::Maybe<kj::Promise<void>> HibernationManagerImpl::QueuedSendWebSocket::tryPumpFrom(
+    kj::WebSocket& other) {
+  // Pumping into us has to go through send() so that it is serialized with queued messages.
+  return nullptr;
+}
+
+kj::Maybe<kj::String> HibernationManagerImpl::QueuedSendWebSocket::getPreferredExtensions(
+    ExtensionsContext ctx) {
+  // Needed so that a Response can offer the compression configuration of the real websocket.
+  return inner->getPreferredExtensions(ctx);
+}
+
+uint64_t HibernationManagerImpl::QueuedSendWebSocket::sentByteCount() {
+  return inner->sentByteCount();
+}
+
+uint64_t HibernationManagerImpl::QueuedSendWebSocket::receivedByteCount() {
+  return inner->receivedByteCount();
+}
+
 }; // namespace workerd
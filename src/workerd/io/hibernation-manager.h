@@ -36,6 +36,12 @@ public:
       jsg::Lock& js,
       kj::Maybe<kj::StringPtr> tag) override;
 
+  // Sends `message` to the websockets associated with the given tag (or all accepted websockets),
+  // except `except`, without waking hibernating websockets. Hibernating websockets all send from
+  // one shared copy of the message. Returns the number of websockets the message was queued for.
+  uint broadcast(jsg::Lock& js, kj::OneOf<kj::Array<byte>, kj::String> message,
+      kj::Maybe<kj::StringPtr> tag, kj::Maybe<api::WebSocket&> except) override;
+
   // Hibernates all the websockets held by the HibernationManager.
   // This converts our activeOrPackage from an api::WebSocket to a HibernationPackage.
   void hibernateWebSockets(Worker::Lock& lock) override;
@@ -52,6 +58,74 @@ private:
 
   kj::Promise<void> handleReadLoop(HibernatableWebSocket& refToHibernatable);
 
+  // A message sent by broadcast() or as an auto-response. It is refcounted so that every
+  // websocket it is queued on can send from the same copy.
+  struct SharedMessage: public kj::Refcounted {
+    kj::OneOf<kj::Array<byte>, kj::String> payload;
+
+    explicit SharedMessage(kj::OneOf<kj::Array<byte>, kj::String> payload)
+        : payload(kj::mv(payload)) {}
+
+    size_t size();
+    kj::Promise<void> sendTo(kj::WebSocket& ws);
+
+    // Makes an owned copy, for sending through an api::WebSocket.
+    kj::OneOf<kj::Array<byte>, kj::String> clone();
+  };
+
+  // Wraps the kj::WebSocket of a HibernatableWebSocket. The api::WebSocket (whenever one exists)
+  // and the HibernationManager both write through this wrapper, which makes sure that only one
+  // write is in progress at a time and that writes happen in the order they were started.
+  class QueuedSendWebSocket final: public kj::WebSocket {
+  public:
+    QueuedSendWebSocket(kj::Own<kj::WebSocket> inner, kj::TaskSet::ErrorHandler& errorHandler)
+        : inner(kj::mv(inner)), backgroundSends(errorHandler) {}
+
+    // Queues `message` behind all writes started so far. It is sent once `outputLock`, if any,
+    // resolves. If the peer has fallen so far behind that the bytes queued this way would exceed
+    // BACKLOG_LIMIT, the connection is aborted instead and false is returned; the read loop
+    // then reports the disconnect to the application.
+    bool queueSend(kj::Own<SharedMessage> message, kj::Maybe<kj::Promise<void>> outputLock);
+
+    kj::Promise<void> send(kj::ArrayPtr<const byte> message) override;
+    kj::Promise<void> send(kj::ArrayPtr<const char> message) override;
+    kj::Promise<void> close(uint16_t code, kj::StringPtr reason) override;
+    kj::Promise<void> disconnect() override;
+    void abort() override;
+    kj::Promise<void> whenAborted() override;
+    kj::Promise<Message> receive(size_t maxSize = SUGGESTED_MAX_MESSAGE_SIZE) override;
+    kj::Promise<void> pumpTo(kj::WebSocket& other) override;
+    kj::Maybe<kj::Promise<void>> tryPumpFrom(kj::WebSocket& other) override;
+    kj::Maybe<kj::String> getPreferredExtensions(ExtensionsContext ctx) override;
+    uint64_t sentByteCount() override;
+    uint64_t receivedByteCount() override;
+
+    // The most bytes queueSend() will hold for one websocket.
+    static constexpr size_t BACKLOG_LIMIT = 1024 * 1024;
+
+  private:
+    kj::Own<kj::WebSocket> inner;
+
+    // Resolves once the most recently started write has finished.
+    kj::Promise<void> lastWrite = kj::READY_NOW;
+
+    // Bytes queued by queueSend() which haven't been written yet.
+    size_t backlog = 0;
+
+    // True once the connection has been aborted, by queueSend() or abort().
+    bool aborted = false;
+
+    // Writes started by queueSend(). Declared after `inner` so they are canceled first.
+    kj::TaskSet backgroundSends;
+
+    // Runs `write` once all previously started writes have finished. Writes started later wait
+    // for those too, even if this one is canceled before it runs.
+    kj::Promise<void> serialize(kj::Function<kj::Promise<void>()> write);
+
+    kj::Promise<void> sendQueued(
+        kj::Own<SharedMessage> message, kj::Maybe<kj::Promise<void>> outputLock);
+  };
+
   // Each HibernatableWebSocket can have multiple tags, so we want to store a reference
   // in our kj::List.
   struct TagListItem {
@@ -78,8 +152,12 @@ private:
         : tagItems(kj::heapArray<TagListItem>(tags.size())),
           activeOrPackage(kj::mv(websocket)),
           // Extract's the kj::Own<kj::WebSocket> from api::WebSocket so the HibernatableWebSocket
-          // can own it. The api::WebSocket retains a reference to our ws.
-          ws(activeOrPackage.get<jsg::Ref<api::WebSocket>>()->acceptAsHibernatable()),
+          // can own it, wrapped so that broadcast() can write to it too. The api::WebSocket
+          // retains a reference to our ws.
+          ws(activeOrPackage.get<jsg::Ref<api::WebSocket>>()->acceptAsHibernatable(
+              [&](kj::Own<kj::WebSocket> inner) {
+            return kj::heap<QueuedSendWebSocket>(kj::mv(inner), manager.onDisconnect);
+          })),
           manager(manager) {}
 
     ~HibernatableWebSocket() noexcept(false) {
@@ -133,7 +211,7 @@ private:
     // hibernatable. It becomes null once we dispatch a close or error event because we want its
     // lifetime to be managed by IoContext's DeleteQueue. This helps prevent a situation where the
     // HibernationManager drops the websocket before all queued messages have sent.
-    kj::Maybe<kj::Own<kj::WebSocket>> ws;
+    kj::Maybe<kj::Own<QueuedSendWebSocket>> ws;
 
     HibernationManagerImpl& manager;
     // TODO(someday): We (currently) only use the HibernationManagerImpl reference to refer to
@@ -161,6 +239,10 @@ private:
   // Removes the HibernatableWebSocket from `allWs`.
   inline void removeFromAllWs(HibernatableWebSocket& hib);
 
+  // Sends a broadcast() message to one websocket. Returns false if it was skipped.
+  bool broadcastTo(jsg::Lock& js, HibernatableWebSocket& hib, SharedMessage& message,
+      kj::Maybe<kj::ForkedPromise<void>>& outputLock, kj::Maybe<api::WebSocket&> except);
+
   // Handles the termination of the websocket. If termination was not clean, we might try to
   // dispatch a close event (if we haven't already), or an error event.
   // We will also remove the HibernatableWebSocket from the HibernationManager's collections.
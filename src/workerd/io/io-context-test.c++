@@ -0,0 +1,76 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "io-context.h"
+#include <workerd/tests/test-fixture.h>
+#include <kj/test.h>
+
+namespace workerd {
+namespace {
+
+KJ_TEST("awaitIo() results delivered in one batch fail independently") {
+  TestFixture fixture;
+
+  fixture.runInIoContext([&](const TestFixture::Environment& env) -> kj::Promise<void> {
+    auto ran = kj::heap<kj::Vector<uint>>();
+    auto& ranRef = *ran;
+
+    // All four are ready before the lock is released, so they're delivered by the same run.
+    kj::Vector<kj::Promise<kj::Maybe<kj::Exception>>> results;
+    auto add = [&](kj::Promise<void> promise) {
+      results.add(promise.then([]() -> kj::Maybe<kj::Exception> {
+        return nullptr;
+      }, [](kj::Exception&& e) -> kj::Maybe<kj::Exception> {
+        return kj::mv(e);
+      }));
+    };
+    add(env.context.runResolutionForTest([&ranRef](Worker::Lock&) {
+      ranRef.add(1);
+    }));
+    add(env.context.runResolutionForTest([&ranRef](Worker::Lock&) {
+      ranRef.add(2);
+      KJ_FAIL_REQUIRE("kj error from resolution");
+    }));
+    add(env.context.runResolutionForTest([&ranRef](Worker::Lock& lock) {
+      ranRef.add(3);
+      jsg::Lock& js = lock;
+      js.throwException(js.error("js error from resolution"));
+    }));
+    add(env.context.runResolutionForTest([&ranRef](Worker::Lock&) {
+      ranRef.add(4);
+    }));
+
+    return kj::joinPromises(results.releaseAsArray())
+        .then([&ranRef](kj::Array<kj::Maybe<kj::Exception>> errors) {
+      KJ_EXPECT(kj::strArray(ranRef, ",") == "1,2,3,4");
+      KJ_EXPECT(errors[0] == nullptr);
+      KJ_EXPECT_THROW_MESSAGE("kj error from resolution",
+          kj::throwFatalException(kj::mv(KJ_ASSERT_NONNULL(errors[1]))));
+      KJ_EXPECT_THROW_MESSAGE("js error from resolution",
+          kj::throwFatalException(kj::mv(KJ_ASSERT_NONNULL(errors[2]))));
+      KJ_EXPECT(errors[3] == nullptr);
+    }).attach(kj::mv(ran));
+  });
+}
+
+KJ_TEST("tryClaimOffThreadSlot() hands out at most `limit` slots at a time") {
+  TestFixture fixture;
+
+  fixture.runInIoContext([&](const TestFixture::Environment& env) {
+    auto first = env.context.tryClaimOffThreadSlot(2);
+    auto second = env.context.tryClaimOffThreadSlot(2);
+    KJ_EXPECT(first != nullptr);
+    KJ_EXPECT(second != nullptr);
+    KJ_EXPECT(env.context.tryClaimOffThreadSlot(2) == nullptr);
+
+    // A larger limit counts the same slots. This one is released right away.
+    KJ_EXPECT(env.context.tryClaimOffThreadSlot(3) != nullptr);
+
+    first = nullptr;
+    KJ_EXPECT(env.context.tryClaimOffThreadSlot(2) != nullptr);
+  });
+}
+
+}  // namespace
+}  // namespace workerd
@@ -9,7 +9,7 @@
 #include <kj/debug.h>
 #include <workerd/jsg/jsg.h>
 #include <workerd/util/sentry.h>
-#include <map>
+#include <workerd/util/timer-wheel.h>
 
 namespace workerd {
 
@@ -37,92 +37,87 @@ void IoContext::DeleteQueue::scheduleDeletion(OwnedObject* object) const {
 class IoContext::TimeoutManagerImpl final: public TimeoutManager {
 public:
   class TimeoutState;
-  using Map = std::map<TimeoutId, TimeoutState>;
-  using Iterator = Map::iterator;
 
   TimeoutManagerImpl() = default;
   KJ_DISALLOW_COPY_AND_MOVE(TimeoutManagerImpl);
 
   TimeoutId setTimeout(
-      IoContext& context, TimeoutId::Generator& generator, TimeoutParameters params) override {
-    auto [id, it] = addState(generator, kj::mv(params));
-    setTimeoutImpl(context, it);
-    return id;
-  }
+      IoContext& context, TimeoutId::Generator& generator, TimeoutParameters params) override;
 
-  void clearTimeout(IoContext&, TimeoutId id) override;
+  void clearTimeout(IoContext& context, TimeoutId id) override;
 
   size_t getTimeoutCount() const override {
     return timeoutsStarted - timeoutsFinished;
   }
 
   kj::Maybe<kj::Date> getNextTimeout() const override {
-    if (timeoutTimes.size() == 0) {
-      return nullptr;
-    } else {
-      return timeoutTimes.begin()->key.when;
+    // Timeouts which are running have already left the wheel, but until they finish, Date.now()
+    // must not pass the time they were scheduled for.
+    KJ_IF_MAYBE(when, firingWhen) {
+      return *when;
     }
+    KJ_IF_MAYBE(entry, wheel.front()) {
+      return entry->getDeadline();
+    }
+    return nullptr;
   }
 
 private:
-  struct IdAndIterator {
-    TimeoutId id;
-    Iterator it;
-  };
-  IdAndIterator addState(TimeoutId::Generator& generator, TimeoutParameters params);
-
-  void setTimeoutImpl(IoContext& context, Iterator it);
-
-  // A pair of a Date and a numeric ID, used as entry in timeoutTimes set, below.
-  struct TimeoutTime {
-    kj::Date when;
-    uint tiebreaker;  // Unique number, in case two timeouts target same time.
-
-    inline bool operator<(const TimeoutTime& other) const {
-      if (when < other.when) return true;
-      if (when > other.when) return false;
-      return tiebreaker < other.tiebreaker;
-    }
-    inline bool operator==(const TimeoutTime& other) const {
-      return when == other.when && tiebreaker == other.tiebreaker;
-    }
-  };
-
-  // Tracks registered timeouts sorted by the next time the timeout is expected to fire.
-  //
-  // The associated fulfiller should be fulfilled when the time has been reached AND all previous
-  // timeouts have completed.
-  kj::TreeMap<TimeoutTime, kj::Own<kj::PromiseFulfiller<void>>> timeoutTimes;
-  uint timeoutTimesTiebreakerCounter = 0;
+  // Scheduled timeouts, ordered by the time they're scheduled for and then by the order in which
+  // they were scheduled.
+  TimerWheel wheel;
 
   uint timeoutsStarted = 0;
   uint timeoutsFinished = 0;
-  Map timeouts;
+  kj::HashMap<TimeoutId, kj::Own<TimeoutState>> timeouts;
+
+  // Timeouts taken from the wheel to run together under one lock, and the time they were all
+  // scheduled for. Only one batch runs at a time, so timeouts can't run out of order.
+  kj::Vector<TimeoutState*> batch;
+  kj::Maybe<kj::Date> firingWhen;
 
-  // Promise that is waiting for the closest timeout, and will fulfill its fulfiller. We only ever
-  // actually wait on the next timeout in `timeoutTasks`, so that we can't fulfill timer callbacks
-  // out-of-order. This task gets replaced each time the lead timeout changes.
+  // Holds a pending event, and for actors a wait-until task, while any timeout is scheduled or
+  // running.
+  kj::Maybe<kj::Own<void>> activity;
+
+  // Waits for the earliest timeout, runs its batch, and repeats until the wheel is empty.
+  // `timerTaskWhen` is the time it's currently waiting for. Canceling timeouts doesn't replace the
+  // task, it just wakes up to find nothing to run yet; only scheduling an earlier timeout does.
+  kj::Maybe<kj::Date> timerTaskWhen;
   kj::Promise<void> timerTask = nullptr;
 
-  // Must be called any time timeoutTimes.begin() changes.
-  void resetTimerTask(TimerChannel& timerChannel);
+  void schedule(IoContext& context, TimeoutState& state);
+  void updateTimerTask(IoContext& context);
+  void updateActivity(IoContext& context);
+  kj::Promise<void> waitForTimeouts(IoContext& context, kj::Date when);
+  kj::Promise<void> runBatch(IoContext& context);
+  void releaseBatch();
 };
 
-class IoContext::TimeoutManagerImpl::TimeoutState {
+class IoContext::TimeoutManagerImpl::TimeoutState final: public TimerWheel::Entry {
 public:
-  TimeoutState(TimeoutManagerImpl& manager, TimeoutParameters params);
-  ~TimeoutState();
+  TimeoutState(TimeoutManagerImpl& manager, TimeoutId id, TimeoutParameters params);
+  ~TimeoutState() noexcept(false);
 
   void trigger(Worker::Lock& lock);
   void cancel();
 
+  // Timeouts can only run in the same batch if they run in the same critical section.
+  bool isInSameCriticalSection(const TimeoutState& other) const;
+
   TimeoutManagerImpl& manager;
+  TimeoutId id;
   TimeoutParameters params;
 
+  // The critical section current when the timeout was scheduled, which its callback runs in too.
+  kj::Maybe<kj::Own<InputGate::CriticalSection>> criticalSection;
+
   bool isCanceled = false;
   bool isRunning = false;
 
-  kj::Maybe<kj::Promise<void>> maybePromise;
+  // Whether the timeout has been taken from the wheel into the current batch. Until the batch
+  // finishes, clearTimeout() only marks the timeout canceled.
+  bool isInBatch = false;
 };
 
 ThreadContext::HeaderIdBundle::HeaderIdBundle(kj::HttpHeaderTable::Builder& builder)
@@ -294,6 +289,7 @@ IoContext::IncomingRequest::~IoContext_IncomingRequest() noexcept(false) {
     a->getMetrics().endRequest();
   }
   context->worker->getIsolate().completedRequest();
+  metrics->reportObjectArenaSize(context->ownedObjects.getArena().getReservedBytes());
   metrics->jsDone();
 }
 
@@ -458,6 +454,12 @@ void IoContext::addTask(kj::Promise<void> promise) {
   tasks.add(kj::mv(promise));
 }
 
+kj::Maybe<kj::Own<void>> IoContext::tryClaimOffThreadSlot(uint limit) {
+  if (offThreadSlotsClaimed >= limit) return nullptr;
+  ++offThreadSlotsClaimed;
+  return kj::Own<void>(kj::heap(kj::defer([this]() { --offThreadSlotsClaimed; })));
+}
+
 void IoContext::addWaitUntil(kj::Promise<void> promise) {
   if (actor == nullptr) {
     // This metric won't work correctly in actors since it's being tracked per-request, but tasks
@@ -585,12 +587,12 @@ TimeoutId TimeoutId::Generator::getNext() {
 }
 
 IoContext::TimeoutManagerImpl::TimeoutState::TimeoutState(
-    TimeoutManagerImpl& manager, TimeoutParameters params)
-    : manager(manager), params(kj::mv(params)) {
+    TimeoutManagerImpl& manager, TimeoutId id, TimeoutParameters params)
+    : manager(manager), id(id), params(kj::mv(params)) {
   ++manager.timeoutsStarted;
 }
 
-IoContext::TimeoutManagerImpl::TimeoutState::~TimeoutState() {
+IoContext::TimeoutManagerImpl::TimeoutState::~TimeoutState() noexcept(false) {
   KJ_ASSERT(!isRunning);
   if (!isCanceled) {
     ++manager.timeoutsFinished;
@@ -614,185 +616,242 @@ void IoContext::TimeoutManagerImpl::TimeoutState::cancel() {
     return;
   }
 
-  auto wasCanceled = isCanceled;
   isCanceled = true;
 
-  if (!isRunning && !wasCanceled) {
+  if (!isRunning) {
     params.function = nullptr;
-    maybePromise = nullptr;
   }
 
   ++manager.timeoutsFinished;
 }
 
-auto IoContext::TimeoutManagerImpl::addState(
-    TimeoutId::Generator& generator, TimeoutParameters params) -> IdAndIterator {
+bool IoContext::TimeoutManagerImpl::TimeoutState::isInSameCriticalSection(
+    const TimeoutState& other) const {
+  KJ_IF_MAYBE(cs, criticalSection) {
+    KJ_IF_MAYBE(otherCs, other.criticalSection) {
+      return cs->get() == otherCs->get();
+    }
+    return false;
+  }
+  return other.criticalSection == nullptr;
+}
+
+TimeoutId IoContext::TimeoutManagerImpl::setTimeout(
+    IoContext& context, TimeoutId::Generator& generator, TimeoutParameters params) {
   JSG_REQUIRE(getTimeoutCount() < MAX_TIMEOUTS, DOMQuotaExceededError,
               "You have exceeded the number of timeouts you may set.",
               MAX_TIMEOUTS);
 
   auto id = generator.getNext();
-  auto [it, wasEmplaced] = timeouts.try_emplace(id, *this, kj::mv(params));
-  if (!wasEmplaced) {
+  KJ_IF_MAYBE(existing, timeouts.find(id)) {
     // We shouldn't have reached here because the `TimeoutId::Generator` throws if it reaches
     // Number.MAX_SAFE_INTEGER, much less wraps around the uint64_t number space. Let's throw with
     // as many details as possible.
-    auto& state = it->second;
+    auto& state = **existing;
     auto delay = state.params.msDelay;
     auto repeat = state.params.repeat;
     KJ_FAIL_ASSERT("Saw a timeout id collision", getTimeoutCount(), id.toNumber(), delay, repeat);
   }
 
-  return { id, it };
+  auto& state = *timeouts.insert(id, kj::heap<TimeoutState>(*this, id, kj::mv(params))).value;
+  KJ_ON_SCOPE_FAILURE(timeouts.erase(id));
+  schedule(context, state);
+  return id;
+}
+
+void IoContext::TimeoutManagerImpl::schedule(IoContext& context, TimeoutState& state) {
+  // Always schedule the timeout relative to what Date.now() currently returns, so that the delay
+  // appear exact. Otherwise, the delay could reveal non-determinism containing side channels.
+  auto when = context.now() + state.params.msDelay * kj::MILLISECONDS;
+  state.criticalSection = context.getCriticalSection();
+  wheel.insert(state, when);
+
+  updateActivity(context);
+  updateTimerTask(context);
+}
+
+void IoContext::TimeoutManagerImpl::updateTimerTask(IoContext& context) {
+  if (firingWhen != nullptr) {
+    // The timer task itself moves on to the next timeout once the batch finishes. (Replacing it
+    // here would also destroy it while it's running.)
+    return;
+  }
+
+  KJ_IF_MAYBE(entry, wheel.front()) {
+    auto when = entry->getDeadline();
+    KJ_IF_MAYBE(current, timerTaskWhen) {
+      if (*current <= when) return;
+    }
+    timerTask = waitForTimeouts(context, when).eagerlyEvaluate([](kj::Exception&& e) {
+      KJ_LOG(ERROR, e);
+    });
+  } else {
+    timerTaskWhen = nullptr;
+    timerTask = nullptr;
+  }
+}
+
+void IoContext::TimeoutManagerImpl::updateActivity(IoContext& context) {
+  if (wheel.size() == 0 && firingWhen == nullptr) {
+    activity = nullptr;
+  } else if (activity == nullptr) {
+    kj::Own<void> event = context.registerPendingEvent();
+
+    if (context.actor != nullptr) {
+      // Add a wait-until task which resolves when no timeouts are left. This ensures that
+      // `IncomingRequest::drain()` waits until all timers finish.
+      auto paf = kj::newPromiseAndFulfiller<void>();
+      event = event.attach(kj::defer([fulfiller = kj::mv(paf.fulfiller)]() mutable {
+        fulfiller->fulfill();
+      }));
+      context.addWaitUntil(kj::mv(paf.promise));
+    }
+
+    activity = kj::mv(event);
+  }
 }
 
-void IoContext::TimeoutManagerImpl::setTimeoutImpl(IoContext& context, Iterator it) {
-  auto& state = it->second;
+kj::Promise<void> IoContext::TimeoutManagerImpl::waitForTimeouts(
+    IoContext& context, kj::Date when) {
+  timerTaskWhen = when;
+  return context.getIoChannelFactory().getTimer().atTime(when)
+      .then([this, &context, when]() -> kj::Promise<void> {
+    timerTaskWhen = nullptr;
 
-  auto stateGuard = kj::defer([&]() {
-    if (state.maybePromise == nullptr) {
-      // Something threw, erase the state.
-      timeouts.erase(it);
+    KJ_IF_MAYBE(entry, wheel.front()) {
+      auto next = entry->getDeadline();
+      if (next > when) {
+        // The timeout we were waiting for was canceled.
+        return waitForTimeouts(context, next);
+      }
+
+      return runBatch(context).then([this, &context]() -> kj::Promise<void> {
+        KJ_IF_MAYBE(entry, wheel.front()) {
+          return waitForTimeouts(context, entry->getDeadline());
+        }
+        return kj::READY_NOW;
+      });
     }
+
+    return kj::READY_NOW;
   });
+}
 
-  auto paf = kj::newPromiseAndFulfiller<void>();
+kj::Promise<void> IoContext::TimeoutManagerImpl::runBatch(IoContext& context) {
+  // Take every timeout scheduled for the same time as the first one, as long as it runs in the
+  // same critical section, so they can all run under one lock.
+  auto& first = static_cast<TimeoutState&>(KJ_ASSERT_NONNULL(wheel.pop()));
+  auto when = first.getDeadline();
+  batch.add(&first);
+  for (;;) {
+    TimeoutState* next = nullptr;
+    KJ_IF_MAYBE(entry, wheel.front()) {
+      next = static_cast<TimeoutState*>(entry);
+    }
+    if (next == nullptr || next->getDeadline() != when || !next->isInSameCriticalSection(first)) {
+      break;
+    }
+    wheel.pop();
+    batch.add(next);
+  }
+  for (auto state: batch) {
+    state->isInBatch = true;
+  }
+  firingWhen = when;
+
+  auto cs = first.criticalSection.map([](kj::Own<InputGate::CriticalSection>& cs) {
+    return kj::addRef(*cs);
+  });
 
-  // Always schedule the timeout relative to what Date.now() currently returns, so that the delay
-  // appear exact. Otherwise, the delay could reveal non-determinism containing side channels.
-  auto when = context.now() + state.params.msDelay * kj::MILLISECONDS;
   // TODO(cleanup): The manual use of run() here (including carrying over the critical section) is
   //   kind of ugly, but using awaitIo() doesn't work here because we need the ability to cancel
   //   the timer, so we don't want to addTask() it, which awaitIo() does implicitly.
-  auto promise = paf.promise
-      .then([this, &context, it, cs = context.getCriticalSection()]() mutable {
-    return context.run([this, &context, it] (Worker::Lock& lock) mutable {
-      auto& state = it->second;
-
-      auto stateGuard = kj::defer([&] {
-        if (state.maybePromise == nullptr) {
-          // At the end of this block, there was no new timeout, so we should remove the state.
-          // Note that this can happen from cancelTimeout or a non-repeating timeout.
-          timeouts.erase(it);
-        }
-      });
+  return context.run([this, &context](Worker::Lock& lock) {
+    jsg::Lock& js = lock;
 
-      if (state.isCanceled) {
-        // We've been canceled before running. Nothing more to do.
-        KJ_ASSERT(state.maybePromise == nullptr);
-        return;
+    for (auto state: batch) {
+      if (state->isCanceled) {
+        // An earlier callback in this batch canceled this one.
+        continue;
       }
 
-      KJ_IF_MAYBE(promise, state.maybePromise) {
-        // We could KJ_ASSERT_NONNULL(iter->second) instead if we are sure clearTimeout() couldn't
-        // race us. However, I'm not sure about that.
-
-        // First, move our timeout promise to the task set so it's safe to call clearInterval()
-        // inside the user's callback. We don't yet null out the Maybe<Promise>, because we need to
-        // be able to detect whether the user does call clearInterval(). We leave the actual map
-        // entry in place because this aids in reporting cross-request-context timeout cancellation
-        // errors to the user.
-        context.addTask(kj::mv(*promise));
-
-        // Because Promise has an underspecified move ctor, we need to explicitly nullify the Maybe
-        // to indicate that we've consumed the promise.
-        state.maybePromise = nullptr;
-
-        // The user's callback might throw, but we need to at least attempt to reschedule interval
-        // callbacks even if they throw. This deferred action takes care of that. Note that we don't
-        // run the user's callback directly in this->run(), because that function throws a fatal
-        // exception if a JS exception is thrown, which complicates our logic here.
-        //
-        // TODO(perf): If we can guarantee that `timeout->second = nullptr` will never throw, it
-        //   might be worthwhile having an early-out path for non-interval timeouts.
-        kj::UnwindDetector unwindDetector;
-        KJ_DEFER(
-          unwindDetector.catchExceptionsIfUnwinding([&] {
-            if (state.isCanceled) {
-              // The user's callback has called clearInterval(), nothing more to do.
-              KJ_ASSERT(state.maybePromise == nullptr);
-              return;
-            }
-
-            // If this is an interval task and the script has CPU time left, reschedule the task;
-            // otherwise leave the dead map entry in place.
-            if (state.params.repeat && context.limitEnforcer->getLimitsExceeded() == nullptr) {
-              setTimeoutImpl(context, it);
-            }
-          });
-        );
-
-        state.trigger(lock);
+      // A callback which throws a JavaScript error mustn't keep the rest of the batch from
+      // running, so we catch and log it here, the way run() would have if it had been run alone.
+      // Anything else (termination, exceeded limits, internal errors) propagates to run() and
+      // abandons the rest of the batch. (We don't use js.tryCatch() because it would turn those
+      // into JavaScript errors too.)
+      kj::Maybe<jsg::Value> error;
+      {
+        v8::TryCatch tryCatch(js.v8Isolate);
+        try {
+          state->trigger(lock);
+        } catch (jsg::JsExceptionThrown&) {
+          if (!tryCatch.CanContinue() || !tryCatch.HasCaught() || tryCatch.Exception().IsEmpty()) {
+            throw;
+          }
+          error = jsg::Value(js.v8Isolate, tryCatch.Exception());
+        } catch (kj::Exception& e) {
+          if (!jsg::isTunneledException(e.getDescription())) {
+            throw;
+          }
+          error = js.exceptionToJs(kj::mv(e));
+        }
+      }
+      KJ_IF_MAYBE(e, error) {
+        auto exception = jsg::JsValue(e->getHandle(js));
+        lock.logUncaughtException(UncaughtExceptionSource::INTERNAL,
+                                  exception, jsg::JsMessage::create(js, exception));
       }
-    }, kj::mv(cs));
-  }, [](kj::Exception&&) {});
-
-  promise = promise.attach(context.registerPendingEvent());
-
-  // Add an entry to the timeoutTimes map, to track when the nearest timeout is. Arrange for it
-  // to be removed when the promise completes.
-  TimeoutTime timeoutTimesKey { when, timeoutTimesTiebreakerCounter++ };
-  timeoutTimes.insert(timeoutTimesKey, kj::mv(paf.fulfiller));
-  auto deferredTimeoutTimeRemoval = kj::defer(
-      [this, &context, timeoutTimesKey]() {
-    // If the promise is being destroyed due to IoContext teardown then IoChannelFactory may
-    // no longer be available, but we can just skip starting a new timer in that case as it'd be
-    // canceled anyway.
-    if (context.selfRef->maybeContext != nullptr) {
-      bool isNext = timeoutTimes.begin()->key == timeoutTimesKey;
-      timeoutTimes.erase(timeoutTimesKey);
-      if (isNext) resetTimerTask(context.getIoChannelFactory().getTimer());
-    }
-  });
 
-  if (timeoutTimes.begin()->key == timeoutTimesKey) {
-    resetTimerTask(context.getIoChannelFactory().getTimer());
-  }
-  promise = promise.attach(kj::mv(deferredTimeoutTimeRemoval));
+      // If this is an interval task and the script has CPU time left, reschedule the task.
+      if (!state->isCanceled && state->params.repeat &&
+          context.limitEnforcer->getLimitsExceeded() == nullptr) {
+        schedule(context, *state);
+      }
 
-  if (context.actor != nullptr) {
-    // Add a wait-until task which resolves when this timer completes. This ensures that
-    // `IncomingRequest::drain()` waits until all timers finish.
-    auto paf = kj::newPromiseAndFulfiller<void>();
-    promise = promise.attach(kj::defer([fulfiller = kj::mv(paf.fulfiller)]() mutable {
-      fulfiller->fulfill();
-    }));
-    context.addWaitUntil(kj::mv(paf.promise));
-  }
+      js.runMicrotasks();
+    }
 
-  state.maybePromise = promise.eagerlyEvaluate(nullptr);
+    releaseBatch();
+  }, kj::mv(cs)).catch_([](kj::Exception&&) {
+    // run() has already logged anything worth logging. Any timeouts the batch didn't get to are
+    // dropped, just like a timeout whose own run() failed.
+  }).then([this, &context]() {
+    releaseBatch();
+    firingWhen = nullptr;
+    updateActivity(context);
+  });
 }
 
-void IoContext::TimeoutManagerImpl::resetTimerTask(TimerChannel& timerChannel) {
-  if (timeoutTimes.size() == 0) {
-    // Not waiting for any timer, clear the existing timer task.
-    timerTask = nullptr;
-  } else {
-    // Wait for the first timer.
-    auto& entry = *timeoutTimes.begin();
-    timerTask = timerChannel.atTime(entry.key.when)
-        .then([this, key = entry.key]() {
-      auto& newEntry = *timeoutTimes.begin();
-      KJ_ASSERT(newEntry.key == key,
-          "front of timeoutTimes changed without calling resetTimerTask(), we probably missed "
-          "a timeout!");
-      newEntry.value->fulfill();
-    }).eagerlyEvaluate([](kj::Exception&& e) {
-      KJ_LOG(ERROR, e);
-    });
+void IoContext::TimeoutManagerImpl::releaseBatch() {
+  for (auto state: batch) {
+    state->isInBatch = false;
+    if (!state->isScheduled()) {
+      // The timeout ran, or was canceled, and isn't an interval to run again.
+      timeouts.erase(state->id);
+    }
   }
+  batch.clear();
 }
 
 void IoContext::TimeoutManagerImpl::clearTimeout(
     IoContext& context, TimeoutId timeoutId) {
-  auto timeout = timeouts.find(timeoutId);
-  if(timeout == timeouts.end()) {
-    // We can't find this timeout, thus we act as if it was already canceled.
-    return;
+  KJ_IF_MAYBE(entry, timeouts.find(timeoutId)) {
+    auto& state = **entry;
+    state.cancel();
+    if (state.isScheduled()) {
+      wheel.remove(state);
+    }
+    if (!state.isInBatch) {
+      // Otherwise releaseBatch() erases it once the batch finishes.
+      timeouts.erase(timeoutId);
+    }
+
+    updateActivity(context);
+    updateTimerTask(context);
   }
 
-  // Cancel the timeout.
-  timeout->second.cancel();
+  // Otherwise we can't find this timeout, thus we act as if it was already canceled.
 }
 
 TimeoutId IoContext::setTimeoutImpl(
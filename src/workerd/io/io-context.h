@@ -19,6 +19,7 @@
 #include <capnp/dynamic.h>
 #include <workerd/io/limit-enforcer.h>
 #include <workerd/io/io-channels.h>
+#include <workerd/util/object-arena.h>
 
 namespace capnp { class HttpOverCapnpFactory; }
 
@@ -124,6 +125,12 @@ public:
   bool operator<(TimeoutId id) const {
     return value < id.value;
   }
+  bool operator==(TimeoutId id) const {
+    return value == id.value;
+  }
+  uint hashCode() const {
+    return kj::hashCode(value);
+  }
 
 private:
   constexpr explicit TimeoutId(ValueType value): value(value) {}
@@ -544,6 +551,13 @@ public:
   template <typename T>
   jsg::Promise<T> awaitIo(jsg::Lock& js, kj::Promise<T> promise);
 
+  // Runs `func` under the lock the way a result of awaitIo() is delivered to JavaScript, batched
+  // with any other results that are ready. The returned promise rejects if `func` throws.
+  template <typename Func>
+  kj::Promise<void> runResolutionForTest(Func&& func) {
+    return runResolution(kj::fwd<Func>(func), getCriticalSection());
+  }
+
   // Waits for the given I/O while holding the input lock, so that all other I/O is blocked from
   // completing in the meantime (unless it is also holding the same input lock).
   template <typename T, typename Func>
@@ -599,6 +613,12 @@ public:
   // Returns the number of times addTask() has been called (even if the tasks have completed).
   uint taskCount() { return addTaskCounter; }
 
+  // Claims one of `limit` slots for work this request hands to a thread pool shared with other
+  // requests, so that one request can't occupy the whole pool. Returns null if all `limit` are
+  // taken; otherwise the slot is released when the returned object is dropped, which must happen
+  // before the IoContext is destroyed.
+  kj::Maybe<kj::Own<void>> tryClaimOffThreadSlot(uint limit);
+
   // Indicates that the script has requested that it stay active until the given promise resolves.
   // drain() waits until all such promises have completed.
   void addWaitUntil(kj::Promise<void> promise);
@@ -941,7 +961,16 @@ private:
       return finalizersRan;
     }
 
+    // Allocates the list's objects. Every object is unlinked, and so destroyed, on the
+    // IoContext's thread, no later than the list's destructor.
+    ObjectArena& getArena() {
+      return arena;
+    }
+
   private:
+    // NOTE: This must be declared before `head`, so it outlives the objects.
+    ObjectArena arena;
+
     kj::Maybe<kj::Own<OwnedObject>> head;
 
     bool finalizersRan = false;
@@ -1014,9 +1043,25 @@ private:
   void setTimeoutImpl(TimeoutId timeoutId, bool repeat, jsg::V8Ref<v8::Function> function,
     double msDelay, kj::Array<jsg::Value> args);
 
+  // A result of awaitIo() waiting to be delivered by a batched run. See runResolution().
+  struct ReadyResolution {
+    kj::Function<void(Worker::Lock&)> resolve;
+    kj::Own<kj::PromiseFulfiller<void>> fulfiller;
+  };
+
+  // Resolutions waiting for the scheduled batched run, if there is one, and those it is
+  // delivering.
+  kj::Vector<ReadyResolution> readyResolutions;
+  kj::Vector<ReadyResolution> runningResolutions;
+  bool resolutionRunScheduled = false;
+  uint resolutionRunsStarted = 0;
+
   uint addTaskCounter = 0;
   kj::Maybe<kj::TaskSet> tasks;
 
+  // Slots held through tryClaimOffThreadSlot().
+  uint offThreadSlotsClaimed = 0;
+
   // The timeout manager needs to live below `deleteQueue` because the promises may refer to
   // objects in the queue.
 
@@ -1061,6 +1106,22 @@ private:
   jsg::Promise<MaybeIoOwn<addIoOwn, T>> awaitIoImpl(
       kj::Promise<T> promise, InputLockOrMaybeCriticalSection ilOrCs);
 
+  // Runs `func` to deliver a result of awaitIo() to JavaScript. Outside of actors, and so without
+  // input locks or critical sections to respect, results that become ready close together share
+  // a single run(): the first one schedules it and the rest join until it starts. A burst of I/O
+  // completions then takes the isolate lock and drains the microtask queue once, not once each.
+  //
+  // Each `func` in a batch succeeds or fails on its own: an exception from one rejects only the
+  // promise returned for it. Only a failure of the run as a whole, such as not getting the lock or
+  // the isolate being terminated, fails the rest of the batch.
+  template <typename Func>
+  kj::Promise<void> runResolution(
+      Func&& func, kj::Maybe<kj::Own<InputGate::CriticalSection>> criticalSection);
+  template <typename Func, typename InputLock>
+  kj::Promise<void> runResolution(Func&& func, InputLock inputLock) {
+    return run(kj::fwd<Func>(func), kj::mv(inputLock));
+  }
+
   // Same as addFunctor() but expects that the returned function will receive a IoOwn<T> as the
   // parameter, and instead passes the underlying `T` as the parameter to `func`. This is needed
   // in the implementation of awaitIo().
@@ -1238,6 +1299,64 @@ kj::PromiseForResult<Func, Worker::Lock&> IoContext::run(
   });
 }
 
+template <typename Func>
+kj::Promise<void> IoContext::runResolution(
+    Func&& func, kj::Maybe<kj::Own<InputGate::CriticalSection>> criticalSection) {
+  if (actor != nullptr || criticalSection != nullptr) {
+    return run(kj::fwd<Func>(func), kj::mv(criticalSection));
+  }
+
+  auto paf = kj::newPromiseAndFulfiller<void>();
+  readyResolutions.add(ReadyResolution { kj::fwd<Func>(func), kj::mv(paf.fulfiller) });
+  if (resolutionRunScheduled) {
+    return kj::mv(paf.promise);
+  }
+
+  resolutionRunScheduled = true;
+  uint startedBefore = resolutionRunsStarted;
+  addTask(run([this](Worker::Lock& lock) {
+    // Anything that becomes ready from here on waits for the next run.
+    ++resolutionRunsStarted;
+    resolutionRunScheduled = false;
+    runningResolutions = kj::mv(readyResolutions);
+
+    jsg::Lock& js = lock;
+    for (auto& resolution: runningResolutions) {
+      kj::Maybe<kj::Exception> error;
+      js.tryCatch([&]() {
+        try {
+          resolution.resolve(lock);
+        } catch (kj::Exception& e) {
+          error = kj::mv(e);
+        }
+      }, [&](jsg::Value exception) {
+        error = jsg::createTunneledException(js.v8Isolate, exception.getHandle(js));
+      });
+
+      KJ_IF_MAYBE(e, error) {
+        resolution.fulfiller->reject(kj::mv(*e));
+      } else {
+        resolution.fulfiller->fulfill();
+      }
+    }
+    runningResolutions.clear();
+  }).catch_([this, startedBefore](kj::Exception&& e) {
+    // Fail whatever the run didn't get to: everything, if it never got the lock.
+    for (auto& resolution: runningResolutions) {
+      resolution.fulfiller->reject(kj::cp(e));
+    }
+    runningResolutions.clear();
+    if (resolutionRunsStarted == startedBefore) {
+      resolutionRunScheduled = false;
+      for (auto& resolution: readyResolutions) {
+        resolution.fulfiller->reject(kj::cp(e));
+      }
+      readyResolutions.clear();
+    }
+  }));
+  return kj::mv(paf.promise);
+}
+
 template <typename T, typename Func>
 jsg::PromiseForResult<Func, T, false> IoContext::awaitIo(
     kj::Promise<T> promise, Func&& func) {
@@ -1361,7 +1480,7 @@ jsg::Promise<IoContext::MaybeIoOwn<addIoOwn, T>> IoContext::awaitIoImpl(
     }).then([this, resolver = kj::mv(resolver), ilOrCs = kj::mv(ilOrCs),
              maybeAsyncContext = jsg::AsyncContextFrame::currentRef(lock)]
             (kj::Maybe<kj::Exception>&& maybeException) mutable {
-      return run([resolver = kj::mv(resolver),
+      return runResolution([resolver = kj::mv(resolver),
                   maybeException = kj::mv(maybeException),
                   maybeAsyncContext = kj::mv(maybeAsyncContext)](Worker::Lock& lock) mutable {
         jsg::AsyncContextFrame::Scope asyncScope(lock, maybeAsyncContext);
@@ -1381,7 +1500,7 @@ jsg::Promise<IoContext::MaybeIoOwn<addIoOwn, T>> IoContext::awaitIoImpl(
     }).then([this, resolver = kj::mv(resolver), ilOrCs = kj::mv(ilOrCs),
              maybeAsyncContext = jsg::AsyncContextFrame::currentRef(lock)]
             (ResultOrException&& resultOrException) mutable {
-      return run([this, resolver = kj::mv(resolver),
+      return runResolution([this, resolver = kj::mv(resolver),
                   resultOrException = kj::mv(resultOrException),
                   maybeAsyncContext = kj::mv(maybeAsyncContext)](Worker::Lock& lock) mutable {
         jsg::AsyncContextFrame::Scope asyncScope(lock, maybeAsyncContext);
@@ -1506,9 +1625,10 @@ inline IoOwn<T> IoContext::DeleteQueue::addObject(
   //   (which would have forced a bunch of useless vtables and vtable pointers)... I'm manually
   //   constructing the kj::Own<> using a disposer that I know is compatible.
   // TODO(cleanup): Can KJ be made to support this use case?
+  auto& arena = ownedObjects.getArena();
   kj::Own<OwnedObject> ownedObject(
-      new SpecificOwnedObject<T>(kj::mv(obj)),
-      kj::_::HeapDisposer<SpecificOwnedObject<T>>::instance);
+      arena.construct<SpecificOwnedObject<T>>(kj::mv(obj)),
+      ObjectArena::disposer<SpecificOwnedObject<T>>());
 
   if constexpr (kj::canConvert<T&, Finalizeable&>()) {
     ownedObject->finalizer = ref;
@@ -1533,7 +1653,11 @@ auto IoContext::addFunctor(Func&& func) {
       return (*func)(kj::fwd<decltype(params)>(params)...);
     };
   } else {
-    return [func = addObject(kj::heap(kj::mv(func)))](auto&&... params) mutable {
+    // The functor lives exactly as long as its OwnedObject, so it can share the arena.
+    requireCurrent();
+    auto& arena = ownedObjects.getArena();
+    return [func = addObject(arena.allocate<kj::Decay<Func>>(kj::mv(func)))]
+           (auto&&... params) mutable {
       return (*func)(kj::fwd<decltype(params)>(params)...);
     };
   }
@@ -1541,12 +1665,16 @@ auto IoContext::addFunctor(Func&& func) {
 
 template <typename T, bool passLock, typename Func>
 auto IoContext::addFunctorIoOwnParam(Func&& func) {
+  requireCurrent();
+  auto& arena = ownedObjects.getArena();
   if constexpr (passLock) {
-    return [func = addObject(kj::heap(kj::mv(func)))](jsg::Lock& js, IoOwn<T> param) mutable {
+    return [func = addObject(arena.allocate<kj::Decay<Func>>(kj::mv(func)))]
+           (jsg::Lock& js, IoOwn<T> param) mutable {
       return (*func)(js, kj::mv(*param));
     };
   } else {
-    return [func = addObject(kj::heap(kj::mv(func)))](IoOwn<T> param) mutable {
+    return [func = addObject(arena.allocate<kj::Decay<Func>>(kj::mv(func)))]
+           (IoOwn<T> param) mutable {
       return (*func)(kj::mv(*param));
     };
   }
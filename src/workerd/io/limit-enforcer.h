@@ -107,6 +107,16 @@ public:
   // data in C++ memory, such as reading an entire HTTP response into an `ArrayBuffer`.
   virtual size_t getBufferingLimit() = 0;
 
+  // Gets how far, in bytes, one branch of a ReadableStream.tee() may read ahead of another branch
+  // that is being pumped (e.g. to a cache or logging sink) before the faster branch's reads wait
+  // for the pump to catch up.
+  virtual size_t getTeeBranchLagLimit() = 0;
+
+  // Called when CPU time was spent on this request's behalf outside of JavaScript execution,
+  // e.g. by a crypto operation that ran on a background thread. That time is not seen by
+  // `enterJs()`, but it should still count toward the request's CPU limit.
+  virtual void chargeCpuTime(kj::Duration cpuTime) = 0;
+
   // If a limit has been exceeded which prevents further JavaScript execution, such as the CPU or
   // memory limit, returns a request status code indicating which one. Returns null if no limits
   // are exceeded.
@@ -70,6 +70,14 @@ public:
   virtual void finishedWaitUntilTask() {}
 
   virtual void setFailedOpen(bool value) {}
+
+  // Reports the peak number of bytes a ReadableStream.tee() held buffered for its lagging
+  // branches, when the tee is destroyed.
+  virtual void reportTeeBufferPeak(uint64_t bytes) {}
+
+  // Reports how many bytes the IoContext had reserved for the objects it owns when the request
+  // finished. For actors, requests share the IoContext, so this covers earlier requests too.
+  virtual void reportObjectArenaSize(uint64_t bytes) {}
 };
 
 class IsolateObserver: public kj::AtomicRefcounted, public jsg::IsolateObserver {
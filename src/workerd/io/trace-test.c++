@@ -0,0 +1,93 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "trace.h"
+#include <capnp/message.h>
+#include <kj/compat/http.h>
+#include <kj/test.h>
+
+namespace workerd {
+namespace {
+
+KJ_TEST("WorkerTracer records fetch event info from a request") {
+  kj::HttpHeaderTable table;
+  kj::HttpHeaders headers(table);
+  headers.add("Accept", "text/html");
+  headers.add("X-Foo", "1");
+  headers.add("x-foo", "2");
+
+  WorkerTracer tracer(PipelineLogLevel::FULL);
+  tracer.setEventInfo(kj::UNIX_EPOCH, Trace::FetchEventInfo::Source {
+    .method = kj::HttpMethod::POST,
+    .url = "https://example.com/"_kj,
+    .cfJson = "{}"_kj,
+    .headers = headers,
+  });
+
+  capnp::MallocMessageBuilder message;
+  auto builder = message.initRoot<rpc::Trace>();
+  tracer.extractTrace(builder);
+
+  auto fetch = builder.getEventInfo().getFetch();
+  KJ_EXPECT(fetch.getMethod() == capnp::HttpMethod::POST);
+  KJ_EXPECT(fetch.getUrl() == "https://example.com/");
+  KJ_EXPECT(fetch.getCfJson() == "{}");
+
+  // Names are lower-cased, and same-named headers combined.
+  auto traceHeaders = fetch.getHeaders();
+  KJ_ASSERT(traceHeaders.size() == 2);
+  KJ_EXPECT(traceHeaders[0].getName() == "accept");
+  KJ_EXPECT(traceHeaders[0].getValue() == "text/html");
+  KJ_EXPECT(traceHeaders[1].getName() == "x-foo");
+  KJ_EXPECT(traceHeaders[1].getValue() == "1, 2");
+}
+
+KJ_TEST("WorkerTracer drops fetch event info which exceeds the trace size limit") {
+  kj::HttpHeaderTable table;
+  kj::HttpHeaders headers(table);
+  auto big = kj::heapString(200 * 1024);
+  memset(big.begin(), 'a', big.size());
+  headers.add("X-Big", big);
+
+  WorkerTracer tracer(PipelineLogLevel::FULL);
+  tracer.setEventInfo(kj::UNIX_EPOCH, Trace::FetchEventInfo::Source {
+    .method = kj::HttpMethod::GET,
+    .url = "https://example.com/"_kj,
+    .cfJson = nullptr,
+    .headers = headers,
+  });
+
+  capnp::MallocMessageBuilder message;
+  auto builder = message.initRoot<rpc::Trace>();
+  tracer.extractTrace(builder);
+
+  auto fetch = builder.getEventInfo().getFetch();
+  KJ_EXPECT(fetch.getMethod() == capnp::HttpMethod::GET);
+  KJ_EXPECT(fetch.getUrl() == "");
+  KJ_EXPECT(fetch.getHeaders().size() == 0);
+  KJ_ASSERT(builder.getLogs().size() == 1);
+  KJ_EXPECT(builder.getLogs()[0].getMessage().asString().startsWith(
+      "[\"Trace resource limit exceeded"));
+}
+
+KJ_TEST("WorkerTracer ignores fetch event info when not logging") {
+  kj::HttpHeaderTable table;
+  kj::HttpHeaders headers(table);
+
+  WorkerTracer tracer(PipelineLogLevel::NONE);
+  tracer.setEventInfo(kj::UNIX_EPOCH, Trace::FetchEventInfo::Source {
+    .method = kj::HttpMethod::GET,
+    .url = "https://example.com/"_kj,
+    .cfJson = nullptr,
+    .headers = headers,
+  });
+
+  capnp::MallocMessageBuilder message;
+  auto builder = message.initRoot<rpc::Trace>();
+  tracer.extractTrace(builder);
+  KJ_EXPECT(builder.getEventInfo().isNone());
+}
+
+}  // namespace
+}  // namespace workerd
@@ -3,6 +3,7 @@
 //     https://opensource.org/licenses/Apache-2.0
 
 #include <workerd/io/trace.h>
+#include <workerd/util/strings.h>
 #include <capnp/schema.h>
 #include <kj/compat/http.h>
 #include <kj/debug.h>
@@ -28,6 +29,22 @@ Trace::FetchEventInfo::FetchEventInfo(kj::HttpMethod method, kj::String url, kj:
     kj::Array<Header> headers)
     : method(method), url(kj::mv(url)), cfJson(kj::mv(cfJson)), headers(kj::mv(headers)) {}
 
+Trace::FetchEventInfo::FetchEventInfo(const Source& source)
+    : method(source.method),
+      url(kj::str(source.url)),
+      cfJson(kj::str(source.cfJson.orDefault(""_kj))) {
+  kj::TreeMap<kj::String, kj::Vector<kj::StringPtr>> combined;
+  source.headers.forEach([&](kj::StringPtr name, kj::StringPtr value) {
+    auto lower = toLowerCopy(name);
+    auto& slot = combined.findOrCreate(lower,
+        [&]() { return decltype(combined)::Entry {kj::mv(lower), {}}; });
+    slot.add(value);
+  });
+  headers = KJ_MAP(entry, combined) {
+    return Header(kj::mv(entry.key), kj::strArray(entry.value, ", "));
+  };
+}
+
 Trace::FetchEventInfo::FetchEventInfo(rpc::Trace::FetchEventInfo::Reader reader)
     : method(validateMethod(reader.getMethod())),
       url(kj::str(reader.getUrl())),
@@ -474,8 +491,8 @@ void WorkerTracer::setEventInfo(kj::Date timestamp, Trace::EventInfo&& info) {
   // TODO(someday): For now, we're using logLevel == none as a hint to avoid doing anything
   //   expensive while tracing.  We may eventually want separate configuration for event info vs.
   //   logs.
-  // TODO(perf): Find a way to allow caller to avoid the cost of generation if the info struct
-  //   won't be used?
+  // Fetch events should use the FetchEventInfo::Source overload below, which skips building the
+  // info when it won't be used.
   if (pipelineLogLevel == PipelineLogLevel::NONE) {
     return;
   }
@@ -491,10 +508,7 @@ void WorkerTracer::setEventInfo(kj::Date timestamp, Trace::EventInfo&& info) {
       }
       newSize += fetch.cfJson.size();
       if (newSize > MAX_TRACE_BYTES) {
-        trace->logs.add(
-            timestamp, LogLevel::WARN,
-            kj::str("[\"Trace resource limit exceeded; could not capture event info.\"]"));
-        trace->eventInfo = Trace::FetchEventInfo(fetch.method, {}, {}, {});
+        setFetchEventInfoTooLarge(timestamp, fetch.method);
         return;
       }
     }
@@ -508,6 +522,38 @@ void WorkerTracer::setEventInfo(kj::Date timestamp, Trace::EventInfo&& info) {
   trace->eventInfo = kj::mv(info);
 }
 
+void WorkerTracer::setEventInfo(kj::Date timestamp, const Trace::FetchEventInfo::Source& source) {
+  KJ_ASSERT(trace->eventInfo == nullptr, "tracer can only be used for a single event");
+
+  if (pipelineLogLevel == PipelineLogLevel::NONE) {
+    return;
+  }
+
+  // Combining same-named headers only ever removes repeated names, so the built info will count
+  // at least this many bytes. If even that doesn't fit, there's no need to build it.
+  size_t minSize = trace->bytesUsed + source.url.size();
+  KJ_IF_MAYBE(cfJson, source.cfJson) {
+    minSize += cfJson->size();
+  }
+  source.headers.forEach([&](kj::StringPtr name, kj::StringPtr value) {
+    minSize += value.size();
+  });
+  if (minSize > MAX_TRACE_BYTES) {
+    trace->eventTimestamp = timestamp;
+    setFetchEventInfoTooLarge(timestamp, source.method);
+    return;
+  }
+
+  setEventInfo(timestamp, Trace::FetchEventInfo(source));
+}
+
+void WorkerTracer::setFetchEventInfoTooLarge(kj::Date timestamp, kj::HttpMethod method) {
+  trace->logs.add(
+      timestamp, LogLevel::WARN,
+      kj::str("[\"Trace resource limit exceeded; could not capture event info.\"]"));
+  trace->eventInfo = Trace::FetchEventInfo(method, {}, {}, {});
+}
+
 void WorkerTracer::setOutcome(EventOutcome outcome) {
   trace->outcome = outcome;
 }
@@ -17,6 +17,7 @@
 
 namespace kj {
   enum class HttpMethod;
+  class HttpHeaders;
   class EntropySource;
 }
 
@@ -62,6 +63,24 @@ public:
         kj::Array<Header> headers);
     FetchEventInfo(rpc::Trace::FetchEventInfo::Reader reader);
 
+    // Refers to the parts of an incoming request which a FetchEventInfo describes. Passing this
+    // to WorkerTracer::setEventInfo() instead of a FetchEventInfo lets the tracer skip copying
+    // the URL, headers and cf blob when it won't record them. The referenced data need only
+    // remain valid for the duration of that call.
+    struct Source {
+      kj::HttpMethod method;
+      kj::StringPtr url;
+      kj::Maybe<kj::StringPtr> cfJson;
+      const kj::HttpHeaders& headers;
+    };
+
+    // Copies the request referenced by `source`. To match our historical behavior (when we used
+    // to pull the headers from the JavaScript object later on), header names are lower-cased and
+    // multiple headers with the same name are combined into a comma-delimited list. (This
+    // explicitly breaks the Set-Cookie header, incidentally, but should be equivalent for all
+    // other headers.)
+    explicit FetchEventInfo(const Source& source);
+
     class Header {
     public:
       explicit Header(kj::String name, kj::String value);
@@ -308,6 +327,10 @@ public:
   // Adds info about the event that triggered the trace.  Must not be called more than once.
   void setEventInfo(kj::Date timestamp, Trace::EventInfo&&);
 
+  // Like setEventInfo() with a FetchEventInfo built from `source`, but only builds it if it will
+  // be recorded.
+  void setEventInfo(kj::Date timestamp, const Trace::FetchEventInfo::Source& source);
+
   // Adds info about the response. Must not be called more than once, and only
   // after passing a FetchEventInfo to setEventInfo().
   void setFetchResponseInfo(Trace::FetchResponseInfo&&);
@@ -330,6 +353,9 @@ private:
   PipelineLogLevel pipelineLogLevel;
   kj::Own<Trace> trace;
 
+  // Records that a fetch event's info was too large to fit in the trace.
+  void setFetchEventInfoTooLarge(kj::Date timestamp, kj::HttpMethod method);
+
   // own an instance of the pipeline to make sure it doesn't get destroyed
   // before we're finished tracing
   kj::Maybe<kj::Own<PipelineTracer>> parentPipeline;
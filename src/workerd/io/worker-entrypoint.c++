@@ -126,32 +126,17 @@ kj::Promise<void> WorkerEntrypoint::request(
   bool isActor = context.getActor() != nullptr;
 
   KJ_IF_MAYBE(t, incomingRequest->getWorkerTracer()) {
-    auto timestamp = context.now();
-    kj::String cfJson;
+    kj::Maybe<kj::StringPtr> cfJson;
     KJ_IF_MAYBE(c, cfBlobJson) {
-      cfJson = kj::str(*c);
+      cfJson = *c;
     }
 
-    // To match our historical behavior (when we used to pull the headers from the JavaScript
-    // object later on), we need to canonicalize the headers, including:
-    // - Lower-case the header name.
-    // - Combine multiple headers with the same name into a comma-delimited list. (This explicitly
-    //   breaks the Set-Cookie header, incidentally, but should be equivalent for all other
-    //   headers.)
-    kj::TreeMap<kj::String, kj::Vector<kj::StringPtr>> traceHeaders;
-    headers.forEach([&](kj::StringPtr name, kj::StringPtr value) {
-      kj::String lower = api::toLower(name);
-      auto& slot = traceHeaders.findOrCreate(lower,
-          [&]() { return decltype(traceHeaders)::Entry {kj::mv(lower), {}}; });
-      slot.add(value);
+    t->setEventInfo(context.now(), Trace::FetchEventInfo::Source {
+      .method = method,
+      .url = url,
+      .cfJson = cfJson,
+      .headers = headers,
     });
-    auto traceHeadersArray = KJ_MAP(entry, traceHeaders) {
-      return Trace::FetchEventInfo::Header(kj::mv(entry.key),
-          kj::strArray(entry.value, ", "));
-    };
-
-    t->setEventInfo(timestamp, Trace::FetchEventInfo(method, kj::str(url),
-        kj::mv(cfJson), kj::mv(traceHeadersArray)));
   }
 
   auto metricsForCatch = kj::addRef(incomingRequest->getMetrics());
@@ -696,6 +696,8 @@ public:
     virtual kj::Vector<jsg::Ref<api::WebSocket>> getWebSockets(
         jsg::Lock& js,
         kj::Maybe<kj::StringPtr> tag) = 0;
+    virtual uint broadcast(jsg::Lock& js, kj::OneOf<kj::Array<byte>, kj::String> message,
+        kj::Maybe<kj::StringPtr> tag, kj::Maybe<api::WebSocket&> except) = 0;
     virtual void hibernateWebSockets(Worker::Lock& lock) = 0;
     virtual void setWebSocketAutoResponse(jsg::Ref<api::WebSocketRequestResponsePair> reqResp) = 0;
     virtual void unsetWebSocketAutoResponse() = 0;
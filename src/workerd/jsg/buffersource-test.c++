@@ -4,6 +4,7 @@
 
 #include "jsg-test.h"
 #include "buffersource.h"
+#include <kj/thread.h>
 
 // ========================================================================================
 namespace workerd::jsg::test {
@@ -55,15 +56,79 @@ struct BufferSourceContext: public jsg::Object, public jsg::ContextGlobal {
     return BufferSource(js, BackingStore::alloc<v8::ArrayBuffer>(js, 3));
   }
 
+  uint sumDetached(Lock& js, BufferSource buf) {
+    // Detaching and releasing hands KJ the JavaScript buffer's own memory.
+    auto before = buf.asArrayPtr().begin();
+    auto bytes = buf.detach(js).release();
+    KJ_ASSERT(bytes.begin() == before);
+    uint sum = 0;
+    for (auto b: bytes) sum += b;
+    return sum;
+  }
+
   JSG_RESOURCE_TYPE(BufferSourceContext) {
     JSG_METHOD(takeBufferSource);
     JSG_METHOD(takeUint8Array);
     JSG_METHOD(makeBufferSource);
     JSG_METHOD(makeArrayBuffer);
+    JSG_METHOD(sumDetached);
   }
 };
 JSG_DECLARE_ISOLATE_TYPE(BufferSourceIsolate, BufferSourceContext);
 
+class CountingDisposer final: public kj::ArrayDisposer {
+public:
+  mutable uint count = 0;
+
+protected:
+  void disposeImpl(void* firstElement, size_t elementSize, size_t elementCount,
+                   size_t capacity, void (*destroyElement)(void*)) const override {
+    ++count;
+  }
+};
+
+// This runs before any JavaScript, so that the pool's owners are all free to begin with.
+KJ_TEST("handing arrays between KJ and V8 recycles their owners") {
+  kj::byte buffer[16];
+  CountingDisposer disposer;
+
+  // Warm up the pool.
+  BackingStore::from(kj::Array<kj::byte>(buffer, sizeof(buffer), disposer));
+  auto capacity = getBackingStoreOwnerCapacityForTest();
+  KJ_EXPECT(capacity > 0);
+  KJ_EXPECT(disposer.count == 1);
+
+  for (auto i KJ_UNUSED: kj::zeroTo(1000)) {
+    auto backing = BackingStore::from(kj::Array<kj::byte>(buffer, sizeof(buffer), disposer));
+    auto bytes = backing.release();
+    KJ_EXPECT(bytes.begin() == buffer);
+    KJ_EXPECT(bytes.size() == sizeof(buffer));
+  }
+  KJ_EXPECT(disposer.count == 1001);
+
+  // No further owners were allocated.
+  KJ_EXPECT(getBackingStoreOwnerCapacityForTest() == capacity);
+
+  // Owners released on another thread return to the pool of the thread which acquired them. Each
+  // round trip here uses two owners, so this uses every owner in the pool.
+  kj::Vector<kj::Array<kj::byte>> arrays;
+  for (auto i KJ_UNUSED: kj::zeroTo(capacity / 2)) {
+    std::shared_ptr<v8::BackingStore> backing =
+        newBackingStore(kj::Array<kj::byte>(buffer, sizeof(buffer), disposer));
+    arrays.add(attachBackingStore(kj::arrayPtr(buffer, sizeof(buffer)), kj::mv(backing)));
+  }
+  {
+    kj::Thread thread([&]() { arrays.clear(); });
+  }
+  KJ_EXPECT(disposer.count == 1001 + capacity / 2);
+
+  kj::Vector<BackingStore> stores;
+  for (auto i KJ_UNUSED: kj::zeroTo(capacity)) {
+    stores.add(BackingStore::from(kj::Array<kj::byte>(buffer, sizeof(buffer), disposer)));
+  }
+  KJ_EXPECT(getBackingStoreOwnerCapacityForTest() == capacity);
+}
+
 KJ_TEST("BufferSource works") {
   Evaluator<BufferSourceContext, BufferSourceIsolate> e(v8System);
 
@@ -129,5 +194,15 @@ KJ_TEST("BufferSource works") {
       "true");
 }
 
+KJ_TEST("detached BufferSource contents are released without copying") {
+  Evaluator<BufferSourceContext, BufferSourceIsolate> e(v8System);
+  e.expectEval(
+      "const u8 = new Uint8Array([1, 2, 3, 4]).subarray(1);"
+      "const sum = sumDetached(u8);"
+      "sum === 9 && u8.byteLength === 0",
+      "boolean",
+      "true");
+}
+
 }  // namespace
 }  // namespace workerd::jsg::test
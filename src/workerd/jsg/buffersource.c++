@@ -77,6 +77,11 @@ BackingStore::BackingStore(
               kj::str("byteLength must be a multiple of ", this->elementSize, "."));
 }
 
+kj::Array<kj::byte> BackingStore::release() {
+  auto bytes = asArrayPtr();
+  return attachBackingStore(bytes, kj::mv(backingStore));
+}
+
 bool BackingStore::operator==(const BackingStore& other) {
   return backingStore == other.backingStore &&
          byteLength == other.byteLength &&
@@ -75,13 +75,8 @@ public:
   static BackingStore from(kj::Array<kj::byte> data) {
     // Creates a new BackingStore that takes over ownership of the given kj::Array.
     size_t size = data.size();
-    auto ptr = new kj::Array<byte>(kj::mv(data));
     return BackingStore(
-        v8::ArrayBuffer::NewBackingStore(
-            ptr->begin(), size,
-            [](void*, size_t, void* ptr) {
-              delete reinterpret_cast<kj::Array<byte>*>(ptr);
-            }, ptr),
+        newBackingStore(kj::mv(data)),
         size, 0,
         getBufferSourceElementSize<T>(), construct<T>,
         checkIsIntegerType<T>());
@@ -207,6 +202,10 @@ public:
     return BackingStore(backingStore, byteLength, byteOffset, elementSize, ctor, integerType);
   }
 
+  // Converts this BackingStore into a kj::Array over the same bytes, without copying, leaving the
+  // BackingStore empty. Use this to hand the contents of a detached buffer to KJ.
+  kj::Array<kj::byte> release();
+
 private:
   std::shared_ptr<v8::BackingStore> backingStore;
   size_t byteLength;
@@ -0,0 +1,112 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "jsg-test.h"
+
+namespace workerd::jsg::test {
+namespace {
+
+// --allow-natives-syntax lets the tests force optimization, so that V8 actually makes fast calls.
+V8System v8System({"--allow-natives-syntax"_kj});
+
+class FastCounter: public Object {
+public:
+  static Ref<FastCounter> constructor() { return alloc<FastCounter>(); }
+
+  double add(double amount) { return total += amount; }
+  int addInt(int amount) { return total += amount; }
+  uint32_t sum(kj::Array<kj::byte> bytes) {
+    uint32_t result = 0;
+    for (auto b: bytes) result += b;
+    return result;
+  }
+  void addPositive(int amount) {
+    JSG_REQUIRE(amount >= 0, RangeError, "amount must not be negative");
+    total += amount;
+  }
+  bool isZero() { return total == 0; }
+
+  JSG_RESOURCE_TYPE(FastCounter) {
+    JSG_FAST_METHOD(add);
+    JSG_FAST_METHOD(addInt);
+    JSG_FAST_METHOD(sum);
+    JSG_FAST_METHOD(addPositive);
+    JSG_FAST_METHOD(isZero);
+  }
+
+private:
+  double total = 0;
+};
+
+struct FastMethodContext: public Object, public ContextGlobal {
+  JSG_RESOURCE_TYPE(FastMethodContext) {
+    JSG_NESTED_TYPE(FastCounter);
+  }
+};
+JSG_DECLARE_ISOLATE_TYPE(FastMethodIsolate, FastMethodContext, FastCounter);
+
+// Wraps `body` (the body of `function run(c, i)`) in code which calls it from both unoptimized and
+// optimized code, and evaluates to the final result.
+kj::String optimized(kj::StringPtr body) {
+  return kj::str(
+      "function run(c, i) {", body, "}\n"
+      "const c = new FastCounter();\n"
+      "%PrepareFunctionForOptimization(run);\n"
+      "run(c, 0); run(c, 1);\n"
+      "%OptimizeFunctionOnNextCall(run);\n"
+      "run(c, 2);\n"
+      "let result;\n"
+      "for (let i = 3; i < 100; i++) result = run(c, i);\n"
+      "result");
+}
+
+KJ_TEST("fast methods take and return numbers") {
+  Evaluator<FastMethodContext, FastMethodIsolate> e(v8System);
+  e.expectEval(optimized("return c.add(i);"), "number", "4950");
+  e.expectEval(optimized("return c.addInt(i);"), "number", "4950");
+  e.expectEval(optimized("return c.isZero();"), "boolean", "true");
+
+  // Arguments which don't match the fast signature are coerced on the regular path.
+  e.expectEval(optimized("return c.add(i % 2 ? String(i) : i);"), "number", "4950");
+}
+
+KJ_TEST("fast methods take Uint8Arrays") {
+  Evaluator<FastMethodContext, FastMethodIsolate> e(v8System);
+  e.expectEval(optimized("return c.sum(new Uint8Array([i, 1, 2]));"), "number", "102");
+
+  // Other BufferSources take the regular path.
+  e.expectEval(optimized("return c.sum(new Uint8Array([i, 1, 2]).buffer);"), "number", "102");
+}
+
+KJ_TEST("fast methods report errors") {
+  Evaluator<FastMethodContext, FastMethodIsolate> e(v8System);
+
+  e.expectEval(optimized("return c.addInt(i < 99 ? i : 2 ** 32);"),
+      "throws",
+      "TypeError: Value out of range. Must be between -2147483648 and 2147483647 (inclusive).");
+
+  // An exception thrown by the method itself is rethrown from the regular path, without the
+  // method's effects being applied twice.
+  e.expectEval(
+      "const c = new FastCounter();\n"
+      "function run(i) { c.addPositive(i); }\n"
+      "%PrepareFunctionForOptimization(run);\n"
+      "run(1);\n"
+      "%OptimizeFunctionOnNextCall(run);\n"
+      "run(2);\n"
+      "try { run(-1); } catch (e) { String(e) + ', ' + c.addInt(0) }",
+      "string", "RangeError: amount must not be negative, 3");
+
+  e.expectEval(
+      "function run(c) { return FastCounter.prototype.add.call(c, 1); }\n"
+      "%PrepareFunctionForOptimization(run);\n"
+      "run(new FastCounter());\n"
+      "%OptimizeFunctionOnNextCall(run);\n"
+      "run(new FastCounter());\n"
+      "run({})",
+      "throws", "TypeError: Illegal invocation");
+}
+
+}  // namespace
+}  // namespace workerd::jsg::test
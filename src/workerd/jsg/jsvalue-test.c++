@@ -52,6 +52,12 @@ struct JsValueContext: public ContextGlobalObject {
   JsValue getStringIntern(Lock& js) {
     return js.strIntern("foo");
   }
+  JsValue getCommonStringIntern(Lock& js) {
+    return js.strIntern("content-type");
+  }
+  kj::StringPtr getCommonString() {
+    return "application/json"_kj;
+  }
   JsObject getMap(Lock& js) {
     auto map = js.map();
     map.set(js, "foo", js.num(1));
@@ -73,6 +79,15 @@ struct JsValueContext: public ContextGlobalObject {
   JsDate getDate(Lock& js) {
     return js.date(0);
   }
+  JsArray getShapedRows(Lock& js) {
+    kj::StringPtr names[] = { "a"_kj, "b"_kj, "a"_kj, "__proto__"_kj };
+    JsObjectShape shape(js, names);
+    KJ_ASSERT(shape.size() == 4);
+    auto row = [&](double base) {
+      return shape.instantiate(js, [&](uint i) -> JsValue { return js.num(base + i); });
+    };
+    return js.arr(row(0), row(10));
+  }
 
   JSG_RESOURCE_TYPE(JsValueContext) {
     JSG_METHOD(takeJsValue);
@@ -82,12 +97,15 @@ struct JsValueContext: public ContextGlobalObject {
     JSG_METHOD(takeJsArray);
     JSG_METHOD(getString);
     JSG_METHOD(getStringIntern);
+    JSG_METHOD(getCommonStringIntern);
+    JSG_METHOD(getCommonString);
     JSG_METHOD(getMap);
     JSG_METHOD(getArray);
     JSG_METHOD(getSet);
     JSG_METHOD(setRef);
     JSG_METHOD(getRef);
     JSG_METHOD(getDate);
+    JSG_METHOD(getShapedRows);
   }
 };
 JSG_DECLARE_ISOLATE_TYPE(JsValueIsolate, JsValueContext);
@@ -104,6 +122,10 @@ KJ_TEST("simple") {
   e.expectEval("const a = [1,2,3]; a[1] === takeJsArray(a)[1]", "boolean", "true");
   e.expectEval("getString()", "string", "foo");
   e.expectEval("getStringIntern()", "string", "foo");
+  e.expectEval("getCommonStringIntern()", "string", "content-type");
+  e.expectEval("getCommonStringIntern() === getCommonStringIntern()", "boolean", "true");
+  e.expectEval("getCommonString() + getCommonString()", "string",
+               "application/jsonapplication/json");
   e.expectEval("const m = getMap(); m.get('foo')", "number", "1");
   e.expectEval("const s = getSet(); s.size === 2 && s.has(1) && s.has('foo') && !s.has('bar')",
                "boolean", "true");
@@ -115,5 +137,15 @@ KJ_TEST("simple") {
   e.expectEval("getDate() instanceof Date", "boolean", "true");
 }
 
+KJ_TEST("JsObjectShape") {
+  Evaluator<JsValueContext, JsValueIsolate> e(v8System);
+  // Duplicate names keep their first position and their last value, as if set one at a time.
+  e.expectEval("JSON.stringify(getShapedRows())", "string",
+               "[{\"a\":2,\"b\":1,\"__proto__\":3},{\"a\":12,\"b\":11,\"__proto__\":13}]");
+  // `__proto__` is an ordinary property, not the prototype.
+  e.expectEval("const [r] = getShapedRows(); Object.getPrototypeOf(r) === Object.prototype && "
+               "Object.hasOwn(r, '__proto__')", "boolean", "true");
+}
+
 }  // namespace
 }  // namespace workerd::jsg::test
@@ -1,6 +1,7 @@
 #include "jsvalue.h"
 #include "buffersource.h"
 #include "ser.h"
+#include <kj/map.h>
 
 namespace workerd::jsg {
 
@@ -105,6 +106,36 @@ JsObject JsObject::jsonClone(Lock& js) {
   return JsObject(obj);
 }
 
+JsObjectShape::JsObjectShape(Lock& js, kj::ArrayPtr<const kj::StringPtr> namesParam)
+    : objectTemplate(nullptr) {
+  auto tmpl = v8::ObjectTemplate::New(js.v8Isolate);
+  kj::HashSet<kj::StringPtr> seen;
+  auto builder = kj::heapArrayBuilder<JsRef<JsString>>(namesParam.size());
+  for (auto name: namesParam) {
+    auto str = js.strIntern(name);
+    if (!seen.contains(name)) {
+      seen.insert(name);
+      tmpl->Set(v8::Local<v8::String>(str), v8::Undefined(js.v8Isolate));
+    }
+    builder.add(js, str);
+  }
+  objectTemplate = V8Ref<v8::ObjectTemplate>(js.v8Isolate, tmpl);
+  names = builder.finish();
+}
+
+JsObject JsObjectShape::instantiate(Lock& js, kj::FunctionParam<JsValue(uint)> getValue) {
+  auto context = js.v8Context();
+  auto obj = check(objectTemplate.getHandle(js)->NewInstance(context));
+  for (auto i: kj::indices(names)) {
+    // The object already has this property, so defining it again just stores the value without
+    // changing the object's map. We define rather than set so that names like `__proto__` are
+    // plain data properties, never setters.
+    check(obj->CreateDataProperty(context,
+        v8::Local<v8::String>(names[i].getHandle(js)), getValue(i)));
+  }
+  return JsObject(obj);
+}
+
 bool JsValue::isTruthy(Lock& js) const {
   KJ_ASSERT(!inner.IsEmpty());
   return inner->BooleanValue(js.v8Isolate);
@@ -347,6 +378,11 @@ JsString Lock::str(kj::ArrayPtr<const kj::byte> str) {
 }
 
 JsString Lock::strIntern(kj::StringPtr str) {
+  if (str.size() <= MAX_COMMON_STRING_SIZE) {
+    KJ_IF_MAYBE(common, tryGetCommonString(v8Isolate, str)) {
+      return JsString(*common);
+    }
+  }
   return JsString(check(v8::String::NewFromUtf8(
       v8Isolate,
       str.begin(),
@@ -423,6 +423,38 @@ private:
 #undef V
 };
 
+// Makes objects that all have the same string-keyed properties, in the same order, such as the
+// rows of a query result. Objects are stamped out of an object template, so they share a hidden
+// class from the start rather than each transitioning through a new map per property as it is
+// added, which is much of the cost of building many small objects.
+class JsObjectShape final {
+public:
+  // `names` may contain duplicates, in which case the last value given for a name wins, as if the
+  // properties were set one at a time.
+  JsObjectShape(Lock& js, kj::ArrayPtr<const kj::StringPtr> names);
+
+  // Number of values each object has, including duplicates.
+  size_t size() const { return names.size(); }
+
+  // Makes an object whose properties have the values returned by `getValue(i)`, for each `i` up
+  // to size(), in the order of the names passed to the constructor.
+  JsObject instantiate(Lock& js, kj::FunctionParam<JsValue(uint)> getValue)
+      KJ_WARN_UNUSED_RESULT;
+
+  // The property name for each value, as given to the constructor.
+  kj::ArrayPtr<JsRef<JsString>> getNames() { return names; }
+
+  void visitForGc(GcVisitor& visitor) {
+    for (auto& name: names) {
+      visitor.visit(name);
+    }
+  }
+
+private:
+  V8Ref<v8::ObjectTemplate> objectTemplate;
+  kj::Array<JsRef<JsString>> names;
+};
+
 template <typename T, typename Self>
 inline JsRef<Self> JsBase<T,Self>::addRef(Lock& js) {
   return JsRef<Self>(js, *static_cast<Self*>(this));
@@ -66,6 +66,10 @@ struct PromiseContext: public jsg::Object, public jsg::ContextGlobal {
         .tryConsumeResolved(js) == nullptr);
   }
 
+  bool isResolvedNow(jsg::Lock& js, jsg::Promise<int> promise) {
+    return promise.tryConsumeResolved(js) != nullptr;
+  }
+
   void whenResolved(jsg::Lock& js, jsg::Promise<int> promise) {
     // The returned promise should resolve to undefined.
 
@@ -102,6 +106,7 @@ struct PromiseContext: public jsg::Object, public jsg::ContextGlobal {
 
     JSG_METHOD(testConsumeResolved);
     JSG_METHOD(whenResolved);
+    JSG_METHOD(isResolvedNow);
   }
 
   kj::Maybe<Promise<int>::Resolver> resolver;
@@ -172,5 +177,17 @@ KJ_TEST("whenResolved") {
   e.expectEval("whenResolved(Promise.resolve(1))", "undefined", "undefined");
 }
 
+KJ_TEST("already-fulfilled promises are unwrapped immediately") {
+  Evaluator<PromiseContext, PromiseIsolate> e(v8System);
+
+  e.expectEval("isResolvedNow(Promise.resolve(1))", "boolean", "true");
+  e.expectEval("isResolvedNow(new Promise(() => {}))", "boolean", "false");
+  e.expectEval("isResolvedNow(Promise.resolve({ valueOf() { return 1; } }))", "boolean", "false");
+
+  // Converting these throws, which has to happen in the continuation, as a rejection.
+  e.expectEval("isResolvedNow(Promise.resolve(Symbol()))", "boolean", "false");
+  e.expectEval("isResolvedNow(Promise.resolve(1n))", "boolean", "false");
+}
+
 }  // namespace
 }  // namespace workerd::jsg::test
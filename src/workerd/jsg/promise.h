@@ -661,13 +661,30 @@ public:
     if (handle->IsPromise()) {
       auto promise = handle.As<v8::Promise>();
       if constexpr (!isVoid<T>() && !isV8Ref<T>()) {
+        // If the promise is already fulfilled with a primitive, unwrap it now rather than
+        // leaving it for a continuation, which would take another trip through the microtask
+        // queue. Objects are left to the continuation, since unwrapping them can run JavaScript
+        // (getters, etc.), which shouldn't happen synchronously here. So are Symbols and BigInts,
+        // since converting them (e.g. to a string or number) throws, and that must become a
+        // rejection rather than an exception from here.
+        //
+        // TODO(perf): Something similar could be done in `wrap()`, but wrapping can throw, which
+        //   the continuation turns into a rejection.
+        if (promise->State() == v8::Promise::kFulfilled) {
+          auto result = promise->Result();
+          if (!result->IsObject() && !result->IsSymbol() && !result->IsBigInt()) {
+            auto& wrapper = *static_cast<TypeWrapper*>(this);
+            KJ_IF_MAYBE(value,
+                wrapper.tryUnwrap(context, result, (T*)nullptr, parentObject)) {
+              return resolvedPromise<T>(context->GetIsolate(), kj::mv(*value));
+            }
+            // Wrong type. Let the continuation reject with the usual error.
+          }
+        }
+
         // Add a .then() to unwrap the promise's resolution (i.e. convert it from JS to C++).
         // Note that we don't need to handle the rejection case here as there is no wrapping
         // applied to exception values, so we just let it propagate through.
-        //
-        // TODO(perf): We could in theory check if promise->State() is kFulfilled and, in that
-        //   case, pull out promise->Result(), unwrap it, and make a new immediate promise.
-        //   Similarly in `wrap()`. Not clear if the added complexity is worth it, though.
         auto then = check(v8::Function::New(context,
             &thenUnwrap<TypeWrapper, T>, {}, 1, v8::ConstructorBehavior::kThrow));
         promise = check(promise->Then(context, then));
@@ -19,6 +19,7 @@
 #include <typeindex>
 #include "meta.h"
 #include <workerd/jsg/modules.capnp.h>
+#include <v8-fast-api-calls.h>
 
 namespace std {
   inline auto KJ_HASHCODE(const std::type_index& idx) {
@@ -263,6 +264,143 @@ struct MethodCallback<TypeWrapper, methodName, isContext,
   }
 };
 
+// Describes how a parameter or return type of a JSG_FAST_METHOD is passed in a V8 fast API call.
+// Only types whose fast-path conversion agrees with the regular unwrap() are supported. When V8
+// can't convert an argument for the fast path (e.g. a string passed where a number is expected,
+// or an integer out of range), it makes the regular callback instead, which does the usual
+// coercion or throws the usual error.
+template <typename T>
+struct FastApiType {
+  static constexpr bool supported = false;
+  static constexpr bool returnable = false;
+};
+
+template <>
+struct FastApiType<void> {
+  static constexpr bool supported = false;
+  static constexpr bool returnable = true;
+  using Type = void;
+  static constexpr v8::CTypeInfo info() { return v8::CTypeInfo(v8::CTypeInfo::Type::kVoid); }
+};
+
+template <>
+struct FastApiType<bool> {
+  static constexpr bool supported = true;
+  static constexpr bool returnable = true;
+  using Type = bool;
+  static constexpr v8::CTypeInfo info() { return v8::CTypeInfo(v8::CTypeInfo::Type::kBool); }
+  static bool toKj(bool value) { return value; }
+};
+
+template <>
+struct FastApiType<int> {
+  static constexpr bool supported = true;
+  static constexpr bool returnable = true;
+  using Type = int32_t;
+  static constexpr v8::CTypeInfo info() {
+    // kEnforceRange makes V8 take the regular path for out-of-range values, where unwrap() throws.
+    return v8::CTypeInfo(v8::CTypeInfo::Type::kInt32, v8::CTypeInfo::SequenceType::kScalar,
+                         v8::CTypeInfo::Flags::kEnforceRangeBit);
+  }
+  static int toKj(int32_t value) { return value; }
+};
+
+template <>
+struct FastApiType<uint32_t> {
+  static constexpr bool supported = true;
+  static constexpr bool returnable = true;
+  using Type = uint32_t;
+  static constexpr v8::CTypeInfo info() {
+    return v8::CTypeInfo(v8::CTypeInfo::Type::kUint32, v8::CTypeInfo::SequenceType::kScalar,
+                         v8::CTypeInfo::Flags::kEnforceRangeBit);
+  }
+  static uint32_t toKj(uint32_t value) { return value; }
+};
+
+template <>
+struct FastApiType<double> {
+  static constexpr bool supported = true;
+  static constexpr bool returnable = true;
+  using Type = double;
+  static constexpr v8::CTypeInfo info() { return v8::CTypeInfo(v8::CTypeInfo::Type::kFloat64); }
+  static double toKj(double value) { return value; }
+};
+
+// A Uint8Array argument. Other BufferSources take the regular path. As with the regular path, the
+// array is a view onto the JavaScript buffer and must not be retained past the call.
+template <>
+struct FastApiType<kj::Array<kj::byte>> {
+  static constexpr bool supported = true;
+  static constexpr bool returnable = false;
+  using Type = const v8::FastApiTypedArray<uint8_t>&;
+  static constexpr v8::CTypeInfo info() {
+    return v8::CTypeInfo(v8::CTypeInfo::Type::kUint8, v8::CTypeInfo::SequenceType::kIsTypedArray);
+  }
+  static kj::Array<kj::byte> toKj(const v8::FastApiTypedArray<uint8_t>& value) {
+    uint8_t* data;
+    KJ_ASSERT(value.getStorageIfAligned(&data), "byte arrays are always aligned");
+    return kj::Array<kj::byte>(data, value.length(), kj::NullArrayDisposer::instance);
+  }
+};
+
+template <typename Method>
+struct IsFastApiMethod {
+  static constexpr bool value = false;
+};
+
+template <typename U, typename Ret, typename... Args>
+struct IsFastApiMethod<Ret (U::*)(Args...)> {
+  static constexpr bool value =
+      FastApiType<Ret>::returnable && (FastApiType<Args>::supported && ...);
+};
+
+// Implements the V8 fast API call for a method declared with JSG_FAST_METHOD. V8 calls this
+// directly from optimized code instead of MethodCallback<>::callback when the arguments already
+// have the expected types, skipping the FunctionCallbackInfo and handle allocation.
+template <typename TypeWrapper, const char* methodName,
+          typename T, typename Method, Method method, typename Indexes>
+struct FastMethodCallback;
+
+template <typename TypeWrapper, const char* methodName,
+          typename T, typename U, typename Ret, typename... Args,
+          Ret (U::*method)(Args...), size_t... indexes>
+struct FastMethodCallback<TypeWrapper, methodName,
+                          T, Ret (U::*)(Args...), method, kj::_::Indexes<indexes...>> {
+  using Result = typename FastApiType<Ret>::Type;
+
+  static Result fastCall(v8::Local<v8::Object> receiver,
+                         typename FastApiType<Args>::Type... args,
+                         v8::FastApiCallbackOptions& options) {
+    // A fast call can't throw into JavaScript, so anything unusual -- a receiver which isn't one
+    // of our wrappers, or an exception from the method -- sets `fallback`, and V8 repeats the call
+    // on the regular path, which reports the error. Fast methods must therefore not have side
+    // effects before throwing.
+    if (receiver->InternalFieldCount() != Wrappable::INTERNAL_FIELD_COUNT) {
+      options.fallback = true;
+      return Result();
+    }
+    auto& self = *reinterpret_cast<T*>(receiver->GetAlignedPointerFromInternalField(
+        Wrappable::WRAPPED_OBJECT_FIELD_INDEX));
+    try {
+      return (self.*method)(FastApiType<Args>::toKj(args)...);
+    } catch (...) {
+      options.fallback = true;
+      return Result();
+    }
+  }
+
+  static const v8::CFunction* getCFunction() {
+    static constexpr v8::CTypeInfo argInfo[] = {
+      v8::CTypeInfo(v8::CTypeInfo::Type::kV8Value),
+      FastApiType<Args>::info()...,
+      v8::CTypeInfo(v8::CTypeInfo::kCallbackOptionsType),
+    };
+    static const v8::CFunctionInfo info(FastApiType<Ret>::info(), kj::size(argInfo), argInfo);
+    static const v8::CFunction function(reinterpret_cast<const void*>(&fastCall), &info);
+    return &function;
+  }
+};
+
 // Implements the V8 callback function for calling a static method of the C++ class.
 //
 // This is separate from MethodCallback<> because we need to know the interface type, T, and it
@@ -648,6 +786,26 @@ struct ResourceTypeBuilder {
         v8::Local<v8::Value>(), signature, 0, v8::ConstructorBehavior::kThrow));
   }
 
+  template<const char* name, typename Method, Method method>
+  inline void registerFastMethod() {
+    static_assert(IsFastApiMethod<Method>::value,
+        "JSG_FAST_METHOD requires parameters of type bool, int, uint32_t, double or "
+        "kj::Array<kj::byte>, and a return type of void, bool, int, uint32_t or double");
+    if constexpr (isContext) {
+      // The global object's C++ pointer lives in the context's embedder data, which a fast call
+      // can't get at, so global methods always take the regular path.
+      registerMethod<name, Method, method>();
+    } else {
+      prototype->Set(isolate, name, v8::FunctionTemplate::New(isolate,
+          &MethodCallback<TypeWrapper, name, isContext, Self, Method, method,
+                          ArgumentIndexes<Method>>::callback,
+          v8::Local<v8::Value>(), signature, 0, v8::ConstructorBehavior::kThrow,
+          v8::SideEffectType::kHasSideEffect,
+          FastMethodCallback<TypeWrapper, name, Self, Method, method,
+                             ArgumentIndexes<Method>>::getCFunction()));
+    }
+  }
+
   template<const char* name, typename Method, Method method>
   inline void registerStaticMethod() {
     // Notably, we specify an empty signature because a static method invocation will have no holder
@@ -856,6 +1014,9 @@ struct JsSetup {
   template<const char* name, typename Method, Method method>
   inline void registerMethod() { }
 
+  template<const char* name, typename Method, Method method>
+  inline void registerFastMethod() { }
+
   template<const char* name, typename Method, Method method>
   inline void registerStaticMethod() { }
 
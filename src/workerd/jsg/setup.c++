@@ -260,6 +260,67 @@ bool HeapTracer::TryResetRoot(const v8::TracedReference<v8::Value>& handle) {
 }
 
 namespace {
+  // Strings which nearly every request converts to or from JavaScript: header names (lower-cased,
+  // as Headers presents them), methods, and common header values, MIME types and property names.
+  // See v8StrCommon().
+  constexpr kj::StringPtr COMMON_STRINGS[] = {
+    // Header names.
+    "accept"_kj, "accept-charset"_kj, "accept-encoding"_kj, "accept-language"_kj,
+    "accept-ranges"_kj, "access-control-allow-credentials"_kj,
+    "access-control-allow-headers"_kj, "access-control-allow-methods"_kj,
+    "access-control-allow-origin"_kj, "access-control-expose-headers"_kj,
+    "access-control-max-age"_kj, "access-control-request-headers"_kj,
+    "access-control-request-method"_kj, "age"_kj, "allow"_kj, "authorization"_kj,
+    "cache-control"_kj, "cf-connecting-ip"_kj, "cf-ipcountry"_kj, "cf-ray"_kj, "cf-visitor"_kj,
+    "connection"_kj, "content-disposition"_kj, "content-encoding"_kj, "content-language"_kj,
+    "content-length"_kj, "content-location"_kj, "content-range"_kj,
+    "content-security-policy"_kj, "content-type"_kj, "cookie"_kj, "date"_kj, "etag"_kj,
+    "expect"_kj, "expires"_kj, "forwarded"_kj, "host"_kj, "if-match"_kj,
+    "if-modified-since"_kj, "if-none-match"_kj, "if-range"_kj, "if-unmodified-since"_kj,
+    "keep-alive"_kj, "last-modified"_kj, "link"_kj, "location"_kj, "origin"_kj, "pragma"_kj,
+    "range"_kj, "referer"_kj, "referrer-policy"_kj, "retry-after"_kj,
+    "sec-websocket-accept"_kj, "sec-websocket-extensions"_kj, "sec-websocket-key"_kj,
+    "sec-websocket-protocol"_kj, "sec-websocket-version"_kj, "server"_kj, "set-cookie"_kj,
+    "strict-transport-security"_kj, "te"_kj, "trailer"_kj, "transfer-encoding"_kj,
+    "upgrade"_kj, "user-agent"_kj, "vary"_kj, "via"_kj, "www-authenticate"_kj,
+    "x-content-type-options"_kj, "x-forwarded-for"_kj, "x-forwarded-proto"_kj,
+    "x-frame-options"_kj, "x-real-ip"_kj, "x-requested-with"_kj,
+
+    // Methods.
+    "GET"_kj, "HEAD"_kj, "POST"_kj, "PUT"_kj, "DELETE"_kj, "PATCH"_kj, "OPTIONS"_kj,
+    "CONNECT"_kj, "TRACE"_kj,
+
+    // MIME types.
+    "text/plain"_kj, "text/plain;charset=UTF-8"_kj, "text/html"_kj,
+    "text/html; charset=utf-8"_kj, "text/html;charset=UTF-8"_kj, "text/css"_kj,
+    "text/javascript"_kj, "application/javascript"_kj, "application/json"_kj,
+    "application/octet-stream"_kj, "application/x-www-form-urlencoded"_kj,
+    "multipart/form-data"_kj, "image/png"_kj, "image/jpeg"_kj, "image/gif"_kj,
+    "image/webp"_kj, "image/svg+xml"_kj,
+
+    // Other header values.
+    "*"_kj, "br"_kj, "chunked"_kj, "close"_kj, "deflate"_kj, "gzip"_kj, "identity"_kj,
+    "no-cache"_kj, "no-store"_kj, "websocket"_kj,
+
+    // Property names.
+    "body"_kj, "code"_kj, "data"_kj, "done"_kj, "error"_kj, "headers"_kj, "id"_kj, "key"_kj,
+    "length"_kj, "message"_kj, "method"_kj, "name"_kj, "ok"_kj, "result"_kj, "size"_kj,
+    "status"_kj, "statusText"_kj, "type"_kj, "url"_kj, "value"_kj,
+  };
+
+  // Maps each string in COMMON_STRINGS to its index. Shared by all isolates.
+  const kj::HashMap<kj::StringPtr, uint>& commonStringIndex() {
+    static const kj::HashMap<kj::StringPtr, uint> index = []() {
+      kj::HashMap<kj::StringPtr, uint> result;
+      for (auto i: kj::zeroTo(kj::size(COMMON_STRINGS))) {
+        KJ_ASSERT(COMMON_STRINGS[i].size() <= MAX_COMMON_STRING_SIZE, COMMON_STRINGS[i]);
+        result.insert(COMMON_STRINGS[i], i);
+      }
+      return result;
+    }();
+    return index;
+  }
+
   static v8::Isolate* newIsolate(v8::Isolate::CreateParams&& params) {
     V8StackScope stackScope;
     if (params.array_buffer_allocator == nullptr &&
@@ -274,6 +335,7 @@ namespace {
 IsolateBase::IsolateBase(const V8System& system, v8::Isolate::CreateParams&& createParams, kj::Own<IsolateObserver> observer)
     : system(system),
       ptr(newIsolate(kj::mv(createParams))),
+      commonStrings(kj::heapArray<v8::Global<v8::String>>(kj::size(COMMON_STRINGS))),
       heapTracer(ptr),
       observer(kj::mv(observer)) {
   V8StackScope stackScope;
@@ -382,6 +444,7 @@ void IsolateBase::dropWrappers(kj::Own<void> typeWrapperInstance) {
 
   // Make sure opaqueTemplate is destroyed under lock (but not until later).
   KJ_DEFER(opaqueTemplate.Reset());
+  KJ_DEFER(commonStrings = nullptr);
 
   // Make sure the TypeWrapper is destroyed under lock by declaring a new copy of the variable that
   // is destroyed before the lock is released.
@@ -647,6 +710,17 @@ kj::Maybe<kj::StringPtr> getJsStackTrace(void* ucontext, kj::ArrayPtr<char> scra
 }
 #endif
 
+kj::Maybe<v8::Local<v8::String>> IsolateBase::tryGetCommonString(kj::StringPtr str) {
+  KJ_IF_MAYBE(index, commonStringIndex().find(str)) {
+    auto& handle = commonStrings[*index];
+    if (handle.IsEmpty()) {
+      handle.Reset(ptr, v8StrIntern(ptr, COMMON_STRINGS[*index]));
+    }
+    return handle.Get(ptr);
+  }
+  return nullptr;
+}
+
 kj::StringPtr IsolateBase::getUuid() {
   // Lazily create a random UUID for this isolate.
   KJ_IF_MAYBE(u, uuid) { return *u; }
@@ -106,6 +106,10 @@ public:
 
   IsolateObserver& getObserver() { return *observer; }
 
+  // Returns this isolate's internalized copy of `str` if it is in the common string table,
+  // creating it on first use. See v8StrCommon().
+  kj::Maybe<v8::Local<v8::String>> tryGetCommonString(kj::StringPtr str);
+
 private:
   template <typename TypeWrapper>
   friend class Isolate;
@@ -154,6 +158,9 @@ private:
   // object with 2 internal fields.
   v8::Global<v8::FunctionTemplate> opaqueTemplate;
 
+  // Handles for the strings in the common string table, by index, filled in as they are used.
+  kj::Array<v8::Global<v8::String>> commonStrings;
+
   // We expect queues to remain relatively small -- 8 is the largest size I have observed from local
   // testing.
   static constexpr auto DESTRUCTION_QUEUE_INITIAL_SIZE = 8;
@@ -5,6 +5,8 @@
 #include "jsg.h"  // can't include util.h directly due to weird cyclic dependency...
 #include "setup.h"
 #include <kj/debug.h>
+#include <kj/vector.h>
+#include <atomic>
 #include <stdlib.h>
 
 #if !_WIN32
@@ -15,6 +17,10 @@
 
 namespace workerd::jsg {
 
+kj::Maybe<v8::Local<v8::String>> tryGetCommonString(v8::Isolate* isolate, kj::StringPtr str) {
+  return IsolateBase::from(isolate).tryGetCommonString(str);
+}
+
 bool getCaptureThrowsAsRejections(v8::Isolate* isolate) {
   auto& jsgIsolate = *reinterpret_cast<IsolateBase*>(isolate->GetData(0));
   return jsgIsolate.getCaptureThrowsAsRejections();
@@ -499,13 +505,164 @@ static kj::Array<kj::byte> getEmptyArray() {
   return kj::Array<kj::byte>(&DUMMY, 0, kj::NullArrayDisposer::instance);
 }
 
+namespace {
+
+class OwnerPool;
+
+// Owns a v8::BackingStore on behalf of a kj::Array returned by attachBackingStore().
+class BackingStoreOwner final: public kj::ArrayDisposer {
+public:
+  explicit BackingStoreOwner(std::shared_ptr<v8::BackingStore> backing)
+      : backing(kj::mv(backing)) {}
+
+protected:
+  void disposeImpl(void* firstElement, size_t elementSize, size_t elementCount,
+                   size_t capacity, void (*destroyElement)(void*)) const override;
+
+private:
+  std::shared_ptr<v8::BackingStore> backing;
+};
+
+// Storage for either a kj::Array<kj::byte> owned by V8 (see newBackingStore()) or a
+// BackingStoreOwner. `storage` comes first so that a pointer to it is a pointer to the slot.
+struct OwnerSlot {
+  alignas(void*) kj::byte storage[kj::max(sizeof(kj::Array<kj::byte>),
+                                          sizeof(BackingStoreOwner))];
+  OwnerPool* pool;
+  OwnerSlot* next;
+};
+
+// A pool of OwnerSlots for one thread. Slots are only ever acquired by the pool's own thread, but
+// they may be released on any thread: V8 frees backing stores on its background threads, and a
+// jsg::BackingStore or kj::Array can be handed to another thread. So releases from other threads
+// go onto a lock-free list, which the owning thread takes over whole when its local list runs out.
+// (Only the owning thread ever removes from that list, so there is no ABA problem.)
+//
+// The pool is refcounted by its thread and by each slot in use, and is freed along with its slots
+// once both the thread has exited and every slot has been released. Until then it keeps as many
+// slots as its thread has had in use at once.
+class OwnerPool {
+public:
+  static OwnerPool& current();
+  static void release(OwnerSlot& slot);
+
+  OwnerSlot& acquire() {
+    if (localFree == nullptr) {
+      localFree = remoteFree.exchange(nullptr, std::memory_order_acquire);
+      if (localFree == nullptr) grow();
+    }
+    auto& slot = *localFree;
+    localFree = slot.next;
+    refcount.fetch_add(1, std::memory_order_relaxed);
+    return slot;
+  }
+
+  size_t getCapacity() { return capacity; }
+
+  void unref() {
+    if (refcount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete this;
+    }
+  }
+
+private:
+  std::atomic<uint> refcount {1};
+  std::atomic<OwnerSlot*> remoteFree {nullptr};
+  OwnerSlot* localFree = nullptr;
+  size_t capacity = 0;
+  kj::Vector<kj::Array<OwnerSlot>> chunks;
+
+  void grow() {
+    // Each chunk doubles the capacity, so a thread with many buffers alive at once quickly stops
+    // allocating.
+    auto chunk = kj::heapArray<OwnerSlot>(kj::max(capacity, 16));
+    for (auto& slot: chunk) {
+      slot.pool = this;
+      slot.next = localFree;
+      localFree = &slot;
+    }
+    capacity += chunk.size();
+    chunks.add(kj::mv(chunk));
+  }
+};
+
+struct ThreadOwnerPool {
+  OwnerPool* pool = nullptr;
+
+  ~ThreadOwnerPool() noexcept(false) {
+    if (pool != nullptr) {
+      auto p = pool;
+      pool = nullptr;
+      p->unref();
+    }
+  }
+};
+thread_local ThreadOwnerPool threadOwnerPool;
+
+OwnerPool& OwnerPool::current() {
+  if (threadOwnerPool.pool == nullptr) {
+    threadOwnerPool.pool = new OwnerPool();
+  }
+  return *threadOwnerPool.pool;
+}
+
+void OwnerPool::release(OwnerSlot& slot) {
+  auto& pool = *slot.pool;
+  if (&pool == threadOwnerPool.pool) {
+    slot.next = pool.localFree;
+    pool.localFree = &slot;
+  } else {
+    auto head = pool.remoteFree.load(std::memory_order_relaxed);
+    do {
+      slot.next = head;
+    } while (!pool.remoteFree.compare_exchange_weak(
+        head, &slot, std::memory_order_release, std::memory_order_relaxed));
+  }
+  pool.unref();
+}
+
+void BackingStoreOwner::disposeImpl(void* firstElement, size_t elementSize, size_t elementCount,
+                                    size_t capacity, void (*destroyElement)(void*)) const {
+  auto& slot = *reinterpret_cast<OwnerSlot*>(const_cast<BackingStoreOwner*>(this));
+  kj::dtor(*const_cast<BackingStoreOwner*>(this));
+  OwnerPool::release(slot);
+}
+
+void disposeOwnedArray(void* data, size_t length, void* deleterData) {
+  auto& slot = *reinterpret_cast<OwnerSlot*>(deleterData);
+  kj::dtor(*reinterpret_cast<kj::Array<kj::byte>*>(slot.storage));
+  OwnerPool::release(slot);
+}
+
+}  // namespace
+
+std::unique_ptr<v8::BackingStore> newBackingStore(kj::Array<kj::byte> bytes) {
+  auto begin = bytes.begin();
+  auto size = bytes.size();
+  auto& slot = OwnerPool::current().acquire();
+  kj::ctor(*reinterpret_cast<kj::Array<kj::byte>*>(slot.storage), kj::mv(bytes));
+  return v8::ArrayBuffer::NewBackingStore(begin, size, &disposeOwnedArray, &slot);
+}
+
+kj::Array<kj::byte> attachBackingStore(
+    kj::ArrayPtr<kj::byte> bytes, std::shared_ptr<v8::BackingStore> backing) {
+  auto& slot = OwnerPool::current().acquire();
+  auto owner = reinterpret_cast<BackingStoreOwner*>(slot.storage);
+  kj::ctor(*owner, kj::mv(backing));
+  return kj::Array<kj::byte>(bytes.begin(), bytes.size(), *owner);
+}
+
+size_t getBackingStoreOwnerCapacityForTest() {
+  return OwnerPool::current().getCapacity();
+}
+
 kj::Array<kj::byte> asBytes(v8::Local<v8::ArrayBuffer> arrayBuffer) {
   auto backing = arrayBuffer->GetBackingStore();
   kj::ArrayPtr bytes(static_cast<kj::byte*>(backing->Data()), backing->ByteLength());
   if (bytes == nullptr) {
     return getEmptyArray();
   } else {
-    return bytes.attach(kj::mv(backing));
+    return attachBackingStore(bytes, kj::mv(backing));
   }
 }
 kj::Array<kj::byte> asBytes(v8::Local<v8::ArrayBufferView> arrayBufferView) {
@@ -518,7 +675,7 @@ kj::Array<kj::byte> asBytes(v8::Local<v8::ArrayBufferView> arrayBufferView) {
   if (bytes == nullptr) {
     return getEmptyArray();
   } else {
-    return bytes.attach(kj::mv(backing));
+    return attachBackingStore(bytes, kj::mv(backing));
   }
 }
 
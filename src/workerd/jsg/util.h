@@ -184,6 +184,20 @@ kj::Array<kj::byte> asBytes(v8::Local<v8::ArrayBuffer> arrayBuffer);
 // View the contents of the given v8::ArrayBuffer/ArrayBufferView as an ArrayPtr<byte>.
 kj::Array<kj::byte> asBytes(v8::Local<v8::ArrayBufferView> arrayBufferView);
 
+// Returns a v8::BackingStore which takes ownership of `bytes`, so that a kj::Array can become the
+// contents of an ArrayBuffer without copying. The small object which owns the array on V8's behalf
+// comes from a per-thread pool, so in the steady state this does no allocation of its own.
+std::unique_ptr<v8::BackingStore> newBackingStore(kj::Array<kj::byte> bytes);
+
+// The reverse of newBackingStore(): returns a kj::Array viewing `bytes`, which must lie within
+// `backing`, that keeps `backing` alive. Use this to take over the contents of a detached or
+// transferred ArrayBuffer without copying. The array's disposer comes from the same pool.
+kj::Array<kj::byte> attachBackingStore(
+    kj::ArrayPtr<kj::byte> bytes, std::shared_ptr<v8::BackingStore> backing);
+
+// Returns how many owners the calling thread's pool has allocated so far.
+size_t getBackingStoreOwnerCapacityForTest();
+
 // Freeze the given object and all its members, making it recursively immutable.
 //
 // WARNING: This function is unsafe to call on user-provided content since if the value is cyclic
@@ -248,6 +262,25 @@ inline v8::Local<v8::String> v8StrIntern(v8::Isolate* isolate, kj::StringPtr str
   return v8Str(isolate, str, v8::NewStringType::kInternalized);
 }
 
+// No string longer than this is in the common string table. See v8StrCommon().
+constexpr size_t MAX_COMMON_STRING_SIZE = 40;
+
+// Returns the isolate's internalized copy of `str` if it is in the common string table.
+kj::Maybe<v8::Local<v8::String>> tryGetCommonString(v8::Isolate* isolate, kj::StringPtr str);
+
+// Like v8Str(), but if `str` is one of a fixed set of strings that come up on nearly every
+// request -- common HTTP header names and values, methods, MIME types, and property names --
+// returns an internalized string whose handle the isolate keeps, skipping the allocation and
+// UTF-8 decoding. Checking the table is cheap, and skipped for longer strings.
+inline v8::Local<v8::String> v8StrCommon(v8::Isolate* isolate, kj::StringPtr str) {
+  if (str.size() <= MAX_COMMON_STRING_SIZE) {
+    KJ_IF_MAYBE(common, tryGetCommonString(isolate, str)) {
+      return *common;
+    }
+  }
+  return v8Str(isolate, str);
+}
+
 template <typename T> constexpr bool isVoid() { return false; }
 template <> constexpr bool isVoid<void>() { return true; }
 
@@ -0,0 +1,59 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "backend-balancer.h"
+#include <kj/debug.h>
+
+namespace workerd::server {
+
+BackendBalancer::BackendBalancer(kj::Timer& timer, size_t backendCount, Options options)
+    : timer(timer), options(options), backends(kj::heapArray<Backend>(backendCount)) {
+  KJ_REQUIRE(backendCount > 0);
+}
+
+size_t BackendBalancer::pick() {
+  if (backends.size() == 1) return 0;
+
+  auto now = timer.now();
+  auto isBetter = [&](const Backend& a, const Backend& b) {
+    bool aEjected = a.ejectedUntil > now;
+    bool bEjected = b.ejectedUntil > now;
+    if (aEjected != bEjected) return bEjected;
+    return a.inFlight < b.inFlight;
+  };
+
+  size_t best = next;
+  for (auto i: kj::range<size_t>(1, backends.size())) {
+    auto candidate = (next + i) % backends.size();
+    if (isBetter(backends[candidate], backends[best])) {
+      best = candidate;
+    }
+  }
+  next = (best + 1) % backends.size();
+  return best;
+}
+
+kj::Promise<void> BackendBalancer::track(size_t backend, kj::Promise<void> promise,
+                                         kj::Function<bool()> failed) {
+  ++backends[backend].inFlight;
+  return promise.then([this, backend, failed = kj::mv(failed)]() mutable {
+    recordResult(backend, failed());
+  }, [this, backend](kj::Exception&& e) -> void {
+    recordResult(backend, true);
+    kj::throwFatalException(kj::mv(e));
+  }).attach(kj::defer([this, backend]() { --backends[backend].inFlight; }));
+}
+
+void BackendBalancer::recordResult(size_t backend, bool failed) {
+  auto& state = backends[backend];
+  if (!failed) {
+    state.consecutiveFailures = 0;
+  } else if (options.ejectAfterFailures > 0 &&
+             ++state.consecutiveFailures >= options.ejectAfterFailures) {
+    state.consecutiveFailures = 0;
+    state.ejectedUntil = timer.now() + options.ejectionTime;
+  }
+}
+
+}  // namespace workerd::server
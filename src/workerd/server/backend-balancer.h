@@ -0,0 +1,60 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/async.h>
+#include <kj/function.h>
+#include <kj/timer.h>
+
+namespace workerd::server {
+
+// Chooses which of a fixed set of interchangeable backends each request goes to, as an
+// ExternalServer with several addresses does. Backends are identified by index; the caller keeps
+// whatever it needs to actually reach them.
+//
+// Each request goes to the backend with the fewest requests in flight, with ties spread
+// round-robin. A backend which fails `ejectAfterFailures` requests in a row is skipped for
+// `ejectionTime`, unless every backend is being skipped.
+class BackendBalancer {
+public:
+  struct Options {
+    // 0 means never eject.
+    uint ejectAfterFailures = 0;
+    kj::Duration ejectionTime = 0 * kj::SECONDS;
+  };
+
+  BackendBalancer(kj::Timer& timer, size_t backendCount, Options options);
+
+  // Returns the index of the backend the next request should go to.
+  size_t pick();
+
+  // Counts `promise` as in flight at `backend` until it completes or is canceled, and records
+  // whether it failed. `failed` says whether a request which completed normally should still
+  // count as a failure.
+  kj::Promise<void> track(size_t backend, kj::Promise<void> promise,
+                          kj::Function<bool()> failed);
+
+  // Records the outcome of a request to `backend`, ejecting it if it has now failed too many
+  // times in a row. track() calls this.
+  void recordResult(size_t backend, bool failed);
+
+  uint getInFlight(size_t backend) const { return backends[backend].inFlight; }
+
+private:
+  struct Backend {
+    uint inFlight = 0;
+    uint consecutiveFailures = 0;
+    kj::TimePoint ejectedUntil = kj::origin<kj::TimePoint>();
+  };
+
+  kj::Timer& timer;
+  Options options;
+  kj::Array<Backend> backends;
+
+  // Where the next search for a backend starts, so that ties are spread across backends.
+  size_t next = 0;
+};
+
+}  // namespace workerd::server
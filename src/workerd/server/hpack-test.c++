@@ -0,0 +1,208 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "hpack.h"
+#include <kj/encoding.h>
+#include <kj/test.h>
+
+namespace workerd::server {
+namespace {
+
+// Examples are from RFC 7541 Appendix C.
+
+kj::String decodeBlock(HpackDecoder& decoder, kj::StringPtr hex) {
+  auto block = kj::decodeHex(hex);
+  KJ_ASSERT(!block.hadErrors);
+  kj::Vector<kj::String> lines;
+  decoder.decode(block, [&](kj::StringPtr name, kj::StringPtr value) {
+    lines.add(kj::str(name, ": ", value));
+  });
+  return kj::strArray(lines, "\n");
+}
+
+struct Header {
+  kj::StringPtr name;
+  kj::StringPtr value;
+};
+
+kj::String encodeBlock(HpackEncoder& encoder, kj::ArrayPtr<const Header> headers) {
+  kj::Vector<kj::byte> out;
+  encoder.beginBlock(out);
+  for (auto& header: headers) {
+    encoder.encode(out, header.name, header.value);
+  }
+  return kj::encodeHex(out);
+}
+
+KJ_TEST("HPACK Huffman coding") {
+  struct {
+    kj::StringPtr text;
+    kj::StringPtr hex;
+  } examples[] = {
+    { "www.example.com"_kj, "f1e3c2e5f23a6ba0ab90f4ff"_kj },
+    { "no-cache"_kj, "a8eb10649cbf"_kj },
+    { "custom-key"_kj, "25a849e95ba97d7f"_kj },
+    { "custom-value"_kj, "25a849e95bb8e8b4bf"_kj },
+    { "302"_kj, "6402"_kj },
+    { "private"_kj, "aec3771a4b"_kj },
+    { "Mon, 21 Oct 2013 20:13:21 GMT"_kj, "d07abe941054d444a8200595040b8166e082a62d1bff"_kj },
+    { "https://www.example.com"_kj, "9d29ad171863c78f0b97c8e9ae82ae43d3"_kj },
+  };
+
+  for (auto& example: examples) {
+    kj::Vector<kj::byte> encoded;
+    hpackEncodeHuffman(encoded, example.text);
+    KJ_EXPECT(kj::encodeHex(encoded) == example.hex, example.text);
+    KJ_EXPECT(hpackDecodeHuffman(encoded) == example.text);
+  }
+
+  // Every byte value survives a round trip.
+  kj::Vector<char> all;
+  for (uint i = 1; i < 256; i++) {
+    all.add(i);
+  }
+  all.add('\0');
+  kj::String text(all.releaseAsArray());
+  kj::Vector<kj::byte> encoded;
+  hpackEncodeHuffman(encoded, text);
+  KJ_EXPECT(hpackDecodeHuffman(encoded) == text);
+
+  // Padding longer than 7 bits, padding which isn't all ones, and EOS are all errors.
+  kj::byte tooMuchPadding[] = { 0xf1, 0xff };
+  KJ_EXPECT_THROW_MESSAGE("padding", hpackDecodeHuffman(tooMuchPadding));
+  kj::byte zeroPadding[] = { 0x18 };
+  KJ_EXPECT_THROW_MESSAGE("padding", hpackDecodeHuffman(zeroPadding));
+  kj::byte eos[] = { 0xff, 0xff, 0xff, 0xff };
+  KJ_EXPECT_THROW_MESSAGE("EOS", hpackDecodeHuffman(eos));
+}
+
+KJ_TEST("HPACK decodes requests") {
+  // C.3, without Huffman coding.
+  {
+    HpackDecoder decoder;
+    KJ_EXPECT(decodeBlock(decoder, "828684410f7777772e6578616d706c652e636f6d") ==
+        ":method: GET\n:scheme: http\n:path: /\n:authority: www.example.com");
+    KJ_EXPECT(decodeBlock(decoder, "828684be58086e6f2d6361636865") ==
+        ":method: GET\n:scheme: http\n:path: /\n:authority: www.example.com\n"
+        "cache-control: no-cache");
+    KJ_EXPECT(decodeBlock(decoder,
+        "828785bf400a637573746f6d2d6b65790c637573746f6d2d76616c7565") ==
+        ":method: GET\n:scheme: https\n:path: /index.html\n:authority: www.example.com\n"
+        "custom-key: custom-value");
+  }
+
+  // C.4, with Huffman coding.
+  {
+    HpackDecoder decoder;
+    KJ_EXPECT(decodeBlock(decoder, "828684418cf1e3c2e5f23a6ba0ab90f4ff") ==
+        ":method: GET\n:scheme: http\n:path: /\n:authority: www.example.com");
+    KJ_EXPECT(decodeBlock(decoder, "828684be5886a8eb10649cbf") ==
+        ":method: GET\n:scheme: http\n:path: /\n:authority: www.example.com\n"
+        "cache-control: no-cache");
+    KJ_EXPECT(decodeBlock(decoder, "828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf") ==
+        ":method: GET\n:scheme: https\n:path: /index.html\n:authority: www.example.com\n"
+        "custom-key: custom-value");
+  }
+}
+
+KJ_TEST("HPACK decodes responses, evicting from a small table") {
+  // C.6, whose table is limited to 256 bytes.
+  HpackDecoder decoder(256);
+  KJ_EXPECT(decodeBlock(decoder,
+      "488264025885aec3771a4b6196d07abe941054d444a8200595040b8166e082a62d1bff6e919d29ad171863c7"
+      "8f0b97c8e9ae82ae43d3") ==
+      ":status: 302\ncache-control: private\ndate: Mon, 21 Oct 2013 20:13:21 GMT\n"
+      "location: https://www.example.com");
+  KJ_EXPECT(decodeBlock(decoder, "4883640effc1c0bf") ==
+      ":status: 307\ncache-control: private\ndate: Mon, 21 Oct 2013 20:13:21 GMT\n"
+      "location: https://www.example.com");
+  KJ_EXPECT(decodeBlock(decoder,
+      "88c16196d07abe941054d444a8200595040b8166e084a62d1bffc05a839bd9ab77ad94e7821dd7f2e6c7b335"
+      "dfdfcd5b3960d5af27087f3672c1ab270fb5291f9587316065c003ed4ee5b1063d5007") ==
+      ":status: 200\ncache-control: private\ndate: Mon, 21 Oct 2013 20:13:22 GMT\n"
+      "location: https://www.example.com\ncontent-encoding: gzip\n"
+      "set-cookie: foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1");
+}
+
+KJ_TEST("HPACK rejects malformed blocks") {
+  {
+    // Index past the end of the dynamic table.
+    HpackDecoder decoder;
+    KJ_EXPECT_THROW_MESSAGE("past the end", decodeBlock(decoder, "be"));
+  }
+  {
+    // Index 0.
+    HpackDecoder decoder;
+    KJ_EXPECT_THROW_MESSAGE("index 0", decodeBlock(decoder, "80"));
+  }
+  {
+    // String runs off the end of the block.
+    HpackDecoder decoder;
+    KJ_EXPECT_THROW_MESSAGE("truncated", decodeBlock(decoder, "410f7777"));
+  }
+  {
+    // Table size update above what we allow.
+    HpackDecoder decoder(256);
+    KJ_EXPECT_THROW_MESSAGE("exceeds the limit", decodeBlock(decoder, "3fe201"));
+  }
+  {
+    // Table size update after a header.
+    HpackDecoder decoder;
+    KJ_EXPECT_THROW_MESSAGE("must come before", decodeBlock(decoder, "8220"));
+  }
+}
+
+KJ_TEST("HPACK encodes like the RFC's examples") {
+  // Our choices happen to match C.4 exactly.
+  HpackEncoder encoder;
+  KJ_EXPECT(encodeBlock(encoder, {
+    { ":method", "GET" }, { ":scheme", "http" }, { ":path", "/" },
+    { ":authority", "www.example.com" },
+  }) == "828684418cf1e3c2e5f23a6ba0ab90f4ff");
+  KJ_EXPECT(encodeBlock(encoder, {
+    { ":method", "GET" }, { ":scheme", "http" }, { ":path", "/" },
+    { ":authority", "www.example.com" }, { "cache-control", "no-cache" },
+  }) == "828684be5886a8eb10649cbf");
+  KJ_EXPECT(encodeBlock(encoder, {
+    { ":method", "GET" }, { ":scheme", "https" }, { ":path", "/index.html" },
+    { ":authority", "www.example.com" }, { "custom-key", "custom-value" },
+  }) == "828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf");
+}
+
+KJ_TEST("HPACK encoder and decoder stay in step") {
+  HpackEncoder encoder;
+  HpackDecoder decoder;
+  auto longValue = kj::str(kj::repeat('x', 2000));
+
+  for (uint i = 0; i < 200; i++) {
+    auto counter = kj::str(i % 37);
+    kj::Vector<kj::byte> out;
+    if (i == 50) encoder.setMaxTableSize(0);
+    if (i == 51) encoder.setMaxTableSize(100000);
+    encoder.beginBlock(out);
+    encoder.encode(out, ":status", "200");
+    encoder.encode(out, "x-counter", counter);
+    encoder.encode(out, "authorization", "secret");
+    encoder.encode(out, "x-long", longValue);
+
+    kj::Vector<kj::String> decoded;
+    decoder.decode(out, [&](kj::StringPtr name, kj::StringPtr value) {
+      decoded.add(kj::str(name, ": ", value));
+    });
+    KJ_ASSERT(decoded.size() == 4);
+    KJ_EXPECT(decoded[0] == ":status: 200");
+    KJ_EXPECT(decoded[1] == kj::str("x-counter: ", counter));
+    KJ_EXPECT(decoded[2] == "authorization: secret");
+    KJ_EXPECT(decoded[3] == kj::str("x-long: ", longValue));
+  }
+
+  // Once indexed, a repeated header is a single byte.
+  kj::Vector<kj::byte> out;
+  encoder.beginBlock(out);
+  encoder.encode(out, "x-counter", "5");
+  KJ_EXPECT(out.size() == 1);
+}
+
+}  // namespace
+}  // namespace workerd::server
@@ -0,0 +1,447 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "hpack.h"
+#include <kj/debug.h>
+
+namespace workerd::server {
+
+namespace {
+
+struct StaticEntry {
+  kj::StringPtr name;
+  kj::StringPtr value;
+};
+
+// RFC 7541 Appendix A. Index 1 is the first entry.
+constexpr StaticEntry STATIC_TABLE[] = {
+  { ":authority"_kj, ""_kj },
+  { ":method"_kj, "GET"_kj },
+  { ":method"_kj, "POST"_kj },
+  { ":path"_kj, "/"_kj },
+  { ":path"_kj, "/index.html"_kj },
+  { ":scheme"_kj, "http"_kj },
+  { ":scheme"_kj, "https"_kj },
+  { ":status"_kj, "200"_kj },
+  { ":status"_kj, "204"_kj },
+  { ":status"_kj, "206"_kj },
+  { ":status"_kj, "304"_kj },
+  { ":status"_kj, "400"_kj },
+  { ":status"_kj, "404"_kj },
+  { ":status"_kj, "500"_kj },
+  { "accept-charset"_kj, ""_kj },
+  { "accept-encoding"_kj, "gzip, deflate"_kj },
+  { "accept-language"_kj, ""_kj },
+  { "accept-ranges"_kj, ""_kj },
+  { "accept"_kj, ""_kj },
+  { "access-control-allow-origin"_kj, ""_kj },
+  { "age"_kj, ""_kj },
+  { "allow"_kj, ""_kj },
+  { "authorization"_kj, ""_kj },
+  { "cache-control"_kj, ""_kj },
+  { "content-disposition"_kj, ""_kj },
+  { "content-encoding"_kj, ""_kj },
+  { "content-language"_kj, ""_kj },
+  { "content-length"_kj, ""_kj },
+  { "content-location"_kj, ""_kj },
+  { "content-range"_kj, ""_kj },
+  { "content-type"_kj, ""_kj },
+  { "cookie"_kj, ""_kj },
+  { "date"_kj, ""_kj },
+  { "etag"_kj, ""_kj },
+  { "expect"_kj, ""_kj },
+  { "expires"_kj, ""_kj },
+  { "from"_kj, ""_kj },
+  { "host"_kj, ""_kj },
+  { "if-match"_kj, ""_kj },
+  { "if-modified-since"_kj, ""_kj },
+  { "if-none-match"_kj, ""_kj },
+  { "if-range"_kj, ""_kj },
+  { "if-unmodified-since"_kj, ""_kj },
+  { "last-modified"_kj, ""_kj },
+  { "link"_kj, ""_kj },
+  { "location"_kj, ""_kj },
+  { "max-forwards"_kj, ""_kj },
+  { "proxy-authenticate"_kj, ""_kj },
+  { "proxy-authorization"_kj, ""_kj },
+  { "range"_kj, ""_kj },
+  { "referer"_kj, ""_kj },
+  { "refresh"_kj, ""_kj },
+  { "retry-after"_kj, ""_kj },
+  { "server"_kj, ""_kj },
+  { "set-cookie"_kj, ""_kj },
+  { "strict-transport-security"_kj, ""_kj },
+  { "transfer-encoding"_kj, ""_kj },
+  { "user-agent"_kj, ""_kj },
+  { "vary"_kj, ""_kj },
+  { "via"_kj, ""_kj },
+  { "www-authenticate"_kj, ""_kj },
+};
+
+constexpr size_t STATIC_TABLE_SIZE = kj::size(STATIC_TABLE);
+
+// We never let the peer's encoder use a bigger table than this, nor use one ourselves.
+constexpr size_t DEFAULT_TABLE_SIZE = 4096;
+
+struct HuffmanCode {
+  uint32_t code;
+  uint8_t bits;
+};
+
+// RFC 7541 Appendix B, indexed by symbol. Symbol 256 is EOS.
+constexpr HuffmanCode HUFFMAN_CODES[257] = {
+  {0x1ff8, 13}, {0x7fffd8, 23}, {0xfffffe2, 28}, {0xfffffe3, 28}, {0xfffffe4, 28}, {0xfffffe5, 28},
+  {0xfffffe6, 28}, {0xfffffe7, 28}, {0xfffffe8, 28}, {0xffffea, 24}, {0x3ffffffc, 30},
+  {0xfffffe9, 28}, {0xfffffea, 28}, {0x3ffffffd, 30}, {0xfffffeb, 28}, {0xfffffec, 28},
+  {0xfffffed, 28}, {0xfffffee, 28}, {0xfffffef, 28}, {0xffffff0, 28}, {0xffffff1, 28},
+  {0xffffff2, 28}, {0x3ffffffe, 30}, {0xffffff3, 28}, {0xffffff4, 28}, {0xffffff5, 28},
+  {0xffffff6, 28}, {0xffffff7, 28}, {0xffffff8, 28}, {0xffffff9, 28}, {0xffffffa, 28},
+  {0xffffffb, 28}, {0x14, 6}, {0x3f8, 10}, {0x3f9, 10}, {0xffa, 12}, {0x1ff9, 13}, {0x15, 6},
+  {0xf8, 8}, {0x7fa, 11}, {0x3fa, 10}, {0x3fb, 10}, {0xf9, 8}, {0x7fb, 11}, {0xfa, 8}, {0x16, 6},
+  {0x17, 6}, {0x18, 6}, {0x0, 5}, {0x1, 5}, {0x2, 5}, {0x19, 6}, {0x1a, 6}, {0x1b, 6}, {0x1c, 6},
+  {0x1d, 6}, {0x1e, 6}, {0x1f, 6}, {0x5c, 7}, {0xfb, 8}, {0x7ffc, 15}, {0x20, 6}, {0xffb, 12},
+  {0x3fc, 10}, {0x1ffa, 13}, {0x21, 6}, {0x5d, 7}, {0x5e, 7}, {0x5f, 7}, {0x60, 7}, {0x61, 7},
+  {0x62, 7}, {0x63, 7}, {0x64, 7}, {0x65, 7}, {0x66, 7}, {0x67, 7}, {0x68, 7}, {0x69, 7}, {0x6a, 7},
+  {0x6b, 7}, {0x6c, 7}, {0x6d, 7}, {0x6e, 7}, {0x6f, 7}, {0x70, 7}, {0x71, 7}, {0x72, 7}, {0xfc, 8},
+  {0x73, 7}, {0xfd, 8}, {0x1ffb, 13}, {0x7fff0, 19}, {0x1ffc, 13}, {0x3ffc, 14}, {0x22, 6},
+  {0x7ffd, 15}, {0x3, 5}, {0x23, 6}, {0x4, 5}, {0x24, 6}, {0x5, 5}, {0x25, 6}, {0x26, 6}, {0x27, 6},
+  {0x6, 5}, {0x74, 7}, {0x75, 7}, {0x28, 6}, {0x29, 6}, {0x2a, 6}, {0x7, 5}, {0x2b, 6}, {0x76, 7},
+  {0x2c, 6}, {0x8, 5}, {0x9, 5}, {0x2d, 6}, {0x77, 7}, {0x78, 7}, {0x79, 7}, {0x7a, 7}, {0x7b, 7},
+  {0x7ffe, 15}, {0x7fc, 11}, {0x3ffd, 14}, {0x1ffd, 13}, {0xffffffc, 28}, {0xfffe6, 20},
+  {0x3fffd2, 22}, {0xfffe7, 20}, {0xfffe8, 20}, {0x3fffd3, 22}, {0x3fffd4, 22}, {0x3fffd5, 22},
+  {0x7fffd9, 23}, {0x3fffd6, 22}, {0x7fffda, 23}, {0x7fffdb, 23}, {0x7fffdc, 23}, {0x7fffdd, 23},
+  {0x7fffde, 23}, {0xffffeb, 24}, {0x7fffdf, 23}, {0xffffec, 24}, {0xffffed, 24}, {0x3fffd7, 22},
+  {0x7fffe0, 23}, {0xffffee, 24}, {0x7fffe1, 23}, {0x7fffe2, 23}, {0x7fffe3, 23}, {0x7fffe4, 23},
+  {0x1fffdc, 21}, {0x3fffd8, 22}, {0x7fffe5, 23}, {0x3fffd9, 22}, {0x7fffe6, 23}, {0x7fffe7, 23},
+  {0xffffef, 24}, {0x3fffda, 22}, {0x1fffdd, 21}, {0xfffe9, 20}, {0x3fffdb, 22}, {0x3fffdc, 22},
+  {0x7fffe8, 23}, {0x7fffe9, 23}, {0x1fffde, 21}, {0x7fffea, 23}, {0x3fffdd, 22}, {0x3fffde, 22},
+  {0xfffff0, 24}, {0x1fffdf, 21}, {0x3fffdf, 22}, {0x7fffeb, 23}, {0x7fffec, 23}, {0x1fffe0, 21},
+  {0x1fffe1, 21}, {0x3fffe0, 22}, {0x1fffe2, 21}, {0x7fffed, 23}, {0x3fffe1, 22}, {0x7fffee, 23},
+  {0x7fffef, 23}, {0xfffea, 20}, {0x3fffe2, 22}, {0x3fffe3, 22}, {0x3fffe4, 22}, {0x7ffff0, 23},
+  {0x3fffe5, 22}, {0x3fffe6, 22}, {0x7ffff1, 23}, {0x3ffffe0, 26}, {0x3ffffe1, 26}, {0xfffeb, 20},
+  {0x7fff1, 19}, {0x3fffe7, 22}, {0x7ffff2, 23}, {0x3fffe8, 22}, {0x1ffffec, 25}, {0x3ffffe2, 26},
+  {0x3ffffe3, 26}, {0x3ffffe4, 26}, {0x7ffffde, 27}, {0x7ffffdf, 27}, {0x3ffffe5, 26},
+  {0xfffff1, 24}, {0x1ffffed, 25}, {0x7fff2, 19}, {0x1fffe3, 21}, {0x3ffffe6, 26}, {0x7ffffe0, 27},
+  {0x7ffffe1, 27}, {0x3ffffe7, 26}, {0x7ffffe2, 27}, {0xfffff2, 24}, {0x1fffe4, 21}, {0x1fffe5, 21},
+  {0x3ffffe8, 26}, {0x3ffffe9, 26}, {0xffffffd, 28}, {0x7ffffe3, 27}, {0x7ffffe4, 27},
+  {0x7ffffe5, 27}, {0xfffec, 20}, {0xfffff3, 24}, {0xfffed, 20}, {0x1fffe6, 21}, {0x3fffe9, 22},
+  {0x1fffe7, 21}, {0x1fffe8, 21}, {0x7ffff3, 23}, {0x3fffea, 22}, {0x3fffeb, 22}, {0x1ffffee, 25},
+  {0x1ffffef, 25}, {0xfffff4, 24}, {0xfffff5, 24}, {0x3ffffea, 26}, {0x7ffff4, 23}, {0x3ffffeb, 26},
+  {0x7ffffe6, 27}, {0x3ffffec, 26}, {0x3ffffed, 26}, {0x7ffffe7, 27}, {0x7ffffe8, 27},
+  {0x7ffffe9, 27}, {0x7ffffea, 27}, {0x7ffffeb, 27}, {0xffffffe, 28}, {0x7ffffec, 27},
+  {0x7ffffed, 27}, {0x7ffffee, 27}, {0x7ffffef, 27}, {0x7fffff0, 27}, {0x3ffffee, 26},
+  {0x3fffffff, 30}
+};
+
+constexpr uint MAX_HUFFMAN_BITS = 30;
+
+// The code is canonical: codes of each length are consecutive, and ordered by symbol. So a code
+// can be decoded from the first code of its length and the symbols sorted by code length.
+struct HuffmanDecodeTable {
+  uint32_t firstCode[MAX_HUFFMAN_BITS + 1] = {};
+  uint16_t firstSymbol[MAX_HUFFMAN_BITS + 1] = {};
+  uint16_t count[MAX_HUFFMAN_BITS + 1] = {};
+  uint16_t symbols[257] = {};
+
+  HuffmanDecodeTable() {
+    for (auto& code: HUFFMAN_CODES) {
+      ++count[code.bits];
+    }
+
+    uint16_t next[MAX_HUFFMAN_BITS + 1];
+    uint16_t index = 0;
+    uint32_t code = 0;
+    for (uint bits = 1; bits <= MAX_HUFFMAN_BITS; bits++) {
+      firstSymbol[bits] = next[bits] = index;
+      index += count[bits];
+      code = (code + count[bits - 1]) << 1;
+      firstCode[bits] = code;
+    }
+
+    for (uint16_t symbol = 0; symbol < kj::size(HUFFMAN_CODES); symbol++) {
+      symbols[next[HUFFMAN_CODES[symbol].bits]++] = symbol;
+    }
+  }
+};
+
+// Integers with an N-bit prefix, RFC 7541 section 5.1.
+
+uint64_t readInteger(const kj::byte*& pos, const kj::byte* end, uint prefixBits) {
+  KJ_REQUIRE(pos < end, "HPACK header block is truncated");
+  uint64_t max = (1u << prefixBits) - 1;
+  uint64_t value = *pos++ & max;
+  if (value < max) return value;
+
+  for (uint shift = 0; ; shift += 7) {
+    KJ_REQUIRE(pos < end, "HPACK header block is truncated");
+    KJ_REQUIRE(shift <= 28, "HPACK integer is too large");
+    kj::byte b = *pos++;
+    value += uint64_t(b & 0x7f) << shift;
+    if ((b & 0x80) == 0) return value;
+  }
+}
+
+void writeInteger(kj::Vector<kj::byte>& out, kj::byte flags, uint prefixBits, uint64_t value) {
+  uint64_t max = (1u << prefixBits) - 1;
+  if (value < max) {
+    out.add(flags | value);
+    return;
+  }
+
+  out.add(flags | max);
+  value -= max;
+  while (value >= 0x80) {
+    out.add((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  out.add(value);
+}
+
+kj::String readString(const kj::byte*& pos, const kj::byte* end) {
+  KJ_REQUIRE(pos < end, "HPACK header block is truncated");
+  bool huffman = *pos & 0x80;
+  auto length = readInteger(pos, end, 7);
+  KJ_REQUIRE(length <= uint64_t(end - pos), "HPACK header block is truncated");
+
+  auto bytes = kj::arrayPtr(pos, length);
+  pos += length;
+  if (huffman) {
+    return hpackDecodeHuffman(bytes);
+  } else {
+    return kj::heapString(bytes.asChars());
+  }
+}
+
+void writeString(kj::Vector<kj::byte>& out, kj::StringPtr text) {
+  size_t bits = 0;
+  for (char c: text) {
+    bits += HUFFMAN_CODES[kj::byte(c)].bits;
+  }
+
+  size_t huffmanSize = (bits + 7) / 8;
+  if (huffmanSize < text.size()) {
+    writeInteger(out, 0x80, 7, huffmanSize);
+    hpackEncodeHuffman(out, text);
+  } else {
+    writeInteger(out, 0x00, 7, text.size());
+    out.addAll(text.asBytes());
+  }
+}
+
+}  // namespace
+
+void hpackEncodeHuffman(kj::Vector<kj::byte>& out, kj::StringPtr text) {
+  uint64_t pending = 0;
+  uint pendingBits = 0;
+  for (char c: text) {
+    auto& code = HUFFMAN_CODES[kj::byte(c)];
+    pending = (pending << code.bits) | code.code;
+    pendingBits += code.bits;
+    while (pendingBits >= 8) {
+      pendingBits -= 8;
+      out.add(pending >> pendingBits);
+    }
+    pending &= (uint64_t(1) << pendingBits) - 1;
+  }
+
+  if (pendingBits > 0) {
+    // Pad with the most significant bits of EOS, which are all ones.
+    out.add((pending << (8 - pendingBits)) | (0xff >> pendingBits));
+  }
+}
+
+kj::String hpackDecodeHuffman(kj::ArrayPtr<const kj::byte> data) {
+  static const HuffmanDecodeTable table;
+
+  // The shortest codes are five bits.
+  kj::Vector<char> out(data.size() * 8 / 5 + 1);
+  uint32_t code = 0;
+  uint bits = 0;
+  for (auto b: data) {
+    for (int shift = 7; shift >= 0; shift--) {
+      code = (code << 1) | ((b >> shift) & 1);
+      ++bits;
+      KJ_REQUIRE(bits <= MAX_HUFFMAN_BITS, "invalid HPACK Huffman code");
+
+      // (Wraps around, and so fails the check, if `code` is before the first code.)
+      uint32_t offset = code - table.firstCode[bits];
+      if (offset < table.count[bits]) {
+        auto symbol = table.symbols[table.firstSymbol[bits] + offset];
+        KJ_REQUIRE(symbol != 256, "HPACK Huffman string contains EOS");
+        out.add(symbol);
+        code = 0;
+        bits = 0;
+      }
+    }
+  }
+
+  // Padding must be shorter than a byte, and made of the most significant bits of EOS.
+  KJ_REQUIRE(bits < 8 && code == (1u << bits) - 1, "invalid HPACK Huffman padding");
+
+  out.add('\0');
+  return kj::String(out.releaseAsArray());
+}
+
+// =======================================================================================
+
+void HpackTable::add(kj::String name, kj::String value) {
+  auto size = entrySize(name, value);
+  if (size > maxSize) {
+    evictDownTo(0);
+    return;
+  }
+
+  evictDownTo(maxSize - size);
+  entries.add(Entry { kj::mv(name), kj::mv(value) });
+  currentSize += size;
+}
+
+void HpackTable::setMaxSize(size_t size) {
+  maxSize = size;
+  evictDownTo(size);
+}
+
+void HpackTable::evictDownTo(size_t size) {
+  size_t evicted = 0;
+  while (currentSize > size) {
+    auto& entry = entries[evicted++];
+    currentSize -= entrySize(entry.name, entry.value);
+  }
+
+  if (evicted > 0) {
+    for (auto i: kj::range(evicted, entries.size())) {
+      entries[i - evicted] = kj::mv(entries[i]);
+    }
+    entries.truncate(entries.size() - evicted);
+  }
+}
+
+// =======================================================================================
+
+void HpackDecoder::decode(kj::ArrayPtr<const kj::byte> block,
+    kj::FunctionParam<void(kj::StringPtr name, kj::StringPtr value)> callback) {
+  auto lookup = [this](uint64_t index) -> StaticEntry {
+    KJ_REQUIRE(index > 0, "HPACK index 0 is invalid");
+    if (index <= STATIC_TABLE_SIZE) {
+      return STATIC_TABLE[index - 1];
+    }
+    index -= STATIC_TABLE_SIZE + 1;
+    KJ_REQUIRE(index < table.size(), "HPACK index is past the end of the table");
+    auto& entry = table[index];
+    return { entry.name, entry.value };
+  };
+
+  auto pos = block.begin();
+  auto end = block.end();
+  bool sawHeader = false;
+
+  while (pos < end) {
+    kj::byte first = *pos;
+
+    if (first & 0x80) {
+      // Indexed header field.
+      auto entry = lookup(readInteger(pos, end, 7));
+      callback(entry.name, entry.value);
+    } else if ((first & 0xe0) == 0x20) {
+      // Dynamic table size update.
+      KJ_REQUIRE(!sawHeader, "HPACK table size update must come before any headers");
+      auto size = readInteger(pos, end, 5);
+      KJ_REQUIRE(size <= maxTableSize, "HPACK table size update exceeds the limit");
+      table.setMaxSize(size);
+      continue;
+    } else {
+      // Literal header field, either with incremental indexing (01), without indexing (0000), or
+      // never indexed (0001).
+      bool addToTable = first & 0x40;
+      auto nameIndex = readInteger(pos, end, addToTable ? 6 : 4);
+
+      kj::String ownName;
+      kj::StringPtr name;
+      if (nameIndex == 0) {
+        name = ownName = readString(pos, end);
+      } else {
+        name = lookup(nameIndex).name;
+      }
+      auto value = readString(pos, end);
+
+      callback(name, value);
+      if (addToTable) {
+        if (ownName == nullptr) ownName = kj::str(name);
+        table.add(kj::mv(ownName), kj::mv(value));
+      }
+    }
+
+    sawHeader = true;
+  }
+}
+
+// =======================================================================================
+
+void HpackEncoder::setMaxTableSize(size_t size) {
+  size = kj::min(size, DEFAULT_TABLE_SIZE);
+  if (size == table.getMaxSize()) return;
+
+  // If the size shrinks and then grows back before the next block, the decoder still needs to
+  // hear about the smallest size, since it will have evicted entries down to it.
+  smallestTableSize = kj::min(smallestTableSize, size);
+  table.setMaxSize(size);
+  tableSizeChanged = true;
+}
+
+void HpackEncoder::beginBlock(kj::Vector<kj::byte>& out) {
+  if (!tableSizeChanged) return;
+
+  if (smallestTableSize < table.getMaxSize()) {
+    writeInteger(out, 0x20, 5, smallestTableSize);
+  }
+  writeInteger(out, 0x20, 5, table.getMaxSize());
+  tableSizeChanged = false;
+  smallestTableSize = table.getMaxSize();
+}
+
+void HpackEncoder::encode(kj::Vector<kj::byte>& out, kj::StringPtr name, kj::StringPtr value) {
+  uint64_t nameIndex = 0;
+
+  for (auto i: kj::indices(STATIC_TABLE)) {
+    auto& entry = STATIC_TABLE[i];
+    if (entry.name == name) {
+      if (entry.value == value) {
+        writeInteger(out, 0x80, 7, i + 1);
+        return;
+      }
+      if (nameIndex == 0) nameIndex = i + 1;
+    }
+  }
+
+  for (auto i: kj::zeroTo(table.size())) {
+    auto& entry = table[i];
+    if (entry.name == name) {
+      if (entry.value == value) {
+        writeInteger(out, 0x80, 7, STATIC_TABLE_SIZE + 1 + i);
+        return;
+      }
+      if (nameIndex == 0) nameIndex = STATIC_TABLE_SIZE + 1 + i;
+    }
+  }
+
+  if (name == "authorization"_kj || name == "proxy-authorization"_kj) {
+    // Credentials are never indexed, so that intermediaries don't either, and so that their
+    // presence in the table can't be probed for by guessing.
+    writeInteger(out, 0x10, 4, nameIndex);
+  } else if (HpackTable::entrySize(name, value) <= table.getMaxSize() / 4) {
+    writeInteger(out, 0x40, 6, nameIndex);
+    if (nameIndex == 0) writeString(out, name);
+    writeString(out, value);
+    table.add(kj::str(name), kj::str(value));
+    return;
+  } else {
+    // Big values would push everything else out of the table.
+    writeInteger(out, 0x00, 4, nameIndex);
+  }
+
+  if (nameIndex == 0) writeString(out, name);
+  writeString(out, value);
+}
+
+}  // namespace workerd::server
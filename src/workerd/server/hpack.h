@@ -0,0 +1,98 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+// HPACK, the header compression format used by HTTP/2 (RFC 7541).
+
+#include <kj/function.h>
+#include <kj/string.h>
+#include <kj/vector.h>
+
+namespace workerd::server {
+
+using kj::uint;
+
+// The dynamic table which HPACK encoders and decoders each keep, in step with each other.
+class HpackTable {
+public:
+  explicit HpackTable(size_t maxSize): maxSize(maxSize) {}
+
+  struct Entry {
+    kj::String name;
+    kj::String value;
+  };
+
+  // Number of entries.
+  size_t size() const { return entries.size(); }
+
+  // Index 0 is the newest entry.
+  const Entry& operator[](size_t index) const {
+    return entries[entries.size() - 1 - index];
+  }
+
+  // Adds an entry, evicting the oldest ones to make room. An entry bigger than the whole table
+  // just empties it.
+  void add(kj::String name, kj::String value);
+
+  void setMaxSize(size_t size);
+  size_t getMaxSize() const { return maxSize; }
+
+  // The size which RFC 7541 assigns an entry, for the purpose of limiting the table.
+  static size_t entrySize(kj::StringPtr name, kj::StringPtr value) {
+    return name.size() + value.size() + 32;
+  }
+
+private:
+  // Oldest first.
+  kj::Vector<Entry> entries;
+  size_t currentSize = 0;
+  size_t maxSize;
+
+  void evictDownTo(size_t size);
+};
+
+class HpackDecoder {
+public:
+  // `maxTableSize` is the limit on the dynamic table which we've advertised to the peer (with
+  // SETTINGS_HEADER_TABLE_SIZE).
+  explicit HpackDecoder(size_t maxTableSize = 4096)
+      : table(maxTableSize), maxTableSize(maxTableSize) {}
+
+  // Decodes a complete header block, calling `callback` with each header in order. Throws if the
+  // block is malformed, after which the decoder is out of step with the peer's encoder, so the
+  // connection must be closed.
+  void decode(kj::ArrayPtr<const kj::byte> block,
+              kj::FunctionParam<void(kj::StringPtr name, kj::StringPtr value)> callback);
+
+private:
+  HpackTable table;
+  size_t maxTableSize;
+};
+
+class HpackEncoder {
+public:
+  explicit HpackEncoder(size_t maxTableSize = 4096)
+      : table(maxTableSize), smallestTableSize(maxTableSize) {}
+
+  // Called when the peer's SETTINGS_HEADER_TABLE_SIZE changes. The encoder may use less than the
+  // peer allows, and does if the peer allows more than the default.
+  void setMaxTableSize(size_t size);
+
+  // Must be called at the start of each header block, before encode().
+  void beginBlock(kj::Vector<kj::byte>& out);
+
+  // Appends one header to the block in `out`. `name` must be lowercase.
+  void encode(kj::Vector<kj::byte>& out, kj::StringPtr name, kj::StringPtr value);
+
+private:
+  HpackTable table;
+  size_t smallestTableSize;
+  bool tableSizeChanged = false;
+};
+
+// Exposed for testing.
+void hpackEncodeHuffman(kj::Vector<kj::byte>& out, kj::StringPtr text);
+kj::String hpackDecodeHuffman(kj::ArrayPtr<const kj::byte> data);
+
+}  // namespace workerd::server
@@ -0,0 +1,414 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "http2.h"
+#include <kj/test.h>
+#include <kj/timer.h>
+
+namespace workerd::server {
+namespace {
+
+class TestService final: public kj::HttpService {
+public:
+  TestService(kj::HttpHeaderTable::Builder& builder)
+      : xMethod(builder.add("X-Method")), xUrl(builder.add("X-Url")),
+        xHost(builder.add("X-Host")), xCookie(builder.add("X-Cookie")),
+        xLength(builder.add("X-Length")), table(builder.build()) {}
+
+  kj::HttpHeaderId xMethod;
+  kj::HttpHeaderId xUrl;
+  kj::HttpHeaderId xHost;
+  kj::HttpHeaderId xCookie;
+  kj::HttpHeaderId xLength;
+  kj::Own<kj::HttpHeaderTable> table;
+
+  uint inFlight = 0;
+  uint maxInFlight = 0;
+
+  // Requests for /slow wait for this.
+  kj::Maybe<kj::Own<kj::PromiseFulfiller<void>>> slowFulfiller;
+
+  kj::Promise<void> request(
+      kj::HttpMethod method, kj::StringPtr url, const kj::HttpHeaders& headers,
+      kj::AsyncInputStream& requestBody, Response& response) override {
+    ++inFlight;
+    maxInFlight = kj::max(maxInFlight, inFlight);
+    KJ_DEFER(--inFlight);
+
+    kj::HttpHeaders responseHeaders(*table);
+    responseHeaders.set(xMethod, kj::str(method));
+    responseHeaders.set(xUrl, kj::str(url));
+    responseHeaders.set(xHost, kj::str(headers.get(kj::HttpHeaderId::HOST).orDefault("(none)")));
+    responseHeaders.set(xCookie, kj::str(headers.get(kj::HttpHeaderId::COOKIE).orDefault("")));
+    KJ_IF_SOME(length, requestBody.tryGetLength()) {
+      responseHeaders.set(xLength, kj::str(length));
+    }
+    auto body = co_await requestBody.readAllText();
+
+    if (url == "/slow") {
+      auto paf = kj::newPromiseAndFulfiller<void>();
+      slowFulfiller = kj::mv(paf.fulfiller);
+      co_await paf.promise;
+    } else if (url == "/yield") {
+      co_await kj::yield();
+      co_await kj::yield();
+    } else if (url == "/no-response") {
+      co_return;
+    } else if (url == "/throw") {
+      KJ_FAIL_REQUIRE("test exception");
+    } else if (url == "/websocket") {
+      response.acceptWebSocket(responseHeaders);
+      KJ_FAIL_EXPECT("acceptWebSocket() should have thrown");
+    }
+
+    auto text = url == "/echo" ? kj::mv(body) : kj::str("hello from ", url);
+    auto stream = response.send(200, "OK", responseHeaders, text.size());
+    co_await stream->write(text.begin(), text.size());
+  }
+};
+
+// Connects to an Http2Server through in-memory pipes.
+class PipeAddress final: public kj::NetworkAddress {
+public:
+  PipeAddress(Http2Server& server, kj::TaskSet& tasks): server(server), tasks(tasks) {}
+
+  kj::Promise<kj::Own<kj::AsyncIoStream>> connect() override {
+    ++connections;
+    auto pipe = kj::newTwoWayPipe();
+    tasks.add(server.listenHttp2(kj::mv(pipe.ends[1])).then([this]() { ++closed; }));
+    return kj::mv(pipe.ends[0]);
+  }
+  kj::Own<kj::ConnectionReceiver> listen() override { KJ_UNIMPLEMENTED("not used"); }
+  kj::Own<kj::NetworkAddress> clone() override { KJ_UNIMPLEMENTED("not used"); }
+  kj::String toString() override { return kj::str("pipe"); }
+
+  uint connections = 0;
+  uint closed = 0;
+
+private:
+  Http2Server& server;
+  kj::TaskSet& tasks;
+};
+
+class ErrorHandler final: public kj::TaskSet::ErrorHandler {
+public:
+  void taskFailed(kj::Exception&& exception) override {
+    KJ_FAIL_EXPECT(exception);
+  }
+};
+
+struct TestFixture {
+  TestFixture(Http2Settings settings = {})
+      : waitScope(loop), service(builder), server(timer, *service.table, service, settings),
+        tasks(errorHandler), address(server, tasks),
+        client(newHttp2Client(*service.table, address, "https", settings)) {}
+
+  kj::EventLoop loop;
+  kj::WaitScope waitScope;
+  kj::TimerImpl timer = kj::TimerImpl(kj::origin<kj::TimePoint>());
+  kj::HttpHeaderTable::Builder builder;
+  TestService service;
+  Http2Server server;
+  ErrorHandler errorHandler;
+  kj::TaskSet tasks;
+  PipeAddress address;
+  kj::Own<kj::HttpClient> client;
+
+  kj::HttpHeaders headers() {
+    kj::HttpHeaders result(*service.table);
+    result.set(kj::HttpHeaderId::HOST, "example.com");
+    return result;
+  }
+
+  kj::StringPtr get(const kj::HttpClient::Response& response, kj::HttpHeaderId id) {
+    return KJ_ASSERT_NONNULL(response.headers->get(id));
+  }
+
+  void advanceTimer(kj::Duration amount) {
+    timer.advanceTo(timer.now() + amount);
+    loop.run();
+  }
+};
+
+// Writes a frame straight to a connection, bypassing the client.
+void writeFrame(kj::AsyncOutputStream& out, kj::WaitScope& waitScope, uint8_t type,
+                uint8_t flags, uint32_t streamId, kj::ArrayPtr<const kj::byte> payload) {
+  kj::Vector<kj::byte> frame;
+  frame.add(payload.size() >> 16);
+  frame.add(payload.size() >> 8);
+  frame.add(payload.size());
+  frame.add(type);
+  frame.add(flags);
+  frame.add(streamId >> 24);
+  frame.add(streamId >> 16);
+  frame.add(streamId >> 8);
+  frame.add(streamId);
+  frame.addAll(payload);
+  out.write(frame.begin(), frame.size()).wait(waitScope);
+}
+
+constexpr uint8_t HEADERS = 1;
+constexpr uint8_t SETTINGS = 4;
+constexpr uint8_t END_HEADERS = 4;
+
+KJ_TEST("HTTP/2 request and response") {
+  TestFixture test;
+
+  auto headers = test.headers();
+  headers.set(kj::HttpHeaderId::COOKIE, "a=1; b=2");
+  auto response = test.client->request(kj::HttpMethod::GET, "/hello?x=y", headers, uint64_t(0))
+      .response.wait(test.waitScope);
+
+  KJ_EXPECT(response.statusCode == 200);
+  KJ_EXPECT(response.statusText == "OK");
+  KJ_EXPECT(test.get(response, test.service.xMethod) == "GET");
+  KJ_EXPECT(test.get(response, test.service.xUrl) == "/hello?x=y");
+  KJ_EXPECT(test.get(response, test.service.xHost) == "example.com");
+  KJ_EXPECT(test.get(response, test.service.xCookie) == "a=1; b=2");
+  KJ_EXPECT(test.get(response, test.service.xLength) == "0");
+  KJ_EXPECT(test.get(response, kj::HttpHeaderId::CONTENT_LENGTH) == "21");
+  KJ_EXPECT(response.body->readAllText().wait(test.waitScope) == "hello from /hello?x=y");
+}
+
+KJ_TEST("HTTP/2 HEAD response has no body") {
+  TestFixture test;
+
+  auto headers = test.headers();
+  auto response = test.client->request(kj::HttpMethod::HEAD, "/", headers, uint64_t(0))
+      .response.wait(test.waitScope);
+  KJ_EXPECT(response.statusCode == 200);
+  KJ_EXPECT(test.get(response, kj::HttpHeaderId::CONTENT_LENGTH) == "12");
+  KJ_EXPECT(response.body->readAllText().wait(test.waitScope) == "");
+}
+
+KJ_TEST("HTTP/2 bodies larger than the flow control windows") {
+  Http2Settings settings;
+  settings.initialWindowSize = 65535;
+  settings.connectionWindowSize = 65535;
+  TestFixture test(settings);
+
+  kj::String text = kj::str(kj::repeat('x', 1 << 20));
+  auto headers = test.headers();
+  auto request = test.client->request(kj::HttpMethod::POST, "/echo", headers, text.size());
+  request.body->write(text.begin(), text.size()).wait(test.waitScope);
+  request.body = nullptr;
+
+  auto response = request.response.wait(test.waitScope);
+  KJ_EXPECT(test.get(response, test.service.xLength) == kj::str(text.size()));
+  KJ_EXPECT(response.body->readAllText().wait(test.waitScope) == text);
+}
+
+KJ_TEST("HTTP/2 body of unknown length") {
+  TestFixture test;
+
+  auto headers = test.headers();
+  auto request = test.client->request(kj::HttpMethod::POST, "/echo", headers);
+  request.body->write("abc", 3).wait(test.waitScope);
+  request.body->write("def", 3).wait(test.waitScope);
+  request.body = nullptr;
+
+  auto response = request.response.wait(test.waitScope);
+  KJ_EXPECT(response.headers->get(test.service.xLength) == kj::none);
+  KJ_EXPECT(response.body->readAllText().wait(test.waitScope) == "abcdef");
+}
+
+KJ_TEST("HTTP/2 multiplexes concurrent requests over one connection") {
+  TestFixture test;
+
+  kj::Vector<kj::Promise<kj::String>> responses;
+  for (uint i = 0; i < 50; i++) {
+    auto headers = test.headers();
+    auto url = kj::str("/yield/", i);
+    auto request = test.client->request(kj::HttpMethod::GET, url, headers, uint64_t(0));
+    responses.add(request.response.then([](kj::HttpClient::Response response) {
+      return response.body->readAllText().attach(kj::mv(response.body));
+    }));
+  }
+
+  auto results = kj::joinPromises(responses.releaseAsArray()).wait(test.waitScope);
+  for (auto i: kj::indices(results)) {
+    KJ_EXPECT(results[i] == kj::str("hello from /yield/", i));
+  }
+  KJ_EXPECT(test.address.connections == 1);
+}
+
+KJ_TEST("HTTP/2 client waits for the server's stream limit") {
+  Http2Settings settings;
+  settings.maxConcurrentStreams = 2;
+  TestFixture test(settings);
+
+  // Let the client learn the server's settings.
+  auto headers = test.headers();
+  test.client->request(kj::HttpMethod::GET, "/", headers, uint64_t(0))
+      .response.wait(test.waitScope).body->readAllText().wait(test.waitScope);
+
+  kj::Vector<kj::Promise<kj::String>> responses;
+  for (uint i = 0; i < 10; i++) {
+    auto request = test.client->request(kj::HttpMethod::GET, "/yield", headers, uint64_t(0));
+    responses.add(request.response.then([](kj::HttpClient::Response response) {
+      return response.body->readAllText().attach(kj::mv(response.body));
+    }));
+  }
+
+  auto results = kj::joinPromises(responses.releaseAsArray()).wait(test.waitScope);
+  for (auto& result: results) {
+    KJ_EXPECT(result == "hello from /yield");
+  }
+  KJ_EXPECT(test.service.maxInFlight == 2);
+  KJ_EXPECT(test.address.connections == 1);
+}
+
+KJ_TEST("HTTP/2 server responds 500 when the service fails") {
+  TestFixture test;
+
+  auto headers = test.headers();
+  {
+    KJ_EXPECT_LOG(ERROR, "without sending a response");
+    auto response = test.client->request(kj::HttpMethod::GET, "/no-response", headers,
+        uint64_t(0)).response.wait(test.waitScope);
+    KJ_EXPECT(response.statusCode == 500);
+    KJ_EXPECT(response.statusText == "Internal Server Error");
+  }
+  {
+    KJ_EXPECT_LOG(ERROR, "test exception");
+    auto response = test.client->request(kj::HttpMethod::GET, "/throw", headers, uint64_t(0))
+        .response.wait(test.waitScope);
+    KJ_EXPECT(response.statusCode == 500);
+  }
+
+  // The connection is still fine.
+  auto response = test.client->request(kj::HttpMethod::GET, "/", headers, uint64_t(0))
+      .response.wait(test.waitScope);
+  KJ_EXPECT(response.statusCode == 200);
+  KJ_EXPECT(test.address.connections == 1);
+}
+
+KJ_TEST("HTTP/2 server drains connections") {
+  TestFixture test;
+
+  auto headers = test.headers();
+  auto slow = test.client->request(kj::HttpMethod::GET, "/slow", headers, uint64_t(0));
+  while (test.service.slowFulfiller == kj::none) {
+    test.loop.run();
+  }
+
+  test.server.drain();
+  test.loop.run();
+  KJ_EXPECT(test.address.closed == 0);
+
+  // The request in progress finishes, and then the connection closes.
+  KJ_ASSERT_NONNULL(test.service.slowFulfiller)->fulfill();
+  auto response = slow.response.wait(test.waitScope);
+  KJ_EXPECT(response.body->readAllText().wait(test.waitScope) == "hello from /slow");
+  response.body = nullptr;
+  test.loop.run();
+  KJ_EXPECT(test.address.closed == 1);
+
+  // The client opens a new connection for the next request, which the draining server closes.
+  KJ_EXPECT_THROW_MESSAGE("went away",
+      test.client->request(kj::HttpMethod::GET, "/", headers, uint64_t(0))
+          .response.wait(test.waitScope));
+  KJ_EXPECT(test.address.connections == 2);
+}
+
+KJ_TEST("HTTP/2 server closes connections which reset too many streams") {
+  Http2Settings settings;
+  settings.maxResetsPerWindow = 10;
+  TestFixture test(settings);
+
+  // Each request is canceled as soon as it's sent: the body is cut short, which resets the stream.
+  auto headers = test.headers();
+  for (uint i = 0; i < 10; i++) {
+    test.client->request(kj::HttpMethod::POST, "/echo", headers, uint64_t(100));
+  }
+  test.loop.run();
+  KJ_EXPECT(test.address.closed == 0);
+
+  // One more is too many. The server sends GOAWAY(ENHANCE_YOUR_CALM) and closes.
+  test.client->request(kj::HttpMethod::POST, "/echo", headers, uint64_t(100));
+  test.loop.run();
+  KJ_EXPECT(test.address.closed == 1);
+
+  // The client reconnects, and a well-behaved request works.
+  auto response = test.client->request(kj::HttpMethod::GET, "/", headers, uint64_t(0))
+      .response.wait(test.waitScope);
+  KJ_EXPECT(response.statusCode == 200);
+  KJ_EXPECT(test.address.connections == 2);
+}
+
+KJ_TEST("HTTP/2 server refuses WebSockets with HTTP_1_1_REQUIRED") {
+  TestFixture test;
+
+  auto headers = test.headers();
+  KJ_EXPECT_THROW_MESSAGE("reset by the peer",
+      test.client->request(kj::HttpMethod::GET, "/websocket", headers, uint64_t(0))
+          .response.wait(test.waitScope));
+
+  // Only the stream is affected.
+  auto response = test.client->request(kj::HttpMethod::GET, "/", headers, uint64_t(0))
+      .response.wait(test.waitScope);
+  KJ_EXPECT(response.statusCode == 200);
+  KJ_EXPECT(test.address.connections == 1);
+}
+
+KJ_TEST("HTTP/2 server closes idle connections") {
+  Http2Settings settings;
+  settings.headerTimeout = 10 * kj::SECONDS;
+  settings.idleTimeout = 5 * kj::SECONDS;
+  TestFixture test(settings);
+
+  // A connection which never starts a request is closed after the header timeout.
+  auto silent = test.address.connect().wait(test.waitScope);
+  auto silentReceived = silent->readAllBytes();
+  test.advanceTimer(9 * kj::SECONDS);
+  KJ_EXPECT(test.address.closed == 0);
+  test.advanceTimer(1 * kj::SECONDS);
+  KJ_EXPECT(test.address.closed == 1);
+
+  // One whose requests have finished is closed after the idle timeout, but not while a request
+  // is in progress.
+  auto headers = test.headers();
+  auto slow = test.client->request(kj::HttpMethod::GET, "/slow", headers, uint64_t(0));
+  while (test.service.slowFulfiller == kj::none) {
+    test.loop.run();
+  }
+  test.advanceTimer(60 * kj::SECONDS);
+  KJ_EXPECT(test.address.closed == 1);
+
+  KJ_ASSERT_NONNULL(test.service.slowFulfiller)->fulfill();
+  auto response = slow.response.wait(test.waitScope);
+  KJ_EXPECT(response.body->readAllText().wait(test.waitScope) == "hello from /slow");
+  test.advanceTimer(4 * kj::SECONDS);
+  KJ_EXPECT(test.address.closed == 1);
+  test.advanceTimer(1 * kj::SECONDS);
+  KJ_EXPECT(test.address.closed == 2);
+}
+
+KJ_TEST("HTTP/2 server closes connections which don't finish a header block") {
+  Http2Settings settings;
+  settings.headerTimeout = 10 * kj::SECONDS;
+  TestFixture test(settings);
+
+  auto conn = test.address.connect().wait(test.waitScope);
+  auto received = conn->readAllBytes();
+  auto preface = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"_kj;
+  conn->write(preface.begin(), preface.size()).wait(test.waitScope);
+  writeFrame(*conn, test.waitScope, SETTINGS, 0, 0, nullptr);
+
+  // A POST to "/" whose body is still to come keeps stream 1 open, so the connection isn't idle.
+  kj::byte post[] = { 0x83, 0x86, 0x84 };
+  writeFrame(*conn, test.waitScope, HEADERS, END_HEADERS, 1, post);
+
+  // Stream 3's headers are never finished with CONTINUATION.
+  kj::byte get[] = { 0x82 };
+  writeFrame(*conn, test.waitScope, HEADERS, 0, 3, get);
+
+  test.advanceTimer(9 * kj::SECONDS);
+  KJ_EXPECT(test.address.closed == 0);
+  test.advanceTimer(1 * kj::SECONDS);
+  KJ_EXPECT(test.address.closed == 1);
+}
+
+}  // namespace
+}  // namespace workerd::server
@@ -0,0 +1,1898 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "http2.h"
+#include "hpack.h"
+#include <kj/debug.h>
+#include <kj/map.h>
+#include <string.h>
+
+namespace workerd::server {
+
+namespace {
+
+constexpr kj::StringPtr CONNECTION_PREFACE = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"_kj;
+
+constexpr size_t FRAME_HEADER_SIZE = 9;
+constexpr uint32_t DEFAULT_WINDOW_SIZE = 65535;
+constexpr int64_t MAX_WINDOW_SIZE = 0x7fffffff;
+constexpr uint32_t MAX_STREAM_ID = 0x7fffffff;
+
+// The largest frame the protocol lets us refuse. We never ask for bigger ones.
+constexpr uint32_t MIN_MAX_FRAME_SIZE = 16384;
+constexpr uint32_t MAX_MAX_FRAME_SIZE = 0xffffff;
+
+// Enough for a few maximum-size frames, so that most reads take in several.
+constexpr size_t READ_BUFFER_SIZE = 65536;
+
+// Once this much is waiting to be written, body writes wait for it to be.
+constexpr size_t WRITE_BUFFER_HIGH_WATER = 65536;
+
+// What we assume the peer allows until its SETTINGS say otherwise, as RFC 9113 recommends.
+constexpr uint32_t INITIAL_MAX_CONCURRENT_STREAMS = 100;
+
+enum class FrameType: uint8_t {
+  DATA = 0x0,
+  HEADERS = 0x1,
+  PRIORITY = 0x2,
+  RST_STREAM = 0x3,
+  SETTINGS = 0x4,
+  PUSH_PROMISE = 0x5,
+  PING = 0x6,
+  GOAWAY = 0x7,
+  WINDOW_UPDATE = 0x8,
+  CONTINUATION = 0x9,
+};
+
+constexpr uint8_t FLAG_END_STREAM = 0x1;
+constexpr uint8_t FLAG_ACK = 0x1;
+constexpr uint8_t FLAG_END_HEADERS = 0x4;
+constexpr uint8_t FLAG_PADDED = 0x8;
+constexpr uint8_t FLAG_PRIORITY = 0x20;
+
+enum class ErrorCode: uint32_t {
+  NONE = 0x0,
+  PROTOCOL = 0x1,
+  INTERNAL = 0x2,
+  FLOW_CONTROL = 0x3,
+  STREAM_CLOSED = 0x5,
+  FRAME_SIZE = 0x6,
+  REFUSED_STREAM = 0x7,
+  CANCEL = 0x8,
+  COMPRESSION = 0x9,
+  ENHANCE_YOUR_CALM = 0xb,
+  HTTP_1_1_REQUIRED = 0xd,
+};
+
+enum class SettingId: uint16_t {
+  HEADER_TABLE_SIZE = 0x1,
+  ENABLE_PUSH = 0x2,
+  MAX_CONCURRENT_STREAMS = 0x3,
+  INITIAL_WINDOW_SIZE = 0x4,
+  MAX_FRAME_SIZE = 0x5,
+  MAX_HEADER_LIST_SIZE = 0x6,
+};
+
+uint16_t readUint16(const kj::byte* p) {
+  return (uint16_t(p[0]) << 8) | p[1];
+}
+
+uint32_t readUint24(const kj::byte* p) {
+  return (uint32_t(p[0]) << 16) | (uint32_t(p[1]) << 8) | p[2];
+}
+
+uint32_t readUint32(const kj::byte* p) {
+  return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+}
+
+void writeUint32(kj::byte* p, uint32_t value) {
+  p[0] = value >> 24;
+  p[1] = value >> 16;
+  p[2] = value >> 8;
+  p[3] = value;
+}
+
+void addSetting(kj::Vector<kj::byte>& out, SettingId id, uint32_t value) {
+  kj::byte setting[6];
+  setting[0] = uint16_t(id) >> 8;
+  setting[1] = uint16_t(id);
+  writeUint32(setting + 2, value);
+  out.addAll(setting, setting + sizeof(setting));
+}
+
+bool isValidFieldName(kj::StringPtr name) {
+  if (name.size() == 0) return false;
+  for (char c: name) {
+    if (('a' <= c && c <= 'z') || ('0' <= c && c <= '9')) continue;
+    switch (c) {
+      case '!': case '#': case '$': case '%': case '&': case '\'': case '*': case '+': case '-':
+      case '.': case '^': case '_': case '`': case '|': case '~':
+        continue;
+    }
+    return false;
+  }
+  return true;
+}
+
+bool isValidFieldValue(kj::StringPtr value) {
+  for (char c: value) {
+    if (c == '\0' || c == '\r' || c == '\n') return false;
+  }
+  return true;
+}
+
+// Headers which only make sense for one HTTP/1 connection, which HTTP/2 forbids. `name` must be
+// lowercase.
+bool isConnectionSpecific(kj::StringPtr name) {
+  return name == "connection"_kj || name == "keep-alive"_kj || name == "proxy-connection"_kj ||
+         name == "transfer-encoding"_kj || name == "upgrade"_kj;
+}
+
+kj::Maybe<uint64_t> parseDecimal(kj::StringPtr value) {
+  if (value.size() == 0 || value.size() > 19) return kj::none;
+  uint64_t result = 0;
+  for (char c: value) {
+    if (c < '0' || c > '9') return kj::none;
+    result = result * 10 + (c - '0');
+  }
+  return result;
+}
+
+// HTTP/2 has no reason phrases, but kj::HttpClient::Response has a place for one.
+kj::StringPtr statusText(uint statusCode) {
+  switch (statusCode) {
+    case 200: return "OK"_kj;
+    case 201: return "Created"_kj;
+    case 202: return "Accepted"_kj;
+    case 204: return "No Content"_kj;
+    case 206: return "Partial Content"_kj;
+    case 301: return "Moved Permanently"_kj;
+    case 302: return "Found"_kj;
+    case 303: return "See Other"_kj;
+    case 304: return "Not Modified"_kj;
+    case 307: return "Temporary Redirect"_kj;
+    case 308: return "Permanent Redirect"_kj;
+    case 400: return "Bad Request"_kj;
+    case 401: return "Unauthorized"_kj;
+    case 403: return "Forbidden"_kj;
+    case 404: return "Not Found"_kj;
+    case 405: return "Method Not Allowed"_kj;
+    case 408: return "Request Timeout"_kj;
+    case 409: return "Conflict"_kj;
+    case 410: return "Gone"_kj;
+    case 412: return "Precondition Failed"_kj;
+    case 413: return "Payload Too Large"_kj;
+    case 429: return "Too Many Requests"_kj;
+    case 431: return "Request Header Fields Too Large"_kj;
+    case 500: return "Internal Server Error"_kj;
+    case 501: return "Not Implemented"_kj;
+    case 502: return "Bad Gateway"_kj;
+    case 503: return "Service Unavailable"_kj;
+    case 504: return "Gateway Timeout"_kj;
+  }
+  return ""_kj;
+}
+
+struct HeaderField {
+  kj::String name;
+  kj::String value;
+};
+
+// Header fields to send, borrowing strings wherever they're already in HTTP/2 form.
+class HeaderList {
+public:
+  struct Field {
+    kj::StringPtr name;
+    kj::StringPtr value;
+  };
+
+  void add(kj::StringPtr name, kj::StringPtr value) {
+    fields.add(Field { name, value });
+  }
+
+  // Adds the headers of an HTTP/1 message, with names lowercased, leaving out those which are
+  // specific to an HTTP/1 connection, and `Host`, which becomes `:authority`.
+  void addHttp1(const kj::HttpHeaders& headers) {
+    headers.forEach([this](kj::StringPtr name, kj::StringPtr value) {
+      for (char c: name) {
+        if ('A' <= c && c <= 'Z') {
+          auto lower = kj::heapString(name);
+          for (char& l: lower) {
+            if ('A' <= l && l <= 'Z') l += 'a' - 'A';
+          }
+          name = ownNames.add(kj::mv(lower));
+          break;
+        }
+      }
+
+      if (isConnectionSpecific(name) || name == "host"_kj ||
+          (name == "te"_kj && value != "trailers"_kj)) {
+        return;
+      }
+      add(name, value);
+    });
+  }
+
+  bool has(kj::StringPtr name) const {
+    for (auto& field: fields) {
+      if (field.name == name) return true;
+    }
+    return false;
+  }
+
+  kj::ArrayPtr<const Field> asPtr() const { return fields.asPtr(); }
+
+  // Copies the fields, for a request which has to wait before it can be sent.
+  kj::Array<HeaderField> copy() const {
+    return KJ_MAP(field, fields) {
+      return HeaderField { kj::str(field.name), kj::str(field.value) };
+    };
+  }
+
+private:
+  kj::Vector<Field> fields;
+  kj::Vector<kj::String> ownNames;
+};
+
+class Http2Connection;
+
+// One request and its response. Refcounted, since the bodies handed to the application refer to
+// it, and may outlive its place in the connection.
+class Stream final: public kj::Refcounted {
+public:
+  Stream(Http2Connection& conn, uint32_t id, uint32_t recvWindow, uint32_t sendWindow)
+      : conn(conn), id(id), recvWindow(recvWindow), sendWindow(sendWindow) {}
+
+  // Null once the stream is closed, or its connection is gone.
+  kj::Maybe<Http2Connection&> conn;
+
+  // Zero for a client stream still waiting for the server to allow another stream.
+  uint32_t id;
+
+  // Received body data which the application hasn't read yet, starting at `recvStart`.
+  kj::Vector<kj::byte> recvBuffer;
+  size_t recvStart = 0;
+
+  // Whether the peer has finished sending.
+  bool recvEnded = false;
+
+  // How much more the peer may send, and how much the application has read which we haven't
+  // yet told the peer it may send again.
+  int64_t recvWindow;
+  uint32_t recvUnacked = 0;
+
+  // Body bytes still to come, if the peer sent content-length.
+  kj::Maybe<uint64_t> recvRemaining;
+
+  // How much more we may send.
+  int64_t sendWindow;
+
+  // Whether we've finished sending.
+  bool sendEnded = false;
+
+  // Set if the stream is reset or its connection fails. Reads and writes then throw it.
+  kj::Maybe<kj::Exception> error;
+
+  // Woken when there's more to read, or more window to write into, or an error.
+  kj::Maybe<kj::Own<kj::PromiseFulfiller<void>>> recvWaiter;
+  kj::Maybe<kj::Own<kj::PromiseFulfiller<void>>> sendWaiter;
+
+  // For client streams, awaiting the response.
+  kj::Maybe<kj::Own<kj::PromiseFulfiller<kj::HttpClient::Response>>> responseFulfiller;
+
+  // For server streams, cancels the request handler if the stream is reset.
+  kj::Maybe<kj::Own<kj::PromiseFulfiller<void>>> resetFulfiller;
+
+  // For client streams waiting to open, the headers to open them with.
+  kj::Array<HeaderField> pendingHeaders;
+
+  size_t available() const { return recvBuffer.size() - recvStart; }
+
+  Http2Connection& getConnection() {
+    KJ_IF_SOME(e, error) {
+      kj::throwFatalException(kj::cp(e));
+    }
+    return KJ_REQUIRE_NONNULL(conn, "HTTP/2 stream is already closed");
+  }
+
+  kj::Promise<void> waitRecv() {
+    auto paf = kj::newPromiseAndFulfiller<void>();
+    recvWaiter = kj::mv(paf.fulfiller);
+    return kj::mv(paf.promise);
+  }
+
+  kj::Promise<void> waitSend() {
+    auto paf = kj::newPromiseAndFulfiller<void>();
+    sendWaiter = kj::mv(paf.fulfiller);
+    return kj::mv(paf.promise);
+  }
+
+  void wakeRecv() {
+    KJ_IF_SOME(f, recvWaiter) {
+      f->fulfill();
+      recvWaiter = kj::none;
+    }
+  }
+
+  void wakeSend() {
+    KJ_IF_SOME(f, sendWaiter) {
+      f->fulfill();
+      sendWaiter = kj::none;
+    }
+  }
+
+  void fail(const kj::Exception& exception) {
+    if (error == kj::none) {
+      error = kj::cp(exception);
+    }
+    KJ_IF_SOME(f, responseFulfiller) {
+      f->reject(kj::cp(exception));
+      responseFulfiller = kj::none;
+    }
+    KJ_IF_SOME(f, resetFulfiller) {
+      f->fulfill();
+      resetFulfiller = kj::none;
+    }
+    wakeRecv();
+    wakeSend();
+  }
+
+  // Copies up to `maxBytes` of received data to `out`, and returns how much.
+  size_t read(kj::byte* out, size_t maxBytes);
+
+  void receive(kj::ArrayPtr<const kj::byte> data) {
+    if (recvStart > 0 && recvStart == recvBuffer.size()) {
+      recvBuffer.clear();
+      recvStart = 0;
+    }
+    recvBuffer.addAll(data);
+  }
+};
+
+// What HTTP/2 clients and servers have in common: framing, flow control, and stream bookkeeping.
+class Http2Connection: public kj::Refcounted, private kj::TaskSet::ErrorHandler {
+public:
+  Http2Connection(kj::Own<kj::AsyncIoStream> transport, const kj::HttpHeaderTable& headerTable,
+                  const Http2Settings& settings, bool isClient);
+  virtual ~Http2Connection() noexcept(false);
+  KJ_DISALLOW_COPY_AND_MOVE(Http2Connection);
+
+  // Runs the connection until it closes.
+  kj::Promise<void> run();
+
+  // Queues as much of `data` as flow control allows on `stream`, returning how much that was.
+  size_t trySendData(Stream& stream, kj::ArrayPtr<const kj::byte> data);
+
+  // Resolves once there's room in the write buffer.
+  kj::Promise<void> whenWritable();
+
+  // Finishes sending on `stream`.
+  void endStream(Stream& stream);
+
+  // Sends RST_STREAM, and fails the stream locally.
+  void resetStream(Stream& stream, ErrorCode code);
+
+  // Called when the application has read `bytes` of `stream`'s data, so the peer may send more.
+  void consumed(Stream& stream, size_t bytes);
+
+protected:
+  const kj::HttpHeaderTable& headerTable;
+  Http2Settings settings;
+
+  // Streams which are open, or half-closed in one direction.
+  kj::HashMap<uint32_t, kj::Own<Stream>> streams;
+
+  // Client streams waiting for `streams` to shrink below `peerMaxConcurrentStreams`.
+  kj::Vector<kj::Own<Stream>> pendingStreams;
+
+  uint32_t nextStreamId;
+  uint32_t lastPeerStreamId = 0;
+
+  uint32_t peerInitialWindowSize = DEFAULT_WINDOW_SIZE;
+  uint32_t peerMaxConcurrentStreams = INITIAL_MAX_CONCURRENT_STREAMS;
+
+  bool goAwaySent = false;
+  bool goAwayReceived = false;
+  bool closed = false;
+
+  kj::Maybe<Stream&> findStream(uint32_t id) {
+    KJ_IF_SOME(stream, streams.find(id)) {
+      return *stream;
+    }
+    return kj::none;
+  }
+
+  void sendHeaders(Stream& stream, kj::ArrayPtr<const HeaderList::Field> fields, bool endStream);
+
+  // Sends GOAWAY, telling the peer that streams after the last it opened won't be processed.
+  void goAway(ErrorCode code, kj::StringPtr debugData = nullptr);
+
+  // Closes the connection once everything queued has been written.
+  void finish();
+
+  // Closes both directions of `stream` if both are finished.
+  void maybeForget(Stream& stream) {
+    if (stream.recvEnded && stream.sendEnded) forget(stream);
+  }
+
+  // Removes `stream` from the connection. It may be destroyed.
+  void forget(Stream& stream);
+
+  // Handles a complete header block. `tooLarge` means it exceeded `maxHeaderListSize`, so
+  // `fields` is incomplete.
+  virtual void onHeaderBlock(uint32_t streamId, kj::Vector<HeaderField> fields, bool endStream,
+                             bool tooLarge) = 0;
+  virtual void onStreamClosed() {}
+  virtual void onSettings() {}
+
+  // Called when the peer resets a stream which was still open.
+  virtual void onPeerReset() {}
+
+  // Called when the peer starts a header block which continues in CONTINUATION frames.
+  virtual void onHeaderBlockContinued() {}
+
+  bool isInHeaderBlock() { return inHeaderBlock; }
+
+  kj::TaskSet& getTasks() { return tasks; }
+
+  // Fails the connection: the read loop sends GOAWAY with `code` and closes.
+  [[noreturn]] void connectionError(ErrorCode code, kj::StringPtr message) {
+    errorCode = code;
+    KJ_FAIL_REQUIRE("HTTP/2 protocol error", message);
+  }
+
+private:
+  kj::Own<kj::AsyncIoStream> transport;
+  bool isClient;
+
+  HpackEncoder encoder;
+  HpackDecoder decoder;
+
+  uint32_t peerMaxFrameSize = MIN_MAX_FRAME_SIZE;
+
+  int64_t connRecvWindow = DEFAULT_WINDOW_SIZE;
+  uint32_t connRecvUnacked = 0;
+  int64_t connSendWindow = DEFAULT_WINDOW_SIZE;
+
+  // A header block split over HEADERS and CONTINUATION frames, while it's being received.
+  kj::Vector<kj::byte> headerBlock;
+  uint32_t headerStreamId = 0;
+  bool headerEndStream = false;
+  bool inHeaderBlock = false;
+
+  // Scratch space for encoding header blocks.
+  kj::Vector<kj::byte> encodeBuffer;
+
+  // Frames waiting to be written. They're written by one task, which waits a turn before
+  // writing, so that frames queued by many streams at once go out together.
+  kj::Vector<kj::byte> writeBuffer;
+  kj::Vector<kj::byte> spareWriteBuffer;
+  bool flushing = false;
+  kj::Vector<kj::Own<kj::PromiseFulfiller<void>>> flushWaiters;
+
+  // Set when the connection should close in an orderly way.
+  kj::Own<kj::PromiseFulfiller<void>> doneFulfiller;
+  kj::Promise<void> done;
+
+  // The error code to send with GOAWAY if handling a frame throws.
+  ErrorCode errorCode = ErrorCode::INTERNAL;
+
+  // Declared last, so that tasks are canceled before anything they use is destroyed.
+  kj::TaskSet tasks;
+
+  void taskFailed(kj::Exception&& exception) override;
+
+  bool isKnownStreamId(uint32_t id) {
+    bool peerInitiated = (id & 1) == (isClient ? 0 : 1);
+    return peerInitiated ? id <= lastPeerStreamId : id < nextStreamId;
+  }
+
+  void queueFrame(FrameType type, uint8_t flags, uint32_t streamId,
+                  kj::ArrayPtr<const kj::byte> payload);
+  void queueWindowUpdate(uint32_t streamId, uint32_t increment);
+  void scheduleFlush();
+  kj::Promise<void> flushLoop();
+  kj::Promise<void> whenFlushed();
+
+  void creditConnection(size_t bytes);
+  void creditStream(Stream& stream, size_t bytes);
+
+  void failAllStreams(const kj::Exception& exception);
+
+  kj::Promise<void> readLoop();
+  void handleFrame(FrameType type, uint8_t flags, uint32_t streamId,
+                   kj::ArrayPtr<const kj::byte> payload);
+  kj::ArrayPtr<const kj::byte> stripPadding(uint8_t flags, kj::ArrayPtr<const kj::byte> payload);
+  void handleData(uint8_t flags, uint32_t streamId, kj::ArrayPtr<const kj::byte> payload);
+  void handleHeaders(uint8_t flags, uint32_t streamId, kj::ArrayPtr<const kj::byte> payload);
+  void handleContinuation(uint8_t flags, uint32_t streamId,
+                          kj::ArrayPtr<const kj::byte> payload);
+  void finishHeaderBlock();
+  void handleRstStream(uint32_t streamId, kj::ArrayPtr<const kj::byte> payload);
+  void handleSettings(uint8_t flags, uint32_t streamId, kj::ArrayPtr<const kj::byte> payload);
+  void handlePing(uint8_t flags, uint32_t streamId, kj::ArrayPtr<const kj::byte> payload);
+  void handleGoAway(uint32_t streamId, kj::ArrayPtr<const kj::byte> payload);
+  void handleWindowUpdate(uint32_t streamId, kj::ArrayPtr<const kj::byte> payload);
+};
+
+size_t Stream::read(kj::byte* out, size_t maxBytes) {
+  size_t n = kj::min(available(), maxBytes);
+  if (n == 0) return 0;
+
+  memcpy(out, recvBuffer.begin() + recvStart, n);
+  recvStart += n;
+  if (recvStart == recvBuffer.size()) {
+    recvBuffer.clear();
+    recvStart = 0;
+  }
+
+  KJ_IF_SOME(c, conn) {
+    c.consumed(*this, n);
+  }
+  return n;
+}
+
+// ---------------------------------------------------------------------------------------
+// Bodies
+
+class BodyReader final: public kj::AsyncInputStream {
+public:
+  // If `cancelIfUnfinished`, destroying the reader before the body ends resets the stream, so
+  // that the peer stops sending it.
+  BodyReader(kj::Own<Stream> stream, bool cancelIfUnfinished)
+      : stream(kj::mv(stream)), cancelIfUnfinished(cancelIfUnfinished) {}
+
+  ~BodyReader() noexcept(false) {
+    if (cancelIfUnfinished && !stream->recvEnded) {
+      KJ_IF_SOME(conn, stream->conn) {
+        conn.resetStream(*stream, ErrorCode::CANCEL);
+      }
+    }
+  }
+
+  kj::Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override {
+    auto out = reinterpret_cast<kj::byte*>(buffer);
+    size_t total = 0;
+    for (;;) {
+      total += stream->read(out + total, maxBytes - total);
+      if (total >= minBytes || (stream->recvEnded && stream->available() == 0)) {
+        co_return total;
+      }
+      KJ_IF_SOME(e, stream->error) {
+        kj::throwFatalException(kj::cp(e));
+      }
+      co_await stream->waitRecv();
+    }
+  }
+
+  kj::Maybe<uint64_t> tryGetLength() override {
+    KJ_IF_SOME(remaining, stream->recvRemaining) {
+      return remaining + stream->available();
+    } else if (stream->recvEnded) {
+      return stream->available();
+    } else {
+      return kj::none;
+    }
+  }
+
+private:
+  kj::Own<Stream> stream;
+  bool cancelIfUnfinished;
+};
+
+class BodyWriter final: public kj::AsyncOutputStream {
+public:
+  // `discard` is for responses to HEAD, which have no body but may be written one anyway.
+  BodyWriter(kj::Own<Stream> stream, kj::Maybe<uint64_t> expectedSize, bool discard)
+      : stream(kj::mv(stream)), remaining(expectedSize), discard(discard) {}
+
+  ~BodyWriter() noexcept(false) {
+    if (discard || stream->sendEnded) return;
+    KJ_IF_SOME(conn, stream->conn) {
+      unwindDetector.catchExceptionsIfUnwinding([&]() {
+        // Don't let a body which was cut short look complete to the peer.
+        bool incomplete = false;
+        KJ_IF_SOME(r, remaining) {
+          incomplete = r > 0;
+        }
+        if (incomplete || unwindDetector.isUnwinding()) {
+          conn.resetStream(*stream, ErrorCode::INTERNAL);
+        } else {
+          conn.endStream(*stream);
+        }
+      });
+    }
+  }
+
+  kj::Promise<void> write(const void* buffer, size_t size) override {
+    if (discard || size == 0) return kj::READY_NOW;
+    KJ_IF_SOME(r, remaining) {
+      KJ_REQUIRE(size <= r, "body is longer than its expected size");
+      r -= size;
+    }
+    return writeImpl(kj::arrayPtr(reinterpret_cast<const kj::byte*>(buffer), size));
+  }
+
+  kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const kj::byte>> pieces) override {
+    for (auto piece: pieces) {
+      co_await write(piece.begin(), piece.size());
+    }
+  }
+
+  kj::Promise<void> whenWriteDisconnected() override {
+    return kj::NEVER_DONE;
+  }
+
+private:
+  kj::Own<Stream> stream;
+  kj::Maybe<uint64_t> remaining;
+  bool discard;
+  kj::UnwindDetector unwindDetector;
+
+  kj::Promise<void> writeImpl(kj::ArrayPtr<const kj::byte> data) {
+    while (data.size() > 0) {
+      size_t n = stream->getConnection().trySendData(*stream, data);
+      data = data.slice(n, data.size());
+      if (n == 0) {
+        // Out of window, or the stream hasn't opened yet.
+        co_await stream->waitSend();
+      }
+    }
+    co_await stream->getConnection().whenWritable();
+  }
+};
+
+// ---------------------------------------------------------------------------------------
+// Http2Connection
+
+Http2Connection::Http2Connection(
+    kj::Own<kj::AsyncIoStream> transportParam, const kj::HttpHeaderTable& headerTable,
+    const Http2Settings& settings, bool isClient)
+    : headerTable(headerTable), settings(settings), nextStreamId(isClient ? 1 : 2),
+      transport(kj::mv(transportParam)), isClient(isClient), done(nullptr), tasks(*this) {
+  auto paf = kj::newPromiseAndFulfiller<void>();
+  doneFulfiller = kj::mv(paf.fulfiller);
+  done = kj::mv(paf.promise);
+
+  if (isClient) {
+    writeBuffer.addAll(CONNECTION_PREFACE.asBytes());
+  }
+
+  kj::Vector<kj::byte> payload;
+  if (isClient) {
+    addSetting(payload, SettingId::ENABLE_PUSH, 0);
+  } else {
+    addSetting(payload, SettingId::MAX_CONCURRENT_STREAMS, settings.maxConcurrentStreams);
+  }
+  addSetting(payload, SettingId::INITIAL_WINDOW_SIZE, settings.initialWindowSize);
+  addSetting(payload, SettingId::MAX_HEADER_LIST_SIZE, settings.maxHeaderListSize);
+  queueFrame(FrameType::SETTINGS, 0, 0, payload);
+
+  if (settings.connectionWindowSize > DEFAULT_WINDOW_SIZE) {
+    queueWindowUpdate(0, settings.connectionWindowSize - DEFAULT_WINDOW_SIZE);
+    connRecvWindow = settings.connectionWindowSize;
+  }
+}
+
+Http2Connection::~Http2Connection() noexcept(false) {
+  failAllStreams(KJ_EXCEPTION(DISCONNECTED, "HTTP/2 connection closed"));
+}
+
+kj::Promise<void> Http2Connection::run() {
+  kj::Maybe<kj::Exception> error;
+  try {
+    co_await readLoop().exclusiveJoin(kj::mv(done));
+    co_await whenFlushed();
+    transport->shutdownWrite();
+  } catch (...) {
+    error = kj::getCaughtExceptionAsKj();
+  }
+
+  closed = true;
+  KJ_IF_SOME(e, error) {
+    failAllStreams(e);
+    if (e.getType() != kj::Exception::Type::DISCONNECTED) {
+      kj::throwFatalException(kj::mv(e));
+    }
+  } else {
+    failAllStreams(KJ_EXCEPTION(DISCONNECTED, "HTTP/2 connection closed"));
+  }
+}
+
+void Http2Connection::taskFailed(kj::Exception&& exception) {
+  // Only writes fail here; request handlers catch their own exceptions.
+  if (doneFulfiller->isWaiting()) {
+    doneFulfiller->reject(kj::mv(exception));
+  }
+}
+
+void Http2Connection::finish() {
+  if (doneFulfiller->isWaiting()) {
+    doneFulfiller->fulfill();
+  }
+}
+
+void Http2Connection::failAllStreams(const kj::Exception& exception) {
+  kj::Vector<kj::Own<Stream>> all;
+  for (auto& entry: streams) {
+    all.add(kj::mv(entry.value));
+  }
+  streams.clear();
+  for (auto& stream: pendingStreams) {
+    all.add(kj::mv(stream));
+  }
+  pendingStreams.clear();
+
+  for (auto& stream: all) {
+    stream->conn = kj::none;
+    stream->fail(exception);
+  }
+
+  for (auto& waiter: flushWaiters) {
+    waiter->reject(kj::cp(exception));
+  }
+  flushWaiters.clear();
+}
+
+// ---------------------------------------------------------------------------------------
+// Writing
+
+void Http2Connection::queueFrame(FrameType type, uint8_t flags, uint32_t streamId,
+                                 kj::ArrayPtr<const kj::byte> payload) {
+  kj::byte header[FRAME_HEADER_SIZE];
+  header[0] = payload.size() >> 16;
+  header[1] = payload.size() >> 8;
+  header[2] = payload.size();
+  header[3] = kj::byte(type);
+  header[4] = flags;
+  writeUint32(header + 5, streamId & MAX_STREAM_ID);
+  writeBuffer.addAll(header, header + FRAME_HEADER_SIZE);
+  writeBuffer.addAll(payload);
+  scheduleFlush();
+}
+
+void Http2Connection::queueWindowUpdate(uint32_t streamId, uint32_t increment) {
+  kj::byte payload[4];
+  writeUint32(payload, increment);
+  queueFrame(FrameType::WINDOW_UPDATE, 0, streamId, payload);
+}
+
+void Http2Connection::scheduleFlush() {
+  if (flushing || closed) return;
+  flushing = true;
+  tasks.add(flushLoop());
+}
+
+kj::Promise<void> Http2Connection::flushLoop() {
+  co_await kj::yield();
+
+  while (writeBuffer.size() > 0) {
+    auto data = kj::mv(writeBuffer);
+    writeBuffer = kj::mv(spareWriteBuffer);
+    co_await transport->write(data.begin(), data.size());
+    data.clear();
+    spareWriteBuffer = kj::mv(data);
+  }
+
+  flushing = false;
+  for (auto& waiter: flushWaiters) {
+    waiter->fulfill();
+  }
+  flushWaiters.clear();
+}
+
+kj::Promise<void> Http2Connection::whenFlushed() {
+  if (!flushing) return kj::READY_NOW;
+  auto paf = kj::newPromiseAndFulfiller<void>();
+  flushWaiters.add(kj::mv(paf.fulfiller));
+  return kj::mv(paf.promise);
+}
+
+kj::Promise<void> Http2Connection::whenWritable() {
+  if (writeBuffer.size() < WRITE_BUFFER_HIGH_WATER) return kj::READY_NOW;
+  return whenFlushed();
+}
+
+void Http2Connection::sendHeaders(Stream& stream, kj::ArrayPtr<const HeaderList::Field> fields,
+                                  bool endStream) {
+  encodeBuffer.clear();
+  encoder.beginBlock(encodeBuffer);
+  for (auto& field: fields) {
+    encoder.encode(encodeBuffer, field.name, field.value);
+  }
+
+  // Blocks bigger than a frame continue in CONTINUATION frames, which must follow immediately.
+  size_t offset = 0;
+  bool first = true;
+  do {
+    size_t n = kj::min(encodeBuffer.size() - offset, size_t(peerMaxFrameSize));
+    uint8_t flags = 0;
+    if (offset + n == encodeBuffer.size()) flags |= FLAG_END_HEADERS;
+    if (first && endStream) flags |= FLAG_END_STREAM;
+    queueFrame(first ? FrameType::HEADERS : FrameType::CONTINUATION, flags, stream.id,
+               encodeBuffer.asPtr().slice(offset, offset + n));
+    offset += n;
+    first = false;
+  } while (offset < encodeBuffer.size());
+
+  if (endStream) {
+    stream.sendEnded = true;
+    maybeForget(stream);
+  }
+}
+
+size_t Http2Connection::trySendData(Stream& stream, kj::ArrayPtr<const kj::byte> data) {
+  KJ_REQUIRE(!stream.sendEnded, "HTTP/2 stream already ended");
+  if (stream.id == 0) return 0;
+
+  size_t sent = 0;
+  while (sent < data.size()) {
+    int64_t window = kj::min(stream.sendWindow, connSendWindow);
+    if (window <= 0) break;
+    size_t n = kj::min(kj::min(data.size() - sent, size_t(window)), size_t(peerMaxFrameSize));
+    queueFrame(FrameType::DATA, 0, stream.id, data.slice(sent, sent + n));
+    stream.sendWindow -= n;
+    connSendWindow -= n;
+    sent += n;
+  }
+  return sent;
+}
+
+void Http2Connection::endStream(Stream& stream) {
+  if (stream.sendEnded) return;
+  stream.sendEnded = true;
+
+  // A stream which hasn't opened yet will carry END_STREAM on its HEADERS.
+  if (stream.id == 0) return;
+
+  queueFrame(FrameType::DATA, FLAG_END_STREAM, stream.id, nullptr);
+  maybeForget(stream);
+}
+
+void Http2Connection::resetStream(Stream& stream, ErrorCode code) {
+  if (stream.id != 0) {
+    kj::byte payload[4];
+    writeUint32(payload, uint32_t(code));
+    queueFrame(FrameType::RST_STREAM, 0, stream.id, payload);
+  }
+  stream.fail(KJ_EXCEPTION(DISCONNECTED, "HTTP/2 stream was reset", uint32_t(code)));
+  forget(stream);
+}
+
+void Http2Connection::goAway(ErrorCode code, kj::StringPtr debugData) {
+  kj::Vector<kj::byte> payload(8 + debugData.size());
+  kj::byte fixed[8];
+  writeUint32(fixed, lastPeerStreamId);
+  writeUint32(fixed + 4, uint32_t(code));
+  payload.addAll(fixed, fixed + sizeof(fixed));
+  payload.addAll(debugData.asBytes());
+  queueFrame(FrameType::GOAWAY, 0, 0, payload);
+  goAwaySent = true;
+}
+
+void Http2Connection::forget(Stream& stream) {
+  if (stream.conn == kj::none) return;
+  stream.conn = kj::none;
+
+  // Data the application never read still counts against the connection's window.
+  creditConnection(stream.available());
+
+  if (stream.id == 0) {
+    for (auto i: kj::indices(pendingStreams)) {
+      if (pendingStreams[i].get() == &stream) {
+        for (auto j: kj::range(i + 1, pendingStreams.size())) {
+          pendingStreams[j - 1] = kj::mv(pendingStreams[j]);
+        }
+        pendingStreams.removeLast();
+        break;
+      }
+    }
+  } else {
+    streams.eraseMatch(stream.id);
+  }
+
+  onStreamClosed();
+}
+
+// ---------------------------------------------------------------------------------------
+// Flow control
+
+void Http2Connection::creditConnection(size_t bytes) {
+  connRecvUnacked += bytes;
+  if (connRecvUnacked >= settings.connectionWindowSize / 2) {
+    queueWindowUpdate(0, connRecvUnacked);
+    connRecvWindow += connRecvUnacked;
+    connRecvUnacked = 0;
+  }
+}
+
+void Http2Connection::creditStream(Stream& stream, size_t bytes) {
+  stream.recvUnacked += bytes;
+  if (stream.recvUnacked >= settings.initialWindowSize / 2) {
+    queueWindowUpdate(stream.id, stream.recvUnacked);
+    stream.recvWindow += stream.recvUnacked;
+    stream.recvUnacked = 0;
+  }
+}
+
+void Http2Connection::consumed(Stream& stream, size_t bytes) {
+  creditConnection(bytes);
+  if (!stream.recvEnded) {
+    creditStream(stream, bytes);
+  }
+}
+
+// ---------------------------------------------------------------------------------------
+// Reading
+
+kj::Promise<void> Http2Connection::readLoop() {
+  auto buffer = kj::heapArray<kj::byte>(READ_BUFFER_SIZE);
+  size_t start = 0;
+  size_t end = 0;
+  bool prefaceReceived = isClient;
+
+  for (;;) {
+    auto error = kj::runCatchingExceptions([&]() {
+      if (!prefaceReceived && end - start >= CONNECTION_PREFACE.size()) {
+        if (memcmp(buffer.begin() + start, CONNECTION_PREFACE.begin(),
+                   CONNECTION_PREFACE.size()) != 0) {
+          kj::throwFatalException(KJ_EXCEPTION(DISCONNECTED,
+              "client didn't send the HTTP/2 connection preface"));
+        }
+        start += CONNECTION_PREFACE.size();
+        prefaceReceived = true;
+      }
+
+      while (prefaceReceived && end - start >= FRAME_HEADER_SIZE) {
+        auto frame = buffer.begin() + start;
+        uint32_t length = readUint24(frame);
+        if (length > MIN_MAX_FRAME_SIZE) {
+          connectionError(ErrorCode::FRAME_SIZE, "frame is larger than SETTINGS_MAX_FRAME_SIZE");
+        }
+        if (end - start < FRAME_HEADER_SIZE + length) break;
+
+        handleFrame(FrameType(frame[3]), frame[4], readUint32(frame + 5) & MAX_STREAM_ID,
+                    kj::arrayPtr(frame + FRAME_HEADER_SIZE, length));
+        start += FRAME_HEADER_SIZE + length;
+      }
+    });
+
+    KJ_IF_SOME(e, error) {
+      if (e.getType() == kj::Exception::Type::DISCONNECTED) {
+        kj::throwFatalException(kj::mv(e));
+      }
+
+      // The peer broke the protocol. Tell it why, and stop.
+      goAway(errorCode, e.getDescription());
+      failAllStreams(e);
+      co_await whenFlushed();
+      co_return;
+    }
+
+    if (start == end) {
+      start = end = 0;
+    } else if (start > 0) {
+      memmove(buffer.begin(), buffer.begin() + start, end - start);
+      end -= start;
+      start = 0;
+    }
+
+    size_t n = co_await transport->tryRead(buffer.begin() + end, 1, buffer.size() - end);
+    if (n == 0) co_return;
+    end += n;
+  }
+}
+
+void Http2Connection::handleFrame(FrameType type, uint8_t flags, uint32_t streamId,
+                                  kj::ArrayPtr<const kj::byte> payload) {
+  if (inHeaderBlock && type != FrameType::CONTINUATION) {
+    connectionError(ErrorCode::PROTOCOL, "header block interrupted by another frame");
+  }
+
+  switch (type) {
+    case FrameType::DATA:
+      return handleData(flags, streamId, payload);
+    case FrameType::HEADERS:
+      return handleHeaders(flags, streamId, payload);
+    case FrameType::PRIORITY:
+      // We don't prioritize streams.
+      return;
+    case FrameType::RST_STREAM:
+      return handleRstStream(streamId, payload);
+    case FrameType::SETTINGS:
+      return handleSettings(flags, streamId, payload);
+    case FrameType::PUSH_PROMISE:
+      // Clients disable push, and servers may not push to us.
+      connectionError(ErrorCode::PROTOCOL, "unexpected PUSH_PROMISE");
+    case FrameType::PING:
+      return handlePing(flags, streamId, payload);
+    case FrameType::GOAWAY:
+      return handleGoAway(streamId, payload);
+    case FrameType::WINDOW_UPDATE:
+      return handleWindowUpdate(streamId, payload);
+    case FrameType::CONTINUATION:
+      return handleContinuation(flags, streamId, payload);
+  }
+
+  // Unknown frame types must be ignored.
+}
+
+kj::ArrayPtr<const kj::byte> Http2Connection::stripPadding(
+    uint8_t flags, kj::ArrayPtr<const kj::byte> payload) {
+  if (!(flags & FLAG_PADDED)) return payload;
+  if (payload.size() == 0) {
+    connectionError(ErrorCode::FRAME_SIZE, "padded frame has no pad length");
+  }
+  size_t padLength = payload[0];
+  if (padLength >= payload.size()) {
+    connectionError(ErrorCode::PROTOCOL, "padding is longer than the frame");
+  }
+  return payload.slice(1, payload.size() - padLength);
+}
+
+void Http2Connection::handleData(uint8_t flags, uint32_t streamId,
+                                 kj::ArrayPtr<const kj::byte> payload) {
+  if (streamId == 0) {
+    connectionError(ErrorCode::PROTOCOL, "DATA on stream 0");
+  }
+  if (int64_t(payload.size()) > connRecvWindow) {
+    connectionError(ErrorCode::FLOW_CONTROL, "peer overran the connection's flow control window");
+  }
+  connRecvWindow -= payload.size();
+
+  auto data = stripPadding(flags, payload);
+  size_t padding = payload.size() - data.size();
+
+  auto& stream = KJ_UNWRAP_OR(findStream(streamId), {
+    if (!isKnownStreamId(streamId)) {
+      connectionError(ErrorCode::PROTOCOL, "DATA on a stream which was never opened");
+    }
+    // The stream was closed or reset, and the peer hadn't heard yet.
+    creditConnection(payload.size());
+    return;
+  });
+
+  if (stream.recvEnded) {
+    creditConnection(payload.size());
+    resetStream(stream, ErrorCode::STREAM_CLOSED);
+    return;
+  }
+  if (int64_t(payload.size()) > stream.recvWindow) {
+    creditConnection(payload.size());
+    resetStream(stream, ErrorCode::FLOW_CONTROL);
+    return;
+  }
+  stream.recvWindow -= payload.size();
+
+  // Padding is never read by the application, so give it back now.
+  if (padding > 0) {
+    creditConnection(padding);
+    creditStream(stream, padding);
+  }
+
+  KJ_IF_SOME(remaining, stream.recvRemaining) {
+    if (data.size() > remaining) {
+      creditConnection(data.size());
+      resetStream(stream, ErrorCode::PROTOCOL);
+      return;
+    }
+    remaining -= data.size();
+  }
+
+  stream.receive(data);
+
+  if (flags & FLAG_END_STREAM) {
+    KJ_IF_SOME(remaining, stream.recvRemaining) {
+      if (remaining > 0) {
+        resetStream(stream, ErrorCode::PROTOCOL);
+        return;
+      }
+    }
+    stream.recvEnded = true;
+    stream.wakeRecv();
+    maybeForget(stream);
+  } else {
+    stream.wakeRecv();
+  }
+}
+
+void Http2Connection::handleHeaders(uint8_t flags, uint32_t streamId,
+                                    kj::ArrayPtr<const kj::byte> payload) {
+  if (streamId == 0) {
+    connectionError(ErrorCode::PROTOCOL, "HEADERS on stream 0");
+  }
+
+  auto fragment = stripPadding(flags, payload);
+  if (flags & FLAG_PRIORITY) {
+    if (fragment.size() < 5) {
+      connectionError(ErrorCode::FRAME_SIZE, "HEADERS too short for its priority");
+    }
+    fragment = fragment.slice(5, fragment.size());
+  }
+
+  headerBlock.clear();
+  headerBlock.addAll(fragment);
+  headerStreamId = streamId;
+  headerEndStream = flags & FLAG_END_STREAM;
+
+  if (flags & FLAG_END_HEADERS) {
+    finishHeaderBlock();
+  } else {
+    inHeaderBlock = true;
+    onHeaderBlockContinued();
+  }
+}
+
+void Http2Connection::handleContinuation(uint8_t flags, uint32_t streamId,
+                                         kj::ArrayPtr<const kj::byte> payload) {
+  if (!inHeaderBlock || streamId != headerStreamId) {
+    connectionError(ErrorCode::PROTOCOL, "unexpected CONTINUATION");
+  }
+
+  // Compressed headers are never bigger than the decoded ones, give or take a little.
+  if (headerBlock.size() + payload.size() > settings.maxHeaderListSize + MIN_MAX_FRAME_SIZE) {
+    connectionError(ErrorCode::ENHANCE_YOUR_CALM, "header block is too large");
+  }
+  headerBlock.addAll(payload);
+
+  if (flags & FLAG_END_HEADERS) {
+    inHeaderBlock = false;
+    finishHeaderBlock();
+  }
+}
+
+void Http2Connection::finishHeaderBlock() {
+  // The block must be decoded even if the stream is gone, to keep the decoder in step.
+  kj::Vector<HeaderField> fields;
+  size_t listSize = 0;
+  KJ_IF_SOME(e, kj::runCatchingExceptions([&]() {
+    decoder.decode(headerBlock, [&](kj::StringPtr name, kj::StringPtr value) {
+      listSize += HpackTable::entrySize(name, value);
+      if (listSize <= settings.maxHeaderListSize) {
+        fields.add(HeaderField { kj::str(name), kj::str(value) });
+      }
+    });
+  })) {
+    connectionError(ErrorCode::COMPRESSION, e.getDescription());
+  }
+
+  onHeaderBlock(headerStreamId, kj::mv(fields), headerEndStream,
+                listSize > settings.maxHeaderListSize);
+}
+
+void Http2Connection::handleRstStream(uint32_t streamId, kj::ArrayPtr<const kj::byte> payload) {
+  if (streamId == 0) {
+    connectionError(ErrorCode::PROTOCOL, "RST_STREAM on stream 0");
+  }
+  if (payload.size() != 4) {
+    connectionError(ErrorCode::FRAME_SIZE, "RST_STREAM must be 4 bytes");
+  }
+
+  KJ_IF_SOME(stream, findStream(streamId)) {
+    auto code = readUint32(payload.begin());
+    stream.fail(KJ_EXCEPTION(DISCONNECTED, "HTTP/2 stream was reset by the peer", code));
+    forget(stream);
+    onPeerReset();
+  } else if (!isKnownStreamId(streamId)) {
+    connectionError(ErrorCode::PROTOCOL, "RST_STREAM on a stream which was never opened");
+  }
+}
+
+void Http2Connection::handleSettings(uint8_t flags, uint32_t streamId,
+                                     kj::ArrayPtr<const kj::byte> payload) {
+  if (streamId != 0) {
+    connectionError(ErrorCode::PROTOCOL, "SETTINGS on a stream");
+  }
+  if (flags & FLAG_ACK) {
+    if (payload.size() != 0) {
+      connectionError(ErrorCode::FRAME_SIZE, "SETTINGS ack with a payload");
+    }
+    return;
+  }
+  if (payload.size() % 6 != 0) {
+    connectionError(ErrorCode::FRAME_SIZE, "SETTINGS payload isn't a whole number of settings");
+  }
+
+  for (size_t i = 0; i < payload.size(); i += 6) {
+    auto id = readUint16(payload.begin() + i);
+    auto value = readUint32(payload.begin() + i + 2);
+    switch (SettingId(id)) {
+      case SettingId::HEADER_TABLE_SIZE:
+        encoder.setMaxTableSize(value);
+        break;
+      case SettingId::ENABLE_PUSH:
+        if (value > 1) {
+          connectionError(ErrorCode::PROTOCOL, "invalid SETTINGS_ENABLE_PUSH");
+        }
+        break;
+      case SettingId::MAX_CONCURRENT_STREAMS:
+        peerMaxConcurrentStreams = value;
+        break;
+      case SettingId::INITIAL_WINDOW_SIZE: {
+        if (value > MAX_WINDOW_SIZE) {
+          connectionError(ErrorCode::FLOW_CONTROL, "invalid SETTINGS_INITIAL_WINDOW_SIZE");
+        }
+        // The change applies to the windows of streams which are already open.
+        int64_t delta = int64_t(value) - peerInitialWindowSize;
+        peerInitialWindowSize = value;
+        for (auto& entry: streams) {
+          auto& stream = *entry.value;
+          stream.sendWindow += delta;
+          if (stream.sendWindow > MAX_WINDOW_SIZE) {
+            connectionError(ErrorCode::FLOW_CONTROL, "stream flow control window overflowed");
+          }
+          stream.wakeSend();
+        }
+        break;
+      }
+      case SettingId::MAX_FRAME_SIZE:
+        if (value < MIN_MAX_FRAME_SIZE || value > MAX_MAX_FRAME_SIZE) {
+          connectionError(ErrorCode::PROTOCOL, "invalid SETTINGS_MAX_FRAME_SIZE");
+        }
+        peerMaxFrameSize = value;
+        break;
+      case SettingId::MAX_HEADER_LIST_SIZE:
+        // Advisory. Our headers are the application's, and it will find out if they're too big.
+        break;
+    }
+  }
+
+  queueFrame(FrameType::SETTINGS, FLAG_ACK, 0, nullptr);
+  onSettings();
+}
+
+void Http2Connection::handlePing(uint8_t flags, uint32_t streamId,
+                                 kj::ArrayPtr<const kj::byte> payload) {
+  if (streamId != 0) {
+    connectionError(ErrorCode::PROTOCOL, "PING on a stream");
+  }
+  if (payload.size() != 8) {
+    connectionError(ErrorCode::FRAME_SIZE, "PING must be 8 bytes");
+  }
+  if (!(flags & FLAG_ACK)) {
+    queueFrame(FrameType::PING, FLAG_ACK, 0, payload);
+  }
+}
+
+void Http2Connection::handleGoAway(uint32_t streamId, kj::ArrayPtr<const kj::byte> payload) {
+  if (streamId != 0) {
+    connectionError(ErrorCode::PROTOCOL, "GOAWAY on a stream");
+  }
+  if (payload.size() < 8) {
+    connectionError(ErrorCode::FRAME_SIZE, "GOAWAY is too short");
+  }
+
+  goAwayReceived = true;
+  uint32_t lastStreamId = readUint32(payload.begin()) & MAX_STREAM_ID;
+  uint32_t code = readUint32(payload.begin() + 4);
+
+  // Streams we opened after the last one the peer will process were never seen by the
+  // application, so are safe to retry.
+  kj::Vector<kj::Own<Stream>> unprocessed;
+  for (auto& entry: streams) {
+    bool ours = (entry.key & 1) == (isClient ? 1 : 0);
+    if (ours && entry.key > lastStreamId) {
+      unprocessed.add(kj::addRef(*entry.value));
+    }
+  }
+  for (auto& stream: pendingStreams) {
+    unprocessed.add(kj::addRef(*stream));
+  }
+  for (auto& stream: unprocessed) {
+    stream->fail(KJ_EXCEPTION(DISCONNECTED,
+        "HTTP/2 peer went away before processing the request", code));
+    forget(*stream);
+  }
+
+  if (streams.size() == 0) finish();
+}
+
+void Http2Connection::handleWindowUpdate(uint32_t streamId,
+                                         kj::ArrayPtr<const kj::byte> payload) {
+  if (payload.size() != 4) {
+    connectionError(ErrorCode::FRAME_SIZE, "WINDOW_UPDATE must be 4 bytes");
+  }
+  uint32_t increment = readUint32(payload.begin()) & MAX_STREAM_ID;
+
+  if (streamId == 0) {
+    if (increment == 0) {
+      connectionError(ErrorCode::PROTOCOL, "WINDOW_UPDATE of zero");
+    }
+    connSendWindow += increment;
+    if (connSendWindow > MAX_WINDOW_SIZE) {
+      connectionError(ErrorCode::FLOW_CONTROL, "connection flow control window overflowed");
+    }
+    for (auto& entry: streams) {
+      entry.value->wakeSend();
+    }
+  } else KJ_IF_SOME(stream, findStream(streamId)) {
+    if (increment == 0) {
+      resetStream(stream, ErrorCode::PROTOCOL);
+      return;
+    }
+    stream.sendWindow += increment;
+    if (stream.sendWindow > MAX_WINDOW_SIZE) {
+      resetStream(stream, ErrorCode::FLOW_CONTROL);
+      return;
+    }
+    stream.wakeSend();
+  }
+}
+
+// ---------------------------------------------------------------------------------------
+// Client
+
+class ClientConnection final: public Http2Connection {
+public:
+  ClientConnection(kj::Own<kj::AsyncIoStream> transport, const kj::HttpHeaderTable& headerTable,
+                   const Http2Settings& settings, kj::StringPtr scheme)
+      : Http2Connection(kj::mv(transport), headerTable, settings, true), scheme(scheme) {}
+
+  bool canTakeRequests() {
+    return !closed && !retired && !goAwayReceived && nextStreamId < MAX_STREAM_ID;
+  }
+
+  // Stops taking new requests, and closes once the ones in progress are done.
+  void retire() {
+    retired = true;
+    if (streams.size() == 0 && pendingStreams.size() == 0) finish();
+  }
+
+  kj::HttpClient::Request startRequest(kj::HttpMethod method, kj::StringPtr url,
+                                       const kj::HttpHeaders& headers,
+                                       kj::Maybe<uint64_t> expectedBodySize) {
+    kj::StringPtr requestScheme = scheme;
+    kj::StringPtr authority;
+    kj::StringPtr path = url;
+    kj::Url parsed;
+    kj::String ownPath;
+    if (url.startsWith("/") || url == "*"_kj) {
+      authority = headers.get(kj::HttpHeaderId::HOST).orDefault(""_kj);
+    } else {
+      // An absolute URL, as sent to proxies.
+      parsed = kj::Url::parse(url, kj::Url::HTTP_PROXY_REQUEST,
+          kj::Url::Options {.percentDecode = false, .allowEmpty = true});
+      requestScheme = parsed.scheme;
+      authority = parsed.host;
+      path = ownPath = parsed.toString(kj::Url::HTTP_REQUEST);
+    }
+
+    HeaderList fields;
+    fields.add(":method", kj::toCharSequence(method));
+    fields.add(":scheme", requestScheme);
+    if (authority.size() > 0) {
+      fields.add(":authority", authority);
+    }
+    fields.add(":path", path);
+    fields.addHttp1(headers);
+
+    kj::String ownLength;
+    bool endStream = false;
+    KJ_IF_SOME(size, expectedBodySize) {
+      if (size == 0) {
+        endStream = true;
+      } else if (!fields.has("content-length")) {
+        ownLength = kj::str(size);
+        fields.add("content-length", ownLength);
+      }
+    }
+
+    auto stream = kj::refcounted<Stream>(*this, 0, settings.initialWindowSize, 0);
+    auto paf = kj::newPromiseAndFulfiller<kj::HttpClient::Response>();
+    stream->responseFulfiller = kj::mv(paf.fulfiller);
+    stream->sendEnded = endStream;
+
+    if (streams.size() < peerMaxConcurrentStreams) {
+      openStream(*stream, fields.asPtr());
+    } else {
+      stream->pendingHeaders = fields.copy();
+      pendingStreams.add(kj::addRef(*stream));
+    }
+
+    return {
+      .body = kj::heap<BodyWriter>(kj::mv(stream), expectedBodySize, false),
+      .response = kj::mv(paf.promise),
+    };
+  }
+
+protected:
+  void onHeaderBlock(uint32_t streamId, kj::Vector<HeaderField> fields, bool endStream,
+                     bool tooLarge) override {
+    auto& stream = KJ_UNWRAP_OR(findStream(streamId), {
+      if ((streamId & 1) == 0 || streamId >= nextStreamId) {
+        connectionError(ErrorCode::PROTOCOL, "server opened a stream");
+      }
+      // A stream we already reset.
+      return;
+    });
+
+    if (stream.responseFulfiller == kj::none) {
+      // Trailers, which we don't pass on, except that they end the body.
+      if (!endStream) {
+        resetStream(stream, ErrorCode::PROTOCOL);
+        return;
+      }
+      stream.recvEnded = true;
+      stream.wakeRecv();
+      maybeForget(stream);
+      return;
+    }
+
+    if (tooLarge) {
+      stream.fail(KJ_EXCEPTION(FAILED, "HTTP/2 response headers are too large"));
+      resetStream(stream, ErrorCode::CANCEL);
+      return;
+    }
+
+    uint statusCode = 0;
+    auto headers = kj::heap<kj::HttpHeaders>(headerTable);
+    for (auto& field: fields) {
+      if (field.name == ":status"_kj) {
+        auto parsed = parseDecimal(field.value).orDefault(0);
+        statusCode = parsed <= 999 ? parsed : 0;
+      } else if (field.name.startsWith(":") || !isValidFieldName(field.name) ||
+                 !isValidFieldValue(field.value)) {
+        stream.fail(KJ_EXCEPTION(FAILED, "malformed HTTP/2 response headers", field.name));
+        resetStream(stream, ErrorCode::PROTOCOL);
+        return;
+      } else {
+        if (field.name == "content-length"_kj) {
+          stream.recvRemaining = parseDecimal(field.value);
+        }
+        headers->add(kj::mv(field.name), kj::mv(field.value));
+      }
+    }
+
+    if (statusCode < 100 || statusCode > 999) {
+      stream.fail(KJ_EXCEPTION(FAILED, "HTTP/2 response has no valid :status"));
+      resetStream(stream, ErrorCode::PROTOCOL);
+      return;
+    }
+    if (statusCode < 200) {
+      // An informational response. The real one follows.
+      if (endStream) resetStream(stream, ErrorCode::PROTOCOL);
+      return;
+    }
+
+    auto fulfiller = kj::mv(KJ_ASSERT_NONNULL(stream.responseFulfiller));
+    stream.responseFulfiller = kj::none;
+    if (!fulfiller->isWaiting()) {
+      // The request was canceled.
+      resetStream(stream, ErrorCode::CANCEL);
+      return;
+    }
+
+    if (endStream) {
+      stream.recvEnded = true;
+    }
+    auto& headersRef = *headers;
+    auto body = kj::heap<BodyReader>(kj::addRef(stream), true).attach(kj::mv(headers));
+    fulfiller->fulfill({ statusCode, statusText(statusCode), &headersRef, kj::mv(body) });
+    maybeForget(stream);
+  }
+
+  void onStreamClosed() override {
+    openPendingStreams();
+    if (retired && streams.size() == 0 && pendingStreams.size() == 0) finish();
+  }
+
+  void onSettings() override {
+    openPendingStreams();
+  }
+
+private:
+  kj::StringPtr scheme;
+  bool retired = false;
+
+  void openStream(Stream& stream, kj::ArrayPtr<const HeaderList::Field> fields) {
+    stream.id = nextStreamId;
+    nextStreamId += 2;
+    stream.sendWindow = peerInitialWindowSize;
+    streams.insert(stream.id, kj::addRef(stream));
+    sendHeaders(stream, fields, stream.sendEnded);
+
+    // The body may be waiting for the stream to open.
+    stream.wakeSend();
+  }
+
+  void openPendingStreams() {
+    size_t opened = 0;
+    while (opened < pendingStreams.size() && streams.size() < peerMaxConcurrentStreams &&
+           !closed && !goAwayReceived) {
+      auto& stream = *pendingStreams[opened++];
+      auto fields = KJ_MAP(field, stream.pendingHeaders) {
+        return HeaderList::Field { field.name, field.value };
+      };
+      openStream(stream, fields);
+      stream.pendingHeaders = nullptr;
+    }
+
+    if (opened > 0) {
+      for (auto i: kj::range(opened, pendingStreams.size())) {
+        pendingStreams[i - opened] = kj::mv(pendingStreams[i]);
+      }
+      pendingStreams.truncate(pendingStreams.size() - opened);
+    }
+  }
+};
+
+class Http2Client final: public kj::HttpClient, private kj::TaskSet::ErrorHandler {
+public:
+  Http2Client(const kj::HttpHeaderTable& headerTable, kj::NetworkAddress& addr,
+              kj::StringPtr scheme, Http2Settings settings)
+      : headerTable(headerTable), addr(addr), scheme(kj::str(scheme)), settings(settings),
+        tasks(*this) {}
+
+  Request request(kj::HttpMethod method, kj::StringPtr url, const kj::HttpHeaders& headers,
+                  kj::Maybe<uint64_t> expectedBodySize = kj::none) override {
+    return getConnection().startRequest(method, url, headers, expectedBodySize);
+  }
+
+  kj::Promise<WebSocketResponse> openWebSocket(
+      kj::StringPtr url, const kj::HttpHeaders& headers) override {
+    return KJ_EXCEPTION(UNIMPLEMENTED, "WebSockets are not supported over HTTP/2");
+  }
+
+private:
+  const kj::HttpHeaderTable& headerTable;
+  kj::NetworkAddress& addr;
+  kj::String scheme;
+  Http2Settings settings;
+
+  kj::Maybe<kj::Own<ClientConnection>> current;
+
+  // Runs connections, including retired ones which are finishing their last requests.
+  kj::TaskSet tasks;
+
+  ClientConnection& getConnection() {
+    KJ_IF_SOME(conn, current) {
+      if (conn->canTakeRequests()) return *conn;
+      conn->retire();
+      current = kj::none;
+    }
+
+    auto conn = kj::refcounted<ClientConnection>(
+        kj::newPromisedStream(addr.connect()), headerTable, settings, scheme);
+    tasks.add(conn->run().attach(kj::addRef(*conn)));
+    auto& result = *conn;
+    current = kj::mv(conn);
+    return result;
+  }
+
+  void taskFailed(kj::Exception&& exception) override {
+    // The connection's requests have already failed with this.
+    KJ_LOG(WARNING, "HTTP/2 client connection failed", exception);
+  }
+};
+
+}  // namespace
+
+// =======================================================================================
+// Server
+
+class Http2Server::Connection final: public Http2Connection {
+public:
+  Connection(Http2Server& server, kj::Own<kj::AsyncIoStream> transport)
+      : Http2Connection(kj::mv(transport), server.headerTable, server.settings, false),
+        server(server) {
+    server.connections.add(this);
+
+    // Until the first request, the connection is held to the header timeout.
+    setIdleTimer(settings.headerTimeout);
+  }
+
+  ~Connection() noexcept(false) {
+    for (auto i: kj::indices(server.connections)) {
+      if (server.connections[i] == this) {
+        server.connections[i] = server.connections.back();
+        server.connections.removeLast();
+        break;
+      }
+    }
+  }
+
+  void drain() {
+    if (goAwaySent) return;
+    goAway(ErrorCode::NONE);
+    if (streams.size() == 0) finish();
+  }
+
+protected:
+  void onHeaderBlock(uint32_t streamId, kj::Vector<HeaderField> fields, bool endStream,
+                     bool tooLarge) override {
+    KJ_IF_SOME(stream, findStream(streamId)) {
+      // Trailers, which we don't pass on, except that they end the request body.
+      if (!endStream || stream.recvEnded) {
+        resetStream(stream, ErrorCode::PROTOCOL);
+        return;
+      }
+      stream.recvEnded = true;
+      stream.wakeRecv();
+      maybeForget(stream);
+      return;
+    }
+
+    if ((streamId & 1) == 0) {
+      connectionError(ErrorCode::PROTOCOL, "client opened an even-numbered stream");
+    }
+    if (streamId <= lastPeerStreamId) {
+      // A stream which has closed, or which we reset.
+      return;
+    }
+    lastPeerStreamId = streamId;
+
+    if (goAwaySent) {
+      // Draining. The client knows from GOAWAY that this stream won't be processed.
+      return;
+    }
+
+    auto ownStream = kj::refcounted<Stream>(*this, streamId, settings.initialWindowSize,
+                                            peerInitialWindowSize);
+    auto& stream = *ownStream;
+    stream.recvEnded = endStream;
+
+    if (streams.size() >= settings.maxConcurrentStreams) {
+      streams.insert(streamId, kj::mv(ownStream));
+      resetStream(stream, ErrorCode::REFUSED_STREAM);
+      countReset();
+      return;
+    }
+    streams.insert(streamId, kj::mv(ownStream));
+    idleTimer = nullptr;
+
+    if (tooLarge) {
+      return sendSimpleResponse(stream, 431);
+    }
+
+    kj::Maybe<kj::HttpMethod> method;
+    bool sawMethod = false;
+    bool sawScheme = false;
+    kj::String path;
+    kj::String authority;
+    kj::Vector<kj::String> cookies;
+    auto headers = kj::heap<kj::HttpHeaders>(server.headerTable);
+
+    bool pseudoHeadersDone = false;
+    for (auto& field: fields) {
+      if (field.name.startsWith(":")) {
+        if (pseudoHeadersDone) return sendSimpleResponse(stream, 400);
+        if (field.name == ":method"_kj) {
+          sawMethod = true;
+          method = kj::tryParseHttpMethod(field.value);
+        } else if (field.name == ":path"_kj) {
+          path = kj::mv(field.value);
+        } else if (field.name == ":scheme"_kj) {
+          sawScheme = true;
+        } else if (field.name == ":authority"_kj) {
+          authority = kj::mv(field.value);
+        } else {
+          return sendSimpleResponse(stream, 400);
+        }
+        continue;
+      }
+
+      pseudoHeadersDone = true;
+      if (!isValidFieldName(field.name) || !isValidFieldValue(field.value) ||
+          isConnectionSpecific(field.name) ||
+          (field.name == "te"_kj && field.value != "trailers"_kj)) {
+        return sendSimpleResponse(stream, 400);
+      }
+
+      if (field.name == "cookie"_kj) {
+        // HTTP/2 allows splitting cookies across fields, which HTTP/1 doesn't.
+        cookies.add(kj::mv(field.value));
+        continue;
+      }
+      if (field.name == "content-length"_kj) {
+        stream.recvRemaining = parseDecimal(field.value);
+        if (stream.recvRemaining == kj::none) return sendSimpleResponse(stream, 400);
+      }
+      headers->add(kj::mv(field.name), kj::mv(field.value));
+    }
+
+    if (!sawMethod || !sawScheme || path.size() == 0) {
+      return sendSimpleResponse(stream, 400);
+    }
+    auto parsedMethod = KJ_UNWRAP_OR(method, {
+      // Including CONNECT, which we don't support.
+      return sendSimpleResponse(stream, 501);
+    });
+
+    if (authority.size() > 0 && headers->get(kj::HttpHeaderId::HOST) == kj::none) {
+      headers->set(kj::HttpHeaderId::HOST, kj::mv(authority));
+    }
+    if (cookies.size() > 0) {
+      headers->add(kj::str("cookie"), kj::strArray(cookies, "; "));
+    }
+    if (endStream) {
+      stream.recvRemaining = kj::none;
+    }
+
+    auto paf = kj::newPromiseAndFulfiller<void>();
+    stream.resetFulfiller = kj::mv(paf.fulfiller);
+    getTasks().add(handleRequest(kj::addRef(stream), parsedMethod, kj::mv(path),
+                                 kj::mv(headers))
+        .exclusiveJoin(kj::mv(paf.promise)));
+  }
+
+  void onStreamClosed() override {
+    if (streams.size() > 0) return;
+    if (goAwaySent) {
+      finish();
+    } else {
+      setIdleTimer(settings.idleTimeout);
+    }
+  }
+
+  void onPeerReset() override {
+    countReset();
+  }
+
+  void onHeaderBlockContinued() override {
+    // A client that never finishes the block would stall every stream on the connection, and the
+    // block can't be abandoned without the HPACK decoder losing its place, so give up on the
+    // whole connection.
+    headerTimer = server.timer.afterDelay(settings.headerTimeout).then([this]() {
+      if (isInHeaderBlock()) close(ErrorCode::PROTOCOL);
+    }).eagerlyEvaluate(nullptr);
+  }
+
+private:
+  Http2Server& server;
+
+  // Closes the connection once it has sat without streams for long enough.
+  kj::Promise<void> idleTimer = nullptr;
+
+  // Closes the connection if a header block isn't finished in time.
+  kj::Promise<void> headerTimer = nullptr;
+
+  void setIdleTimer(kj::Duration timeout) {
+    idleTimer = server.timer.afterDelay(timeout).then([this]() {
+      // No streams can have opened, or this would have been canceled.
+      close(ErrorCode::NONE);
+    }).eagerlyEvaluate(nullptr);
+  }
+
+  // Tells the client no further streams will be processed, and closes the connection without
+  // waiting for the streams in progress.
+  void close(ErrorCode code) {
+    if (!goAwaySent) goAway(code);
+    finish();
+  }
+
+  // Streams the client reset, or which we refused, since `resetWindowStart`.
+  uint32_t recentResets = 0;
+  kj::TimePoint resetWindowStart = kj::origin<kj::TimePoint>();
+
+  void countReset() {
+    auto now = kj::systemCoarseMonotonicClock().now();
+    if (now - resetWindowStart >= settings.resetWindow) {
+      resetWindowStart = now;
+      recentResets = 0;
+    }
+    if (++recentResets > settings.maxResetsPerWindow) {
+      connectionError(ErrorCode::ENHANCE_YOUR_CALM, "too many streams reset");
+    }
+  }
+
+  class ResponseImpl final: public kj::HttpService::Response {
+  public:
+    ResponseImpl(Stream& stream, kj::HttpMethod method): stream(stream), method(method) {}
+
+    bool sent = false;
+
+    kj::Own<kj::AsyncOutputStream> send(
+        uint statusCode, kj::StringPtr statusText, const kj::HttpHeaders& headers,
+        kj::Maybe<uint64_t> expectedBodySize = kj::none) override {
+      KJ_REQUIRE(!sent, "already called send()");
+      sent = true;
+      auto& conn = kj::downcast<Connection>(stream.getConnection());
+
+      auto status = kj::str(statusCode);
+      HeaderList fields;
+      fields.add(":status", status);
+      fields.addHttp1(headers);
+
+      bool noBody = method == kj::HttpMethod::HEAD || statusCode == 204 || statusCode == 304;
+      bool endStream = noBody;
+      kj::String ownLength;
+      KJ_IF_SOME(size, expectedBodySize) {
+        if (size == 0) endStream = true;
+        if (statusCode != 204 && statusCode != 304 && !fields.has("content-length")) {
+          ownLength = kj::str(size);
+          fields.add("content-length", ownLength);
+        }
+      }
+
+      conn.sendHeaders(stream, fields.asPtr(), endStream);
+      return kj::heap<BodyWriter>(kj::addRef(stream),
+          endStream ? kj::Maybe<uint64_t>(uint64_t(0)) : expectedBodySize, noBody);
+    }
+
+    kj::Own<kj::WebSocket> acceptWebSocket(const kj::HttpHeaders& headers) override {
+      // HTTP/2 has no Upgrade, and we don't implement extended CONNECT (RFC 8441), so ask the
+      // client to retry over HTTP/1.1. The service sees the stream as disconnected.
+      KJ_REQUIRE(!sent, "already called send()");
+      sent = true;
+      stream.getConnection().resetStream(stream, ErrorCode::HTTP_1_1_REQUIRED);
+      kj::throwFatalException(
+          KJ_EXCEPTION(DISCONNECTED, "WebSockets are not supported over HTTP/2"));
+    }
+
+  private:
+    Stream& stream;
+    kj::HttpMethod method;
+  };
+
+  kj::Promise<void> handleRequest(kj::Own<Stream> stream, kj::HttpMethod method, kj::String path,
+                                  kj::Own<kj::HttpHeaders> headers) {
+    BodyReader body(kj::addRef(*stream), false);
+    ResponseImpl response(*stream, method);
+
+    kj::Maybe<kj::Exception> error;
+    try {
+      co_await server.service.request(method, path, *headers, body, response);
+    } catch (...) {
+      error = kj::getCaughtExceptionAsKj();
+    }
+
+    if (stream->conn == kj::none) co_return;
+
+    KJ_IF_SOME(e, error) {
+      if (e.getType() != kj::Exception::Type::DISCONNECTED) {
+        KJ_LOG(ERROR, "uncaught exception handling HTTP/2 request", e);
+      }
+      if (response.sent) {
+        resetStream(*stream, ErrorCode::INTERNAL);
+      } else {
+        sendSimpleResponse(*stream, 500);
+      }
+    } else if (!response.sent) {
+      KJ_LOG(ERROR, "HttpService::request() returned without sending a response");
+      sendSimpleResponse(*stream, 500);
+    } else if (stream->sendEnded && !stream->recvEnded) {
+      // The response is complete, so the rest of the request body isn't wanted.
+      resetStream(*stream, ErrorCode::NONE);
+    }
+  }
+
+  // Responds with an empty body, and abandons the rest of the request.
+  void sendSimpleResponse(Stream& stream, uint statusCode) {
+    auto status = kj::str(statusCode);
+    HeaderList fields;
+    fields.add(":status", status);
+    fields.add("content-length", "0");
+
+    bool recvEnded = stream.recvEnded;
+    sendHeaders(stream, fields.asPtr(), true);
+    if (!recvEnded) {
+      resetStream(stream, ErrorCode::NONE);
+    }
+  }
+};
+
+Http2Server::Http2Server(kj::Timer& timer, const kj::HttpHeaderTable& headerTable,
+                         kj::HttpService& service, Http2Settings settings)
+    : timer(timer), headerTable(headerTable), service(service), settings(settings) {}
+
+kj::Promise<void> Http2Server::listenHttp2(kj::Own<kj::AsyncIoStream> connection) {
+  auto conn = kj::refcounted<Connection>(*this, kj::mv(connection));
+  if (draining) conn->drain();
+  return conn->run().attach(kj::mv(conn));
+}
+
+void Http2Server::drain() {
+  draining = true;
+  for (auto conn: connections) {
+    conn->drain();
+  }
+}
+
+kj::Own<kj::HttpClient> newHttp2Client(const kj::HttpHeaderTable& headerTable,
+                                       kj::NetworkAddress& addr, kj::StringPtr scheme,
+                                       Http2Settings settings) {
+  return kj::heap<Http2Client>(headerTable, addr, scheme, settings);
+}
+
+}  // namespace workerd::server
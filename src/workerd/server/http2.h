@@ -0,0 +1,84 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+// HTTP/2 (RFC 9113), adapted to KJ's HTTP interfaces.
+//
+// Both ends speak HTTP/2 from the first byte ("prior knowledge"), since KJ's TLS doesn't do ALPN
+// and so can't negotiate it. Requests are translated to and from the HTTP/1 form which
+// kj::HttpService and kj::HttpClient deal in: the URL is the `:path`, and `:authority` becomes the
+// `Host` header.
+//
+// Not supported: WebSockets, CONNECT, server push, and stream priorities (which are ignored).
+// A server whose service tries to accept a WebSocket resets the stream with HTTP_1_1_REQUIRED.
+
+#include <kj/compat/http.h>
+
+namespace workerd::server {
+
+struct Http2Settings {
+  // Flow control window we give the peer for each stream, and for the connection as a whole.
+  // The protocol's default of 64KiB is far too small to keep a connection of any bandwidth busy.
+  uint32_t initialWindowSize = 1u << 20;
+  uint32_t connectionWindowSize = 16u << 20;
+
+  // How many streams the peer may open at once. (Servers only; clients accept no pushed streams.)
+  uint32_t maxConcurrentStreams = 256;
+
+  // Limit on the decoded size of a request or response's headers.
+  uint32_t maxHeaderListSize = 64u << 10;
+
+  // How many streams a client may reset, or have refused for exceeding `maxConcurrentStreams`,
+  // within `resetWindow` before the server closes the connection with ENHANCE_YOUR_CALM. This
+  // stops "rapid reset" floods (CVE-2023-44487), where a client opens and immediately cancels
+  // streams to start far more requests than the stream limit would allow. (Servers only.)
+  uint32_t maxResetsPerWindow = 1000;
+  kj::Duration resetWindow = 10 * kj::SECONDS;
+
+  // Timeouts after which the server closes a connection, which default to those of
+  // kj::HttpServerSettings. A new connection must start its first request within `headerTimeout`,
+  // and a connection with no open streams is closed after `idleTimeout`. A header block, once
+  // started, must also be finished within `headerTimeout`, since the connection can't process
+  // any other frame until it is. (Servers only.)
+  kj::Duration headerTimeout = 15 * kj::SECONDS;
+  kj::Duration idleTimeout = 5 * kj::SECONDS;
+};
+
+// Serves HTTP/2 connections, like kj::HttpServer does HTTP/1. Must outlive the promises returned
+// by listenHttp2().
+class Http2Server final {
+public:
+  Http2Server(kj::Timer& timer, const kj::HttpHeaderTable& headerTable,
+              kj::HttpService& service, Http2Settings settings = {});
+  KJ_DISALLOW_COPY_AND_MOVE(Http2Server);
+
+  // Serves one connection, whose client is expected to start with the HTTP/2 connection preface.
+  // Resolves when the connection closes.
+  kj::Promise<void> listenHttp2(kj::Own<kj::AsyncIoStream> connection);
+
+  // Asks clients to stop sending requests, and closes each connection once the requests already
+  // started on it are done.
+  void drain();
+
+private:
+  class Connection;
+
+  kj::Timer& timer;
+  const kj::HttpHeaderTable& headerTable;
+  kj::HttpService& service;
+  Http2Settings settings;
+  bool draining = false;
+
+  // Connections currently open, so that drain() can reach them.
+  kj::Vector<Connection*> connections;
+};
+
+// Returns an HttpClient which multiplexes all requests over a single HTTP/2 connection to `addr`,
+// made when the first request is. If the server closes the connection, or sends GOAWAY, the next
+// request opens a new one. `scheme` is sent as `:scheme`, unless the URL is absolute.
+kj::Own<kj::HttpClient> newHttp2Client(const kj::HttpHeaderTable& headerTable,
+                                       kj::NetworkAddress& addr, kj::StringPtr scheme,
+                                       Http2Settings settings = {});
+
+}  // namespace workerd::server
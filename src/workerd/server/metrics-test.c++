@@ -0,0 +1,129 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "metrics.h"
+#include <kj/test.h>
+#include <kj/thread.h>
+#include <string.h>
+
+namespace workerd::server {
+namespace {
+
+bool hasLine(kj::StringPtr text, kj::StringPtr line) {
+  auto haystack = kj::str('\n', text);
+  auto needle = kj::str('\n', line, '\n');
+  return strstr(haystack.cStr(), needle.cStr()) != nullptr;
+}
+
+KJ_TEST("ServerMetrics renders counters, gauges and histograms") {
+  ServerMetrics metrics;
+
+  metrics.increment(ServerMetrics::Counter::REQUESTS);
+  metrics.increment(ServerMetrics::Counter::REQUESTS, 2);
+  metrics.adjust(ServerMetrics::Gauge::ISOLATES, 3);
+  metrics.adjust(ServerMetrics::Gauge::ISOLATES, -1);
+  metrics.record(ServerMetrics::Histogram::GC_PAUSE, 50 * kj::MICROSECONDS);
+  metrics.record(ServerMetrics::Histogram::GC_PAUSE, 3 * kj::MILLISECONDS);
+  metrics.record(ServerMetrics::Histogram::GC_PAUSE, 60 * kj::SECONDS);
+
+  auto text = metrics.renderPrometheus();
+  KJ_EXPECT(text.endsWith("\n"));
+
+  KJ_EXPECT(hasLine(text, "# TYPE workerd_requests_total counter"), text);
+  KJ_EXPECT(hasLine(text, "workerd_requests_total 3"), text);
+  KJ_EXPECT(hasLine(text, "workerd_subrequests_total 0"), text);
+
+  KJ_EXPECT(hasLine(text, "# TYPE workerd_isolates gauge"), text);
+  KJ_EXPECT(hasLine(text, "workerd_isolates 2"), text);
+
+  KJ_EXPECT(hasLine(text, "# TYPE workerd_gc_pause_seconds histogram"), text);
+  KJ_EXPECT(hasLine(text, "workerd_gc_pause_seconds_bucket{le=\"0.0001\"} 1"), text);
+  KJ_EXPECT(hasLine(text, "workerd_gc_pause_seconds_bucket{le=\"0.0025\"} 1"), text);
+  KJ_EXPECT(hasLine(text, "workerd_gc_pause_seconds_bucket{le=\"0.005\"} 2"), text);
+  KJ_EXPECT(hasLine(text, "workerd_gc_pause_seconds_bucket{le=\"10\"} 2"), text);
+  KJ_EXPECT(hasLine(text, "workerd_gc_pause_seconds_bucket{le=\"+Inf\"} 3"), text);
+  KJ_EXPECT(hasLine(text, "workerd_gc_pause_seconds_count 3"), text);
+}
+
+KJ_TEST("ServerMetrics sums values recorded on different threads") {
+  ServerMetrics metrics;
+  ServerMetrics other;
+
+  metrics.increment(ServerMetrics::Counter::SUBREQUESTS);
+  {
+    kj::Thread thread([&]() {
+      for (auto i KJ_UNUSED: kj::zeroTo(1000)) {
+        metrics.increment(ServerMetrics::Counter::SUBREQUESTS);
+        // Alternating between two ServerMetrics on one thread must not lose or misdirect values.
+        other.increment(ServerMetrics::Counter::SUBREQUESTS);
+      }
+      metrics.adjust(ServerMetrics::Gauge::ACTOR_WEBSOCKETS, -1);
+    });
+  }
+  metrics.adjust(ServerMetrics::Gauge::ACTOR_WEBSOCKETS, 1);
+
+  auto text = metrics.renderPrometheus();
+  KJ_EXPECT(hasLine(text, "workerd_subrequests_total 1001"), text);
+  KJ_EXPECT(hasLine(text, "workerd_actor_websockets 0"), text);
+  KJ_EXPECT(hasLine(other.renderPrometheus(), "workerd_subrequests_total 1000"));
+}
+
+KJ_TEST("ServerMetrics observers report into their ServerMetrics") {
+  ServerMetrics metrics;
+
+  {
+    auto request = metrics.makeRequestObserver();
+    KJ_EXPECT(hasLine(metrics.renderPrometheus(), "workerd_requests_in_flight 1"));
+    request->delivered();
+  }
+
+  {
+    auto isolate = metrics.makeIsolateObserver();
+    isolate->created();
+    KJ_EXPECT(hasLine(metrics.renderPrometheus(), "workerd_isolates 1"));
+
+    IsolateObserver::LockRecord record(isolate->tryCreateLockTiming(kj::Maybe<RequestObserver&>()));
+    record.locked();
+    record.gcPrologue();
+    record.gcEpilogue();
+
+    isolate->parse(IsolateObserver::StartType::COLD)->done();
+    // A parse which fails never calls done(), and isn't recorded.
+    isolate->parse(IsolateObserver::StartType::COLD);
+  }
+
+  {
+    auto request = metrics.makeRequestObserver();
+    request->reportTeeBufferPeak(3000);
+    request->reportObjectArenaSize(1 << 20);
+  }
+
+  {
+    auto worker = metrics.makeWorkerObserver();
+    worker->startup(IsolateObserver::StartType::PREWARM)->done();
+  }
+
+  auto text = metrics.renderPrometheus();
+  KJ_EXPECT(hasLine(text, "workerd_requests_total 1"), text);
+  KJ_EXPECT(hasLine(text, "workerd_requests_in_flight 0"), text);
+  KJ_EXPECT(hasLine(text, "workerd_request_duration_seconds_count 1"), text);
+  KJ_EXPECT(hasLine(text, "workerd_isolates 0"), text);
+  KJ_EXPECT(hasLine(text, "workerd_isolates_created_total 1"), text);
+  KJ_EXPECT(hasLine(text, "workerd_isolate_lock_wait_seconds_count 1"), text);
+  KJ_EXPECT(hasLine(text, "workerd_isolate_lock_held_seconds_count 1"), text);
+  KJ_EXPECT(hasLine(text, "workerd_gc_pause_seconds_count 1"), text);
+  KJ_EXPECT(hasLine(text, "workerd_script_parse_seconds_count 1"), text);
+  KJ_EXPECT(hasLine(text, "workerd_worker_startup_seconds_count 1"), text);
+  KJ_EXPECT(hasLine(text, "# TYPE workerd_tee_buffer_peak_bytes histogram"), text);
+  KJ_EXPECT(hasLine(text, "workerd_tee_buffer_peak_bytes_bucket{le=\"1024\"} 0"), text);
+  KJ_EXPECT(hasLine(text, "workerd_tee_buffer_peak_bytes_bucket{le=\"4096\"} 1"), text);
+  KJ_EXPECT(hasLine(text, "workerd_tee_buffer_peak_bytes_sum 3000"), text);
+  KJ_EXPECT(hasLine(text, "workerd_tee_buffer_peak_bytes_count 1"), text);
+  KJ_EXPECT(hasLine(text, "workerd_object_arena_bytes_bucket{le=\"262144\"} 0"), text);
+  KJ_EXPECT(hasLine(text, "workerd_object_arena_bytes_bucket{le=\"1048576\"} 1"), text);
+  KJ_EXPECT(hasLine(text, "workerd_object_arena_bytes_sum 1048576"), text);
+}
+
+}  // namespace
+}  // namespace workerd::server
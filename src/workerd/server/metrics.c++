@@ -0,0 +1,513 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "metrics.h"
+#include <workerd/io/worker-interface.h>
+#include <atomic>
+#include <thread>
+
+namespace workerd::server {
+
+namespace {
+
+struct MetricInfo {
+  kj::StringPtr name;
+  kj::StringPtr help;
+};
+
+constexpr MetricInfo COUNTER_INFO[] = {
+  { "workerd_requests_total"_kj, "Requests delivered to Workers."_kj },
+  { "workerd_request_failures_total"_kj, "Requests which failed with an exception."_kj },
+  { "workerd_subrequests_total"_kj, "Subrequests made by Workers."_kj },
+  { "workerd_isolates_created_total"_kj, "Isolates created."_kj },
+  { "workerd_actor_requests_total"_kj, "Requests delivered to Durable Objects."_kj },
+  { "workerd_actor_websocket_messages_received_total"_kj,
+    "WebSocket messages received by Durable Objects."_kj },
+  { "workerd_actor_websocket_messages_sent_total"_kj,
+    "WebSocket messages sent by Durable Objects."_kj },
+  { "workerd_actor_websocket_received_bytes_total"_kj,
+    "Bytes of WebSocket messages received by Durable Objects."_kj },
+  { "workerd_actor_websocket_sent_bytes_total"_kj,
+    "Bytes of WebSocket messages sent by Durable Objects."_kj },
+  { "workerd_actor_storage_read_units_total"_kj, "Durable Object storage read units."_kj },
+  { "workerd_actor_storage_write_units_total"_kj, "Durable Object storage write units."_kj },
+  { "workerd_actor_storage_deletes_total"_kj, "Durable Object storage deletes."_kj },
+};
+static_assert(kj::size(COUNTER_INFO) == ServerMetrics::COUNTER_COUNT);
+
+constexpr MetricInfo GAUGE_INFO[] = {
+  { "workerd_requests_in_flight"_kj, "Requests which have started but not yet finished."_kj },
+  { "workerd_isolates"_kj, "Isolates currently alive."_kj },
+  { "workerd_actor_websockets"_kj, "WebSockets currently accepted by Durable Objects."_kj },
+};
+static_assert(kj::size(GAUGE_INFO) == ServerMetrics::GAUGE_COUNT);
+
+constexpr MetricInfo HISTOGRAM_INFO[] = {
+  { "workerd_request_duration_seconds"_kj,
+    "Time from the start of a request until it, including its waitUntil() tasks, finished."_kj },
+  { "workerd_isolate_lock_wait_seconds"_kj, "Time spent waiting to acquire an isolate lock."_kj },
+  { "workerd_isolate_lock_held_seconds"_kj, "Time for which an isolate lock was held."_kj },
+  { "workerd_gc_pause_seconds"_kj, "Duration of each garbage collection pause."_kj },
+  { "workerd_script_parse_seconds"_kj, "Time to compile a Worker's script."_kj },
+  { "workerd_worker_startup_seconds"_kj,
+    "Time to create a Worker's global scope and run its top-level code."_kj },
+};
+static_assert(kj::size(HISTOGRAM_INFO) == ServerMetrics::HISTOGRAM_COUNT);
+
+constexpr MetricInfo SIZE_HISTOGRAM_INFO[] = {
+  { "workerd_tee_buffer_peak_bytes"_kj,
+    "Most bytes each ReadableStream.tee() held buffered for its slower branch."_kj },
+  { "workerd_object_arena_bytes"_kj,
+    "Bytes reserved for the objects a request's IoContext owns, when the request finished."_kj },
+};
+static_assert(kj::size(SIZE_HISTOGRAM_INFO) == ServerMetrics::SIZE_HISTOGRAM_COUNT);
+
+struct Bucket {
+  kj::Duration upperBound;
+  kj::StringPtr label;
+};
+
+// The last bucket is "+Inf", and is not listed.
+constexpr Bucket BUCKETS[] = {
+  { 100 * kj::MICROSECONDS, "0.0001"_kj },
+  { 250 * kj::MICROSECONDS, "0.00025"_kj },
+  { 500 * kj::MICROSECONDS, "0.0005"_kj },
+  { 1 * kj::MILLISECONDS, "0.001"_kj },
+  { 2500 * kj::MICROSECONDS, "0.0025"_kj },
+  { 5 * kj::MILLISECONDS, "0.005"_kj },
+  { 10 * kj::MILLISECONDS, "0.01"_kj },
+  { 25 * kj::MILLISECONDS, "0.025"_kj },
+  { 50 * kj::MILLISECONDS, "0.05"_kj },
+  { 100 * kj::MILLISECONDS, "0.1"_kj },
+  { 250 * kj::MILLISECONDS, "0.25"_kj },
+  { 500 * kj::MILLISECONDS, "0.5"_kj },
+  { 1 * kj::SECONDS, "1"_kj },
+  { 2500 * kj::MILLISECONDS, "2.5"_kj },
+  { 5 * kj::SECONDS, "5"_kj },
+  { 10 * kj::SECONDS, "10"_kj },
+};
+static_assert(kj::size(BUCKETS) + 1 == ServerMetrics::BUCKET_COUNT);
+
+struct SizeBucket {
+  uint64_t upperBound;
+  kj::StringPtr label;
+};
+
+// The last bucket is "+Inf", and is not listed.
+constexpr SizeBucket SIZE_BUCKETS[] = {
+  { uint64_t(1) << 10, "1024"_kj },
+  { uint64_t(1) << 12, "4096"_kj },
+  { uint64_t(1) << 14, "16384"_kj },
+  { uint64_t(1) << 16, "65536"_kj },
+  { uint64_t(1) << 18, "262144"_kj },
+  { uint64_t(1) << 20, "1048576"_kj },
+  { uint64_t(1) << 22, "4194304"_kj },
+  { uint64_t(1) << 24, "16777216"_kj },
+  { uint64_t(1) << 26, "67108864"_kj },
+  { uint64_t(1) << 28, "268435456"_kj },
+  { uint64_t(1) << 30, "1073741824"_kj },
+};
+static_assert(kj::size(SIZE_BUCKETS) + 1 == ServerMetrics::SIZE_BUCKET_COUNT);
+
+// Only the thread owning a shard ever writes to it, so a plain load and store suffices to update
+// a cell; the atomics only ensure that readers on other threads never see a torn value.
+template <typename T>
+inline void addToCell(std::atomic<T>& cell, T amount) {
+  cell.store(cell.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+struct ShardCache {
+  uint64_t ownerId = 0;
+  void* shard = nullptr;
+};
+thread_local ShardCache shardCache;
+
+std::atomic<uint64_t> nextMetricsId { 1 };
+
+kj::TimePoint now() {
+  return kj::systemPreciseMonotonicClock().now();
+}
+
+}  // namespace
+
+struct ServerMetrics::Shard {
+  std::thread::id thread;
+  std::atomic<uint64_t> counters[COUNTER_COUNT] = {};
+  std::atomic<int64_t> gauges[GAUGE_COUNT] = {};
+
+  // `sum` is in nanoseconds for durations and in bytes for sizes.
+  template <uint bucketCount>
+  struct HistogramCells {
+    std::atomic<uint64_t> buckets[bucketCount] = {};
+    std::atomic<uint64_t> count {0};
+    std::atomic<uint64_t> sum {0};
+  };
+  HistogramCells<BUCKET_COUNT> histograms[HISTOGRAM_COUNT];
+  HistogramCells<SIZE_BUCKET_COUNT> sizeHistograms[SIZE_HISTOGRAM_COUNT];
+};
+
+ServerMetrics::ServerMetrics()
+    : id(nextMetricsId.fetch_add(1, std::memory_order_relaxed)) {}
+ServerMetrics::~ServerMetrics() noexcept(false) {}
+
+ServerMetrics::Shard& ServerMetrics::getShard() {
+  if (shardCache.ownerId == id) {
+    return *static_cast<Shard*>(shardCache.shard);
+  }
+
+  // Slow path: first use on this thread, or this thread last recorded into a different
+  // ServerMetrics.
+  auto thread = std::this_thread::get_id();
+  auto lock = shards.lockExclusive();
+  Shard* result = nullptr;
+  for (auto& shard: *lock) {
+    if (shard->thread == thread) {
+      result = shard.get();
+      break;
+    }
+  }
+  if (result == nullptr) {
+    auto shard = kj::heap<Shard>();
+    shard->thread = thread;
+    result = shard.get();
+    lock->add(kj::mv(shard));
+  }
+
+  shardCache = { id, result };
+  return *result;
+}
+
+void ServerMetrics::increment(Counter counter, uint64_t amount) {
+  addToCell(getShard().counters[uint(counter)], amount);
+}
+
+void ServerMetrics::adjust(Gauge gauge, int64_t delta) {
+  addToCell(getShard().gauges[uint(gauge)], delta);
+}
+
+void ServerMetrics::record(Histogram histogram, kj::Duration duration) {
+  auto& cells = getShard().histograms[uint(histogram)];
+
+  uint bucket = 0;
+  while (bucket < kj::size(BUCKETS) && duration > BUCKETS[bucket].upperBound) {
+    ++bucket;
+  }
+
+  addToCell(cells.buckets[bucket], uint64_t(1));
+  addToCell(cells.count, uint64_t(1));
+  addToCell(cells.sum, uint64_t(kj::max(duration, 0 * kj::NANOSECONDS) / kj::NANOSECONDS));
+}
+
+void ServerMetrics::record(SizeHistogram histogram, uint64_t bytes) {
+  auto& cells = getShard().sizeHistograms[uint(histogram)];
+
+  uint bucket = 0;
+  while (bucket < kj::size(SIZE_BUCKETS) && bytes > SIZE_BUCKETS[bucket].upperBound) {
+    ++bucket;
+  }
+
+  addToCell(cells.buckets[bucket], uint64_t(1));
+  addToCell(cells.count, uint64_t(1));
+  addToCell(cells.sum, bytes);
+}
+
+kj::String ServerMetrics::renderPrometheus() const {
+  uint64_t counters[COUNTER_COUNT] = {};
+  int64_t gauges[GAUGE_COUNT] = {};
+  uint64_t buckets[HISTOGRAM_COUNT][BUCKET_COUNT] = {};
+  uint64_t counts[HISTOGRAM_COUNT] = {};
+  uint64_t sumsNs[HISTOGRAM_COUNT] = {};
+  uint64_t sizeBuckets[SIZE_HISTOGRAM_COUNT][SIZE_BUCKET_COUNT] = {};
+  uint64_t sizeCounts[SIZE_HISTOGRAM_COUNT] = {};
+  uint64_t sizeSums[SIZE_HISTOGRAM_COUNT] = {};
+
+  {
+    auto lock = shards.lockShared();
+    for (auto& shard: *lock) {
+      for (auto i: kj::zeroTo(COUNTER_COUNT)) {
+        counters[i] += shard->counters[i].load(std::memory_order_relaxed);
+      }
+      for (auto i: kj::zeroTo(GAUGE_COUNT)) {
+        gauges[i] += shard->gauges[i].load(std::memory_order_relaxed);
+      }
+      for (auto i: kj::zeroTo(HISTOGRAM_COUNT)) {
+        auto& cells = shard->histograms[i];
+        for (auto j: kj::zeroTo(BUCKET_COUNT)) {
+          buckets[i][j] += cells.buckets[j].load(std::memory_order_relaxed);
+        }
+        counts[i] += cells.count.load(std::memory_order_relaxed);
+        sumsNs[i] += cells.sum.load(std::memory_order_relaxed);
+      }
+      for (auto i: kj::zeroTo(SIZE_HISTOGRAM_COUNT)) {
+        auto& cells = shard->sizeHistograms[i];
+        for (auto j: kj::zeroTo(SIZE_BUCKET_COUNT)) {
+          sizeBuckets[i][j] += cells.buckets[j].load(std::memory_order_relaxed);
+        }
+        sizeCounts[i] += cells.count.load(std::memory_order_relaxed);
+        sizeSums[i] += cells.sum.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  kj::Vector<kj::String> lines;
+  auto header = [&](const MetricInfo& info, kj::StringPtr type) {
+    lines.add(kj::str("# HELP ", info.name, ' ', info.help));
+    lines.add(kj::str("# TYPE ", info.name, ' ', type));
+  };
+
+  for (auto i: kj::zeroTo(COUNTER_COUNT)) {
+    header(COUNTER_INFO[i], "counter"_kj);
+    lines.add(kj::str(COUNTER_INFO[i].name, ' ', counters[i]));
+  }
+
+  for (auto i: kj::zeroTo(GAUGE_COUNT)) {
+    header(GAUGE_INFO[i], "gauge"_kj);
+    lines.add(kj::str(GAUGE_INFO[i].name, ' ', gauges[i]));
+  }
+
+  for (auto i: kj::zeroTo(HISTOGRAM_COUNT)) {
+    auto name = HISTOGRAM_INFO[i].name;
+    header(HISTOGRAM_INFO[i], "histogram"_kj);
+
+    // Prometheus buckets are cumulative.
+    uint64_t cumulative = 0;
+    for (auto j: kj::zeroTo(BUCKET_COUNT)) {
+      cumulative += buckets[i][j];
+      auto label = j < kj::size(BUCKETS) ? BUCKETS[j].label : "+Inf"_kj;
+      lines.add(kj::str(name, "_bucket{le=\"", label, "\"} ", cumulative));
+    }
+    lines.add(kj::str(name, "_sum ", double(sumsNs[i]) / 1e9));
+    lines.add(kj::str(name, "_count ", counts[i]));
+  }
+
+  for (auto i: kj::zeroTo(SIZE_HISTOGRAM_COUNT)) {
+    auto name = SIZE_HISTOGRAM_INFO[i].name;
+    header(SIZE_HISTOGRAM_INFO[i], "histogram"_kj);
+
+    uint64_t cumulative = 0;
+    for (auto j: kj::zeroTo(SIZE_BUCKET_COUNT)) {
+      cumulative += sizeBuckets[i][j];
+      auto label = j < kj::size(SIZE_BUCKETS) ? SIZE_BUCKETS[j].label : "+Inf"_kj;
+      lines.add(kj::str(name, "_bucket{le=\"", label, "\"} ", cumulative));
+    }
+    lines.add(kj::str(name, "_sum ", sizeSums[i]));
+    lines.add(kj::str(name, "_count ", sizeCounts[i]));
+  }
+
+  lines.add(nullptr);
+  return kj::strArray(lines, "\n");
+}
+
+// =======================================================================================
+// Observers
+
+namespace {
+
+class MetricsRequestObserver final: public RequestObserver {
+public:
+  explicit MetricsRequestObserver(ServerMetrics& metrics)
+      : metrics(metrics), startTime(now()) {
+    metrics.adjust(ServerMetrics::Gauge::REQUESTS_IN_FLIGHT, 1);
+  }
+  ~MetricsRequestObserver() noexcept(false) {
+    metrics.adjust(ServerMetrics::Gauge::REQUESTS_IN_FLIGHT, -1);
+    if (wasDelivered) {
+      metrics.record(ServerMetrics::Histogram::REQUEST_DURATION, now() - startTime);
+    }
+  }
+
+  void delivered() override {
+    wasDelivered = true;
+    metrics.increment(ServerMetrics::Counter::REQUESTS);
+  }
+
+  void reportFailure(const kj::Exception& e) override {
+    metrics.increment(ServerMetrics::Counter::REQUEST_FAILURES);
+  }
+
+  kj::Own<WorkerInterface> wrapSubrequestClient(kj::Own<WorkerInterface> client) override {
+    metrics.increment(ServerMetrics::Counter::SUBREQUESTS);
+    return kj::mv(client);
+  }
+
+  kj::Own<WorkerInterface> wrapActorSubrequestClient(kj::Own<WorkerInterface> client) override {
+    metrics.increment(ServerMetrics::Counter::SUBREQUESTS);
+    return kj::mv(client);
+  }
+
+  void reportTeeBufferPeak(uint64_t bytes) override {
+    metrics.record(ServerMetrics::SizeHistogram::TEE_BUFFER_PEAK, bytes);
+  }
+
+  void reportObjectArenaSize(uint64_t bytes) override {
+    metrics.record(ServerMetrics::SizeHistogram::OBJECT_ARENA_SIZE, bytes);
+  }
+
+private:
+  ServerMetrics& metrics;
+  kj::TimePoint startTime;
+  bool wasDelivered = false;
+};
+
+class MetricsLockTiming final: public IsolateObserver::LockTiming {
+public:
+  explicit MetricsLockTiming(ServerMetrics& metrics): metrics(metrics) {}
+
+  void start() override {
+    startTime = now();
+  }
+
+  void stop() override {
+    KJ_IF_SOME(t, lockedTime) {
+      metrics.record(ServerMetrics::Histogram::ISOLATE_LOCK_HELD, now() - t);
+    }
+  }
+
+  void locked() override {
+    auto time = now();
+    KJ_IF_SOME(t, startTime) {
+      metrics.record(ServerMetrics::Histogram::ISOLATE_LOCK_WAIT, time - t);
+    }
+    lockedTime = time;
+  }
+
+  void gcPrologue() override {
+    // V8 may nest collections (e.g. a scavenge within a full GC); time only the outermost.
+    if (gcDepth++ == 0) {
+      gcStartTime = now();
+    }
+  }
+
+  void gcEpilogue() override {
+    if (gcDepth > 0 && --gcDepth == 0) {
+      metrics.record(ServerMetrics::Histogram::GC_PAUSE, now() - gcStartTime);
+    }
+  }
+
+private:
+  ServerMetrics& metrics;
+  kj::Maybe<kj::TimePoint> startTime;
+  kj::Maybe<kj::TimePoint> lockedTime;
+  kj::TimePoint gcStartTime = kj::origin<kj::TimePoint>();
+  uint gcDepth = 0;
+};
+
+// Records the time from its construction until done() into a histogram. Not recorded if the
+// operation fails, i.e. done() is never called.
+template <typename Base>
+class MetricsTiming final: public Base {
+public:
+  MetricsTiming(ServerMetrics& metrics, ServerMetrics::Histogram histogram)
+      : metrics(metrics), histogram(histogram), startTime(now()) {}
+
+  void done() override {
+    metrics.record(histogram, now() - startTime);
+  }
+
+private:
+  ServerMetrics& metrics;
+  ServerMetrics::Histogram histogram;
+  kj::TimePoint startTime;
+};
+
+class MetricsIsolateObserver final: public IsolateObserver {
+public:
+  explicit MetricsIsolateObserver(ServerMetrics& metrics): metrics(metrics) {}
+  ~MetricsIsolateObserver() noexcept(false) {
+    if (wasCreated) {
+      metrics.adjust(ServerMetrics::Gauge::ISOLATES, -1);
+    }
+  }
+
+  void created() override {
+    wasCreated = true;
+    metrics.increment(ServerMetrics::Counter::ISOLATES_CREATED);
+    metrics.adjust(ServerMetrics::Gauge::ISOLATES, 1);
+  }
+
+  kj::Maybe<kj::Own<LockTiming>> tryCreateLockTiming(
+      kj::OneOf<SpanParent, kj::Maybe<RequestObserver&>> parentOrRequest) const override {
+    return kj::Own<LockTiming>(kj::heap<MetricsLockTiming>(metrics));
+  }
+
+  kj::Own<Parse> parse(StartType startType) const override {
+    return kj::heap<MetricsTiming<Parse>>(metrics, ServerMetrics::Histogram::SCRIPT_PARSE);
+  }
+
+private:
+  ServerMetrics& metrics;
+  bool wasCreated = false;
+};
+
+class MetricsWorkerObserver final: public WorkerObserver {
+public:
+  explicit MetricsWorkerObserver(ServerMetrics& metrics): metrics(metrics) {}
+
+  kj::Own<Startup> startup(IsolateObserver::StartType startType) const override {
+    return kj::heap<MetricsTiming<Startup>>(metrics, ServerMetrics::Histogram::WORKER_STARTUP);
+  }
+
+private:
+  ServerMetrics& metrics;
+};
+
+class MetricsActorObserver final: public ActorObserver {
+public:
+  explicit MetricsActorObserver(ServerMetrics& metrics): metrics(metrics) {}
+
+  void startRequest() override {
+    metrics.increment(ServerMetrics::Counter::ACTOR_REQUESTS);
+  }
+
+  void webSocketAccepted() override {
+    metrics.adjust(ServerMetrics::Gauge::ACTOR_WEBSOCKETS, 1);
+  }
+  void webSocketClosed() override {
+    metrics.adjust(ServerMetrics::Gauge::ACTOR_WEBSOCKETS, -1);
+  }
+  void receivedWebSocketMessage(size_t bytes) override {
+    metrics.increment(ServerMetrics::Counter::ACTOR_WEBSOCKET_MESSAGES_RECEIVED);
+    metrics.increment(ServerMetrics::Counter::ACTOR_WEBSOCKET_BYTES_RECEIVED, bytes);
+  }
+  void sentWebSocketMessage(size_t bytes) override {
+    metrics.increment(ServerMetrics::Counter::ACTOR_WEBSOCKET_MESSAGES_SENT);
+    metrics.increment(ServerMetrics::Counter::ACTOR_WEBSOCKET_BYTES_SENT, bytes);
+  }
+
+  void addCachedStorageReadUnits(uint32_t units) override {
+    metrics.increment(ServerMetrics::Counter::ACTOR_STORAGE_READ_UNITS, units);
+  }
+  void addUncachedStorageReadUnits(uint32_t units) override {
+    metrics.increment(ServerMetrics::Counter::ACTOR_STORAGE_READ_UNITS, units);
+  }
+  void addStorageWriteUnits(uint32_t units) override {
+    metrics.increment(ServerMetrics::Counter::ACTOR_STORAGE_WRITE_UNITS, units);
+  }
+  void addStorageDeletes(uint32_t count) override {
+    metrics.increment(ServerMetrics::Counter::ACTOR_STORAGE_DELETES, count);
+  }
+
+private:
+  ServerMetrics& metrics;
+};
+
+}  // namespace
+
+kj::Own<RequestObserver> ServerMetrics::makeRequestObserver() {
+  return kj::refcounted<MetricsRequestObserver>(*this);
+}
+
+kj::Own<IsolateObserver> ServerMetrics::makeIsolateObserver() {
+  return kj::atomicRefcounted<MetricsIsolateObserver>(*this);
+}
+
+kj::Own<WorkerObserver> ServerMetrics::makeWorkerObserver() {
+  return kj::atomicRefcounted<MetricsWorkerObserver>(*this);
+}
+
+kj::Own<ActorObserver> ServerMetrics::makeActorObserver() {
+  return kj::refcounted<MetricsActorObserver>(*this);
+}
+
+}  // namespace workerd::server
@@ -0,0 +1,101 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+// Concrete implementations of the observer interfaces from io/observer.h which collect
+// process-wide metrics, plus rendering of those metrics in the Prometheus text format.
+
+#include <workerd/io/observer.h>
+#include <kj/mutex.h>
+#include <kj/vector.h>
+
+namespace workerd::server {
+
+// Counters, gauges and histograms collected by the observers returned from the make*Observer()
+// methods.
+//
+// Recording is designed to be cheap enough to leave on in production: each thread which records
+// a metric gets its own shard of cells which no other thread writes, so recording a value is a
+// relaxed atomic load and store, with no locks and no contended cache lines. Rendering sums the
+// shards of all threads.
+class ServerMetrics {
+public:
+  enum class Counter: uint {
+    REQUESTS,
+    REQUEST_FAILURES,
+    SUBREQUESTS,
+    ISOLATES_CREATED,
+    ACTOR_REQUESTS,
+    ACTOR_WEBSOCKET_MESSAGES_RECEIVED,
+    ACTOR_WEBSOCKET_MESSAGES_SENT,
+    ACTOR_WEBSOCKET_BYTES_RECEIVED,
+    ACTOR_WEBSOCKET_BYTES_SENT,
+    ACTOR_STORAGE_READ_UNITS,
+    ACTOR_STORAGE_WRITE_UNITS,
+    ACTOR_STORAGE_DELETES,
+  };
+  static constexpr uint COUNTER_COUNT = uint(Counter::ACTOR_STORAGE_DELETES) + 1;
+
+  enum class Gauge: uint {
+    REQUESTS_IN_FLIGHT,
+    ISOLATES,
+    ACTOR_WEBSOCKETS,
+  };
+  static constexpr uint GAUGE_COUNT = uint(Gauge::ACTOR_WEBSOCKETS) + 1;
+
+  enum class Histogram: uint {
+    REQUEST_DURATION,
+    ISOLATE_LOCK_WAIT,
+    ISOLATE_LOCK_HELD,
+    GC_PAUSE,
+    SCRIPT_PARSE,
+    WORKER_STARTUP,
+  };
+  static constexpr uint HISTOGRAM_COUNT = uint(Histogram::WORKER_STARTUP) + 1;
+
+  // Histogram buckets are fixed, spanning 100us to 10s.
+  static constexpr uint BUCKET_COUNT = 17;
+
+  // Histograms of sizes in bytes.
+  enum class SizeHistogram: uint {
+    TEE_BUFFER_PEAK,
+    OBJECT_ARENA_SIZE,
+  };
+  static constexpr uint SIZE_HISTOGRAM_COUNT = uint(SizeHistogram::OBJECT_ARENA_SIZE) + 1;
+
+  // Size histogram buckets are fixed, at powers of four from 1KiB to 1GiB.
+  static constexpr uint SIZE_BUCKET_COUNT = 12;
+
+  ServerMetrics();
+  ~ServerMetrics() noexcept(false);
+  KJ_DISALLOW_COPY_AND_MOVE(ServerMetrics);
+
+  void increment(Counter counter, uint64_t amount = 1);
+  void adjust(Gauge gauge, int64_t delta);
+  void record(Histogram histogram, kj::Duration duration);
+  void record(SizeHistogram histogram, uint64_t bytes);
+
+  // Renders the current value of every metric in the Prometheus text exposition format, version
+  // 0.0.4.
+  kj::String renderPrometheus() const;
+
+  // Observers which report into this object. The ServerMetrics must outlive them.
+  kj::Own<RequestObserver> makeRequestObserver();
+  kj::Own<IsolateObserver> makeIsolateObserver();
+  kj::Own<WorkerObserver> makeWorkerObserver();
+  kj::Own<ActorObserver> makeActorObserver();
+
+private:
+  struct Shard;
+
+  // Distinguishes this object from other ServerMetrics in the thread-local shard cache, in case a
+  // new one is allocated at the address of a destroyed one.
+  const uint64_t id;
+
+  kj::MutexGuarded<kj::Vector<kj::Own<Shard>>> shards;
+
+  Shard& getShard();
+};
+
+}  // namespace workerd::server
@@ -209,11 +209,7 @@ public:
         cwd(root->openSubdir(pwd, kj::WriteMode::CREATE | kj::WriteMode::CREATE_PARENT)),
         timer(kj::origin<kj::TimePoint>()),
         server(*this, timer, mockNetwork, *this, [this](kj::String error) {
-          if (expectedErrors.startsWith(error) && expectedErrors[error.size()] == '\n') {
-            expectedErrors = expectedErrors.slice(error.size() + 1);
-          } else {
-            KJ_FAIL_EXPECT(error, expectedErrors);
-          }
+          checkError(kj::mv(error));
         }),
         fakeDate(kj::UNIX_EPOCH),
         mockNetwork(*this, {}, {}) {}
@@ -228,6 +224,9 @@ public:
       KJ_IF_MAYBE(t, runTask) {
         t->poll(ws);
       }
+      KJ_IF_MAYBE(t, successorTask) {
+        t->poll(ws);
+      }
     }
   }
 
@@ -250,6 +249,28 @@ public:
     KJ_EXPECT(expectedErrors == nullptr, "some expected errors weren't seen");
   }
 
+  // Builds a second Server from `configText` which takes over from `server`, as reloading the
+  // config does, and runs it. Call after start(). `expected` lists the config errors the new
+  // config should produce, one per line, in which case the new Server shouldn't take over.
+  void reload(kj::StringPtr configText, kj::StringPtr expected = nullptr,
+              kj::SourceLocation loc = {}) {
+    KJ_REQUIRE(successor.get() == nullptr);
+    successorConfig = parseConfig(configText, loc);
+    successor = kj::heap<Server>(*this, timer, mockNetwork, *this, [this](kj::String error) {
+      checkError(kj::mv(error));
+    });
+    successor->takeOverFrom(server);
+
+    expectedErrors = expected;
+    auto task = successor->run(v8System, *successorConfig)
+        .eagerlyEvaluate([](kj::Exception&& e) {
+      KJ_FAIL_EXPECT(e);
+    });
+    task.poll(ws);
+    KJ_EXPECT_AT(expectedErrors == nullptr, loc, "some expected errors weren't seen");
+    successorTask = kj::mv(task);
+  }
+
   // Connect to the server on the given address. The string just has to match what is in the
   // config; the actual connection is in-memory with no network involved.
   TestStream connect(kj::StringPtr addr) {
@@ -294,11 +315,24 @@ public:
   kj::Maybe<kj::Promise<void>> runTask;
   kj::StringPtr expectedErrors;
 
+  // Set by reload().
+  kj::Own<config::Config::Reader> successorConfig;
+  kj::Own<Server> successor;
+  kj::Maybe<kj::Promise<void>> successorTask;
+
   kj::Date fakeDate;
 
 private:
   kj::UnwindDetector unwindDetector;
 
+  void checkError(kj::String error) {
+    if (expectedErrors.startsWith(error) && expectedErrors[error.size()] == '\n') {
+      expectedErrors = expectedErrors.slice(error.size() + 1);
+    } else {
+      KJ_FAIL_EXPECT(error, expectedErrors);
+    }
+  }
+
   // ---------------------------------------------------------------------------
   // implements Filesytem
 
@@ -1807,6 +1841,139 @@ KJ_TEST("Server: inject headers on incoming request/response") {
   )"_blockquote);
 }
 
+kj::String webSocketWorker(kj::StringPtr httpOptions) {
+  return kj::str(R"((
+    services = [
+      ( name = "hello",
+        worker = (
+          compatibilityDate = "2022-08-17",
+          compatibilityFlags = ["web_socket_compression"],
+          modules = [
+            ( name = "main.js",
+              esModule =
+                `export default {
+                `  async fetch(request) {
+                `    let pair = new WebSocketPair();
+                `    pair[1].accept();
+                `    return new Response(null, {status: 101, webSocket: pair[0]});
+                `  }
+                `}
+            )
+          ]
+        )
+      )
+    ],
+    sockets = [
+      ( name = "main",
+        address = "test-addr",
+        service = "hello",
+        http = )"_kj, httpOptions, R"(
+      )
+    ]
+  ))"_kj);
+}
+
+void sendWebSocketUpgrade(TestStream& conn) {
+  conn.send(R"(
+    GET / HTTP/1.1
+    Host: foo
+    Upgrade: websocket
+    Connection: Upgrade
+    Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==
+    Sec-WebSocket-Version: 13
+    Sec-WebSocket-Extensions: permessage-deflate; client_max_window_bits
+
+  )"_blockquote);
+}
+
+KJ_TEST("Server: WebSocket compression options on incoming connections") {
+  TestServer test(webSocketWorker(R"((
+    webSocketCompression = (
+      serverNoContextTakeover = true,
+      serverMaxWindowBits = 10,
+      clientMaxWindowBits = 12
+    )
+  ))"_kj));
+
+  test.start();
+  auto conn = test.connect("test-addr");
+  sendWebSocketUpgrade(conn);
+  conn.recvRegex(
+      "HTTP/1\\.1 101 [^\\n]*\\n[\\s\\S]*"
+      "Sec-WebSocket-Extensions: permessage-deflate; server_no_context_takeover; "
+      "server_max_window_bits=10; client_max_window_bits=12\\n[\\s\\S]*");
+}
+
+KJ_TEST("Server: WebSocket compression can be disabled on incoming connections") {
+  TestServer test(webSocketWorker(R"((
+    webSocketCompression = (enabled = false)
+  ))"_kj));
+
+  test.start();
+  auto conn = test.connect("test-addr");
+  sendWebSocketUpgrade(conn);
+  conn.recvRegex(
+      "HTTP/1\\.1 101 [^\\n]*\\n(?![\\s\\S]*Sec-WebSocket-Extensions)[\\s\\S]*");
+}
+
+KJ_TEST("Server: WebSocket compression options on outgoing connections") {
+  TestServer test(R"((
+    services = [
+      ( name = "hello",
+        worker = (
+          compatibilityDate = "2022-08-17",
+          compatibilityFlags = ["web_socket_compression"],
+          modules = [
+            ( name = "main.js",
+              esModule =
+                `export default {
+                `  async fetch(request, env) {
+                `    return env.ext.fetch("http://ext/ws", {headers: {
+                `      "Upgrade": "websocket",
+                `      "Sec-WebSocket-Extensions": "permessage-deflate; client_max_window_bits",
+                `    }});
+                `  }
+                `}
+            )
+          ],
+          bindings = [(name = "ext", service = "ext")]
+        )
+      ),
+      ( name = "ext",
+        external = (
+          address = "ext-addr",
+          http = (
+            webSocketCompression = (
+              clientNoContextTakeover = true,
+              clientMaxWindowBits = 10
+            )
+          )
+        )
+      )
+    ],
+    sockets = [
+      (name = "main", address = "test-addr", service = "hello")
+    ]
+  ))"_kj);
+
+  test.start();
+  auto conn = test.connect("test-addr");
+  conn.sendHttpGet("/");
+
+  // The Worker's offer is rewritten on its way to the external server.
+  auto subreq = test.receiveSubrequest("ext-addr");
+  subreq.recvRegex(
+      "GET /ws HTTP/1\\.1\\n[\\s\\S]*"
+      "Sec-WebSocket-Extensions: permessage-deflate; client_no_context_takeover; "
+      "client_max_window_bits=10\\n[\\s\\S]*");
+  subreq.send(R"(
+    HTTP/1.1 404 Not Found
+    Content-Length: 0
+
+  )"_blockquote);
+  conn.recvRegex("HTTP/1\\.1 404 Not Found\\n[\\s\\S]*");
+}
+
 KJ_TEST("Server: drain incoming HTTP connections") {
   TestServer test(singleWorker(R"((
     compatibilityDate = "2022-08-17",
@@ -1865,6 +2032,82 @@ KJ_TEST("Server: drain incoming HTTP connections") {
 // We're going to stop using JavaScript here because it's not really helping. We can directly
 // connect a socket to a non-Worker service.
 
+KJ_TEST("Server: admission control turns away requests over the limit") {
+  TestServer test(R"((
+    services = [
+      (name = "hello", external = "ext-addr")
+    ],
+    sockets = [
+      ( name = "main",
+        address = "test-addr",
+        service = "hello",
+        admission = (
+          maxConcurrentRequests = 1,
+          maxQueuedRequests = 1,
+          queueTimeoutMs = 1000,
+          retryAfterSeconds = 5
+        )
+      )
+    ]
+  ))"_kj);
+
+  test.start();
+
+  auto conn1 = test.connect("test-addr");
+  auto conn2 = test.connect("test-addr");
+  auto conn3 = test.connect("test-addr");
+
+  conn1.sendHttpGet("/one");
+  auto subreq = test.receiveSubrequest("ext-addr");
+  subreq.recv(R"(
+    GET /one HTTP/1.1
+    Host: foo
+
+  )"_blockquote);
+
+  // The second request waits in the queue, so the third is turned away straight away.
+  conn2.sendHttpGet("/two");
+  conn3.sendHttpGet("/three");
+  conn3.recv(R"(
+    HTTP/1.1 503 Service Unavailable
+    Content-Length: 19
+    Retry-After: 5
+
+    Service Unavailable)"_blockquote);
+
+  // The second request gives up once it has waited too long.
+  test.timer.advanceTo(test.timer.now() + 1 * kj::SECONDS);
+  conn2.recv(R"(
+    HTTP/1.1 503 Service Unavailable
+    Content-Length: 19
+    Retry-After: 5
+
+    Service Unavailable)"_blockquote);
+
+  subreq.send(R"(
+    HTTP/1.1 200 OK
+    Content-Length: 3
+    Content-Type: text/plain;charset=UTF-8
+
+    one)"_blockquote);
+  conn1.recvHttp200("one");
+
+  // Now there's room again.
+  conn3.sendHttpGet("/four");
+  subreq.recv(R"(
+    GET /four HTTP/1.1
+    Host: foo
+
+  )"_blockquote);
+  subreq.send(R"(
+    HTTP/1.1 200 OK
+    Content-Length: 4
+    Content-Type: text/plain;charset=UTF-8
+
+    four)"_blockquote);
+  conn3.recvHttp200("four");
+}
+
 KJ_TEST("Server: network outbound with allow/deny") {
   TestServer test(R"((
     services = [
@@ -1933,6 +2176,337 @@ KJ_TEST("Server: external server") {
   conn.recvHttp200("OK");
 }
 
+KJ_TEST("Server: external server balances across addresses") {
+  TestServer test(R"((
+    services = [
+      (name = "hello", external = (address = "ext-a", addresses = ["ext-b"], http = ()))
+    ],
+    sockets = [
+      (name = "main", address = "test-addr", service = "hello")
+    ]
+  ))"_kj);
+
+  test.start();
+
+  auto conn1 = test.connect("test-addr");
+  auto conn2 = test.connect("test-addr");
+
+  // While the first request is outstanding at ext-a, the second goes to ext-b.
+  conn1.sendHttpGet("/one");
+  auto subreqA = test.receiveSubrequest("ext-a");
+  subreqA.recv(R"(
+    GET /one HTTP/1.1
+    Host: foo
+
+  )"_blockquote);
+
+  conn2.sendHttpGet("/two");
+  auto subreqB = test.receiveSubrequest("ext-b");
+  subreqB.recv(R"(
+    GET /two HTTP/1.1
+    Host: foo
+
+  )"_blockquote);
+
+  subreqB.send(R"(
+    HTTP/1.1 200 OK
+    Content-Length: 3
+    Content-Type: text/plain;charset=UTF-8
+
+    two)"_blockquote);
+  conn2.recvHttp200("two");
+
+  subreqA.send(R"(
+    HTTP/1.1 200 OK
+    Content-Length: 3
+    Content-Type: text/plain;charset=UTF-8
+
+    one)"_blockquote);
+  conn1.recvHttp200("one");
+}
+
+KJ_TEST("Server: external server skips failing addresses") {
+  TestServer test(R"((
+    services = [
+      ( name = "hello",
+        external = (
+          address = "ext-a",
+          addresses = ["ext-b"],
+          http = (),
+          pool = (ejectAfterFailures = 1)
+        )
+      )
+    ],
+    sockets = [
+      (name = "main", address = "test-addr", service = "hello")
+    ]
+  ))"_kj);
+
+  test.start();
+
+  auto conn = test.connect("test-addr");
+
+  // ext-a fails a request, which is still passed back to the client.
+  conn.sendHttpGet("/one");
+  {
+    auto subreq = test.receiveSubrequest("ext-a");
+    subreq.recv(R"(
+      GET /one HTTP/1.1
+      Host: foo
+
+    )"_blockquote);
+    subreq.send(R"(
+      HTTP/1.1 503 Service Unavailable
+      Content-Length: 4
+      Content-Type: text/plain;charset=UTF-8
+
+      down)"_blockquote);
+  }
+  conn.recv(R"(
+    HTTP/1.1 503 Service Unavailable
+    Content-Length: 4
+    Content-Type: text/plain;charset=UTF-8
+
+    down)"_blockquote);
+
+  // From then on, requests go to ext-b, even when it would be ext-a's turn.
+  conn.sendHttpGet("/two");
+  auto subreqB = test.receiveSubrequest("ext-b");
+  subreqB.recv(R"(
+    GET /two HTTP/1.1
+    Host: foo
+
+  )"_blockquote);
+  subreqB.send(R"(
+    HTTP/1.1 200 OK
+    Content-Length: 2
+    Content-Type: text/plain;charset=UTF-8
+
+    OK)"_blockquote);
+  conn.recvHttp200("OK");
+
+  // (The connection to ext-b is reused.)
+  conn.sendHttpGet("/three");
+  subreqB.recv(R"(
+    GET /three HTTP/1.1
+    Host: foo
+
+  )"_blockquote);
+  subreqB.send(R"(
+    HTTP/1.1 200 OK
+    Content-Length: 2
+    Content-Type: text/plain;charset=UTF-8
+
+    OK)"_blockquote);
+  conn.recvHttp200("OK");
+}
+
+KJ_TEST("Server: --external-addr replaces all configured addresses") {
+  TestServer test(R"((
+    services = [
+      (name = "hello", external = (address = "ext-a", addresses = ["ext-b"], http = ()))
+    ],
+    sockets = [
+      (name = "main", address = "test-addr", service = "hello")
+    ]
+  ))"_kj);
+
+  test.server.overrideExternal(kj::str("hello"), kj::str("ext-override"));
+  test.start();
+
+  auto conn1 = test.connect("test-addr");
+  auto conn2 = test.connect("test-addr");
+
+  // Even with a request outstanding, the next one doesn't go to a configured address.
+  conn1.sendHttpGet("/one");
+  auto subreq1 = test.receiveSubrequest("ext-override");
+  subreq1.recv(R"(
+    GET /one HTTP/1.1
+    Host: foo
+
+  )"_blockquote);
+
+  conn2.sendHttpGet("/two");
+  auto subreq2 = test.receiveSubrequest("ext-override");
+  subreq2.recv(R"(
+    GET /two HTTP/1.1
+    Host: foo
+
+  )"_blockquote);
+
+  subreq2.send(R"(
+    HTTP/1.1 200 OK
+    Content-Length: 3
+    Content-Type: text/plain;charset=UTF-8
+
+    two)"_blockquote);
+  conn2.recvHttp200("two");
+
+  subreq1.send(R"(
+    HTTP/1.1 200 OK
+    Content-Length: 3
+    Content-Type: text/plain;charset=UTF-8
+
+    one)"_blockquote);
+  conn1.recvHttp200("one");
+}
+
+KJ_TEST("Server: reload hands over sockets without dropping connections") {
+  TestServer test(R"((
+    services = [
+      (name = "hello", external = (address = "backend", http = ()))
+    ],
+    sockets = [
+      (name = "main", address = "test-addr", service = "hello")
+    ]
+  ))"_kj);
+
+  test.start();
+
+  // A request is in progress at the old server when the config is reloaded.
+  auto conn1 = test.connect("test-addr");
+  conn1.sendHttpGet("/old");
+  auto subreq = test.receiveSubrequest("backend");
+  subreq.recv(R"(
+    GET /old HTTP/1.1
+    Host: foo
+
+  )"_blockquote);
+
+  test.reload(R"((
+    services = [
+      ( name = "hello",
+        worker = (
+          compatibilityDate = "2022-08-17",
+          serviceWorkerScript =
+              `addEventListener("fetch", event => {
+              `  event.respondWith(new Response("new"));
+              `})
+        )
+      )
+    ],
+    sockets = [
+      (name = "main", address = "test-addr", service = "hello")
+    ]
+  ))"_kj);
+  KJ_EXPECT(test.server.wasReplaced());
+
+  // The old server finishes the request it had started.
+  subreq.send(R"(
+    HTTP/1.1 200 OK
+    Content-Length: 3
+    Content-Type: text/plain;charset=UTF-8
+
+    old)"_blockquote);
+  conn1.recvHttp200("old");
+
+  // New connections reach the new server through the same socket. (The mock network would have
+  // refused to listen on "test-addr" a second time, had it not been handed over.)
+  auto conn2 = test.connect("test-addr");
+  conn2.httpGet200("/", "new");
+}
+
+KJ_TEST("Server: reload with config errors leaves the old server serving") {
+  TestServer test(singleWorker(R"((
+    compatibilityDate = "2022-08-17",
+    serviceWorkerScript =
+        `addEventListener("fetch", event => {
+        `  event.respondWith(new Response("old"));
+        `})
+  ))"_kj));
+
+  test.start();
+  auto conn1 = test.connect("test-addr");
+  conn1.httpGet200("/", "old");
+
+  test.reload(R"((
+    services = [
+      (name = "hello", external = (http = ()))
+    ],
+    sockets = [
+      (name = "main", address = "test-addr", service = "hello")
+    ]
+  ))"_kj,
+      "External service \"hello\" has no address in the config, so must be specified on the "
+      "command line with `--external-addr`.\n"_kj);
+  KJ_EXPECT(!test.server.wasReplaced());
+
+  // Both existing and new connections are still served by the old server.
+  conn1.httpGet200("/", "old");
+  auto conn2 = test.connect("test-addr");
+  conn2.httpGet200("/", "old");
+}
+
+KJ_TEST("Server: reload moves Durable Objects and shares their storage") {
+  kj::StringPtr config = R"((
+    services = [
+      ( name = "hello",
+        worker = (
+          compatibilityDate = "2022-08-17",
+          modules = [
+            ( name = "main.js",
+              esModule =
+                `export default {
+                `  async fetch(request, env) {
+                `    return await env.ns.get(env.ns.idFromName("counter")).fetch(request)
+                `  }
+                `}
+                `export class MyActorClass {
+                `  constructor(state, env) {
+                `    this.storage = state.storage;
+                `  }
+                `  async fetch(request) {
+                `    let count = (await this.storage.get("foo")) || 0;
+                `    this.storage.put("foo", count + 1);
+                `    return new Response(count.toString());
+                `  }
+                `}
+            )
+          ],
+          bindings = [(name = "ns", durableObjectNamespace = "MyActorClass")],
+          durableObjectNamespaces = [
+            ( className = "MyActorClass",
+              uniqueKey = "mykey",
+            )
+          ],
+          durableObjectStorage = (localDisk = "my-disk")
+        )
+      ),
+      ( name = "my-disk",
+        disk = (
+          path = "../../var/do-storage",
+          writable = true,
+        )
+      ),
+    ],
+    sockets = [
+      ( name = "main",
+        address = "test-addr",
+        service = "hello"
+      )
+    ]
+  ))"_kj;
+
+  TestServer test(config);
+  test.root->openSubdir(kj::Path({"var"_kj, "do-storage"_kj}),
+      kj::WriteMode::CREATE | kj::WriteMode::CREATE_PARENT);
+
+  test.start();
+  auto conn1 = test.connect("test-addr");
+  conn1.httpGet200("/", "0");
+  conn1.httpGet200("/", "1");
+
+  // The old server's actor still has its database open when the new server opens the same one.
+  // The in-memory test filesystem isn't a disk directory, so SQLite's own locks don't apply, and
+  // the two only coordinate their locks because they share a lock manager.
+  test.reload(config);
+  KJ_EXPECT(test.server.wasReplaced());
+
+  auto conn2 = test.connect("test-addr");
+  conn2.httpGet200("/", "2");
+  conn2.httpGet200("/", "3");
+}
+
 KJ_TEST("Server: external server proxy style") {
   TestServer test(R"((
     services = [
@@ -2604,6 +3178,202 @@ KJ_TEST("Server: disk service allow dotfiles") {
 // =======================================================================================
 // Test Cache API
 
+KJ_TEST("Server: metrics service") {
+  TestServer test(R"((
+    services = [
+      ( name = "hello",
+        worker = (
+          compatibilityDate = "2022-08-17",
+          modules = [
+            ( name = "main.js",
+              esModule =
+                `export default {
+                `  async fetch(request, env) {
+                `    let resp = await env.metrics.fetch("http://metrics/metrics");
+                `    let text = await resp.text();
+                `    let type = resp.headers.get("Content-Type");
+                `    let ok = type.startsWith("text/plain; version=0.0.4") &&
+                `             /^workerd_requests_total 1$/m.test(text) &&
+                `             /^workerd_requests_in_flight 1$/m.test(text) &&
+                `             /^workerd_isolates 1$/m.test(text);
+                `    return new Response(ok ? "ok" : text);
+                `  }
+                `}
+            )
+          ],
+          bindings = [(name = "metrics", service = "metrics")]
+        )
+      ),
+      (name = "metrics", metrics = void),
+    ],
+    sockets = [
+      ( name = "main", address = "test-addr", service = "hello" ),
+      ( name = "metrics", address = "metrics-addr", service = "metrics" ),
+    ]
+  ))"_kj);
+
+  test.start();
+
+  auto conn = test.connect("test-addr");
+  conn.httpGet200("/", "ok");
+
+  auto metricsConn = test.connect("metrics-addr");
+  metricsConn.send(R"(
+    POST / HTTP/1.1
+    Host: foo
+    Content-Length: 0
+
+  )"_blockquote);
+  metricsConn.recv(R"(
+    HTTP/1.1 405 Method Not Allowed
+    Content-Length: 18
+
+    Method Not Allowed)"_blockquote);
+}
+
+KJ_TEST("Server: KV namespace service") {
+  TestServer test(R"((
+    services = [
+      ( name = "hello",
+        worker = (
+          compatibilityDate = "2022-08-17",
+          modules = [
+            ( name = "main.js",
+              esModule =
+                `export default {
+                `  async fetch(request, env) {
+                `    let kv = env.kv;
+                `    let results = [];
+                `    await kv.put("foo", "bar", {metadata: {n: 1}});
+                `    await kv.put("dir/a", "1");
+                `    await kv.put("dir/b", "2", {expirationTtl: 3600});
+                `    await kv.put("gone", "x", {expiration: 1});
+                `
+                `    results.push(await kv.get("foo"));
+                `    let {value, metadata} = await kv.getWithMetadata("foo");
+                `    results.push(value + " " + metadata.n);
+                `    results.push(String(await kv.get("gone")));
+                `
+                `    let dir = await kv.list({prefix: "dir/"});
+                `    results.push(dir.keys.map(k => k.name + (k.expiration ? "+" : "")).join(",") +
+                `                 " " + dir.list_complete);
+                `    let all = await kv.list();
+                `    let describe = k => k.name + ":" + JSON.stringify(k.metadata ?? null);
+                `    results.push(all.keys.map(describe).join(","));
+                `    let page = await kv.list({limit: 1});
+                `    let next = await kv.list({limit: 1, cursor: page.cursor});
+                `    results.push(page.keys[0].name + " " + page.list_complete + " " +
+                `                 next.keys[0].name);
+                `
+                `    await kv.delete("foo");
+                `    results.push(String(await kv.get("foo")));
+                `
+                `    let first = await kv.getWithMetadata("dir/a", {cacheTtl: 60});
+                `    let second = await kv.getWithMetadata("dir/a", {cacheTtl: 60});
+                `    await kv.put("dir/a", "3");
+                `    let third = await kv.getWithMetadata("dir/a", {cacheTtl: 60});
+                `    results.push([first, second, third].map(r => r.value + " " + r.cacheStatus)
+                `                 .join(","));
+                `
+                `    return new Response(results.join("|"));
+                `  }
+                `}
+            )
+          ],
+          bindings = [(name = "kv", kvNamespace = "my-kv")]
+        )
+      ),
+      (name = "my-kv", kv = (inMemory = void)),
+    ],
+    sockets = [
+      ( name = "main", address = "test-addr", service = "hello" ),
+    ]
+  ))"_kj);
+
+  test.start();
+  auto conn = test.connect("test-addr");
+  conn.httpGet200("/",
+      "bar|bar 1|null|dir/a,dir/b+ true|dir/a:null,dir/b:null,foo:{\"n\":1}|dir/a false dir/b|"
+      "null|1 null,1 HIT,3 null");
+}
+
+KJ_TEST("Server: KV namespace service (on disk)") {
+  kj::StringPtr config = R"((
+    services = [
+      ( name = "hello",
+        worker = (
+          compatibilityDate = "2022-08-17",
+          modules = [
+            ( name = "main.js",
+              esModule =
+                `export default {
+                `  async fetch(request, env) {
+                `    let count = Number(await env.kv.get("count")) || 0;
+                `    await env.kv.put("count", String(count + 1));
+                `    return new Response(String(count));
+                `  }
+                `}
+            )
+          ],
+          bindings = [(name = "kv", kvNamespace = "my-kv")]
+        )
+      ),
+      (name = "my-kv", kv = (localDisk = "my-disk")),
+      ( name = "my-disk",
+        disk = (
+          path = "../../var/kv-storage",
+          writable = true,
+        )
+      ),
+    ],
+    sockets = [
+      ( name = "main", address = "test-addr", service = "hello" ),
+    ]
+  ))"_kj;
+
+  // Create a directory outside of the test scope which we can use across multiple TestServers.
+  auto dir = kj::newInMemoryDirectory(kj::nullClock());
+
+  {
+    TestServer test(config);
+    test.root->transfer(
+        kj::Path({"var"_kj, "kv-storage"_kj}), kj::WriteMode::CREATE | kj::WriteMode::CREATE_PARENT,
+        *dir, nullptr, kj::TransferMode::LINK);
+
+    test.start();
+    auto conn = test.connect("test-addr");
+    conn.httpGet200("/", "0");
+    conn.httpGet200("/", "1");
+  }
+
+  KJ_EXPECT(dir->exists(kj::Path({"my-kv.sqlite"})));
+
+  // A new server sees the data written by the first one.
+  {
+    TestServer test(config);
+    test.root->transfer(
+        kj::Path({"var"_kj, "kv-storage"_kj}), kj::WriteMode::CREATE | kj::WriteMode::CREATE_PARENT,
+        *dir, nullptr, kj::TransferMode::LINK);
+
+    test.start();
+    auto conn = test.connect("test-addr");
+    conn.httpGet200("/", "2");
+  }
+}
+
+KJ_TEST("Server: KV namespace storage must be a writable disk service") {
+  TestServer test(R"((
+    services = [
+      (name = "my-kv", kv = (localDisk = "my-disk")),
+      (name = "my-disk", disk = (path = "../../current", writable = false)),
+    ]
+  ))"_kj);
+
+  test.expectErrors(
+      "service my-kv: KV storage config refers to the disk service \"my-disk\", but that service "
+      "is defined read-only.\n");
+}
+
 KJ_TEST("Server: If no cache service is defined, access to the cache API should error") {
   TestServer test(singleWorker(R"((
     compatibilityDate = "2022-08-17",
@@ -22,10 +22,13 @@
 #include <openssl/pem.h>
 #include <workerd/io/actor-cache.h>
 #include <workerd/io/actor-sqlite.h>
+#include <workerd/util/sqlite-kv.h>
 #include <workerd/util/http-util.h>
 #include <workerd/api/actor-state.h>
 #include <workerd/util/mimetype.h>
 #include "workerd-api.h"
+#include "metrics.h"
+#include "backend-balancer.h"
 #include <stdlib.h>
 
 namespace workerd::server {
@@ -68,6 +71,24 @@ static kj::Maybe<PemData> decodePem(kj::ArrayPtr<const char> text) {
   return PemData { kj::String(kj::mv(nameArr)), kj::mv(data) };
 }
 
+// Splits `text` at each `delim`, trimming spaces and tabs around each piece. Used to take apart
+// HTTP header values like `Sec-WebSocket-Extensions`.
+static kj::Vector<kj::ArrayPtr<const char>> splitHeaderValue(
+    kj::ArrayPtr<const char> text, char delim) {
+  auto isSpace = [](char c) { return c == ' ' || c == '\t'; };
+  kj::Vector<kj::ArrayPtr<const char>> result;
+  for (;;) {
+    size_t end = 0;
+    while (end < text.size() && text[end] != delim) ++end;
+    auto piece = text.slice(0, end);
+    while (piece.size() > 0 && isSpace(piece.front())) piece = piece.slice(1, piece.size());
+    while (piece.size() > 0 && isSpace(piece.back())) piece = piece.slice(0, piece.size() - 1);
+    result.add(piece);
+    if (end == text.size()) return result;
+    text = text.slice(end + 1, text.size());
+  }
+}
+
 // Returns a time string in the format HTTP likes to use.
 static kj::String httpTime(kj::Date date) {
   time_t time = (date - kj::UNIX_EPOCH) / kj::SECONDS;
@@ -164,13 +185,27 @@ private:
 
 // =======================================================================================
 
+struct Server::StorageLocks: public kj::Refcounted {
+  kj::HashMap<kj::Path, kj::Own<SqliteDatabase::LockManager>> managers;
+};
+
 Server::Server(kj::Filesystem& fs, kj::Timer& timer, kj::Network& network,
                kj::EntropySource& entropySource, kj::Function<void(kj::String)> reportConfigError)
     : fs(fs), timer(timer), network(network), entropySource(entropySource),
-      reportConfigError(kj::mv(reportConfigError)), tasks(*this) {}
+      reportConfigError([this, report = kj::mv(reportConfigError)](kj::String error) mutable {
+        sawConfigErrors = true;
+        report(kj::mv(error));
+      }),
+      storageLocks(kj::refcounted<StorageLocks>()),
+      tasks(*this) {}
 
 Server::~Server() noexcept(false) {}
 
+void Server::takeOverFrom(Server& predecessor) {
+  this->predecessor = predecessor;
+  storageLocks = kj::addRef(*predecessor.storageLocks);
+}
+
 struct Server::GlobalContext {
   jsg::V8System& v8System;
   capnp::ByteStreamFactory byteStreamFactory;
@@ -201,6 +236,10 @@ public:
 
   // Returns true if the service exports the given handler, e.g. `fetch`, `scheduled`, etc.
   virtual bool hasHandler(kj::StringPtr handlerName) = 0;
+
+  // Returns how long requests to the service have recently been waiting to lock its isolate, if
+  // the service has one and this is being tracked.
+  virtual kj::Maybe<kj::Duration> getRecentLockWait() { return kj::none; }
 };
 
 // =======================================================================================
@@ -294,6 +333,14 @@ public:
       : style(httpOptions.getStyle()),
         requestInjector(httpOptions.getInjectRequestHeaders(), headerTableBuilder),
         responseInjector(httpOptions.getInjectResponseHeaders(), headerTableBuilder) {
+    auto compression = httpOptions.getWebSocketCompression();
+    webSocketCompression = WebSocketCompression {
+      .enabled = compression.getEnabled(),
+      .serverNoContextTakeover = compression.getServerNoContextTakeover(),
+      .clientNoContextTakeover = compression.getClientNoContextTakeover(),
+      .serverMaxWindowBits = clampWindowBits(compression.getServerMaxWindowBits()),
+      .clientMaxWindowBits = clampWindowBits(compression.getClientMaxWindowBits()),
+    };
     if (httpOptions.hasForwardedProtoHeader()) {
       forwardedProtoHeader = headerTableBuilder.add(httpOptions.getForwardedProtoHeader());
     }
@@ -309,7 +356,16 @@ public:
   bool needsRewriteRequest() {
     return style == config::HttpOptions::Style::HOST
         || hasCfBlobHeader()
-        || !requestInjector.empty();
+        || !requestInjector.empty()
+        || rewritesWebSocketExtensions();
+  }
+
+  // Does `webSocketCompression` differ from the defaults, i.e. from just passing through whatever
+  // the Worker and the other end negotiate?
+  bool rewritesWebSocketExtensions() {
+    auto& c = webSocketCompression;
+    return !c.enabled || c.serverNoContextTakeover || c.clientNoContextTakeover ||
+        c.serverMaxWindowBits < MAX_WINDOW_BITS || c.clientMaxWindowBits < MAX_WINDOW_BITS;
   }
 
   // Attach this to the promise returned by request().
@@ -342,6 +398,10 @@ public:
 
     requestInjector.apply(*result.headers);
 
+    if (rewritesWebSocketExtensions()) {
+      rewriteWebSocketExtensions(*result.headers, true);
+    }
+
     return result;
   }
 
@@ -388,6 +448,14 @@ public:
     responseInjector.apply(headers);
   }
 
+  // Applies `webSocketCompression` to the response accepting a WebSocket on a `Socket`. (Not for
+  // an `ExternalServer`'s response: the server will use what it agreed to, whatever we say.)
+  void rewriteWebSocketAcceptance(kj::HttpHeaders& headers) {
+    if (rewritesWebSocketExtensions()) {
+      rewriteWebSocketExtensions(headers, false);
+    }
+  }
+
 private:
   config::HttpOptions::Style style;
   kj::Maybe<kj::HttpHeaderId> forwardedProtoHeader;
@@ -428,6 +496,112 @@ private:
 
   HeaderInjector requestInjector;
   HeaderInjector responseInjector;
+
+  static constexpr uint MIN_WINDOW_BITS = 9;
+  static constexpr uint MAX_WINDOW_BITS = 15;
+
+  // From `HttpOptions.webSocketCompression`.
+  struct WebSocketCompression {
+    bool enabled = true;
+    bool serverNoContextTakeover = false;
+    bool clientNoContextTakeover = false;
+    uint serverMaxWindowBits = MAX_WINDOW_BITS;
+    uint clientMaxWindowBits = MAX_WINDOW_BITS;
+  };
+  WebSocketCompression webSocketCompression;
+
+  static uint clampWindowBits(uint bits) {
+    // RFC 7692 allows 8, but zlib silently uses 9 instead when compressing.
+    return kj::max(MIN_WINDOW_BITS, kj::min(bits, MAX_WINDOW_BITS));
+  }
+
+  // Rewrites the `permessage-deflate` entries of the `Sec-WebSocket-Extensions` header to follow
+  // `webSocketCompression`, within what RFC 7692 allows. `isOffer` is true for a client's list
+  // of offers, false for a server's agreement. Other extensions are left alone.
+  void rewriteWebSocketExtensions(kj::HttpHeaders& headers, bool isOffer) {
+    auto& config = webSocketCompression;
+    auto value = KJ_UNWRAP_OR_RETURN(headers.get(kj::HttpHeaderId::SEC_WEBSOCKET_EXTENSIONS));
+    if (!config.enabled) {
+      headers.unset(kj::HttpHeaderId::SEC_WEBSOCKET_EXTENSIONS);
+      return;
+    }
+
+    kj::Vector<kj::String> extensions;
+    for (auto extension: splitHeaderValue(value, ',')) {
+      auto params = splitHeaderValue(extension, ';');
+      if (params[0] != "permessage-deflate"_kj.asArray()) {
+        extensions.add(kj::str(extension));
+        continue;
+      }
+
+      kj::Vector<kj::String> result;
+      result.add(kj::str(params[0]));
+      bool serverNoContextTakeover = false;
+      bool clientNoContextTakeover = false;
+      kj::Maybe<uint> serverMaxWindowBits;
+      bool hasClientMaxWindowBits = false;
+      kj::Maybe<uint> clientMaxWindowBits;
+      for (auto param: params.asPtr().slice(1, params.size())) {
+        auto parts = splitHeaderValue(param, '=');
+        auto name = kj::str(parts[0]);
+        kj::Maybe<uint> bits;
+        if (parts.size() > 1) {
+          auto bitsText = parts[1];
+          if (bitsText.size() >= 2 && bitsText.front() == '"' && bitsText.back() == '"') {
+            bitsText = bitsText.slice(1, bitsText.size() - 1);
+          }
+          bits = kj::str(bitsText).tryParseAs<uint>();
+        }
+
+        if (name == "server_no_context_takeover") {
+          serverNoContextTakeover = true;
+        } else if (name == "client_no_context_takeover") {
+          clientNoContextTakeover = true;
+        } else if (name == "server_max_window_bits") {
+          serverMaxWindowBits = bits.orDefault(MAX_WINDOW_BITS);
+          continue;
+        } else if (name == "client_max_window_bits") {
+          hasClientMaxWindowBits = true;
+          clientMaxWindowBits = bits;
+          continue;
+        }
+        result.add(kj::str(param));
+      }
+
+      // Either end may always ask for no context takeover, and a server may always limit its own
+      // window.
+      if (config.serverNoContextTakeover && !serverNoContextTakeover) {
+        result.add(kj::str("server_no_context_takeover"));
+      }
+      if (config.clientNoContextTakeover && !clientNoContextTakeover) {
+        result.add(kj::str("client_no_context_takeover"));
+      }
+      if (config.serverMaxWindowBits < MAX_WINDOW_BITS) {
+        serverMaxWindowBits = kj::min(
+            serverMaxWindowBits.orDefault(MAX_WINDOW_BITS), config.serverMaxWindowBits);
+      }
+      KJ_IF_SOME(bits, serverMaxWindowBits) {
+        result.add(kj::str("server_max_window_bits=", bits));
+      }
+
+      // But a server may only limit the client's window if the client offered to let it.
+      if (config.clientMaxWindowBits < MAX_WINDOW_BITS && (isOffer || hasClientMaxWindowBits)) {
+        hasClientMaxWindowBits = true;
+        clientMaxWindowBits = kj::min(
+            clientMaxWindowBits.orDefault(MAX_WINDOW_BITS), config.clientMaxWindowBits);
+      }
+      if (hasClientMaxWindowBits) {
+        KJ_IF_SOME(bits, clientMaxWindowBits) {
+          result.add(kj::str("client_max_window_bits=", bits));
+        } else {
+          result.add(kj::str("client_max_window_bits"));
+        }
+      }
+
+      extensions.add(kj::strArray(result, "; "));
+    }
+    headers.set(kj::HttpHeaderId::SEC_WEBSOCKET_EXTENSIONS, kj::strArray(extensions, ", "));
+  }
 };
 
 // =======================================================================================
@@ -500,16 +674,42 @@ private:
 // Service used when the service is configured as external HTTP service.
 class Server::ExternalHttpService final: public Service {
 public:
-  ExternalHttpService(kj::Own<kj::NetworkAddress> addrParam,
+  // Settings from `ExternalServer.pool`, copied out of the config.
+  struct PoolOptions {
+    kj::Maybe<kj::Duration> idleTimeout;
+    uint maxConcurrentRequests = 0;
+    uint ejectAfterFailures = 0;
+    kj::Duration ejectionTime = 0 * kj::SECONDS;
+
+    // From `HttpOptions.protocol`: multiplex requests over one HTTP/2 connection per address
+    // rather than pooling HTTP/1.1 connections. `scheme` is what HTTP/2 sends as `:scheme`.
+    bool http2 = false;
+    kj::StringPtr scheme = "http"_kj;
+  };
+
+  ExternalHttpService(kj::Array<kj::Own<kj::NetworkAddress>> addrs,
                       kj::Own<HttpRewriter> rewriter, kj::HttpHeaderTable& headerTable,
-                      kj::Timer& timer, kj::EntropySource& entropySource)
-      : addr(kj::mv(addrParam)),
-        inner(kj::newHttpClient(timer, headerTable, *addr, {
-          .entropySource = entropySource,
-          .webSocketCompressionMode = kj::HttpClientSettings::MANUAL_COMPRESSION
-        })),
-        serviceAdapter(kj::newHttpService(*inner)),
-        rewriter(kj::mv(rewriter)) {}
+                      kj::Timer& timer, kj::EntropySource& entropySource, PoolOptions options)
+      : balancer(timer, addrs.size(), {
+          .ejectAfterFailures = options.ejectAfterFailures,
+          .ejectionTime = options.ejectionTime,
+        }),
+        rewriter(kj::mv(rewriter)) {
+
+    kj::HttpClientSettings settings {
+      .entropySource = entropySource,
+      .webSocketCompressionMode = kj::HttpClientSettings::MANUAL_COMPRESSION
+    };
+    KJ_IF_SOME(idleTimeout, options.idleTimeout) {
+      settings.idleTimeout = idleTimeout;
+    }
+
+    auto builder = kj::heapArrayBuilder<Backend>(addrs.size());
+    for (auto& addr: addrs) {
+      builder.add(kj::mv(addr), headerTable, timer, settings, options);
+    }
+    backends = builder.finish();
+  }
 
   kj::Own<WorkerInterface> startRequest(IoChannelFactory::SubrequestMetadata metadata) override {
     return kj::heap<WorkerInterfaceImpl>(*this, kj::mv(metadata));
@@ -520,10 +720,30 @@ public:
   }
 
 private:
-  kj::Own<kj::NetworkAddress> addr;
+  // One of the interchangeable servers requests are balanced across.
+  struct Backend {
+    Backend(kj::Own<kj::NetworkAddress> addrParam, kj::HttpHeaderTable& headerTable,
+            kj::Timer& timer, const kj::HttpClientSettings& settings,
+            const PoolOptions& options)
+        : addr(kj::mv(addrParam)),
+          client(options.http2
+              ? newHttp2Client(headerTable, *addr, options.scheme)
+              : kj::newHttpClient(timer, headerTable, *addr, settings)) {
+      if (options.maxConcurrentRequests > 0) {
+        client = kj::newConcurrencyLimitingHttpClient(*client, options.maxConcurrentRequests,
+            [](uint runningCount, uint pendingCount) {}).attach(kj::mv(client));
+      }
+      serviceAdapter = kj::newHttpService(*client);
+    }
 
-  kj::Own<kj::HttpClient> inner;
-  kj::Own<kj::HttpService> serviceAdapter;
+    kj::Own<kj::NetworkAddress> addr;
+    kj::Own<kj::HttpClient> client;
+    kj::Own<kj::HttpService> serviceAdapter;
+  };
+
+  // Indices into `backends`.
+  BackendBalancer balancer;
+  kj::Array<Backend> backends;
 
   kj::Own<HttpRewriter> rewriter;
 
@@ -537,19 +757,30 @@ private:
         kj::AsyncInputStream& requestBody, kj::HttpService::Response& response) override {
       KJ_REQUIRE(wrappedResponse == kj::none, "object should only receive one request");
       wrappedResponse = response;
+
+      auto index = parent.balancer.pick();
+      auto& backend = parent.backends[index];
+      auto isFailure = [this]() {
+        // These statuses typically come from a proxy in front of a server which is down.
+        return statusCode == 502 || statusCode == 503 || statusCode == 504;
+      };
       if (parent.rewriter->needsRewriteRequest()) {
         auto rewrite = parent.rewriter->rewriteOutgoingRequest(url, headers, metadata.cfBlobJson);
-        return parent.serviceAdapter->request(method, url, *rewrite.headers, requestBody, *this)
-            .attach(kj::mv(rewrite));
+        auto promise = backend.serviceAdapter->request(
+            method, url, *rewrite.headers, requestBody, *this).attach(kj::mv(rewrite));
+        return parent.balancer.track(index, kj::mv(promise), kj::mv(isFailure));
       } else {
-        return parent.serviceAdapter->request(method, url, headers, requestBody, *this);
+        auto promise = backend.serviceAdapter->request(method, url, headers, requestBody, *this);
+        return parent.balancer.track(index, kj::mv(promise), kj::mv(isFailure));
       }
     }
 
     kj::Promise<void> connect(
         kj::StringPtr host, const kj::HttpHeaders& headers, kj::AsyncIoStream& connection,
         ConnectResponse& tunnel, kj::HttpConnectSettings settings) override {
-      return parent.serviceAdapter->connect(host, headers, connection, tunnel, kj::mv(settings));
+      auto index = parent.balancer.pick();
+      return parent.balancer.track(index, parent.backends[index].serviceAdapter->connect(
+          host, headers, connection, tunnel, kj::mv(settings)), []() { return false; });
     }
 
     void prewarm(kj::StringPtr url) override {}
@@ -568,6 +799,9 @@ private:
     IoChannelFactory::SubrequestMetadata metadata;
     kj::Maybe<kj::HttpService::Response&> wrappedResponse;
 
+    // Status of the response, once one has been sent.
+    uint statusCode = 0;
+
     [[noreturn]] void throwUnsupported() {
       JSG_FAIL_REQUIRE(Error, "External HTTP servers don't support this event type.");
     }
@@ -575,6 +809,7 @@ private:
     kj::Own<kj::AsyncOutputStream> send(
         uint statusCode, kj::StringPtr statusText, const kj::HttpHeaders& headers,
         kj::Maybe<uint64_t> expectedBodySize) override {
+      this->statusCode = statusCode;
       auto& response = KJ_ASSERT_NONNULL(wrappedResponse);
       if (parent.rewriter->needsRewriteResponse()) {
         auto rewrite = headers.cloneShallow();
@@ -586,6 +821,7 @@ private:
     }
 
     kj::Own<kj::WebSocket> acceptWebSocket(const kj::HttpHeaders& headers) override {
+      statusCode = 101;
       auto& response = KJ_ASSERT_NONNULL(wrappedResponse);
       if (parent.rewriter->needsRewriteResponse()) {
         auto rewrite = headers.cloneShallow();
@@ -601,19 +837,38 @@ private:
 kj::Own<Server::Service> Server::makeExternalService(
     kj::StringPtr name, config::ExternalServer::Reader conf,
     kj::HttpHeaderTable::Builder& headerTableBuilder) {
-  kj::StringPtr addrStr = nullptr;
+  kj::Vector<kj::StringPtr> addrStrs;
   kj::String ownAddrStr = nullptr;
 
   KJ_IF_SOME(override, externalOverrides.findEntry(name)) {
-    addrStr = ownAddrStr = kj::mv(override.value);
+    // The override replaces every configured address, not just `address`.
+    ownAddrStr = kj::mv(override.value);
+    addrStrs.add(ownAddrStr);
     externalOverrides.erase(override);
-  } else if (conf.hasAddress()) {
-    addrStr = conf.getAddress();
   } else {
-    reportConfigError(kj::str(
-        "External service \"", name, "\" has no address in the config, so must be specified "
-        "on the command line with `--external-addr`."));
-    return makeInvalidConfigService();
+    if (conf.hasAddress()) {
+      addrStrs.add(conf.getAddress());
+    }
+    for (auto addrStr: conf.getAddresses()) {
+      addrStrs.add(addrStr);
+    }
+    if (addrStrs.size() == 0) {
+      reportConfigError(kj::str(
+          "External service \"", name, "\" has no address in the config, so must be specified "
+          "on the command line with `--external-addr`."));
+      return makeInvalidConfigService();
+    }
+  }
+
+  ExternalHttpService::PoolOptions poolOptions;
+  {
+    auto pool = conf.getPool();
+    if (pool.getIdleTimeoutMs() > 0) {
+      poolOptions.idleTimeout = pool.getIdleTimeoutMs() * kj::MILLISECONDS;
+    }
+    poolOptions.maxConcurrentRequests = pool.getMaxConcurrentRequests();
+    poolOptions.ejectAfterFailures = pool.getEjectAfterFailures();
+    poolOptions.ejectionTime = pool.getEjectionTimeMs() * kj::MILLISECONDS;
   }
 
   switch (conf.which()) {
@@ -621,9 +876,14 @@ kj::Own<Server::Service> Server::makeExternalService(
       // We have to construct the rewriter upfront before waiting on any promises, since the
       // HeaderTable::Builder is only available synchronously.
       auto rewriter = kj::heap<HttpRewriter>(conf.getHttp(), headerTableBuilder);
-      auto addr = kj::heap<PromisedNetworkAddress>(network.parseAddress(addrStr, 80));
+      poolOptions.http2 =
+          conf.getHttp().getProtocol() == config::HttpOptions::Protocol::HTTP2_PRIOR_KNOWLEDGE;
+      auto addrs = KJ_MAP(addrStr, addrStrs) -> kj::Own<kj::NetworkAddress> {
+        return kj::heap<PromisedNetworkAddress>(network.parseAddress(addrStr, 80));
+      };
       return kj::heap<ExternalHttpService>(
-          kj::mv(addr), kj::mv(rewriter), globalContext->headerTable, timer, entropySource);
+          kj::mv(addrs), kj::mv(rewriter), globalContext->headerTable, timer, entropySource,
+          poolOptions);
     }
     case config::ExternalServer::HTTPS: {
       auto httpsConf = conf.getHttps();
@@ -632,10 +892,16 @@ kj::Own<Server::Service> Server::makeExternalService(
         certificateHost = httpsConf.getCertificateHost();
       }
       auto rewriter = kj::heap<HttpRewriter>(httpsConf.getOptions(), headerTableBuilder);
-      auto addr = kj::heap<PromisedNetworkAddress>(
-          makeTlsNetworkAddress(httpsConf.getTlsOptions(), addrStr, certificateHost, 443));
+      poolOptions.http2 = httpsConf.getOptions().getProtocol() ==
+          config::HttpOptions::Protocol::HTTP2_PRIOR_KNOWLEDGE;
+      poolOptions.scheme = "https"_kj;
+      auto addrs = KJ_MAP(addrStr, addrStrs) -> kj::Own<kj::NetworkAddress> {
+        return kj::heap<PromisedNetworkAddress>(
+            makeTlsNetworkAddress(httpsConf.getTlsOptions(), addrStr, certificateHost, 443));
+      };
       return kj::heap<ExternalHttpService>(
-          kj::mv(addr), kj::mv(rewriter), globalContext->headerTable, timer, entropySource);
+          kj::mv(addrs), kj::mv(rewriter), globalContext->headerTable, timer, entropySource,
+          poolOptions);
     }
   }
   reportConfigError(kj::str(
@@ -726,16 +992,18 @@ kj::Own<Server::Service> Server::makeNetworkService(config::Network::Reader conf
 // Service used when the service is configured as disk directory service.
 class Server::DiskDirectoryService final: public Service, private WorkerInterface {
 public:
-  DiskDirectoryService(config::DiskDirectory::Reader conf,
+  DiskDirectoryService(config::DiskDirectory::Reader conf, kj::Path path,
                        kj::Own<const kj::Directory> dir,
                        kj::HttpHeaderTable::Builder& headerTableBuilder)
-      : writable(*dir), readable(kj::mv(dir)), headerTable(headerTableBuilder.getFutureTable()),
+      : path(kj::mv(path)), writable(*dir), readable(kj::mv(dir)),
+        headerTable(headerTableBuilder.getFutureTable()),
         hLastModified(headerTableBuilder.add("Last-Modified")),
         allowDotfiles(conf.getAllowDotfiles()) {}
-  DiskDirectoryService(config::DiskDirectory::Reader conf,
+  DiskDirectoryService(config::DiskDirectory::Reader conf, kj::Path path,
                        kj::Own<const kj::ReadableDirectory> dir,
                        kj::HttpHeaderTable::Builder& headerTableBuilder)
-      : readable(kj::mv(dir)), headerTable(headerTableBuilder.getFutureTable()),
+      : path(kj::mv(path)), readable(kj::mv(dir)),
+        headerTable(headerTableBuilder.getFutureTable()),
         hLastModified(headerTableBuilder.add("Last-Modified")),
         allowDotfiles(conf.getAllowDotfiles()) {}
 
@@ -743,6 +1011,9 @@ public:
     return { this, kj::NullDisposer::instance };
   }
 
+  // The directory's absolute path in the Server's filesystem.
+  kj::PathPtr getPath() { return path; }
+
   kj::Maybe<const kj::Directory&> getWritable() { return writable; }
 
   bool hasHandler(kj::StringPtr handlerName) override {
@@ -750,6 +1021,7 @@ public:
   }
 
 private:
+  kj::Path path;
   kj::Maybe<const kj::Directory&> writable;
   kj::Own<const kj::ReadableDirectory> readable;
   kj::HttpHeaderTable& headerTable;
@@ -981,24 +1253,492 @@ kj::Own<Server::Service> Server::makeDiskDirectoryService(
   auto path = fs.getCurrentPath().evalNative(pathStr);
 
   if (conf.getWritable()) {
-    auto openDir = KJ_UNWRAP_OR(fs.getRoot().tryOpenSubdir(kj::mv(path), kj::WriteMode::MODIFY), {
+    auto openDir = KJ_UNWRAP_OR(fs.getRoot().tryOpenSubdir(path, kj::WriteMode::MODIFY), {
       reportConfigError(kj::str(
           "Directory named \"", name, "\" not found: ", pathStr));
       return makeInvalidConfigService();
     });
 
-    return kj::heap<DiskDirectoryService>(conf, kj::mv(openDir), headerTableBuilder);
+    return kj::heap<DiskDirectoryService>(conf, kj::mv(path), kj::mv(openDir),
+                                          headerTableBuilder);
   } else {
-    auto openDir = KJ_UNWRAP_OR(fs.getRoot().tryOpenSubdir(kj::mv(path)), {
+    auto openDir = KJ_UNWRAP_OR(fs.getRoot().tryOpenSubdir(path), {
       reportConfigError(kj::str(
           "Directory named \"", name, "\" not found: ", pathStr));
       return makeInvalidConfigService();
     });
 
-    return kj::heap<DiskDirectoryService>(conf, kj::mv(openDir), headerTableBuilder);
+    return kj::heap<DiskDirectoryService>(conf, kj::mv(path), kj::mv(openDir),
+                                          headerTableBuilder);
   }
 }
 
+kj::Own<SqliteDatabase::Vfs> Server::makeStorageVfs(const kj::Directory& dir, kj::PathPtr path) {
+#if !_WIN32
+  if (dir.getFd() != kj::none) {
+    // SQLite's own locks coordinate all connections to a disk file within the process.
+    return kj::heap<SqliteDatabase::Vfs>(dir);
+  }
+#endif
+
+  // Otherwise the locks are only shared by Vfses which use the same LockManager. This Server's
+  // predecessor or successor may have the same databases open, so they share ours.
+  auto& lockManager = *storageLocks->managers.findOrCreate(path, [&]() {
+    return decltype(storageLocks->managers)::Entry {
+      path.clone(), SqliteDatabase::Vfs::newInProcessLockManager()
+    };
+  });
+  return kj::heap<SqliteDatabase::Vfs>(dir, lockManager).attach(kj::addRef(*storageLocks));
+}
+
+// =======================================================================================
+
+// Service used when the service is configured as a metrics service.
+class Server::MetricsService final: public Service, private WorkerInterface {
+public:
+  MetricsService(const ServerMetrics& metrics, kj::HttpHeaderTable& headerTable)
+      : metrics(metrics), headerTable(headerTable) {}
+
+  kj::Own<WorkerInterface> startRequest(IoChannelFactory::SubrequestMetadata metadata) override {
+    return { this, kj::NullDisposer::instance };
+  }
+
+  bool hasHandler(kj::StringPtr handlerName) override {
+    return handlerName == "fetch"_kj;
+  }
+
+private:
+  const ServerMetrics& metrics;
+  kj::HttpHeaderTable& headerTable;
+
+  kj::Promise<void> request(
+      kj::HttpMethod method, kj::StringPtr urlStr, const kj::HttpHeaders& requestHeaders,
+      kj::AsyncInputStream& requestBody, kj::HttpService::Response& response) override {
+    if (method != kj::HttpMethod::GET && method != kj::HttpMethod::HEAD) {
+      co_return co_await response.sendError(405, "Method Not Allowed", headerTable);
+    }
+
+    auto content = metrics.renderPrometheus();
+
+    kj::HttpHeaders headers(headerTable);
+    headers.set(kj::HttpHeaderId::CONTENT_TYPE, "text/plain; version=0.0.4; charset=utf-8"_kj);
+    headers.set(kj::HttpHeaderId::CONTENT_LENGTH, kj::str(content.size()));
+
+    if (method == kj::HttpMethod::HEAD) {
+      response.send(200, "OK", headers, content.size());
+      co_return;
+    }
+
+    auto out = response.send(200, "OK", headers, content.size());
+    co_return co_await out->write(content.begin(), content.size());
+  }
+
+  kj::Promise<void> connect(kj::StringPtr host, const kj::HttpHeaders& headers,
+      kj::AsyncIoStream& connection, kj::HttpService::ConnectResponse& response,
+      kj::HttpConnectSettings settings) override {
+    throwUnsupported();
+  }
+  void prewarm(kj::StringPtr url) override {}
+  kj::Promise<ScheduledResult> runScheduled(kj::Date scheduledTime, kj::StringPtr cron) override {
+    throwUnsupported();
+  }
+  kj::Promise<AlarmResult> runAlarm(kj::Date scheduledTime) override {
+    throwUnsupported();
+  }
+  kj::Promise<CustomEvent::Result> customEvent(kj::Own<CustomEvent> event) override {
+    throwUnsupported();
+  }
+
+  [[noreturn]] void throwUnsupported() {
+    JSG_FAIL_REQUIRE(Error, "Metrics services don't support this event type.");
+  }
+};
+
+kj::Own<Server::Service> Server::makeMetricsService() {
+  // startServices() creates `metrics` up front whenever the config has a metrics service.
+  auto& m = *KJ_ASSERT_NONNULL(metrics);
+  return kj::heap<MetricsService>(m, globalContext->headerTable);
+}
+
+// =======================================================================================
+
+// Service used when the service is configured as a local KV namespace. It implements the HTTP
+// protocol that api::KvNamespace speaks to its backing service:
+//
+// - `GET /<key>` returns the value, with its metadata (JSON) in the `CF-KV-Metadata` header, or
+//   404 if the key doesn't exist.
+// - `GET /` lists keys, taking `prefix`, `cursor` and `key_count_limit` query parameters.
+// - `PUT /<key>` stores the request body, along with the `CF-KV-Metadata` header and either an
+//   `expiration` (seconds since the epoch) or `expiration_ttl` (seconds from now) parameter.
+// - `DELETE /<key>` deletes the key.
+//
+// Values are stored with SqliteKv. Metadata and expiration times live in a second table keyed the
+// same way, with rows only for keys that have either one.
+class Server::KvService final: public Service, private WorkerInterface {
+public:
+  // Called by link() to open the storage directory, once all services exist. Returns null if the
+  // config is invalid, in which case the error has already been reported.
+  using LinkCallback = kj::Function<kj::Maybe<kj::Own<SqliteDatabase::Vfs>>()>;
+
+  KvService(kj::String fileName, kj::HttpHeaderTable::Builder& headerTableBuilder,
+            LinkCallback linkCallback)
+      : fileName(kj::mv(fileName)), headerTable(headerTableBuilder.getFutureTable()),
+        hMetadata(headerTableBuilder.add("CF-KV-Metadata")),
+        linkCallback(kj::mv(linkCallback)) {}
+
+  void link() override {
+    auto callback = kj::mv(KJ_REQUIRE_NONNULL(linkCallback, "already called link()"));
+    linkCallback = kj::none;
+    KJ_IF_SOME(vfs, callback()) {
+      storage = kj::heap<Storage>(kj::mv(vfs), kj::Path({fileName}));
+    }
+  }
+
+  kj::Own<WorkerInterface> startRequest(IoChannelFactory::SubrequestMetadata metadata) override {
+    return { this, kj::NullDisposer::instance };
+  }
+
+  bool hasHandler(kj::StringPtr handlerName) override {
+    return handlerName == "fetch"_kj;
+  }
+
+private:
+  // KV's own limit on keys returned by one list request.
+  static constexpr uint MAX_LIST_LIMIT = 1000;
+
+  struct Storage {
+    Storage(kj::Own<SqliteDatabase::Vfs> vfsParam, kj::PathPtr path)
+        : vfs(kj::mv(vfsParam)), db(*vfs, path, kj::WriteMode::CREATE | kj::WriteMode::MODIFY),
+          kv(ensureMetaTable(db)) {}
+
+    kj::Own<SqliteDatabase::Vfs> vfs;
+    SqliteDatabase db;
+    SqliteKv kv;
+
+    // Creates the metadata table, so that the statements below can be prepared, then returns the
+    // same database.
+    static SqliteDatabase& ensureMetaTable(SqliteDatabase& db) {
+      db.run(R"(
+        CREATE TABLE IF NOT EXISTS _cf_KV_meta (
+          key TEXT PRIMARY KEY,
+          metadata TEXT,
+          expiration INTEGER
+        ) WITHOUT ROWID;
+      )");
+      return db;
+    }
+
+    SqliteDatabase::Statement stmtGetMeta = db.prepare(R"(
+      SELECT metadata, expiration FROM _cf_KV_meta WHERE key = ?
+    )");
+    SqliteDatabase::Statement stmtPutMeta = db.prepare(R"(
+      INSERT INTO _cf_KV_meta VALUES(?, ?, ?)
+        ON CONFLICT DO UPDATE SET metadata = excluded.metadata, expiration = excluded.expiration;
+    )");
+    SqliteDatabase::Statement stmtDeleteMeta = db.prepare(R"(
+      DELETE FROM _cf_KV_meta WHERE key = ?
+    )");
+  };
+
+  struct Meta {
+    kj::Maybe<kj::String> metadata;
+    kj::Maybe<int64_t> expiration;
+  };
+
+  kj::String fileName;
+  kj::HttpHeaderTable& headerTable;
+  kj::HttpHeaderId hMetadata;
+  kj::Maybe<LinkCallback> linkCallback;
+  kj::Maybe<kj::Own<Storage>> storage;
+
+  static int64_t nowSeconds() {
+    return (kj::systemPreciseCalendarClock().now() - kj::UNIX_EPOCH) / kj::SECONDS;
+  }
+
+  static Meta getMeta(Storage& storage, kj::StringPtr key) {
+    auto query = storage.stmtGetMeta.run(key);
+    if (query.isDone()) return {};
+    return {
+      .metadata = query.getMaybeText(0).map([](kj::StringPtr m) { return kj::str(m); }),
+      .expiration = query.getMaybeInt64(1),
+    };
+  }
+
+  static bool isExpired(const Meta& meta, int64_t now) {
+    KJ_IF_SOME(e, meta.expiration) {
+      return e <= now;
+    }
+    return false;
+  }
+
+  static void deleteKey(Storage& storage, kj::StringPtr key) {
+    storage.db.run("BEGIN TRANSACTION;");
+    KJ_ON_SCOPE_FAILURE(storage.db.run("ROLLBACK TRANSACTION;"));
+    storage.kv.delete_(key);
+    storage.stmtDeleteMeta.run(key);
+    storage.db.run("COMMIT TRANSACTION;");
+  }
+
+  // Returns the smallest string that sorts after every string starting with `prefix`, or null if
+  // there is none (`prefix` is empty or all 0xff bytes).
+  static kj::Maybe<kj::String> prefixEnd(kj::StringPtr prefix) {
+    kj::Vector<char> chars;
+    chars.addAll(prefix);
+    while (!chars.empty()) {
+      if (static_cast<byte>(chars.back()) != 0xff) {
+        ++chars.back();
+        return kj::heapString(chars);
+      }
+      chars.removeLast();
+    }
+    return kj::none;
+  }
+
+  kj::Promise<void> request(
+      kj::HttpMethod method, kj::StringPtr urlStr, const kj::HttpHeaders& requestHeaders,
+      kj::AsyncInputStream& requestBody, kj::HttpService::Response& response) override {
+    auto& storage = *KJ_UNWRAP_OR(this->storage, {
+      // The storage config was invalid, which was reported at startup.
+      co_return co_await response.sendError(500, "Internal Server Error", headerTable);
+    });
+
+    // Keys may contain '/' and "." or ".." segments, so take the path undecoded and unnormalized
+    // and decode it as a whole.
+    auto url = kj::Url::parse(urlStr, kj::Url::REMOTE_HREF,
+        kj::Url::Options {.percentDecode = false, .allowEmpty = true});
+    kj::String key = kj::decodeUriComponent(kj::strArray(url.path, "/"));
+
+    if (key.size() == 0) {
+      if (method == kj::HttpMethod::GET) {
+        co_return co_await list(storage, url, response);
+      } else {
+        co_return co_await response.sendError(405, "Method Not Allowed", headerTable);
+      }
+    }
+
+    if (method == kj::HttpMethod::GET) {
+      kj::Maybe<kj::Array<byte>> value;
+      storage.kv.get(key, [&](SqliteKv::ValuePtr v) { value = kj::heapArray(v); });
+      auto& bytes = KJ_UNWRAP_OR(value, {
+        co_return co_await response.sendError(404, "Not Found", headerTable);
+      });
+
+      auto meta = getMeta(storage, key);
+      if (isExpired(meta, nowSeconds())) {
+        deleteKey(storage, key);
+        co_return co_await response.sendError(404, "Not Found", headerTable);
+      }
+
+      kj::HttpHeaders headers(headerTable);
+      headers.set(kj::HttpHeaderId::CONTENT_TYPE, MimeType::OCTET_STREAM.toString());
+      headers.set(kj::HttpHeaderId::CONTENT_LENGTH, kj::str(bytes.size()));
+      KJ_IF_SOME(m, meta.metadata) {
+        headers.set(hMetadata, m);
+      }
+      auto out = response.send(200, "OK", headers, bytes.size());
+      co_return co_await out->write(bytes.begin(), bytes.size());
+    } else if (method == kj::HttpMethod::PUT) {
+      Meta meta;
+      KJ_IF_SOME(m, requestHeaders.get(hMetadata)) {
+        meta.metadata = kj::str(m);
+      }
+      for (auto& param: url.query) {
+        if (param.name == "expiration" || param.name == "expiration_ttl") {
+          auto seconds = KJ_UNWRAP_OR(kj::decodeWwwForm(param.value).tryParseAs<int64_t>(), {
+            co_return co_await response.sendError(400, "Bad Request", headerTable);
+          });
+          meta.expiration = param.name == "expiration" ? seconds : nowSeconds() + seconds;
+        }
+      }
+
+      auto value = co_await requestBody.readAllBytes();
+
+      storage.db.run("BEGIN TRANSACTION;");
+      {
+        KJ_ON_SCOPE_FAILURE(storage.db.run("ROLLBACK TRANSACTION;"));
+        storage.kv.put(key, value);
+        if (meta.metadata == kj::none && meta.expiration == kj::none) {
+          storage.stmtDeleteMeta.run(key);
+        } else {
+          using ValuePtr = SqliteDatabase::Query::ValuePtr;
+          ValuePtr metadata = nullptr;
+          KJ_IF_SOME(m, meta.metadata) {
+            metadata = kj::StringPtr(m);
+          }
+          ValuePtr expiration = nullptr;
+          KJ_IF_SOME(e, meta.expiration) {
+            expiration = e;
+          }
+          storage.stmtPutMeta.run(key, metadata, expiration);
+        }
+        storage.db.run("COMMIT TRANSACTION;");
+      }
+
+      kj::HttpHeaders headers(headerTable);
+      response.send(204, "No Content", headers);
+      co_return;
+    } else if (method == kj::HttpMethod::DELETE) {
+      // Like Cloudflare's KV, deleting a key that doesn't exist succeeds.
+      deleteKey(storage, key);
+      kj::HttpHeaders headers(headerTable);
+      response.send(204, "No Content", headers);
+      co_return;
+    } else {
+      co_return co_await response.sendError(501, "Not Implemented", headerTable);
+    }
+  }
+
+  kj::Promise<void> list(Storage& storage, kj::Url& url, kj::HttpService::Response& response) {
+    kj::String prefix = nullptr;
+    kj::Maybe<kj::String> cursor;
+    uint limit = MAX_LIST_LIMIT;
+    for (auto& param: url.query) {
+      auto value = kj::decodeWwwForm(param.value);
+      if (param.name == "prefix") {
+        prefix = kj::mv(value);
+      } else if (param.name == "cursor") {
+        cursor = kj::mv(value);
+      } else if (param.name == "key_count_limit") {
+        limit = KJ_UNWRAP_OR(value.tryParseAs<uint>(), {
+          return response.sendError(400, "Bad Request", headerTable);
+        });
+        if (limit == 0 || limit > MAX_LIST_LIMIT) {
+          return response.sendError(400, "Bad Request", headerTable);
+        }
+      }
+    }
+
+    // The cursor is the last key returned by the previous page.
+    kj::String begin = kj::str(prefix);
+    bool skipBegin = false;
+    KJ_IF_SOME(c, cursor) {
+      if (prefix < c) {
+        begin = kj::mv(c);
+        skipBegin = true;
+      }
+    }
+    auto end = prefixEnd(prefix);
+    auto endPtr = end.map([](kj::String& e) -> kj::StringPtr { return e; });
+
+    // Page through the table until we have one more live key than the limit, which tells us
+    // whether the listing is complete. Expired keys are skipped, and deleted afterwards.
+    auto now = nowSeconds();
+    kj::Vector<kj::String> jsonKeys;
+    kj::Vector<kj::String> expired;
+    kj::String lastKey = nullptr;
+    bool complete = false;
+    while (!complete) {
+      uint batchSize = limit + 1 - jsonKeys.size() + (skipBegin ? 1 : 0);
+      kj::Vector<kj::String> batch(batchSize);
+      storage.kv.list(begin, endPtr, batchSize, SqliteKv::FORWARD,
+          [&](SqliteKv::KeyPtr k, SqliteKv::ValuePtr) { batch.add(kj::str(k)); });
+      complete = batch.size() < batchSize;
+
+      for (auto& k: batch) {
+        if (skipBegin && k == begin) continue;
+        auto meta = getMeta(storage, k);
+        if (isExpired(meta, now)) {
+          expired.add(kj::str(k));
+          continue;
+        }
+        if (jsonKeys.size() == limit) {
+          // There's at least one more live key.
+          complete = false;
+          break;
+        }
+
+        auto json = kj::str("{\"name\":\"", escapeJsonString(k), "\"");
+        KJ_IF_SOME(e, meta.expiration) {
+          json = kj::str(json, ",\"expiration\":", e);
+        }
+        KJ_IF_SOME(m, meta.metadata) {
+          // The binding expects each key's metadata as a string of JSON.
+          json = kj::str(json, ",\"metadata\":\"", escapeJsonString(m), "\"");
+        }
+        jsonKeys.add(kj::str(json, '}'));
+        lastKey = kj::str(k);
+      }
+
+      if (jsonKeys.size() == limit) break;
+      if (batch.size() > 0) {
+        begin = kj::str(batch.back());
+        skipBegin = true;
+      }
+    }
+
+    for (auto& k: expired) {
+      deleteKey(storage, k);
+    }
+
+    auto content = complete
+        ? kj::str("{\"keys\":[", kj::strArray(jsonKeys, ","), "],\"list_complete\":true}")
+        : kj::str("{\"keys\":[", kj::strArray(jsonKeys, ","), "],\"list_complete\":false,"
+                  "\"cursor\":\"", escapeJsonString(lastKey), "\"}");
+
+    kj::HttpHeaders headers(headerTable);
+    headers.set(kj::HttpHeaderId::CONTENT_TYPE, MimeType::JSON.toString());
+    headers.set(kj::HttpHeaderId::CONTENT_LENGTH, kj::str(content.size()));
+    auto out = response.send(200, "OK", headers, content.size());
+    return out->write(content.begin(), content.size()).attach(kj::mv(out), kj::mv(content));
+  }
+
+  kj::Promise<void> connect(kj::StringPtr host, const kj::HttpHeaders& headers,
+      kj::AsyncIoStream& connection, kj::HttpService::ConnectResponse& response,
+      kj::HttpConnectSettings settings) override {
+    throwUnsupported();
+  }
+  void prewarm(kj::StringPtr url) override {}
+  kj::Promise<ScheduledResult> runScheduled(kj::Date scheduledTime, kj::StringPtr cron) override {
+    throwUnsupported();
+  }
+  kj::Promise<AlarmResult> runAlarm(kj::Date scheduledTime) override {
+    throwUnsupported();
+  }
+  kj::Promise<CustomEvent::Result> customEvent(kj::Own<CustomEvent> event) override {
+    throwUnsupported();
+  }
+
+  [[noreturn]] void throwUnsupported() {
+    JSG_FAIL_REQUIRE(Error, "KV namespace services don't support this event type.");
+  }
+};
+
+kj::Own<Server::Service> Server::makeKvService(
+    kj::StringPtr name, config::KvNamespace::Reader conf,
+    kj::HttpHeaderTable::Builder& headerTableBuilder) {
+  auto storageConf = conf.getStorage();
+  auto linkCallback = [&]() -> KvService::LinkCallback {
+    if (!storageConf.isLocalDisk()) {
+      return []() -> kj::Maybe<kj::Own<SqliteDatabase::Vfs>> {
+        auto dir = kj::newInMemoryDirectory(kj::systemPreciseCalendarClock());
+        return kj::heap<SqliteDatabase::Vfs>(*dir).attach(kj::mv(dir));
+      };
+    }
+
+    return [this, name, diskName = storageConf.getLocalDisk()]()
+        -> kj::Maybe<kj::Own<SqliteDatabase::Vfs>> {
+      KJ_IF_SOME(svc, services.find(diskName)) {
+        auto diskSvc = dynamic_cast<DiskDirectoryService*>(svc.get());
+        if (diskSvc == nullptr) {
+          reportConfigError(kj::str("service ", name, ": KV storage config refers to the "
+              "service \"", diskName, "\", but that service is not a local disk service."));
+        } else KJ_IF_SOME(dir, diskSvc->getWritable()) {
+          return makeStorageVfs(dir, diskSvc->getPath());
+        } else {
+          reportConfigError(kj::str("service ", name, ": KV storage config refers to the disk "
+              "service \"", diskName, "\", but that service is defined read-only."));
+        }
+      } else {
+        reportConfigError(kj::str("service ", name, ": KV storage config refers to a service \"",
+            diskName, "\", but no such service is defined."));
+      }
+      return kj::none;
+    };
+  }();
+
+  return kj::heap<KvService>(kj::str(name, ".sqlite"), headerTableBuilder, kj::mv(linkCallback));
+}
+
 // =======================================================================================
 
 // This class exists to update the InspectorService's table of isolates when a config
@@ -1243,6 +1983,108 @@ void Server::InspectorServiceIsolateRegistrar::registerIsolate(kj::StringPtr nam
 
 // =======================================================================================
 
+// Wraps a Worker's IsolateObserver to also keep a moving average of how long locks on the isolate
+// wait, which sockets use to shed load while the isolate is overloaded.
+class LockWaitTrackingObserver final: public IsolateObserver {
+public:
+  explicit LockWaitTrackingObserver(kj::Own<IsolateObserver> inner): inner(kj::mv(inner)) {}
+
+  // The average decays while no locks are taken, since otherwise a socket shedding all of its
+  // requests would never see the isolate recover.
+  kj::Duration getRecentLockWait() const {
+    auto average = __atomic_load_n(&averageWaitNs, __ATOMIC_RELAXED);
+    auto lastSample = __atomic_load_n(&lastSampleNs, __ATOMIC_RELAXED);
+    auto halvings = (nowNs() - lastSample) / (HALF_LIFE / kj::NANOSECONDS);
+    return (halvings >= 63 ? 0 : average >> halvings) * kj::NANOSECONDS;
+  }
+
+  void created() override { inner->created(); }
+  void evicted() override { inner->evicted(); }
+  void teardownStarted() override { inner->teardownStarted(); }
+  void teardownLockAcquired() override { inner->teardownLockAcquired(); }
+  void teardownFinished() override { inner->teardownFinished(); }
+
+  kj::Own<Parse> parse(StartType startType) const override {
+    return inner->parse(startType);
+  }
+
+  kj::Own<void> onEsmCompilationStart(
+      v8::Isolate* isolate, kj::StringPtr name, Option option) const override {
+    return inner->onEsmCompilationStart(isolate, name, option);
+  }
+  kj::Own<void> onWasmCompilationStart(v8::Isolate* isolate, size_t codeSize) const override {
+    return inner->onWasmCompilationStart(isolate, codeSize);
+  }
+
+  kj::Maybe<kj::Own<LockTiming>> tryCreateLockTiming(
+      kj::OneOf<SpanParent, kj::Maybe<RequestObserver&>> parentOrRequest) const override {
+    return kj::Own<LockTiming>(kj::heap<Timing>(
+        *this, inner->tryCreateLockTiming(kj::mv(parentOrRequest))));
+  }
+
+private:
+  static constexpr kj::Duration HALF_LIFE = 250 * kj::MILLISECONDS;
+
+  kj::Own<IsolateObserver> inner;
+
+  // Exponentially-weighted; each lock moves it 1/8 of the way towards its own wait. Updated with
+  // relaxed loads and stores, since losing the odd sample to a race doesn't matter.
+  mutable int64_t averageWaitNs = 0;
+  mutable int64_t lastSampleNs = 0;
+
+  static int64_t nowNs() {
+    return (kj::systemPreciseMonotonicClock().now() - kj::origin<kj::TimePoint>()) /
+        kj::NANOSECONDS;
+  }
+
+  void addSample(int64_t waitNs) const {
+    auto average = getRecentLockWait() / kj::NANOSECONDS;
+    __atomic_store_n(&averageWaitNs, average + (waitNs - average) / 8, __ATOMIC_RELAXED);
+    __atomic_store_n(&lastSampleNs, nowNs(), __ATOMIC_RELAXED);
+  }
+
+  // Forwards to the inner observer's LockTiming, if it made one.
+  class Timing final: public LockTiming {
+  public:
+    Timing(const LockWaitTrackingObserver& tracker, kj::Maybe<kj::Own<LockTiming>> inner)
+        : tracker(tracker), inner(kj::mv(inner)) {}
+
+    void waitingForOtherIsolate(kj::StringPtr id) override {
+      KJ_IF_SOME(i, inner) i->waitingForOtherIsolate(id);
+    }
+    void reportAsyncInfo(uint currentLoad, bool threadWaitingSameLock,
+        uint threadWaitingDifferentLockCount) override {
+      KJ_IF_SOME(i, inner) {
+        i->reportAsyncInfo(currentLoad, threadWaitingSameLock, threadWaitingDifferentLockCount);
+      }
+    }
+
+    void start() override {
+      startNs = nowNs();
+      KJ_IF_SOME(i, inner) i->start();
+    }
+    void stop() override {
+      KJ_IF_SOME(i, inner) i->stop();
+    }
+
+    void locked() override {
+      tracker.addSample(nowNs() - startNs);
+      KJ_IF_SOME(i, inner) i->locked();
+    }
+    void gcPrologue() override {
+      KJ_IF_SOME(i, inner) i->gcPrologue();
+    }
+    void gcEpilogue() override {
+      KJ_IF_SOME(i, inner) i->gcEpilogue();
+    }
+
+  private:
+    const LockWaitTrackingObserver& tracker;
+    kj::Maybe<kj::Own<LockTiming>> inner;
+    int64_t startNs = 0;
+  };
+};
+
 class Server::WorkerService final: public Service, private kj::TaskSet::ErrorHandler,
                                    private IoChannelFactory, private TimerChannel,
                                    private LimitEnforcer {
@@ -1263,8 +2105,11 @@ public:
                 kj::Maybe<kj::HashSet<kj::String>> defaultEntrypointHandlers,
                 kj::HashMap<kj::String, kj::HashSet<kj::String>> namedEntrypointsParam,
                 const kj::HashMap<kj::String, ActorConfig>& actorClasses,
-                LinkCallback linkCallback)
+                LinkCallback linkCallback, kj::Maybe<ServerMetrics&> metrics,
+                size_t teeBranchLagLimit)
       : threadContext(threadContext),
+        metrics(metrics),
+        teeBranchLagLimit(teeBranchLagLimit),
         ioChannels(kj::mv(linkCallback)),
         worker(kj::mv(worker)),
         defaultEntrypointHandlers(kj::mv(defaultEntrypointHandlers)),
@@ -1321,6 +2166,13 @@ public:
     }
   }
 
+  kj::Maybe<kj::Duration> getRecentLockWait() override {
+    auto tracker = dynamic_cast<const LockWaitTrackingObserver*>(
+        &worker->getIsolate().getMetrics());
+    if (tracker == nullptr) return kj::none;
+    return tracker->getRecentLockWait();
+  }
+
   kj::Own<WorkerInterface> startRequest(
       IoChannelFactory::SubrequestMetadata metadata, kj::Maybe<kj::StringPtr> entrypointName,
       kj::Maybe<kj::Own<Worker::Actor>> actor = kj::none) {
@@ -1332,13 +2184,29 @@ public:
         kj::Own<LimitEnforcer>(this, kj::NullDisposer::instance),
         {},                        // ioContextDependency
         kj::Own<IoChannelFactory>(this, kj::NullDisposer::instance),
-        kj::refcounted<RequestObserver>(),  // default observer makes no observations
+        makeRequestObserver(),
         waitUntilTasks,
         true,                      // tunnelExceptions
         kj::none,                  // workerTracer
         kj::mv(metadata.cfBlobJson));
   }
 
+  kj::Own<RequestObserver> makeRequestObserver() {
+    KJ_IF_SOME(m, metrics) {
+      return m.makeRequestObserver();
+    } else {
+      return kj::refcounted<RequestObserver>();  // default observer makes no observations
+    }
+  }
+
+  kj::Own<ActorObserver> makeActorObserver() {
+    KJ_IF_SOME(m, metrics) {
+      return m.makeActorObserver();
+    } else {
+      return kj::refcounted<ActorObserver>();
+    }
+  }
+
   class ActorNamespace final: private kj::TaskSet::ErrorHandler {
   public:
     ActorNamespace(WorkerService& service, kj::StringPtr className, const ActorConfig& config)
@@ -1373,12 +2241,27 @@ public:
       return kj::heap<ActorChannelImpl>(*this, kj::mv(id));
     }
 
+    // Shuts down every actor and refuses to start more. See Server::releaseActors().
+    void release() {
+      released = true;
+      auto exception = releasedException();
+      for (auto& entry: actors) {
+        entry.value->shutdown(0, exception);
+      }
+    }
+
   private:
     WorkerService& service;
     kj::StringPtr className;
     const ActorConfig& config;
     kj::HashMap<kj::String, kj::Own<Worker::Actor>> actors;
     kj::TaskSet onBrokenTasks;
+    bool released = false;
+
+    static kj::Exception releasedException() {
+      return KJ_EXCEPTION(DISCONNECTED,
+          "Durable Object was moved to a server running a reloaded config");
+    }
 
     kj::Promise<kj::Own<WorkerInterface>> getActorThenStartRequest(
         kj::String id,
@@ -1453,6 +2336,8 @@ public:
       return service.worker->takeAsyncLockWithoutRequest(nullptr).then(
           [this, id = kj::mv(id)]
           (Worker::AsyncLock asyncLock) mutable -> kj::Own<Worker::Actor> {
+        if (released) kj::throwFatalException(releasedException());
+
         auto actor = kj::addRef(*actors.findOrCreate(id, [&]() mutable {
           auto& channels = KJ_ASSERT_NONNULL(service.ioChannels.tryGet<LinkedIoChannels>());
 
@@ -1498,7 +2383,7 @@ public:
           auto newActor = kj::refcounted<Worker::Actor>(
               *service.worker, kj::none, kj::str(id), true, kj::mv(makeActorCache),
               className, kj::mv(makeStorage), lock, kj::mv(loopback),
-              timerChannel, kj::refcounted<ActorObserver>(), kj::none, hibernationEventTypeId);
+              timerChannel, service.makeActorObserver(), kj::none, hibernationEventTypeId);
 
           // If the actor becomes broken, remove it from the map, so a new one will be created
           // next time.
@@ -1544,6 +2429,10 @@ private:
       return handlers.contains(handlerName);
     }
 
+    kj::Maybe<kj::Duration> getRecentLockWait() override {
+      return worker.getRecentLockWait();
+    }
+
   private:
     WorkerService& worker;
     kj::StringPtr entrypoint;
@@ -1551,6 +2440,8 @@ private:
   };
 
   ThreadContext& threadContext;
+  kj::Maybe<ServerMetrics&> metrics;
+  size_t teeBranchLagLimit;
 
   // LinkedIoChannels owns the SqliteDatabase::Vfs, so make sure it is destroyed last.
   kj::OneOf<LinkCallback, LinkedIoChannels> ioChannels;
@@ -1762,6 +2653,9 @@ private:
   kj::Promise<void> limitDrain() override { return kj::NEVER_DONE; }
   kj::Promise<void> limitScheduled() override { return kj::NEVER_DONE; }
   size_t getBufferingLimit() override { return kj::maxValue; }
+  // Not a limit as such: a pumped tee branch only slows its sibling down, never fails it.
+  size_t getTeeBranchLagLimit() override { return teeBranchLagLimit; }
+  void chargeCpuTime(kj::Duration cpuTime) override {}
   kj::Maybe<EventOutcome> getLimitsExceeded() override { return kj::none; }
   kj::Promise<void> onLimitsExceeded() override { return kj::NEVER_DONE; }
   void requireLimitsNotExceeded() override {}
@@ -2157,7 +3051,17 @@ kj::Own<Server::Service> Server::makeWorker(kj::StringPtr name, config::Worker::
     void reportMetrics(IsolateObserver& isolateMetrics) const override {}
   };
 
-  auto observer = kj::atomicRefcounted<IsolateObserver>();
+  kj::Maybe<ServerMetrics&> workerMetrics;
+  kj::Own<IsolateObserver> observer;
+  KJ_IF_SOME(m, metrics) {
+    workerMetrics = *m;
+    observer = m->makeIsolateObserver();
+  } else {
+    observer = kj::atomicRefcounted<IsolateObserver>();
+  }
+  if (trackLockWait) {
+    observer = kj::atomicRefcounted<LockWaitTrackingObserver>(kj::mv(observer));
+  }
   auto limitEnforcer = kj::heap<NullIsolateLimitEnforcer>();
   auto api = kj::heap<WorkerdApiIsolate>(globalContext->v8System,
       featureFlags.asReader(), *limitEnforcer, kj::atomicAddRef(*observer));
@@ -2197,9 +3101,16 @@ kj::Own<Server::Service> Server::makeWorker(kj::StringPtr name, config::Worker::
     }
   }
 
+  kj::Own<WorkerObserver> workerObserver;
+  KJ_IF_SOME(m, workerMetrics) {
+    workerObserver = m.makeWorkerObserver();
+  } else {
+    workerObserver = kj::atomicRefcounted<WorkerObserver>();
+  }
+
   auto worker = kj::atomicRefcounted<Worker>(
       kj::mv(script),
-      kj::atomicRefcounted<WorkerObserver>(),
+      kj::mv(workerObserver),
       [&](jsg::Lock& lock, const Worker::ApiIsolate& apiIsolate, v8::Local<v8::Object> target) {
         return kj::downcast<const WorkerdApiIsolate>(apiIsolate).compileGlobals(
             lock, globals, target, 1);
@@ -2269,7 +3180,7 @@ kj::Own<Server::Service> Server::makeWorker(kj::StringPtr name, config::Worker::
           reportConfigError(kj::str("service ", name, ": durableObjectStorage config refers "
               "to the service \"", diskName, "\", but that service is not a local disk service."));
         } else KJ_IF_SOME(dir, diskSvc->getWritable()) {
-          result.actorStorage = kj::heap<SqliteDatabase::Vfs>(dir);
+          result.actorStorage = makeStorageVfs(dir, diskSvc->getPath());
         } else {
           reportConfigError(kj::str("service ", name, ": durableObjectStorage config refers "
               "to the disk service \"", diskName, "\", but that service is defined read-only."));
@@ -2298,7 +3209,8 @@ kj::Own<Server::Service> Server::makeWorker(kj::StringPtr name, config::Worker::
   return kj::heap<WorkerService>(globalContext->threadContext, kj::mv(worker),
                                  kj::mv(errorReporter.defaultEntrypoint),
                                  kj::mv(errorReporter.namedEntrypoints), localActorConfigs,
-                                 kj::mv(linkCallback));
+                                 kj::mv(linkCallback), workerMetrics,
+                                 conf.getTeeBranchLagLimit());
 }
 
 // =======================================================================================
@@ -2326,6 +3238,12 @@ kj::Own<Server::Service> Server::makeService(
 
     case config::Service::DISK:
       return makeDiskDirectoryService(name, conf.getDisk(), headerTableBuilder);
+
+    case config::Service::METRICS:
+      return makeMetricsService();
+
+    case config::Service::KV:
+      return makeKvService(name, conf.getKv(), headerTableBuilder);
   }
 
   reportConfigError(kj::str(
@@ -2375,16 +3293,54 @@ Server::Service& Server::lookupService(
 
 class Server::HttpListener final: public kj::Refcounted {
 public:
+  // Settings from `Socket.admission`, copied out of the config.
+  struct AdmissionLimits {
+    uint maxConnections = 0;
+    uint maxConcurrentRequests = 0;
+    uint maxQueuedRequests = 0;
+    kj::Duration queueTimeout = 0 * kj::SECONDS;
+    kj::Maybe<kj::Duration> maxLockWait;
+    uint retryAfterSeconds = 0;
+
+    explicit AdmissionLimits(config::Socket::AdmissionControl::Reader conf)
+        : maxConnections(conf.getMaxConnections()),
+          maxConcurrentRequests(conf.getMaxConcurrentRequests()),
+          maxQueuedRequests(conf.getMaxQueuedRequests()),
+          queueTimeout(conf.getQueueTimeoutMs() * kj::MILLISECONDS),
+          retryAfterSeconds(conf.getRetryAfterSeconds()) {
+      if (conf.getMaxLockWaitMs() > 0) {
+        maxLockWait = conf.getMaxLockWaitMs() * kj::MILLISECONDS;
+      }
+    }
+
+    // Whether requests need to be admitted at all.
+    bool limitsRequests() const {
+      return maxConcurrentRequests > 0 || maxLockWait != kj::none;
+    }
+  };
+
   HttpListener(Server& owner, kj::Own<kj::ConnectionReceiver> listener, Service& service,
                kj::StringPtr physicalProtocol, kj::Own<HttpRewriter> rewriter,
-               kj::HttpHeaderTable& headerTable, kj::Timer& timer)
+               kj::HttpHeaderTable& headerTable, kj::Timer& timer, AdmissionLimits limits,
+               bool http2)
       : owner(owner), listener(kj::mv(listener)), service(service),
         headerTable(headerTable), timer(timer),
         physicalProtocol(physicalProtocol),
-        rewriter(kj::mv(rewriter)) {}
+        rewriter(kj::mv(rewriter)), limits(kj::mv(limits)), http2(http2) {}
 
   kj::Promise<void> run() {
+    // Open connections keep this object alive after we stop accepting, but the socket must be
+    // let go of right away, since it may be handed over to another Server.
+    KJ_DEFER(listener = nullptr);
+
     for (;;) {
+      while (limits.maxConnections > 0 && connectionCount >= limits.maxConnections) {
+        // Leave further clients in the listen backlog until a connection closes.
+        auto paf = kj::newPromiseAndFulfiller<void>();
+        connectionClosed = kj::mv(paf.fulfiller);
+        co_await paf.promise;
+      }
+
       kj::AuthenticatedStream stream = co_await listener->acceptAuthenticated();
 
       kj::Maybe<kj::String> cfBlobJson;
@@ -2429,7 +3385,7 @@ public:
                                         kj::Own<Connection> conn,
                                         kj::Own<kj::AsyncIoStream> stream) -> kj::Promise<void> {
         try {
-          co_await conn->listedHttp.httpServer.listenHttp(kj::mv(stream));
+          co_await conn->listen(kj::mv(stream));
         } catch (...) {
           KJ_LOG(ERROR, kj::getCaughtExceptionAsKj());
         }
@@ -2450,18 +3406,120 @@ private:
   kj::Timer& timer;
   kj::StringPtr physicalProtocol;
   kj::Own<HttpRewriter> rewriter;
+  AdmissionLimits limits;
+
+  // Whether connections speak HTTP/2 (with prior knowledge) rather than HTTP/1.1.
+  bool http2;
+
+  uint connectionCount = 0;
+
+  // Fulfilled when a connection closes, if run() is waiting for one to.
+  kj::Maybe<kj::Own<kj::PromiseFulfiller<void>>> connectionClosed;
+
+  // Requests which have been handed to the service and haven't finished.
+  uint requestCount = 0;
+
+  // A request waiting for `requestCount` to drop below `maxConcurrentRequests`.
+  struct QueuedRequest {
+    kj::Own<kj::PromiseFulfiller<void>> fulfiller;
+
+    // Set when a finishing request hands its place to this one. If the waiting request is
+    // canceled before it picks this up, dropping it passes the place on again.
+    kj::Maybe<kj::Own<void>> ticket;
+
+    kj::ListLink<QueuedRequest> link;
+  };
+  kj::List<QueuedRequest, &QueuedRequest::link> queue;
+
+  // Waits until a request may be handed to the service. Returns null if it should be turned away
+  // instead. Otherwise, the request holds its place until it drops the returned ticket.
+  kj::Promise<kj::Maybe<kj::Own<void>>> admitRequest() {
+    KJ_IF_SOME(maxLockWait, limits.maxLockWait) {
+      KJ_IF_SOME(lockWait, service.getRecentLockWait()) {
+        if (lockWait > maxLockWait) co_return kj::none;
+      }
+    }
+
+    if (limits.maxConcurrentRequests == 0 || requestCount < limits.maxConcurrentRequests) {
+      ++requestCount;
+      co_return newAdmissionTicket();
+    }
+    if (queue.size() >= limits.maxQueuedRequests) {
+      co_return kj::none;
+    }
+
+    auto paf = kj::newPromiseAndFulfiller<void>();
+    QueuedRequest waiter { .fulfiller = kj::mv(paf.fulfiller) };
+    queue.add(waiter);
+    KJ_DEFER(if (waiter.link.isLinked()) queue.remove(waiter));
+
+    co_await paf.promise.exclusiveJoin(timer.afterDelay(limits.queueTimeout));
+    co_return kj::mv(waiter.ticket);
+  }
+
+  // Returns a ticket for a place in `requestCount`, which calls finishRequest() when dropped.
+  kj::Own<void> newAdmissionTicket() {
+    return kj::heap(kj::defer([this]() { finishRequest(); }));
+  }
+
+  void finishRequest() {
+    if (queue.empty()) {
+      --requestCount;
+    } else {
+      // Hand our place straight to the request which has waited longest.
+      auto& next = queue.front();
+      queue.remove(next);
+      next.ticket = newAdmissionTicket();
+      next.fulfiller->fulfill();
+    }
+  }
+
+  kj::Promise<void> turnAway(kj::HttpService::Response& response) {
+    kj::HttpHeaders headers(headerTable);
+    headers.add("Retry-After", kj::str(limits.retryAfterSeconds));
+    co_return co_await response.sendError(503, "Service Unavailable", headers);
+  }
 
   struct Connection final: public kj::HttpService, public kj::HttpServerErrorHandler {
     Connection(HttpListener& parent, kj::Maybe<kj::String> cfBlobJson)
-        : parent(parent), cfBlobJson(kj::mv(cfBlobJson)),
-          listedHttp(parent.owner, parent.timer, parent.headerTable, *this, kj::HttpServerSettings {
-            .errorHandler = *this,
-            .webSocketCompressionMode = kj::HttpServerSettings::MANUAL_COMPRESSION
-          }) {}
+        : parent(parent), cfBlobJson(kj::mv(cfBlobJson)) {
+      kj::HttpServerSettings settings {
+        .errorHandler = *this,
+        .webSocketCompressionMode = kj::HttpServerSettings::MANUAL_COMPRESSION
+      };
+      if (parent.http2) {
+        listedHttp2.emplace(parent.owner, parent.timer, parent.headerTable, *this,
+            Http2Settings {
+              .headerTimeout = settings.headerTimeout,
+              .idleTimeout = settings.pipelineTimeout,
+            });
+      } else {
+        listedHttp.emplace(parent.owner, parent.timer, parent.headerTable, *this, settings);
+      }
+      ++parent.connectionCount;
+    }
+    ~Connection() noexcept(false) {
+      --parent.connectionCount;
+      KJ_IF_SOME(fulfiller, parent.connectionClosed) {
+        fulfiller->fulfill();
+        parent.connectionClosed = kj::none;
+      }
+    }
 
     HttpListener& parent;
     kj::Maybe<kj::String> cfBlobJson;
-    ListedHttpServer listedHttp;
+
+    // Exactly one of these is set, depending on the socket's protocol.
+    kj::Maybe<ListedHttpServer> listedHttp;
+    kj::Maybe<ListedHttp2Server> listedHttp2;
+
+    kj::Promise<void> listen(kj::Own<kj::AsyncIoStream> stream) {
+      KJ_IF_SOME(h2, listedHttp2) {
+        return h2.http2Server.listenHttp2(kj::mv(stream));
+      } else {
+        return KJ_ASSERT_NONNULL(listedHttp).httpServer.listenHttp(kj::mv(stream));
+      }
+    }
 
     class ResponseWrapper final: public kj::HttpService::Response {
     public:
@@ -2479,6 +3537,7 @@ private:
       kj::Own<kj::WebSocket> acceptWebSocket(const kj::HttpHeaders& headers) override {
         auto rewrite = headers.cloneShallow();
         rewriter.rewriteResponse(rewrite);
+        rewriter.rewriteWebSocketAcceptance(rewrite);
         return inner.acceptWebSocket(rewrite);
       }
 
@@ -2493,12 +3552,21 @@ private:
     kj::Promise<void> request(
         kj::HttpMethod method, kj::StringPtr url, const kj::HttpHeaders& headers,
         kj::AsyncInputStream& requestBody, kj::HttpService::Response& response) override {
+      kj::Maybe<kj::Own<void>> admission;
+      if (parent.limits.limitsRequests()) {
+        admission = co_await parent.admitRequest();
+        if (admission == kj::none) {
+          co_return co_await parent.turnAway(response);
+        }
+      }
+
       IoChannelFactory::SubrequestMetadata metadata;
       metadata.cfBlobJson = cfBlobJson.map([](kj::StringPtr s) { return kj::str(s); });
 
       Response* wrappedResponse = &response;
       kj::Own<ResponseWrapper> ownResponse;
-      if (parent.rewriter->needsRewriteResponse()) {
+      if (parent.rewriter->needsRewriteResponse() ||
+          parent.rewriter->rewritesWebSocketExtensions()) {
         wrappedResponse = ownResponse = kj::heap<ResponseWrapper>(response, *parent.rewriter);
       }
 
@@ -2532,10 +3600,13 @@ private:
 
 kj::Promise<void> Server::listenHttp(
     kj::Own<kj::ConnectionReceiver> listener, Service& service,
-    kj::StringPtr physicalProtocol, kj::Own<HttpRewriter> rewriter) {
+    kj::StringPtr physicalProtocol, kj::Own<HttpRewriter> rewriter,
+    config::Socket::AdmissionControl::Reader admission, config::HttpOptions::Protocol protocol) {
+  bool http2 = protocol == config::HttpOptions::Protocol::HTTP2_PRIOR_KNOWLEDGE;
   auto obj = kj::refcounted<HttpListener>(*this, kj::mv(listener), service,
                                           physicalProtocol, kj::mv(rewriter),
-                                          globalContext->headerTable, timer);
+                                          globalContext->headerTable, timer,
+                                          HttpListener::AdmissionLimits(admission), http2);
   co_return co_await obj->run();
 }
 
@@ -2549,6 +3620,9 @@ kj::Promise<void> Server::handleDrain(kj::Promise<void> drainWhen) {
   for (auto& httpServer: httpServers) {
     httpServer.httpServer.drain();
   }
+  for (auto& http2Server: http2Servers) {
+    http2Server.http2Server.drain();
+  }
 }
 
 kj::Promise<void> Server::run(jsg::V8System& v8System, config::Config::Reader config,
@@ -2560,10 +3634,23 @@ kj::Promise<void> Server::run(jsg::V8System& v8System, config::Config::Reader co
   auto [ fatalPromise, fatalFulfiller ] = kj::newPromiseAndFulfiller<void>();
   this->fatalFulfiller = kj::mv(fatalFulfiller);
 
-  auto forkedDrainWhen = handleDrain(kj::mv(drainWhen)).fork();
+  auto [ releasePromise, releaseFulfiller ] = kj::newPromiseAndFulfiller<void>();
+  this->releaseFulfiller = kj::mv(releaseFulfiller);
+
+  auto forkedDrainWhen = handleDrain(drainWhen.exclusiveJoin(kj::mv(releasePromise))).fork();
 
   startServices(v8System, config, headerTableBuilder, forkedDrainWhen);
 
+  KJ_IF_SOME(p, predecessor) {
+    predecessor = kj::none;
+    if (sawConfigErrors) {
+      // Leave the predecessor serving rather than replace it with something broken.
+      co_return;
+    }
+    inheritedSockets = p.releaseSockets();
+    p.releaseActors();
+  }
+
   auto listenPromise = listenOnSockets(config, headerTableBuilder, forkedDrainWhen);
 
   // We should have registered all headers synchronously. This is important because we want to
@@ -2574,6 +3661,52 @@ kj::Promise<void> Server::run(jsg::V8System& v8System, config::Config::Reader co
   co_return co_await listenPromise.exclusiveJoin(kj::mv(fatalPromise));
 }
 
+kj::Vector<Server::ListeningSocket> Server::releaseSockets() {
+  // A socket can only have one accept() outstanding, so ours must be canceled before a successor
+  // can listen. The canceled loops let go of the sockets synchronously.
+  socketsReleased = true;
+  acceptCanceler.cancel("sockets were handed over to a new server");
+  KJ_IF_SOME(f, releaseFulfiller) {
+    f->fulfill();
+  }
+  return kj::mv(listeningSockets);
+}
+
+void Server::releaseActors() {
+  // Our actors may still be running requests, and the successor may start the same actors as soon
+  // as it listens. Shutting them down now cancels their background work and fails any further
+  // storage operations, and ActorNamespace refuses to start them again.
+  for (auto& service: services) {
+    auto worker = dynamic_cast<WorkerService*>(service.value.get());
+    if (worker != nullptr) {
+      for (auto& ns: worker->getActorNamespaces()) {
+        ns.value->release();
+      }
+    }
+  }
+}
+
+kj::Maybe<Server::ListeningSocket> Server::claimInheritedSocket(
+    kj::StringPtr name, kj::StringPtr addr) {
+  // A socket which was passed in by the predecessor's caller is matched by name, since it has no
+  // address to match and can't be passed in again. Anything else is matched by address, so that
+  // it carries over even if the socket was renamed.
+  for (auto i: kj::indices(inheritedSockets)) {
+    auto& socket = inheritedSockets[i];
+    bool matches = socket.addr.map([&](kj::StringPtr a) { return addr != nullptr && a == addr; })
+        .orDefault(socket.name == name);
+    if (matches) {
+      auto result = kj::mv(socket);
+      if (i + 1 < inheritedSockets.size()) {
+        socket = kj::mv(inheritedSockets.back());
+      }
+      inheritedSockets.removeLast();
+      return kj::mv(result);
+    }
+  }
+  return kj::none;
+}
+
 void Server::startAlarmScheduler(config::Config::Reader config) {
   auto& clock = kj::systemPreciseCalendarClock();
   auto dir = kj::newInMemoryDirectory(clock);
@@ -2640,11 +3773,23 @@ void Server::startServices(jsg::V8System& v8System, config::Config::Reader confi
   // ---------------------------------------------------------------------------
   // Configure services
 
+  for (auto sock: config.getSockets()) {
+    if (sock.getAdmission().getMaxLockWaitMs() > 0) {
+      trackLockWait = true;
+    }
+  }
+
   // First pass: Extract actor namespace configs.
   for (auto serviceConf: config.getServices()) {
     kj::StringPtr name = serviceConf.getName();
     kj::HashMap<kj::String, ActorConfig> serviceActorConfigs;
 
+    // Observers only record metrics if something will report them, so metrics must be set up
+    // before any Workers are created.
+    if (serviceConf.isMetrics() && metrics == kj::none) {
+      metrics = kj::heap<ServerMetrics>();
+    }
+
     if (serviceConf.isWorker()) {
       auto workerConf = serviceConf.getWorker();
       bool hadDurable = false;
@@ -2815,6 +3960,17 @@ kj::Promise<void> Server::listenOnSockets(config::Config::Reader config,
     continue;
 
   validSocket:
+    // Remember where the socket was bound, so that a successor can take it over.
+    kj::Maybe<kj::String> boundAddr;
+    if (listenerOverride == kj::none) {
+      KJ_IF_SOME(inherited, claimInheritedSocket(name, addrStr)) {
+        listenerOverride = kj::mv(inherited.receiver);
+        boundAddr = kj::mv(inherited.addr);
+      } else {
+        boundAddr = kj::str(addrStr);
+      }
+    }
+
     using PromisedReceived = kj::Promise<kj::Own<kj::ConnectionReceiver>>;
     PromisedReceived listener = nullptr;
     KJ_IF_SOME(l, listenerOverride) {
@@ -2826,6 +3982,14 @@ kj::Promise<void> Server::listenOnSockets(config::Config::Reader config,
       })(network.parseAddress(addrStr, defaultPort));
     }
 
+    listener = listener.then(
+        [this, name = kj::str(name), boundAddr = kj::mv(boundAddr)]
+        (kj::Own<kj::ConnectionReceiver> receiver) mutable -> kj::Own<kj::ConnectionReceiver> {
+      auto& socket = listeningSockets.add(ListeningSocket {
+        .name = kj::mv(name), .addr = kj::mv(boundAddr), .receiver = kj::mv(receiver) });
+      return kj::Own<kj::ConnectionReceiver>(socket.receiver.get(), kj::NullDisposer::instance);
+    });
+
     KJ_IF_SOME(t, tls) {
       listener = ([](kj::Promise<kj::Own<kj::ConnectionReceiver>> promise,
                      kj::Own<kj::TlsContext> tls)
@@ -2840,7 +4004,8 @@ kj::Promise<void> Server::listenOnSockets(config::Config::Reader config,
     auto rewriter = kj::heap<HttpRewriter>(httpOptions, headerTableBuilder);
 
     auto handle = kj::coCapture(
-        [this, &service, rewriter = kj::mv(rewriter), physicalProtocol, name]
+        [this, &service, rewriter = kj::mv(rewriter), physicalProtocol, name,
+         admission = sock.getAdmission(), protocol = httpOptions.getProtocol()]
         (kj::Promise<kj::Own<kj::ConnectionReceiver>> promise)
             mutable -> kj::Promise<void> {
       auto listener = co_await promise;
@@ -2852,11 +4017,20 @@ kj::Promise<void> Server::listenOnSockets(config::Config::Reader config,
           KJ_LOG(ERROR, e);
         }
       }
-      co_await listenHttp(kj::mv(listener), service, physicalProtocol, kj::mv(rewriter));
+      co_await listenHttp(kj::mv(listener), service, physicalProtocol, kj::mv(rewriter),
+                          admission, protocol);
     });
-    tasks.add(handle(kj::mv(listener)).exclusiveJoin(forkedDrainWhen.addBranch()));
+    tasks.add(acceptCanceler.wrap(handle(kj::mv(listener)))
+        .exclusiveJoin(forkedDrainWhen.addBranch())
+        .catch_([this](kj::Exception&& e) {
+      // Being canceled by releaseSockets() is expected.
+      if (!socketsReleased) kj::throwFatalException(kj::mv(e));
+    }));
   }
 
+  // Close any sockets handed over which this config no longer listens on.
+  inheritedSockets.clear();
+
   for (auto& unmatched: socketOverrides) {
     reportConfigError(kj::str(
         "Config did not define any socket named \"", unmatched.key, "\" to match the override "
@@ -11,6 +11,7 @@
 #include <workerd/server/workerd.capnp.h>
 #include <workerd/util/sqlite.h>
 #include <workerd/server/alarm-scheduler.h>
+#include <workerd/server/http2.h>
 #include <kj/compat/http.h>
 
 namespace kj {
@@ -23,6 +24,8 @@ namespace workerd::jsg {
 
 namespace workerd::server {
 
+class ServerMetrics;
+
 // Implements the single-tenant Workers Runtime server / CLI.
 //
 // The purpose of this class is to implement the core logic independently of the CLI itself,
@@ -60,6 +63,31 @@ public:
   kj::Promise<void> run(jsg::V8System& v8System, config::Config::Reader conf,
                         kj::Promise<void> drainWhen = kj::NEVER_DONE);
 
+  // Makes run() replace `predecessor`, a Server running an earlier version of the config, so that
+  // the config can be reloaded without a gap in service. Must be called before run().
+  //
+  // The predecessor keeps its sockets until run() has built this Server's services. Then, unless
+  // that reported any config errors, the predecessor stops accepting connections, hands over each
+  // of its sockets which this config listens on at the same address, and drains. If there were
+  // errors, the predecessor is left as it was, and run() returns without listening.
+  //
+  // Note that the services are built synchronously, on the thread both Servers run on, so the
+  // predecessor can't make progress while workers compile: requests in progress stall, and new
+  // connections wait in the sockets' backlogs. They're delayed, but not refused or dropped.
+  //
+  // Durable Objects move over too: when the predecessor hands over its sockets, it shuts down
+  // its actors and refuses to start more, so that each object runs in only one of the Servers.
+  // The two Servers also share the locks on the SQLite databases in local disk directories which
+  // SQLite can't lock itself (see makeStorageVfs()), since the predecessor's actors and KV
+  // namespaces may still have those databases open.
+  //
+  // The predecessor's run() completes once the connections it had open are done, after which it
+  // may be destroyed. Its config must remain valid until then.
+  void takeOverFrom(Server& predecessor);
+
+  // Whether a successor has taken over from this Server (see takeOverFrom()).
+  bool wasReplaced() const { return socketsReleased; }
+
   // Executes one or more tests. By default, all exported test handlers from all entrypoints to
   // all services in the config are executed. Glob patterns can be specified to match specific
   // service and entrypoint names.
@@ -98,10 +126,62 @@ private:
   kj::Maybe<kj::Own<InspectorServiceIsolateRegistrar>> inspectorIsolateRegistrar;
   kj::Maybe<kj::Own<kj::FdOutputStream>> controlOverride;
 
+  kj::Maybe<Server&> predecessor;
+
+  // Lock managers for the SQLite databases in local disk directories, keyed by the directory's
+  // path. Shared with the Server's successors; see takeOverFrom().
+  struct StorageLocks;
+  kj::Own<StorageLocks> storageLocks;
+
+  // Set once reportConfigError() has been called.
+  bool sawConfigErrors = false;
+
+  // A socket which this Server listens on, underneath any TLS.
+  struct ListeningSocket {
+    kj::String name;
+
+    // The address which the socket was bound to, or none if it was passed to overrideSocket().
+    kj::Maybe<kj::String> addr;
+
+    kj::Own<kj::ConnectionReceiver> receiver;
+  };
+
+  // The sockets which this Server has started listening on. The listeners only borrow them, so
+  // that they can be handed over to a successor.
+  kj::Vector<ListeningSocket> listeningSockets;
+
+  // Sockets handed over by `predecessor`, for listenOnSockets() to claim.
+  kj::Vector<ListeningSocket> inheritedSockets;
+
+  // Wraps the loops accepting connections on `listeningSockets`, so that releaseSockets() can stop
+  // them immediately.
+  kj::Canceler acceptCanceler;
+  bool socketsReleased = false;
+
+  // Fulfilled by releaseSockets() to drain.
+  kj::Maybe<kj::Own<kj::PromiseFulfiller<void>>> releaseFulfiller;
+
+  // Stops accepting connections, starts draining, and returns the sockets, for takeOverFrom().
+  kj::Vector<ListeningSocket> releaseSockets();
+
+  // Shuts down every actor and refuses to start more, once a successor has taken over.
+  void releaseActors();
+
+  // Removes and returns the inherited socket which the socket `name` should use, if any.
+  kj::Maybe<ListeningSocket> claimInheritedSocket(kj::StringPtr name, kj::StringPtr addr);
+
   struct GlobalContext;
   // General context needed to construct workers. Initilaized early in run().
   kj::Own<GlobalContext> globalContext;
 
+  // Collects metrics for the config's metrics services, if it has any. Must outlive `services`,
+  // since workers hold observers which report into it.
+  kj::Maybe<kj::Own<ServerMetrics>> metrics;
+
+  // True if any socket sheds load based on isolate lock wait times, in which case Workers track
+  // them. Set before any Workers are created.
+  bool trackLockWait = false;
+
   class Service;
   kj::Own<Service> invalidConfigServiceSingleton;
 
@@ -136,6 +216,24 @@ private:
   // All active HttpServer objects -- used to implement drain().
   kj::List<ListedHttpServer, &ListedHttpServer::link> httpServers;
 
+  // Likewise for sockets which speak HTTP/2.
+  struct ListedHttp2Server {
+    Server& owner;
+    Http2Server http2Server;
+    kj::ListLink<ListedHttp2Server> link;
+
+    template <typename... Params>
+    ListedHttp2Server(Server& owner, Params&&... params)
+        : owner(owner), http2Server(kj::fwd<Params>(params)...) {
+      owner.http2Servers.add(*this);
+    };
+    ~ListedHttp2Server() noexcept(false) {
+      owner.http2Servers.remove(*this);
+    }
+  };
+
+  kj::List<ListedHttp2Server, &ListedHttp2Server::link> http2Servers;
+
   // Especially includes server loop tasks to listen on sockets. Any error is considered fatal.
   kj::TaskSet tasks;
 
@@ -162,6 +260,12 @@ private:
   kj::Own<Service> makeDiskDirectoryService(
       kj::StringPtr name, config::DiskDirectory::Reader conf,
       kj::HttpHeaderTable::Builder& headerTableBuilder);
+  kj::Own<Service> makeMetricsService();
+
+  // Makes a SQLite VFS for databases in the writable local disk directory `dir`, found at `path`.
+  kj::Own<SqliteDatabase::Vfs> makeStorageVfs(const kj::Directory& dir, kj::PathPtr path);
+  kj::Own<Service> makeKvService(kj::StringPtr name, config::KvNamespace::Reader conf,
+      kj::HttpHeaderTable::Builder& headerTableBuilder);
   kj::Own<Service> makeWorker(kj::StringPtr name, config::Worker::Reader conf,
       capnp::List<config::Extension>::Reader extensions);
   kj::Own<Service> makeService(
@@ -173,12 +277,16 @@ private:
   Service& lookupService(config::ServiceDesignator::Reader designator, kj::String errorContext);
 
   kj::Promise<void> listenHttp(kj::Own<kj::ConnectionReceiver> listener, Service& service,
-                               kj::StringPtr physicalProtocol, kj::Own<HttpRewriter> rewriter);
+                               kj::StringPtr physicalProtocol, kj::Own<HttpRewriter> rewriter,
+                               config::Socket::AdmissionControl::Reader admission,
+                               config::HttpOptions::Protocol protocol);
 
   class InvalidConfigService;
   class ExternalHttpService;
   class NetworkService;
   class DiskDirectoryService;
+  class MetricsService;
+  class KvService;
   class WorkerService;
   class WorkerEntrypointService;
   class HttpListener;
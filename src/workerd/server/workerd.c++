@@ -482,29 +482,14 @@ kj::Maybe<kj::Own<capnp::SchemaFile>> tryImportBulitin(kj::StringPtr name) {
 
 // =======================================================================================
 
-class CliMain: public SchemaFileImpl::ErrorReporter {
+class CliMain: public SchemaFileImpl::ErrorReporter, private kj::TaskSet::ErrorHandler {
 public:
   CliMain(kj::ProcessContext& context, char** argv)
-      : context(context), argv(argv),
-        server(*fs, io.provider->getTimer(), io.provider->getNetwork(), entropySource,
-            [&](kj::String error) {
-          if (watcher == nullptr) {
-            // TODO(someday): Don't just fail on the first error, keep going in order to report
-            //   additional errors. The tricky part is we don't currently have any signal of when
-            //   the server has completely finished loading, and also we probably don't want to
-            //   accept any connections on any of the sockets if the server is partially broken.
-            context.exitError(error);
-          } else {
-            // In --watch mode, we don't want to exit from errors, we want to wait until things
-            // change. It's OK if we try to serve requests despite brokenness since this is a
-            // development server.
-            hadErrors = true;
-            context.error(error);
-          }
-        }) {
+      : context(context), argv(argv) {
     KJ_IF_MAYBE(e, exeInfo) {
       auto& exe = *e->file;
-      auto size = exe.stat().size;
+      exeMetadata = exe.stat();
+      auto size = exeMetadata.size;
       KJ_ASSERT(size > sizeof(COMPILED_MAGIC_SUFFIX) + sizeof(uint64_t));
       kj::byte magic[sizeof(COMPILED_MAGIC_SUFFIX)];
       exe.read(size - sizeof(COMPILED_MAGIC_SUFFIX), magic);
@@ -531,10 +516,6 @@ public:
           "Unable to find and open the program executable, so unable to determine if there is a "
           "compiled-in config file. Proceeding on the assumption that there is not.");
     }
-
-    // We don't want to force people to specify top-level file IDs in `workerd` config files, as
-    // those IDs would be totally irrelevant.
-    schemaParser.setFileIdsRequired(false);
   }
 
   kj::MainFunc getMain() {
@@ -592,7 +573,7 @@ public:
         .addOption({'w', "watch"}, CLI_METHOD(watch),
                    "Watch configuration files (and server binary) and reload if they change. "
                    "Useful for development, but not recommended in production.")
-        .addOption({"experimental"}, [this]() { server.allowExperimental(); return true; },
+        .addOption({"experimental"}, CLI_METHOD(allowExperimental),
                    "Permit the use of experimental features which may break backwards "
                    "compatibility in a future release.");
   }
@@ -694,7 +675,9 @@ public:
 
   void overrideSocketAddr(kj::StringPtr param) {
     auto [ name, value ] = parseOverride(param);
-    server.overrideSocket(kj::mv(name), kj::str(value));
+    addServerOption([name = kj::mv(name), value = kj::str(value)](Server& s) {
+      s.overrideSocket(kj::str(name), kj::str(value));
+    });
   }
 
 #if _WIN32
@@ -750,28 +733,39 @@ public:
     validateSocketFd(fd, name);
 
     inheritedFds.add(fd);
-    server.overrideSocket(kj::mv(name), io.lowLevelProvider->wrapListenSocketFd(
+    // Not a server option: on a config reload, the new Server takes the socket over from the old
+    // one instead.
+    server->overrideSocket(kj::mv(name), io.lowLevelProvider->wrapListenSocketFd(
         fd, kj::LowLevelAsyncIoProvider::TAKE_OWNERSHIP));
   }
 
   void overrideDirectory(kj::StringPtr param) {
     auto [ name, value ] = parseOverride(param);
-    server.overrideDirectory(kj::mv(name), kj::str(value));
+    addServerOption([name = kj::mv(name), value = kj::str(value)](Server& s) {
+      s.overrideDirectory(kj::str(name), kj::str(value));
+    });
   }
 
   void overrideExternal(kj::StringPtr param) {
     auto [ name, value ] = parseOverride(param);
-    server.overrideExternal(kj::mv(name), kj::str(value));
+    addServerOption([name = kj::mv(name), value = kj::str(value)](Server& s) {
+      s.overrideExternal(kj::str(name), kj::str(value));
+    });
   }
 
   void enableInspector(kj::StringPtr param) {
-    server.enableInspector(kj::str(param));
+    server->enableInspector(kj::str(param));
+    inspectorEnabled = true;
+  }
+
+  void allowExperimental() {
+    addServerOption([](Server& s) { s.allowExperimental(); });
   }
 
   void enableControl(kj::StringPtr param) {
     int fd = KJ_UNWRAP_OR(param.tryParseAs<uint>(),
         CLI_ERROR("Output value must be a file descriptor (non-negative integer)."));
-    server.enableControl(fd);
+    addServerOption([fd](Server& s) { s.enableControl(fd); });
   }
 
   void watch() {
@@ -792,6 +786,8 @@ public:
   }
 
   void parseConfigFile(kj::StringPtr pathStr) {
+    configPath = kj::str(pathStr);
+
     if (pathStr == "-") {
       // Read from stdin.
 
@@ -825,9 +821,9 @@ public:
         configOwner = kj::mv(reader);
       } else {
         // Interpret as schema file.
-        schemaParser.loadCompiledTypeAndDependencies<config::Config>();
+        schemaParser->loadCompiledTypeAndDependencies<config::Config>();
 
-        parsedSchema = schemaParser.parseFile(
+        parsedSchema = schemaParser->parseFile(
             kj::heap<SchemaFileImpl>(fs->getRoot(), fs->getCurrentPath(),
                 kj::mv(path), nullptr, importPath, kj::mv(file), watcher, *this));
 
@@ -848,6 +844,7 @@ public:
   }
 
   void setConstName(kj::StringPtr name) {
+    configConstName = kj::str(name);
     auto parent = parsedSchema;
 
     for (;;) {
@@ -1004,8 +1001,10 @@ public:
     }
   }
 
+  // If `reloadInProcess` is true, config changes in --watch mode are applied by
+  // serveWithReloads() rather than by re-executing ourselves.
   template <typename Func>
-  [[noreturn]] void serveImpl(Func&& func) noexcept {
+  [[noreturn]] void serveImpl(Func&& func, bool reloadInProcess = false) noexcept {
     if (hadErrors) {
       // Can't start, stuff is broken.
       KJ_IF_MAYBE(w, watcher) {
@@ -1027,10 +1026,17 @@ public:
           KJ_MAP(flag, config.getV8Flags()) -> kj::StringPtr { return flag; });
       auto promise = func(v8System, config);
       KJ_IF_MAYBE(w, watcher) {
-        promise = promise.exclusiveJoin(waitForChanges(*w).then([this]() {
-          // Watch succeeded.
-          reloadFromConfigChange();
-        }));
+#if !_WIN32
+        if (reloadInProcess) {
+          promise = serveWithReloads(*w, v8System, config, kj::mv(promise));
+        } else
+#endif
+        {
+          promise = promise.exclusiveJoin(waitForChanges(*w).then([this]() {
+            // Watch succeeded.
+            reloadFromConfigChange();
+          }));
+        }
       }
       promise.wait(io.waitScope);
       context.exit();
@@ -1040,13 +1046,13 @@ public:
   [[noreturn]] void serve() noexcept {
     serveImpl([&](jsg::V8System& v8System, config::Config::Reader config) {
 #if _WIN32
-      return server.run(v8System, config);
+      return server->run(v8System, config);
 #else
-      return server.run(v8System, config,
+      return server->run(v8System, config,
           // Gracefully drain when SIGTERM is received.
           io.unixEventPort.onSignal(SIGTERM).ignoreResult());
 #endif
-    });
+    }, canReloadInProcess());
   }
 
   [[noreturn]] void test() noexcept {
@@ -1055,7 +1061,7 @@ public:
     kj::_::Debug::setLogLevel(kj::LogSeverity::INFO);
 
     serveImpl([&](jsg::V8System& v8System, config::Config::Reader config) {
-      return server.test(v8System, config,
+      return server->test(v8System, config,
           testServicePattern.map([](auto& s) -> kj::StringPtr { return s; }).orDefault("*"_kj),
           testEntrypointPattern.map([](auto& s) -> kj::StringPtr { return s; }).orDefault("*"_kj))
           .then([this](bool result) -> kj::Promise<void> {
@@ -1105,8 +1111,185 @@ public:
       }
     }
   }
+
+  // In --watch mode, serves until the server exits, parsing the config again whenever it changes
+  // and building a new Server to take over from the current one (see Server::takeOverFrom()).
+  // If the new config has errors, the current server keeps serving. Changes that this can't
+  // apply -- to our own binary, or to the V8 flags -- still re-execute us.
+  kj::Promise<void> serveWithReloads(FileWatcher& watcher, jsg::V8System& v8System,
+                                     config::Config::Reader currentConfig,
+                                     kj::Promise<void> running) {
+    auto forkedRunning = running.fork();
+
+    // Backs `currentConfig` once the parse state has been replaced by a newer parse. Null while
+    // `currentConfig` is the latest parse.
+    kj::Own<void> currentConfigOwner;
+
+    static auto const waitForResult = [](kj::Promise<void> promise,
+                                         bool result) -> kj::Promise<bool> {
+      co_await promise;
+      co_return result;
+    };
+
+    for (;;) {
+      bool changed = co_await waitForResult(forkedRunning.addBranch(), false)
+          .exclusiveJoin(waitForResult(waitForChanges(watcher), true));
+      if (!changed) co_return;
+
+      if (exeChanged()) {
+        reloadFromConfigChange();
+      }
+
+      // Parsing again replaces the parse state. Keep what backs the current config, unless it was
+      // already set aside and the latest parse is one that failed.
+      auto lastParse = kj::heap(kj::tuple(kj::mv(schemaParser), kj::mv(configOwner)));
+      if (currentConfigOwner == nullptr) {
+        currentConfigOwner = kj::mv(lastParse);
+      }
+
+      auto newConfig = KJ_UNWRAP_OR(reparseConfig(), {
+        context.warning(
+            "Not reloading due to config errors, waiting for config files to change...");
+        continue;
+      });
+
+      if (!sameV8Flags(currentConfig, newConfig)) {
+        // V8 can only be configured once per process.
+        reloadFromConfigChange();
+      }
+
+      auto next = makeServer();
+      next->takeOverFrom(*server);
+      auto nextRunning = next->run(v8System, newConfig,
+          io.unixEventPort.onSignal(SIGTERM).ignoreResult());
+      if (!server->wasReplaced()) {
+        // run() reported errors building the services, and left the current server in place.
+        context.warning(
+            "Not reloading due to config errors, waiting for config files to change...");
+        continue;
+      }
+
+      // The replaced server finishes the requests it has in flight, then goes away along with its
+      // config.
+      replacedServers.add(forkedRunning.addBranch()
+          .attach(kj::mv(server))
+          .attach(kj::mv(currentConfigOwner)));
+      server = kj::mv(next);
+      forkedRunning = nextRunning.fork();
+      currentConfig = newConfig;
+
+      // Write extra spaces to fully overwrite the line that waitForChanges() wrote with a CR.
+      context.warning("Reloaded due to config change.                                          ");
+    }
+  }
+
+  // Resets the parse state and parses the config file again, with the options given on the
+  // command line. Returns none if there were errors, having reported them.
+  kj::Maybe<config::Config::Reader> reparseConfig() {
+    schemaParser = newSchemaParser();
+    parsedSchema = capnp::ParsedSchema();
+    topLevelConfigConstants.clear();
+    configOwner = nullptr;
+    config = nullptr;
+    hadErrors = false;
+
+    try {
+      // Copies, since these record their arguments again.
+      parseConfigFile(kj::str(KJ_ASSERT_NONNULL(configPath)));
+      KJ_IF_MAYBE(name, configConstName) {
+        setConstName(kj::str(*name));
+      }
+    } catch (CliError& e) {
+      context.error(e.description);
+      return nullptr;
+    }
+
+    if (hadErrors) {
+      return nullptr;
+    }
+    return getConfig();
+  }
+
+  static bool sameV8Flags(config::Config::Reader a, config::Config::Reader b) {
+    auto aFlags = a.getV8Flags();
+    auto bFlags = b.getV8Flags();
+    if (aFlags.size() != bFlags.size()) return false;
+    for (auto i: kj::indices(aFlags)) {
+      if (aFlags[i] != bFlags[i]) return false;
+    }
+    return true;
+  }
+
+  // Whether our executable has been modified or replaced since we started.
+  bool exeChanged() {
+    auto& exe = KJ_ASSERT_NONNULL(exeInfo);
+    KJ_IF_MAYBE(file, fs->getRoot().tryOpenFile(fs->getCurrentPath().evalNative(exe.path))) {
+      auto metadata = (*file)->stat();
+      return metadata.hashCode != exeMetadata.hashCode ||
+             metadata.size != exeMetadata.size ||
+             metadata.lastModified != exeMetadata.lastModified;
+    } else {
+      return true;
+    }
+  }
 #endif
 
+  // Whether serve() can apply a config change by building a new Server in this process, rather
+  // than by re-executing ourselves. The inspector can't be started twice, and the config must be
+  // a file which we can parse again.
+  bool canReloadInProcess() {
+    KJ_IF_MAYBE(path, configPath) {
+      return !inspectorEnabled && *path != "-";
+    } else {
+      // The config is compiled into the binary.
+      return false;
+    }
+  }
+
+  // Creates a Server with the options from the command line applied.
+  kj::Own<Server> makeServer() {
+    auto result = kj::heap<Server>(*fs, io.provider->getTimer(), io.provider->getNetwork(),
+        entropySource, [this](kj::String error) {
+      if (watcher == nullptr) {
+        // TODO(someday): Don't just fail on the first error, keep going in order to report
+        //   additional errors. The tricky part is we don't currently have any signal of when
+        //   the server has completely finished loading, and also we probably don't want to
+        //   accept any connections on any of the sockets if the server is partially broken.
+        context.exitError(error);
+      } else {
+        // In --watch mode, we don't want to exit from errors, we want to wait until things
+        // change. It's OK if we try to serve requests despite brokenness since this is a
+        // development server.
+        hadErrors = true;
+        context.error(error);
+      }
+    });
+    for (auto& option: serverOptions) {
+      option(*result);
+    }
+    return result;
+  }
+
+  // Applies a command-line option to `server`, and remembers it for any Server created later by
+  // a config reload.
+  void addServerOption(kj::Function<void(Server&)> option) {
+    option(*server);
+    serverOptions.add(kj::mv(option));
+  }
+
+  static kj::Own<capnp::SchemaParser> newSchemaParser() {
+    auto result = kj::heap<capnp::SchemaParser>();
+    // We don't want to force people to specify top-level file IDs in `workerd` config files, as
+    // those IDs would be totally irrelevant.
+    result->setFileIdsRequired(false);
+    return result;
+  }
+
+  void taskFailed(kj::Exception&& exception) override {
+    // A Server replaced by a config reload failed while draining.
+    KJ_LOG(ERROR, exception);
+  }
+
 private:
   kj::ProcessContext& context;
   char** argv;
@@ -1120,19 +1303,29 @@ private:
   EntropySourceImpl entropySource;
 
   kj::Vector<kj::Path> importPath;
-  capnp::SchemaParser schemaParser;
+  kj::Own<capnp::SchemaParser> schemaParser = newSchemaParser();
   capnp::ParsedSchema parsedSchema;
   kj::Vector<capnp::ConstSchema> topLevelConfigConstants;
 
   kj::Own<void> configOwner;  // backing object for `config`, if it's not `schemaParser`.
   kj::Maybe<config::Config::Reader> config;
 
+  // The config file and constant given on the command line, to parse again on a reload.
+  kj::Maybe<kj::String> configPath;
+  kj::Maybe<kj::String> configConstName;
+
   kj::Vector<int> inheritedFds;
 
   kj::Maybe<kj::String> testServicePattern;
   kj::Maybe<kj::String> testEntrypointPattern;
 
-  Server server;
+  kj::Vector<kj::Function<void(Server&)>> serverOptions;
+  bool inspectorEnabled = false;
+
+  kj::Own<Server> server = makeServer();
+
+  // Servers replaced by a config reload, until they finish draining.
+  kj::TaskSet replacedServers { *this };
 
   // This is a randomly-generated 128-bit number that identifies when a binary has been compiled
   // with a specific config in order to run stand-alone.
@@ -1237,6 +1430,7 @@ private:
   }
 
   kj::Maybe<ExeInfo> exeInfo = getExecFile(context, *fs);
+  kj::FsNode::Metadata exeMetadata {};  // as of when we started
 
   bool hadErrors = false;
 
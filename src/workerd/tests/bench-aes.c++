@@ -0,0 +1,118 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+
+// AES-GCM and AES-CBC encrypt + decrypt round trips, either with one crypto.subtle call each way
+// or through crypto.EncryptionStream / crypto.DecryptionStream, written in 64 KiB chunks. AES-GCM
+// can't be decrypted as a stream, so its streamed round trip decrypts with crypto.subtle. The
+// argument is the payload size.
+
+namespace workerd {
+namespace {
+
+struct AesBenchmark: public benchmark::Fixture {
+  virtual ~AesBenchmark() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    TestFixture::SetupParams params = {
+      .mainModuleSource = R"(
+        const CHUNK_SIZE = 64 * 1024;
+        const keys = {};
+        const inputs = {};
+
+        async function getKey(name) {
+          return keys[name] ??= await crypto.subtle.importKey(
+              "raw", new Uint8Array(32), name, false, ["encrypt", "decrypt"]);
+        }
+
+        function getInput(size) {
+          if (!inputs[size]) {
+            const input = new Uint8Array(size);
+            for (let i = 0; i < size; i++) input[i] = (i * 7) % 251;
+            inputs[size] = input;
+          }
+          return inputs[size];
+        }
+
+        async function pipe(stream, data) {
+          const writer = stream.writable.getWriter();
+          for (let i = 0; i < data.byteLength; i += CHUNK_SIZE) {
+            writer.write(data.subarray(i, i + CHUNK_SIZE));
+          }
+          writer.close();
+          return new Uint8Array(await new Response(stream.readable).arrayBuffer());
+        }
+
+        export default {
+          async fetch(request) {
+            const [, mode, name, size] = new URL(request.url).pathname.split("/");
+            const key = await getKey(name);
+            const algorithm = { name, iv: new Uint8Array(16) };
+            const input = getInput(parseInt(size));
+
+            let output;
+            if (mode == "oneshot") {
+              const cipherText = await crypto.subtle.encrypt(algorithm, key, input);
+              output = new Uint8Array(await crypto.subtle.decrypt(algorithm, key, cipherText));
+            } else {
+              const cipherText =
+                  await pipe(new crypto.EncryptionStream(algorithm, key), input);
+              output = name == "AES-GCM"
+                  ? new Uint8Array(await crypto.subtle.decrypt(algorithm, key, cipherText))
+                  : await pipe(new crypto.DecryptionStream(algorithm, key), cipherText);
+            }
+            return new Response(output.byteLength == input.byteLength ? "OK" : "mismatch");
+          },
+        };
+      )"_kj};
+    fixture = kj::heap<TestFixture>(kj::mv(params));
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    fixture = nullptr;
+  }
+
+  void run(benchmark::State& state, kj::StringPtr mode, kj::StringPtr algorithm) {
+    auto url = kj::str("http://www.example.com/", mode, "/", algorithm, "/", state.range(0));
+    for (auto _ : state) {
+      auto result = fixture->runRequest(kj::HttpMethod::GET, url, ""_kj);
+      KJ_EXPECT(result.statusCode == 200);
+      KJ_EXPECT(result.body == "OK");
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+  }
+
+  kj::Own<TestFixture> fixture;
+};
+
+BENCHMARK_DEFINE_F(AesBenchmark, gcmOneShot)(benchmark::State& state) {
+  run(state, "oneshot"_kj, "AES-GCM"_kj);
+}
+
+BENCHMARK_DEFINE_F(AesBenchmark, gcmStream)(benchmark::State& state) {
+  run(state, "stream"_kj, "AES-GCM"_kj);
+}
+
+BENCHMARK_DEFINE_F(AesBenchmark, cbcOneShot)(benchmark::State& state) {
+  run(state, "oneshot"_kj, "AES-CBC"_kj);
+}
+
+BENCHMARK_DEFINE_F(AesBenchmark, cbcStream)(benchmark::State& state) {
+  run(state, "stream"_kj, "AES-CBC"_kj);
+}
+
+// 1 KiB to 16 MiB.
+BENCHMARK_REGISTER_F(AesBenchmark, gcmOneShot)
+    ->RangeMultiplier(16)->Range(1 << 10, 16 << 20)->Unit(benchmark::kMicrosecond);
+BENCHMARK_REGISTER_F(AesBenchmark, gcmStream)
+    ->RangeMultiplier(16)->Range(1 << 10, 16 << 20)->Unit(benchmark::kMicrosecond);
+BENCHMARK_REGISTER_F(AesBenchmark, cbcOneShot)
+    ->RangeMultiplier(16)->Range(1 << 10, 16 << 20)->Unit(benchmark::kMicrosecond);
+BENCHMARK_REGISTER_F(AesBenchmark, cbcStream)
+    ->RangeMultiplier(16)->Range(1 << 10, 16 << 20)->Unit(benchmark::kMicrosecond);
+
+} // namespace
+} // namespace workerd
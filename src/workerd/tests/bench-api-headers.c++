@@ -57,5 +57,36 @@ BENCHMARK_F(ApiHeaders, constructor)(benchmark::State& state) {
   });
 }
 
+// Handing header names and values to JavaScript, as iterating over Headers does. Most of these
+// are in the isolate's common string table.
+BENCHMARK_F(ApiHeaders, toJs)(benchmark::State& state) {
+  fixture->runInIoContext([&](const TestFixture::Environment& env) {
+    auto jsHeaders = jsg::alloc<api::Headers>(*kjHeaders, api::Headers::Guard::REQUEST);
+    for (auto _ : state) {
+      env.js.withinHandleScope([&]() {
+        for (auto& header: jsHeaders->getDisplayedHeaders(env.js)) {
+          benchmark::DoNotOptimize(jsg::v8StrCommon(env.js.v8Isolate, header.key));
+          benchmark::DoNotOptimize(jsg::v8StrCommon(env.js.v8Isolate, header.value));
+        }
+      });
+    }
+  });
+}
+
+// The same, creating a new string each time, for comparison.
+BENCHMARK_F(ApiHeaders, toJsUncached)(benchmark::State& state) {
+  fixture->runInIoContext([&](const TestFixture::Environment& env) {
+    auto jsHeaders = jsg::alloc<api::Headers>(*kjHeaders, api::Headers::Guard::REQUEST);
+    for (auto _ : state) {
+      env.js.withinHandleScope([&]() {
+        for (auto& header: jsHeaders->getDisplayedHeaders(env.js)) {
+          benchmark::DoNotOptimize(jsg::v8Str(env.js.v8Isolate, header.key));
+          benchmark::DoNotOptimize(jsg::v8Str(env.js.v8Isolate, header.value));
+        }
+      });
+    }
+  });
+}
+
 } // namespace
 } // namespace workerd
@@ -0,0 +1,69 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+#include <atomic>
+
+// Measures delivering many ready awaitIo() results to JavaScript in one request, and reports how
+// many times the isolate lock was taken per request to do so.
+
+namespace workerd {
+namespace {
+
+class CountingIsolateObserver final: public IsolateObserver {
+public:
+  kj::Maybe<kj::Own<LockTiming>> tryCreateLockTiming(
+      kj::OneOf<SpanParent, kj::Maybe<RequestObserver&>> parentOrRequest) const override {
+    locks.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  mutable std::atomic<uint64_t> locks = 0;
+};
+
+struct AwaitIoBenchmark: public benchmark::Fixture {
+  virtual ~AwaitIoBenchmark() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    observer = kj::atomicRefcounted<CountingIsolateObserver>();
+    TestFixture::SetupParams params = { .isolateObserver = *observer };
+    fixture = kj::heap<TestFixture>(params);
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    fixture = nullptr;
+    observer = nullptr;
+  }
+
+  kj::Own<CountingIsolateObserver> observer;
+  kj::Own<TestFixture> fixture;
+};
+
+BENCHMARK_F(AwaitIoBenchmark, readyResults)(benchmark::State& state) {
+  constexpr uint RESULTS = 100;
+  uint64_t locksBefore = observer->locks;
+
+  for (auto _ : state) {
+    fixture->runInIoContext([](const TestFixture::Environment& env) {
+      auto paf = kj::newPromiseAndFulfiller<void>();
+      auto remaining = kj::heap<uint>(RESULTS);
+      for (auto i KJ_UNUSED: kj::zeroTo(RESULTS)) {
+        env.context.awaitIo(env.js, kj::Promise<void>(kj::READY_NOW))
+            .then(env.js, [&count = *remaining, &fulfiller = *paf.fulfiller](jsg::Lock&) {
+          if (--count == 0) {
+            fulfiller.fulfill();
+          }
+        });
+      }
+      return paf.promise.attach(kj::mv(remaining), kj::mv(paf.fulfiller));
+    });
+  }
+
+  state.counters["locks"] = benchmark::Counter(
+      observer->locks - locksBefore, benchmark::Counter::kAvgIterations);
+}
+
+} // namespace
+} // namespace workerd
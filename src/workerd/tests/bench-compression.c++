@@ -0,0 +1,76 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+
+// A benchmark for CompressionStream/DecompressionStream throughput. Each request compresses and
+// then decompresses 1 MiB of mildly compressible data in the format named by the URL path.
+
+namespace workerd {
+namespace {
+
+struct CompressionBenchmark: public benchmark::Fixture {
+  virtual ~CompressionBenchmark() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    auto flags = flagsArena.initRoot<CompatibilityFlags>();
+    flags.setBrotliContentEncoding(true);
+
+    TestFixture::SetupParams params = {
+      .featureFlags = flags.asReader(),
+      .mainModuleSource = R"(
+        const input = new Uint8Array(1024 * 1024);
+        for (let i = 0; i < input.length; i++) input[i] = (i * 7) % 61;
+
+        async function pipe(stream, data) {
+          const writer = stream.writable.getWriter();
+          writer.write(data);
+          writer.close();
+          return new Uint8Array(await new Response(stream.readable).arrayBuffer());
+        }
+
+        export default {
+          async fetch(request) {
+            const format = new URL(request.url).pathname.slice(1);
+            const compressed = await pipe(new CompressionStream(format), input);
+            const output = await pipe(new DecompressionStream(format), compressed);
+            return new Response(output.byteLength == input.byteLength ? "OK" : "mismatch");
+          },
+        };
+      )"_kj};
+    fixture = kj::heap<TestFixture>(kj::mv(params));
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    fixture = nullptr;
+  }
+
+  void run(benchmark::State& state, kj::StringPtr url) {
+    for (auto _ : state) {
+      auto result = fixture->runRequest(kj::HttpMethod::GET, url, ""_kj);
+      KJ_EXPECT(result.statusCode == 200);
+      KJ_EXPECT(result.body == "OK");
+    }
+    state.SetBytesProcessed(state.iterations() * 1024 * 1024);
+  }
+
+  capnp::MallocMessageBuilder flagsArena;
+  kj::Own<TestFixture> fixture;
+};
+
+BENCHMARK_F(CompressionBenchmark, gzip)(benchmark::State& state) {
+  run(state, "http://www.example.com/gzip"_kj);
+}
+
+BENCHMARK_F(CompressionBenchmark, deflateRaw)(benchmark::State& state) {
+  run(state, "http://www.example.com/deflate-raw"_kj);
+}
+
+BENCHMARK_F(CompressionBenchmark, brotli)(benchmark::State& state) {
+  run(state, "http://www.example.com/br"_kj);
+}
+
+} // namespace
+} // namespace workerd
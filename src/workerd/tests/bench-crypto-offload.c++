@@ -0,0 +1,91 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+#include <workerd/api/node/crypto.h>
+
+// Starts a number of 100000-iteration PBKDF2 derivations, then queues one cheap piece of work
+// that needs the isolate lock, standing in for another request on the same isolate. With
+// getPbkdf() the derivations hold the lock until they are done; with getPbkdfAsync() up to
+// MAX_OFF_THREAD_OPERATIONS_PER_REQUEST of them run on the crypto thread pool and the rest still
+// run on the isolate thread. The argument is the number of derivations. The "blocked" counter is
+// how long the cheap work waited for the isolate; the iteration time is how long everything took.
+
+namespace workerd {
+namespace {
+
+constexpr uint32_t ITERATIONS = 100000;
+
+struct CryptoOffloadBenchmark: public benchmark::Fixture {
+  virtual ~CryptoOffloadBenchmark() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    fixture = kj::heap<TestFixture>();
+    fixture->runInIoContext([&](const TestFixture::Environment& env) {
+      crypto = jsg::alloc<api::node::CryptoImpl>();
+    });
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    fixture->runInIoContext([&](const TestFixture::Environment& env) {
+      crypto = nullptr;
+    });
+    fixture = nullptr;
+  }
+
+  void run(benchmark::State& state, bool offload) {
+    auto& clock = kj::systemPreciseMonotonicClock();
+    kj::Duration totalBlocked = 0 * kj::NANOSECONDS;
+
+    for (auto _ : state) {
+      fixture->runInIoContext([&](const TestFixture::Environment& env) {
+        auto& impl = *KJ_ASSERT_NONNULL(crypto);
+        auto start = clock.now();
+
+        kj::Vector<kj::Promise<void>> promises;
+        for (auto i KJ_UNUSED: kj::zeroTo(state.range(0))) {
+          auto password = kj::heapArray<kj::byte>("password"_kj.asBytes());
+          auto salt = kj::heapArray<kj::byte>("salt"_kj.asBytes());
+          if (offload) {
+            auto promise = impl.getPbkdfAsync(env.js, kj::mv(password), kj::mv(salt), ITERATIONS,
+                32, kj::str("sha256")).then(env.js, [](jsg::Lock&, kj::Array<kj::byte>) {});
+            promises.add(env.context.awaitJs(env.js, kj::mv(promise)));
+          } else {
+            impl.getPbkdf(kj::mv(password), kj::mv(salt), ITERATIONS, 32, kj::str("sha256"));
+          }
+        }
+
+        promises.add(kj::evalLater([&context = env.context, &clock, &totalBlocked, start]() {
+          return context.run([&clock, &totalBlocked, start](Worker::Lock&) {
+            totalBlocked += clock.now() - start;
+          });
+        }));
+        return kj::joinPromises(promises.releaseAsArray());
+      });
+    }
+
+    state.counters["blocked_us"] = benchmark::Counter(
+        (totalBlocked / kj::MICROSECONDS) / double(state.iterations()));
+  }
+
+  kj::Own<TestFixture> fixture;
+  kj::Maybe<jsg::Ref<api::node::CryptoImpl>> crypto;
+};
+
+BENCHMARK_DEFINE_F(CryptoOffloadBenchmark, onIsolateThread)(benchmark::State& state) {
+  run(state, false);
+}
+
+BENCHMARK_DEFINE_F(CryptoOffloadBenchmark, offloaded)(benchmark::State& state) {
+  run(state, true);
+}
+
+BENCHMARK_REGISTER_F(CryptoOffloadBenchmark, onIsolateThread)
+    ->Arg(1)->Arg(4)->Arg(8)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_REGISTER_F(CryptoOffloadBenchmark, offloaded)
+    ->Arg(1)->Arg(4)->Arg(8)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+} // namespace
+} // namespace workerd
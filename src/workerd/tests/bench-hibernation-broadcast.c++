@@ -0,0 +1,118 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+#include <workerd/io/hibernation-manager.h>
+#include <workerd/api/web-socket.h>
+
+// Sends one message to every websocket accepted by a HibernationManager while they are all
+// hibernating: natively with broadcast(), versus the way applications had to do it before,
+// which wakes every websocket with getWebSockets(), sends on each, then hibernates them again.
+// The argument is the number of websockets. Each iteration waits until every client has
+// received the message.
+
+namespace workerd {
+namespace {
+
+constexpr kj::StringPtr MESSAGE = "{\"type\":\"tick\",\"seq\":12345,\"payload\":\"hello\"}"_kj;
+
+// None of the benchmark's websockets disconnect, so no events are ever dispatched.
+class NullLoopback final: public Worker::Actor::Loopback {
+public:
+  kj::Own<WorkerInterface> getWorker(IoChannelFactory::SubrequestMetadata metadata) override {
+    KJ_UNIMPLEMENTED("not used by this benchmark");
+  }
+
+  kj::Own<Loopback> addRef() override {
+    return kj::heap<NullLoopback>();
+  }
+};
+
+struct HibernationBroadcastBenchmark: public benchmark::Fixture {
+  virtual ~HibernationBroadcastBenchmark() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    io = kj::setupAsyncIo();
+    auto& ioContext = KJ_ASSERT_NONNULL(io);
+    fixture = kj::heap<TestFixture>(TestFixture::SetupParams {
+      .waitScope = ioContext.waitScope,
+    });
+    manager = kj::heap<HibernationManagerImpl>(kj::heap<NullLoopback>(), 0);
+
+    auto count = state.range(0);
+    auto builder = kj::heapArrayBuilder<kj::Own<kj::WebSocket>>(count);
+    fixture->runInIoContext([&](const TestFixture::Environment& env) {
+      for (auto i KJ_UNUSED: kj::zeroTo(count)) {
+        auto pipe = kj::newWebSocketPipe();
+        builder.add(kj::mv(pipe.ends[1]));
+        manager->acceptWebSocket(
+            jsg::alloc<api::WebSocket>(kj::mv(pipe.ends[0]), api::WebSocket::REMOTE), nullptr);
+      }
+      manager->hibernateWebSockets(env.lock);
+    });
+    clients = builder.finish();
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    // Every websocket is hibernating at this point, so the manager holds no JavaScript objects
+    // and can be destroyed outside of the isolate lock.
+    manager = nullptr;
+    clients = nullptr;
+    fixture = nullptr;
+    io = nullptr;
+  }
+
+  kj::Promise<void> receiveAll() {
+    auto receives = kj::heapArrayBuilder<kj::Promise<void>>(clients.size());
+    for (auto& client: clients) {
+      receives.add(client->receive().ignoreResult());
+    }
+    return kj::joinPromises(receives.finish());
+  }
+
+  kj::Maybe<kj::AsyncIoContext> io;
+  kj::Own<TestFixture> fixture;
+  kj::Own<HibernationManagerImpl> manager;
+  kj::Array<kj::Own<kj::WebSocket>> clients;
+};
+
+BENCHMARK_DEFINE_F(HibernationBroadcastBenchmark, wakeAndSend)(benchmark::State& state) {
+  for (auto _ : state) {
+    fixture->runInIoContext([&](const TestFixture::Environment& env) {
+      for (auto& ws: manager->getWebSockets(env.js, nullptr)) {
+        ws->send(env.js, kj::str(MESSAGE));
+      }
+      // Hibernate again once everything has been sent, from within the same request that woke the
+      // websockets.
+      return receiveAll().then([this, &context = env.context]() {
+        return context.run([this](Worker::Lock& lock) {
+          manager->hibernateWebSockets(lock);
+        });
+      });
+    });
+  }
+  state.counters["sockets"] = benchmark::Counter(
+      state.range(0), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+BENCHMARK_DEFINE_F(HibernationBroadcastBenchmark, broadcast)(benchmark::State& state) {
+  for (auto _ : state) {
+    fixture->runInIoContext([&](const TestFixture::Environment& env) {
+      auto sent = manager->broadcast(env.js, kj::str(MESSAGE), nullptr, nullptr);
+      KJ_ASSERT(sent == clients.size());
+      return receiveAll();
+    });
+  }
+  state.counters["sockets"] = benchmark::Counter(
+      state.range(0), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+BENCHMARK_REGISTER_F(HibernationBroadcastBenchmark, wakeAndSend)
+    ->Arg(100)->Arg(1000)->Arg(10000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_REGISTER_F(HibernationBroadcastBenchmark, broadcast)
+    ->Arg(100)->Arg(1000)->Arg(10000)->Unit(benchmark::kMicrosecond);
+
+} // namespace
+} // namespace workerd
@@ -0,0 +1,176 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/server/backend-balancer.h>
+#include <kj/async-io.h>
+#include <kj/compat/http.h>
+#include <kj/timer.h>
+
+// Compares sending each request to an external server over a new connection with reusing pooled
+// connections, as an ExternalServer's HTTP client does. The server is an in-memory stand-in, so
+// this measures only connection setup and the client's own overhead, not network latency, which
+// makes new connections look cheaper than they are.
+//
+// Balancer drives the BackendBalancer an ExternalServer with several addresses uses, with stand-in
+// backends which take 1, 2, 5 and 20 ms (on a simulated clock) to respond, the slowest of which
+// also fails every request. The argument is the number of requests kept in flight. The counters
+// give the share of requests each backend got.
+
+namespace workerd {
+namespace {
+
+class OkService final: public kj::HttpService {
+public:
+  OkService(kj::HttpHeaderTable& table): table(table) {}
+
+  kj::Promise<void> request(
+      kj::HttpMethod method, kj::StringPtr url, const kj::HttpHeaders& headers,
+      kj::AsyncInputStream& requestBody, Response& response) override {
+    auto body = response.send(200, "OK", kj::HttpHeaders(table), 2);
+    auto promise = body->write("OK", 2);
+    return promise.attach(kj::mv(body));
+  }
+
+private:
+  kj::HttpHeaderTable& table;
+};
+
+// Connects to an HttpServer through an in-memory pipe.
+class PipeAddress final: public kj::NetworkAddress {
+public:
+  PipeAddress(kj::HttpServer& server, kj::TaskSet& tasks): server(server), tasks(tasks) {}
+
+  kj::Promise<kj::Own<kj::AsyncIoStream>> connect() override {
+    ++connections;
+    auto pipe = kj::newTwoWayPipe();
+    tasks.add(server.listenHttp(kj::mv(pipe.ends[1])));
+    return kj::mv(pipe.ends[0]);
+  }
+  kj::Own<kj::ConnectionReceiver> listen() override { KJ_UNIMPLEMENTED("not used"); }
+  kj::Own<kj::NetworkAddress> clone() override { KJ_UNIMPLEMENTED("not used"); }
+  kj::String toString() override { return kj::str("pipe"); }
+
+  uint connections = 0;
+
+private:
+  kj::HttpServer& server;
+  kj::TaskSet& tasks;
+};
+
+struct HttpPool: public benchmark::Fixture, private kj::TaskSet::ErrorHandler {
+  virtual ~HttpPool() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    loop = kj::heap<kj::EventLoop>();
+    ws = kj::heap<kj::WaitScope>(*loop);
+    timer = kj::heap<kj::TimerImpl>(kj::origin<kj::TimePoint>());
+    table = kj::heap<kj::HttpHeaderTable>();
+    service = kj::heap<OkService>(*table);
+    server = kj::heap<kj::HttpServer>(*timer, *table, *service);
+    tasks = kj::heap<kj::TaskSet>(*this);
+    address = kj::heap<PipeAddress>(*server, *tasks);
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    state.counters["connections"] = address->connections;
+    address = nullptr;
+    tasks = nullptr;
+    server = nullptr;
+    service = nullptr;
+    table = nullptr;
+    timer = nullptr;
+    ws = nullptr;
+    loop = nullptr;
+  }
+
+  void taskFailed(kj::Exception&& exception) override {
+    KJ_LOG(ERROR, exception);
+  }
+
+  void get(kj::HttpClient& client) {
+    kj::HttpHeaders headers(*table);
+    auto response = client.request(kj::HttpMethod::GET, "/", headers).response.wait(*ws);
+    benchmark::DoNotOptimize(response.body->readAllText().wait(*ws));
+  }
+
+  kj::Own<kj::EventLoop> loop;
+  kj::Own<kj::WaitScope> ws;
+  kj::Own<kj::TimerImpl> timer;
+  kj::Own<kj::HttpHeaderTable> table;
+  kj::Own<OkService> service;
+  kj::Own<kj::HttpServer> server;
+  kj::Own<kj::TaskSet> tasks;
+  kj::Own<PipeAddress> address;
+};
+
+BENCHMARK_F(HttpPool, NewConnectionPerRequest)(benchmark::State& state) {
+  for (auto _ : state) {
+    auto client = kj::newHttpClient(*timer, *table, *address);
+    get(*client);
+  }
+}
+
+BENCHMARK_F(HttpPool, PooledConnection)(benchmark::State& state) {
+  auto client = kj::newHttpClient(*timer, *table, *address);
+  for (auto _ : state) {
+    get(*client);
+  }
+}
+
+class Balancer: public benchmark::Fixture, private kj::TaskSet::ErrorHandler {
+public:
+  virtual ~Balancer() noexcept(true) {}
+
+  void taskFailed(kj::Exception&& exception) override {
+    KJ_LOG(ERROR, exception);
+  }
+
+  void run(benchmark::State& state) {
+    static constexpr kj::Duration LATENCIES[] = {
+      1 * kj::MILLISECONDS, 2 * kj::MILLISECONDS, 5 * kj::MILLISECONDS, 20 * kj::MILLISECONDS
+    };
+    constexpr size_t FAILING = 3;
+
+    kj::EventLoop loop;
+    kj::WaitScope ws(loop);
+    kj::TimerImpl timer(kj::origin<kj::TimePoint>());
+    server::BackendBalancer balancer(timer, kj::size(LATENCIES), {
+      .ejectAfterFailures = 3,
+      .ejectionTime = 100 * kj::MILLISECONDS,
+    });
+    int64_t inFlight = 0;
+    kj::TaskSet tasks(*this);
+
+    uint64_t picks[kj::size(LATENCIES)] = {};
+    uint64_t total = 0;
+    for (auto _ : state) {
+      // Top up the requests in flight, then let the clock run to the next response.
+      while (inFlight < state.range(0)) {
+        auto backend = balancer.pick();
+        ++picks[backend];
+        ++total;
+        ++inFlight;
+        tasks.add(balancer.track(backend, timer.afterDelay(LATENCIES[backend]), [backend]() {
+          return backend == FAILING;
+        }).then([&inFlight]() { --inFlight; }));
+      }
+      timer.advanceTo(KJ_ASSERT_NONNULL(timer.nextEvent()));
+      ws.poll();
+    }
+
+    for (auto i: kj::zeroTo(kj::size(picks))) {
+      state.counters[kj::str("backend", i).cStr()] = double(picks[i]) / total;
+    }
+  }
+};
+
+BENCHMARK_DEFINE_F(Balancer, PickAndTrack)(benchmark::State& state) {
+  run(state);
+}
+
+BENCHMARK_REGISTER_F(Balancer, PickAndTrack)->Arg(4)->Arg(64);
+
+} // namespace
+} // namespace workerd
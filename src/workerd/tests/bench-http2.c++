@@ -0,0 +1,150 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/server/http2.h>
+#include <kj/async-io.h>
+#include <kj/compat/http.h>
+#include <kj/timer.h>
+
+// Compares sending bursts of concurrent small requests over pooled HTTP/1.1 connections, which
+// need a connection per request in flight, with multiplexing them over one HTTP/2 connection.
+// The server is an in-memory stand-in, so connections cost nothing to set up and the pipe has no
+// latency; this measures framing and header handling rather than what a real network would add.
+
+namespace workerd {
+namespace {
+
+using server::Http2Server;
+
+class OkService final: public kj::HttpService {
+public:
+  OkService(kj::HttpHeaderTable& table): table(table) {}
+
+  kj::Promise<void> request(
+      kj::HttpMethod method, kj::StringPtr url, const kj::HttpHeaders& headers,
+      kj::AsyncInputStream& requestBody, Response& response) override {
+    kj::HttpHeaders responseHeaders(table);
+    responseHeaders.set(kj::HttpHeaderId::CONTENT_TYPE, "text/plain");
+    responseHeaders.add("Cache-Control", "no-store");
+    auto body = response.send(200, "OK", responseHeaders, 2);
+    auto promise = body->write("OK", 2);
+    return promise.attach(kj::mv(body));
+  }
+
+private:
+  kj::HttpHeaderTable& table;
+};
+
+// Connects to an HttpServer or Http2Server through an in-memory pipe.
+class PipeAddress final: public kj::NetworkAddress {
+public:
+  PipeAddress(kj::HttpServer& server, Http2Server& http2Server, kj::TaskSet& tasks)
+      : server(server), http2Server(http2Server), tasks(tasks) {}
+
+  bool http2 = false;
+
+  kj::Promise<kj::Own<kj::AsyncIoStream>> connect() override {
+    ++connections;
+    auto pipe = kj::newTwoWayPipe();
+    if (http2) {
+      tasks.add(http2Server.listenHttp2(kj::mv(pipe.ends[1])));
+    } else {
+      tasks.add(server.listenHttp(kj::mv(pipe.ends[1])));
+    }
+    return kj::mv(pipe.ends[0]);
+  }
+  kj::Own<kj::ConnectionReceiver> listen() override { KJ_UNIMPLEMENTED("not used"); }
+  kj::Own<kj::NetworkAddress> clone() override { KJ_UNIMPLEMENTED("not used"); }
+  kj::String toString() override { return kj::str("pipe"); }
+
+  uint connections = 0;
+
+private:
+  kj::HttpServer& server;
+  Http2Server& http2Server;
+  kj::TaskSet& tasks;
+};
+
+struct Http2: public benchmark::Fixture, private kj::TaskSet::ErrorHandler {
+  virtual ~Http2() noexcept(true) {}
+
+  // Requests in flight at once.
+  static constexpr uint BURST = 32;
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    loop = kj::heap<kj::EventLoop>();
+    ws = kj::heap<kj::WaitScope>(*loop);
+    timer = kj::heap<kj::TimerImpl>(kj::origin<kj::TimePoint>());
+    table = kj::heap<kj::HttpHeaderTable>();
+    service = kj::heap<OkService>(*table);
+    server = kj::heap<kj::HttpServer>(*timer, *table, *service);
+    http2Server = kj::heap<Http2Server>(*timer, *table, *service);
+    tasks = kj::heap<kj::TaskSet>(*this);
+    address = kj::heap<PipeAddress>(*server, *http2Server, *tasks);
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    state.counters["connections"] = address->connections;
+    address = nullptr;
+    tasks = nullptr;
+    http2Server = nullptr;
+    server = nullptr;
+    service = nullptr;
+    table = nullptr;
+    timer = nullptr;
+    ws = nullptr;
+    loop = nullptr;
+  }
+
+  void taskFailed(kj::Exception&& exception) override {
+    KJ_LOG(ERROR, exception);
+  }
+
+  void burst(kj::HttpClient& client) {
+    kj::HttpHeaders headers(*table);
+    headers.set(kj::HttpHeaderId::HOST, "example.com");
+    headers.add("User-Agent", "bench-http2");
+    headers.add("Accept", "*/*");
+
+    auto responses = kj::heapArrayBuilder<kj::Promise<kj::String>>(BURST);
+    for (uint i = 0; i < BURST; i++) {
+      responses.add(client.request(kj::HttpMethod::GET, "/", headers).response
+          .then([](kj::HttpClient::Response response) {
+        return response.body->readAllText().attach(kj::mv(response.body));
+      }));
+    }
+    benchmark::DoNotOptimize(kj::joinPromises(responses.finish()).wait(*ws));
+  }
+
+  kj::Own<kj::EventLoop> loop;
+  kj::Own<kj::WaitScope> ws;
+  kj::Own<kj::TimerImpl> timer;
+  kj::Own<kj::HttpHeaderTable> table;
+  kj::Own<OkService> service;
+  kj::Own<kj::HttpServer> server;
+  kj::Own<Http2Server> http2Server;
+  kj::Own<kj::TaskSet> tasks;
+  kj::Own<PipeAddress> address;
+};
+
+BENCHMARK_F(Http2, PooledHttp1)(benchmark::State& state) {
+  auto client = kj::newHttpClient(*timer, *table, *address);
+  for (auto _ : state) {
+    burst(*client);
+  }
+  state.SetItemsProcessed(state.iterations() * BURST);
+}
+
+BENCHMARK_F(Http2, MultiplexedHttp2)(benchmark::State& state) {
+  address->http2 = true;
+  auto client = server::newHttp2Client(*table, *address, "http");
+  for (auto _ : state) {
+    burst(*client);
+  }
+  state.SetItemsProcessed(state.iterations() * BURST);
+}
+
+} // namespace
+} // namespace workerd
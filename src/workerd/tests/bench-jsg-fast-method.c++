@@ -0,0 +1,87 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/jsg/jsg-test.h>
+
+// Compares the overhead of calling a small native method from JavaScript as a regular JSG_METHOD
+// versus a JSG_FAST_METHOD. Both register the same C++ method, so the difference is all in the
+// call path.
+
+namespace workerd::jsg::test {
+namespace {
+
+V8System v8System;
+
+class Accumulator: public Object {
+public:
+  static Ref<Accumulator> constructor() { return alloc<Accumulator>(); }
+
+  double add(double amount) { return total += amount; }
+  uint32_t sum(kj::Array<kj::byte> bytes) {
+    uint32_t result = 0;
+    for (auto b: bytes) result += b;
+    return result;
+  }
+
+  JSG_RESOURCE_TYPE(Accumulator) {
+    JSG_METHOD_NAMED(slowAdd, add);
+    JSG_FAST_METHOD(add);
+    JSG_METHOD_NAMED(slowSum, sum);
+    JSG_FAST_METHOD(sum);
+  }
+
+private:
+  double total = 0;
+};
+
+struct BenchContext: public Object, public ContextGlobal {
+  JSG_RESOURCE_TYPE(BenchContext) {
+    JSG_NESTED_TYPE(Accumulator);
+  }
+};
+JSG_DECLARE_ISOLATE_TYPE(BenchIsolate, BenchContext, Accumulator);
+
+// Each evaluation makes a million calls, so that the loop gets optimized and the cost of setting
+// up the context is negligible.
+constexpr kj::StringPtr ADD_LOOP =
+    "const a = new Accumulator();\n"
+    "let r = 0;\n"
+    "for (let i = 0; i < 1000000; i++) r = a.$(1);\n"
+    "r"_kj;
+
+constexpr kj::StringPtr SUM_LOOP =
+    "const a = new Accumulator();\n"
+    "const bytes = new Uint8Array(16).fill(1);\n"
+    "let r = 0;\n"
+    "for (let i = 0; i < 1000000; i++) r += a.$(bytes);\n"
+    "r"_kj;
+
+kj::String withMethod(kj::StringPtr code, kj::StringPtr method) {
+  auto pos = KJ_ASSERT_NONNULL(code.findFirst('$'));
+  return kj::str(code.slice(0, pos), method, code.slice(pos + 1));
+}
+
+WD_BENCH("JSG_METHOD(double)") {
+  Evaluator<BenchContext, BenchIsolate> e(v8System);
+  e.expectEval(withMethod(ADD_LOOP, "slowAdd"), "number", "1000000");
+}
+
+WD_BENCH("JSG_FAST_METHOD(double)") {
+  Evaluator<BenchContext, BenchIsolate> e(v8System);
+  e.expectEval(withMethod(ADD_LOOP, "add"), "number", "1000000");
+}
+
+WD_BENCH("JSG_METHOD(Uint8Array)") {
+  Evaluator<BenchContext, BenchIsolate> e(v8System);
+  e.expectEval(withMethod(SUM_LOOP, "slowSum"), "number", "16000000");
+}
+
+WD_BENCH("JSG_FAST_METHOD(Uint8Array)") {
+  Evaluator<BenchContext, BenchIsolate> e(v8System);
+  e.expectEval(withMethod(SUM_LOOP, "sum"), "number", "16000000");
+}
+
+}  // namespace
+}  // namespace workerd::jsg::test
@@ -0,0 +1,106 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/jsg/jsg-test.h>
+
+// Compares the ways SQL cursors can hand rows to JavaScript: a jsg::Dict per row, as they used
+// to; an object made from a JsObjectShape per row; and all rows from a shape in one call, as
+// Cursor.toArray() does. Reports rows per second.
+
+namespace workerd::jsg::test {
+namespace {
+
+V8System v8System;
+
+constexpr kj::StringPtr COLUMNS[] = {
+  "id"_kj, "name"_kj, "email"_kj, "created"_kj, "updated"_kj, "score"_kj, "flags"_kj, "note"_kj,
+};
+
+constexpr uint ROWS = 10'000;
+
+class RowSource: public Object {
+public:
+  RowSource(Lock& js)
+      : shape(js, COLUMNS),
+        names(KJ_MAP(name, kj::ArrayPtr<const kj::StringPtr>(COLUMNS)) {
+          return js.str(name).addRef(js);
+        }) {}
+
+  static Ref<RowSource> constructor(Lock& js) { return alloc<RowSource>(js); }
+
+  Dict<double, JsString> dictRow(Lock& js, double id) {
+    auto fields = kj::heapArrayBuilder<Dict<double, JsString>::Field>(names.size());
+    for (auto i: kj::indices(names)) {
+      fields.add(Dict<double, JsString>::Field { .name = names[i].getHandle(js), .value = id + i });
+    }
+    return Dict<double, JsString> { .fields = fields.finish() };
+  }
+
+  JsObject shapedRow(Lock& js, double id) {
+    return shape.instantiate(js, [&](uint i) -> JsValue { return js.num(id + i); });
+  }
+
+  JsArray shapedRows(Lock& js, double count) {
+    kj::Vector<v8::Local<v8::Value>> rows;
+    for (uint id = 0; id < count; id++) {
+      rows.add(shapedRow(js, id));
+    }
+    return JsArray(v8::Array::New(js.v8Isolate, rows.begin(), rows.size()));
+  }
+
+  JSG_RESOURCE_TYPE(RowSource) {
+    JSG_METHOD(dictRow);
+    JSG_METHOD(shapedRow);
+    JSG_METHOD(shapedRows);
+  }
+
+private:
+  JsObjectShape shape;
+  kj::Array<JsRef<JsString>> names;
+};
+
+struct BenchContext: public Object, public ContextGlobal {
+  JSG_RESOURCE_TYPE(BenchContext) {
+    JSG_NESTED_TYPE(RowSource);
+  }
+};
+JSG_DECLARE_ISOLATE_TYPE(BenchIsolate, BenchContext, RowSource);
+
+// Each loop reads one property of every row, so that the rows are used.
+constexpr kj::StringPtr PER_ROW_LOOP =
+    "const s = new RowSource();\n"
+    "let r = 0;\n"
+    "for (let i = 0; i < 10000; i++) r += s.$(i).score;\n"
+    "r"_kj;
+
+constexpr kj::StringPtr BULK_LOOP =
+    "const s = new RowSource();\n"
+    "let r = 0;\n"
+    "for (const row of s.shapedRows(10000)) r += row.score;\n"
+    "r"_kj;
+
+kj::String withMethod(kj::StringPtr code, kj::StringPtr method) {
+  auto pos = KJ_ASSERT_NONNULL(code.findFirst('$'));
+  return kj::str(code.slice(0, pos), method, code.slice(pos + 1));
+}
+
+void benchRows(benchmark::State& state, kj::String code) {
+  for (auto _ : state) {
+    Evaluator<BenchContext, BenchIsolate> e(v8System);
+    // Sum of `id + 5` over all ids.
+    e.expectEval(code, "number", "50045000");
+  }
+  state.counters["rows"] = benchmark::Counter(ROWS, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+BENCHMARK_CAPTURE(benchRows, dictPerRow, withMethod(PER_ROW_LOOP, "dictRow"))
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(benchRows, shapePerRow, withMethod(PER_ROW_LOOP, "shapedRow"))
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(benchRows, shapeBulk, kj::str(BULK_LOOP))
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+}  // namespace workerd::jsg::test
@@ -0,0 +1,98 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+#include <workerd/api/kv.h>
+
+// Repeatedly reads one hot key through a KV binding, whose backing service answers in-process
+// with a fixed value. Without `cacheTtl` every get() is a subrequest; with it, every get() after
+// the first is served from the binding's in-memory read cache. The argument is the value size.
+
+namespace workerd {
+namespace {
+
+class FixedValueKvService final: public kj::HttpService {
+public:
+  explicit FixedValueKvService(size_t size): value(kj::heapArray<byte>(size)) {
+    for (auto& b: value) b = 'x';
+  }
+
+  kj::Promise<void> request(
+      kj::HttpMethod method, kj::StringPtr url, const kj::HttpHeaders& requestHeaders,
+      kj::AsyncInputStream& requestBody, kj::HttpService::Response& response) override {
+    // Build the response headers on the request's table, which is the one the binding looks its
+    // header IDs up in.
+    auto headers = requestHeaders.cloneShallow();
+    headers.clear();
+    auto out = response.send(200, "OK", headers, value.size());
+    auto promise = out->write(value.begin(), value.size());
+    return promise.attach(kj::mv(out));
+  }
+
+private:
+  kj::Array<byte> value;
+};
+
+struct KvGetBenchmark: public benchmark::Fixture {
+  virtual ~KvGetBenchmark() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    service = kj::heap<FixedValueKvService>(state.range(0));
+    fixture = kj::heap<TestFixture>(TestFixture::SetupParams {
+      .subrequestService = *service,
+    });
+    fixture->runInIoContext([&](const TestFixture::Environment& env) {
+      kv = jsg::alloc<api::KvNamespace>(kj::Array<api::KvNamespace::AdditionalHeader>(), 0);
+    });
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    fixture->runInIoContext([&](const TestFixture::Environment& env) {
+      kv = nullptr;
+    });
+    fixture = nullptr;
+    service = nullptr;
+  }
+
+  void getHotKey(kj::Maybe<int> cacheTtl) {
+    fixture->runInIoContext([&](const TestFixture::Environment& env) {
+      api::KvNamespace::GetOptions options;
+      options.type = kj::str("text");
+      KJ_IF_MAYBE(ttl, cacheTtl) {
+        options.cacheTtl = *ttl;
+      }
+      auto promise = KJ_ASSERT_NONNULL(kv)->get(env.js, kj::str("hot-key"),
+          kj::OneOf<kj::String, api::KvNamespace::GetOptions>(kj::mv(options)), env.features)
+          .then(env.js, [](jsg::Lock&, api::KvNamespace::GetResult result) {
+        KJ_ASSERT(result != nullptr);
+      });
+      return env.context.awaitJs(env.js, kj::mv(promise));
+    });
+  }
+
+  kj::Own<FixedValueKvService> service;
+  kj::Own<TestFixture> fixture;
+  kj::Maybe<jsg::Ref<api::KvNamespace>> kv;
+};
+
+BENCHMARK_DEFINE_F(KvGetBenchmark, uncached)(benchmark::State& state) {
+  for (auto _ : state) {
+    getHotKey(nullptr);
+  }
+}
+
+BENCHMARK_DEFINE_F(KvGetBenchmark, cacheTtl)(benchmark::State& state) {
+  for (auto _ : state) {
+    getHotKey(60);
+  }
+}
+
+BENCHMARK_REGISTER_F(KvGetBenchmark, uncached)
+    ->Arg(64)->Arg(16 * 1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK_REGISTER_F(KvGetBenchmark, cacheTtl)
+    ->Arg(64)->Arg(16 * 1024)->Unit(benchmark::kMicrosecond);
+
+} // namespace
+} // namespace workerd
@@ -0,0 +1,67 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/util/base64.h>
+#include <kj/encoding.h>
+#include <kj/vector.h>
+
+// Compares the ways of assembling a Queue sendBatch() JSON body out of a batch of 100 messages of
+// 128 KiB each: encoding each message with kj::encodeBase64() and appending the result to a
+// growing buffer, versus encoding every message directly into one exactly-sized buffer.
+
+namespace workerd {
+namespace {
+
+constexpr size_t MESSAGE_COUNT = 100;
+constexpr size_t MESSAGE_SIZE = 128 * 1024;
+
+kj::ArrayPtr<const kj::byte> message() {
+  static const kj::Array<kj::byte> data = []() {
+    auto result = kj::heapArray<kj::byte>(MESSAGE_SIZE);
+    for (auto i: kj::indices(result)) {
+      result[i] = i * 31;
+    }
+    return result;
+  }();
+  return data;
+}
+
+WD_BENCH("QueueBatch::EncodeBase64AndCopy") {
+  auto data = message();
+  kj::Vector<char> body((data.size() + 2) / 3 * 4 * MESSAGE_COUNT + MESSAGE_COUNT * 32 + 32);
+  body.addAll("{\"messages\":["_kj);
+  for (auto i: kj::zeroTo(MESSAGE_COUNT)) {
+    if (i > 0) body.add(',');
+    body.addAll("{\"body\":\""_kj);
+    body.addAll(kj::encodeBase64(data));
+    body.addAll("\"}"_kj);
+  }
+  body.addAll("]}"_kj);
+  benchmark::DoNotOptimize(body.begin());
+}
+
+WD_BENCH("QueueBatch::EncodeBase64Into") {
+  auto data = message();
+  auto body = kj::heapArray<char>(13 + MESSAGE_COUNT * (11 + base64EncodedSize(data.size()))
+      + MESSAGE_COUNT - 1 + 2);
+  auto rest = body.asPtr();
+  auto append = [&](kj::StringPtr text) {
+    memcpy(rest.begin(), text.begin(), text.size());
+    rest = rest.slice(text.size(), rest.size());
+  };
+  append("{\"messages\":["_kj);
+  for (auto i: kj::zeroTo(MESSAGE_COUNT)) {
+    if (i > 0) append(","_kj);
+    append("{\"body\":\""_kj);
+    rest = encodeBase64Into(data, rest);
+    append("\"}"_kj);
+  }
+  append("]}"_kj);
+  KJ_ASSERT(rest.size() == 0);
+  benchmark::DoNotOptimize(body.begin());
+}
+
+} // namespace
+} // namespace workerd
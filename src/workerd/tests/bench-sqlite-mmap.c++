@@ -0,0 +1,90 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/util/sqlite.h>
+#include <stdlib.h>
+
+// Read-heavy workload on a database on disk, opened through the KJ-backed VFS, with and without
+// memory-mapped reads. The database is several times larger than SQLite's default page cache so
+// that most reads reach the VFS.
+
+namespace workerd {
+namespace {
+
+constexpr uint ROW_COUNT = 20'000;
+
+struct SqliteMmapBenchmark: public benchmark::Fixture {
+  virtual ~SqliteMmapBenchmark() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    const char* tmpDir = getenv("TEST_TMPDIR");
+    auto pathStr = kj::str(
+        tmpDir != nullptr ? tmpDir : "/var/tmp", "/workerd-sqlite-bench.XXXXXX");
+    KJ_ASSERT(mkdtemp(pathStr.begin()) != nullptr);
+    auto& dirPath = path.emplace(disk->getCurrentPath().evalNative(pathStr));
+    dir = disk->getRoot().openSubdir(dirPath, kj::WriteMode::MODIFY);
+
+    lockManager = SqliteDatabase::Vfs::newInProcessLockManager();
+    vfs = kj::heap<SqliteDatabase::Vfs>(*dir, *lockManager, SqliteDatabase::Vfs::Options {
+      .mmapSize = static_cast<uint64_t>(state.range(0)),
+    });
+    db = kj::heap<SqliteDatabase>(*vfs, kj::Path({"bench"}),
+        kj::WriteMode::CREATE | kj::WriteMode::MODIFY);
+    db->run("CREATE TABLE things (id INTEGER PRIMARY KEY, value BLOB);");
+    db->run("BEGIN TRANSACTION;");
+    for (auto i: kj::zeroTo(ROW_COUNT)) {
+      db->run("INSERT INTO things VALUES (?, randomblob(500));", i);
+    }
+    db->run("COMMIT TRANSACTION;");
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    db = nullptr;
+    vfs = nullptr;
+    lockManager = nullptr;
+    dir = nullptr;
+    KJ_IF_MAYBE(p, path) {
+      disk->getRoot().remove(*p);
+    }
+    path = nullptr;
+  }
+
+  kj::Own<kj::Filesystem> disk = kj::newDiskFilesystem();
+  kj::Maybe<kj::Path> path;
+  kj::Own<const kj::Directory> dir;
+  kj::Own<SqliteDatabase::LockManager> lockManager;
+  kj::Own<SqliteDatabase::Vfs> vfs;
+  kj::Own<SqliteDatabase> db;
+};
+
+BENCHMARK_DEFINE_F(SqliteMmapBenchmark, pointReads)(benchmark::State& state) {
+  auto statement = db->prepare("SELECT length(value) FROM things WHERE id = ?");
+  uint i = 0;
+  for (auto _ : state) {
+    // Stride through the table so consecutive reads land on different pages.
+    auto query = statement.run((i * 7919) % ROW_COUNT);
+    benchmark::DoNotOptimize(query.getInt(0));
+    ++i;
+  }
+}
+
+BENCHMARK_DEFINE_F(SqliteMmapBenchmark, fullScan)(benchmark::State& state) {
+  auto statement = db->prepare("SELECT SUM(length(value)) FROM things");
+  for (auto _ : state) {
+    auto query = statement.run();
+    benchmark::DoNotOptimize(query.getInt(0));
+  }
+  state.counters["rows"] = benchmark::Counter(
+      ROW_COUNT, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+// The argument is `PRAGMA mmap_size`; 0 reads every page with read().
+BENCHMARK_REGISTER_F(SqliteMmapBenchmark, pointReads)
+    ->Arg(0)->Arg(64 << 20)->Unit(benchmark::kNanosecond);
+BENCHMARK_REGISTER_F(SqliteMmapBenchmark, fullScan)
+    ->Arg(0)->Arg(64 << 20)->Unit(benchmark::kMicrosecond);
+
+} // namespace
+} // namespace workerd
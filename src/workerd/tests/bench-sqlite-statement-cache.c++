@@ -0,0 +1,76 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/util/sqlite.h>
+
+// Compares running the same few queries over and over by compiling the SQL code every time, as
+// `sql.exec()` used to, versus looking the statement up in a StatementCache.
+
+namespace workerd {
+namespace {
+
+constexpr uint ROW_COUNT = 1000;
+
+constexpr kj::StringPtr QUERIES[] = {
+  "SELECT value FROM things WHERE id = ?"_kj,
+  "SELECT COUNT(*) FROM things WHERE id < ?"_kj,
+  "UPDATE things SET value = value || 'x' WHERE id = ? AND length(value) < 20"_kj,
+};
+
+struct SqliteBenchmark: public benchmark::Fixture {
+  virtual ~SqliteBenchmark() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    dir = kj::newInMemoryDirectory(kj::nullClock());
+    vfs = kj::heap<SqliteDatabase::Vfs>(*dir);
+    db = kj::heap<SqliteDatabase>(*vfs, kj::Path({"bench"}),
+        kj::WriteMode::CREATE | kj::WriteMode::MODIFY);
+    db->run("CREATE TABLE things (id INTEGER PRIMARY KEY, value TEXT);");
+    for (auto i: kj::zeroTo(ROW_COUNT)) {
+      db->run("INSERT INTO things VALUES (?, 'value');", i);
+    }
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    db = nullptr;
+    vfs = nullptr;
+    dir = nullptr;
+  }
+
+  // Queries run on behalf of an application, as exec() does, rather than trusted ones.
+  SqliteDatabase::Regulator regulator;
+
+  kj::Own<const kj::Directory> dir;
+  kj::Own<SqliteDatabase::Vfs> vfs;
+  kj::Own<SqliteDatabase> db;
+};
+
+BENCHMARK_DEFINE_F(SqliteBenchmark, compileEveryTime)(benchmark::State& state) {
+  uint i = 0;
+  for (auto _ : state) {
+    auto query = db->run(regulator, QUERIES[i % kj::size(QUERIES)], i % ROW_COUNT);
+    benchmark::DoNotOptimize(query.isDone());
+    ++i;
+  }
+}
+
+BENCHMARK_DEFINE_F(SqliteBenchmark, statementCache)(benchmark::State& state) {
+  SqliteDatabase::StatementCache cache(*db, regulator, 100);
+  uint i = 0;
+  for (auto _ : state) {
+    auto& statement = KJ_ASSERT_NONNULL(cache.find(QUERIES[i % kj::size(QUERIES)]));
+    auto query = statement.getStatement().run(i % ROW_COUNT);
+    benchmark::DoNotOptimize(query.isDone());
+    ++i;
+  }
+  state.counters["hits"] = cache.getHits();
+  state.counters["misses"] = cache.getMisses();
+}
+
+BENCHMARK_REGISTER_F(SqliteBenchmark, compileEveryTime)->Unit(benchmark::kNanosecond);
+BENCHMARK_REGISTER_F(SqliteBenchmark, statementCache)->Unit(benchmark::kNanosecond);
+
+} // namespace
+} // namespace workerd
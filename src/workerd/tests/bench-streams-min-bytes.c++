@@ -0,0 +1,97 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+#include <workerd/api/streams/internal.h>
+#include <workerd/api/system-streams.h>
+
+// A benchmark for reading fixed-size frames with minBytes > 1, as a BYOB reader using
+// readAtLeast() does. The writer side produces each frame in many small pieces, so a reader which
+// does not honor minBytes natively needs one round trip per piece.
+
+namespace workerd {
+namespace {
+
+constexpr size_t FRAME_SIZE = 4096;
+constexpr size_t PIECE_SIZE = 64;
+constexpr size_t FRAME_COUNT = 64;
+
+kj::Promise<void> writeFrames(kj::AsyncOutputStream& out) {
+  kj::byte piece[PIECE_SIZE] = {};
+  for (auto i KJ_UNUSED: kj::zeroTo(FRAME_COUNT * FRAME_SIZE / PIECE_SIZE)) {
+    co_await out.write(piece, sizeof(piece));
+  }
+}
+
+kj::Promise<void> writeFrames(api::WritableStreamSink& out) {
+  kj::byte piece[PIECE_SIZE] = {};
+  for (auto i KJ_UNUSED: kj::zeroTo(FRAME_COUNT * FRAME_SIZE / PIECE_SIZE)) {
+    co_await out.write(piece, sizeof(piece));
+  }
+  co_await out.end();
+}
+
+kj::Promise<void> readFrames(api::ReadableStreamSource& in, size_t minBytes) {
+  kj::byte frame[FRAME_SIZE];
+  for (auto i KJ_UNUSED: kj::zeroTo(FRAME_COUNT)) {
+    size_t filled = 0;
+    while (filled < FRAME_SIZE) {
+      auto amount = co_await in.tryRead(frame + filled, kj::min(minBytes, FRAME_SIZE - filled),
+                                        FRAME_SIZE - filled);
+      KJ_ASSERT(amount > 0);
+      filled += amount;
+    }
+  }
+}
+
+struct StreamMinBytes: public benchmark::Fixture {
+  virtual ~StreamMinBytes() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    fixture = kj::heap<TestFixture>();
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    fixture = nullptr;
+  }
+
+  kj::Own<TestFixture> fixture;
+};
+
+// Socket-backed stream: a system stream wrapping one end of an in-memory two-way pipe, which
+// stands in for a TCP socket.
+BENCHMARK_DEFINE_F(StreamMinBytes, SystemStream)(benchmark::State& state) {
+  size_t minBytes = state.range(0);
+  fixture->runInIoContext([&](const TestFixture::Environment& env) -> kj::Promise<void> {
+    for (auto _ : state) {
+      auto pipe = kj::newTwoWayPipe();
+      auto source = api::newSystemStream(kj::mv(pipe.ends[0]), StreamEncoding::IDENTITY,
+                                         env.context);
+      co_await kj::joinPromises(kj::arr(
+          writeFrames(*pipe.ends[1]),
+          readFrames(*source, minBytes)));
+    }
+  });
+}
+
+BENCHMARK_DEFINE_F(StreamMinBytes, IdentityTransformStream)(benchmark::State& state) {
+  size_t minBytes = state.range(0);
+  fixture->runInIoContext([&](const TestFixture::Environment& env) -> kj::Promise<void> {
+    for (auto _ : state) {
+      auto stream = kj::refcounted<api::IdentityTransformStreamImpl>();
+      co_await kj::joinPromises(kj::arr(
+          writeFrames(*stream),
+          readFrames(*stream, minBytes)));
+    }
+  });
+}
+
+BENCHMARK_REGISTER_F(StreamMinBytes, SystemStream)
+    ->Arg(1)->Arg(FRAME_SIZE)->Unit(benchmark::kMicrosecond);
+BENCHMARK_REGISTER_F(StreamMinBytes, IdentityTransformStream)
+    ->Arg(1)->Arg(FRAME_SIZE)->Unit(benchmark::kMicrosecond);
+
+} // namespace
+} // namespace workerd
@@ -0,0 +1,137 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+#include <workerd/util/timer-wheel.h>
+#include <kj/map.h>
+
+// Compares the ways of keeping 10,000 timeouts in order: an ordered map keyed by deadline and a
+// tiebreaker, as IoContext used to, versus a TimerWheel. Half of the timeouts are canceled before
+// they fire, as is typical of timeouts guarding I/O, and the rest are popped in order.
+//
+// Timers::IoContext measures the whole setTimeout()/clearTimeout() path the wheel sits behind:
+// scheduling half as many timeouts through IoContext, with the same delays, and clearing them.
+
+namespace workerd {
+namespace {
+
+constexpr uint TIMER_COUNT = 10'000;
+constexpr kj::Date START = kj::UNIX_EPOCH + 1'700'000'000'000 * kj::MILLISECONDS;
+
+kj::ArrayPtr<const kj::Date> deadlines() {
+  static const kj::Array<kj::Date> result = []() {
+    auto result = kj::heapArrayBuilder<kj::Date>(TIMER_COUNT);
+    uint64_t x = 1;
+    for (auto i KJ_UNUSED: kj::zeroTo(TIMER_COUNT)) {
+      // Mostly short delays, with some up to a minute.
+      x = x * 6364136223846793005 + 1442695040888963407;
+      int64_t range = (x >> 60) == 0 ? 60'000 : 1'000;
+      result.add(START + int64_t((x >> 32) % range) * kj::MILLISECONDS);
+    }
+    return result.finish();
+  }();
+  return result;
+}
+
+WD_BENCH("Timers::TreeMap") {
+  struct Key {
+    kj::Date when;
+    uint tiebreaker;
+
+    inline bool operator<(const Key& other) const {
+      if (when < other.when) return true;
+      if (when > other.when) return false;
+      return tiebreaker < other.tiebreaker;
+    }
+    inline bool operator==(const Key& other) const {
+      return when == other.when && tiebreaker == other.tiebreaker;
+    }
+  };
+
+  kj::TreeMap<Key, uint> timers;
+  auto times = deadlines();
+  for (auto i: kj::indices(times)) {
+    timers.insert(Key { times[i], i }, i);
+  }
+  for (auto i: kj::indices(times)) {
+    if (i % 2 == 0) timers.erase(Key { times[i], i });
+  }
+  uint sum = 0;
+  while (timers.size() > 0) {
+    auto& front = *timers.begin();
+    sum += front.value;
+    timers.erase(front.key);
+  }
+  benchmark::DoNotOptimize(sum);
+}
+
+WD_BENCH("Timers::TimerWheel") {
+  struct Timer: public TimerWheel::Entry {
+    uint id = 0;
+  };
+
+  TimerWheel wheel;
+  auto times = deadlines();
+  auto timers = kj::heapArray<Timer>(times.size());
+  for (auto i: kj::indices(times)) {
+    timers[i].id = i;
+    wheel.insert(timers[i], times[i]);
+  }
+  for (auto i: kj::indices(times)) {
+    if (i % 2 == 0) wheel.remove(timers[i]);
+  }
+  uint sum = 0;
+  for (;;) {
+    KJ_IF_MAYBE(entry, wheel.pop()) {
+      sum += static_cast<Timer*>(entry)->id;
+    } else {
+      break;
+    }
+  }
+  benchmark::DoNotOptimize(sum);
+}
+
+struct IoContextTimersBenchmark: public benchmark::Fixture {
+  virtual ~IoContextTimersBenchmark() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    fixture = kj::heap<TestFixture>();
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    fixture = nullptr;
+  }
+
+  kj::Own<TestFixture> fixture;
+};
+
+BENCHMARK_DEFINE_F(IoContextTimersBenchmark, setAndClear)(benchmark::State& state) {
+  // IoContext allows at most MAX_TIMEOUTS at once.
+  auto times = deadlines().slice(0, TIMER_COUNT / 2);
+  TimeoutId::Generator generator;
+  kj::Vector<TimeoutId> ids(times.size());
+
+  for (auto _ : state) {
+    fixture->runInIoContext([&](const TestFixture::Environment& env) {
+      ids.clear();
+      for (auto time: times) {
+        ids.add(env.context.setTimeoutImpl(generator, false,
+            jsg::Function<void()>([](jsg::Lock&) {}), (time - START) / kj::MILLISECONDS));
+      }
+      for (auto i: kj::indices(times)) {
+        if (i % 2 == 0) env.context.clearTimeoutImpl(ids[i]);
+      }
+      for (auto i: kj::indices(times)) {
+        if (i % 2 == 1) env.context.clearTimeoutImpl(ids[i]);
+      }
+    });
+  }
+}
+
+BENCHMARK_REGISTER_F(IoContextTimersBenchmark, setAndClear)
+    ->Name("Timers::IoContext")->Unit(benchmark::kMicrosecond);
+
+} // namespace
+} // namespace workerd
@@ -0,0 +1,68 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/io/trace.h>
+#include <kj/compat/http.h>
+
+// Measures the per-request cost of recording a fetch event's info with a tracer attached:
+// building a FetchEventInfo up front and handing it to the tracer, versus letting the tracer
+// build it from the request only if it will be recorded.
+
+namespace workerd {
+namespace {
+
+struct Request {
+  kj::HttpHeaderTable table;
+  kj::HttpHeaders headers;
+  kj::String cfJson;
+
+  Request(): headers(table) {
+    headers.add("Accept", "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8");
+    headers.add("Accept-Encoding", "gzip, deflate, br");
+    headers.add("Accept-Language", "en-US,en;q=0.5");
+    headers.add("Cache-Control", "no-cache");
+    headers.add("Cookie", "session=0123456789abcdef0123456789abcdef; theme=dark");
+    headers.add("Host", "example.com");
+    headers.add("Referer", "https://example.com/some/previous/page");
+    headers.add("User-Agent",
+        "Mozilla/5.0 (X11; Linux x86_64; rv:109.0) Gecko/20100101 Firefox/115.0");
+    headers.add("X-Forwarded-For", "203.0.113.1");
+    headers.add("X-Forwarded-For", "198.51.100.2");
+    cfJson = kj::str("{\"colo\":\"SJC\",\"country\":\"US\",\"asn\":13335,"
+        "\"httpProtocol\":\"HTTP/2\",\"tlsVersion\":\"TLSv1.3\"}");
+  }
+
+  Trace::FetchEventInfo::Source source() const {
+    return {
+      .method = kj::HttpMethod::GET,
+      .url = "https://example.com/some/page?with=query"_kj,
+      .cfJson = kj::StringPtr(cfJson),
+      .headers = headers,
+    };
+  }
+};
+
+const Request& request() {
+  static const Request instance;
+  return instance;
+}
+
+void eager(PipelineLogLevel level) {
+  WorkerTracer tracer(level);
+  tracer.setEventInfo(kj::UNIX_EPOCH, Trace::FetchEventInfo(request().source()));
+}
+
+void lazy(PipelineLogLevel level) {
+  WorkerTracer tracer(level);
+  tracer.setEventInfo(kj::UNIX_EPOCH, request().source());
+}
+
+WD_BENCH("Trace::EagerEventInfo/None") { eager(PipelineLogLevel::NONE); }
+WD_BENCH("Trace::LazyEventInfo/None") { lazy(PipelineLogLevel::NONE); }
+WD_BENCH("Trace::EagerEventInfo/Full") { eager(PipelineLogLevel::FULL); }
+WD_BENCH("Trace::LazyEventInfo/Full") { lazy(PipelineLogLevel::FULL); }
+
+} // namespace
+} // namespace workerd
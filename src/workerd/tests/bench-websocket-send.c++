@@ -0,0 +1,50 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+#include <workerd/api/web-socket.h>
+
+// Measures the outgoing throughput of an api::WebSocket when the application sends many small
+// messages in one turn, as actors pushing game state or telemetry tend to. The argument is the
+// message size in bytes. Each iteration waits until the peer has received every message.
+
+namespace workerd {
+namespace {
+
+constexpr uint MESSAGES = 1000;
+
+kj::Promise<void> receiveMessages(kj::WebSocket& ws, uint count) {
+  for (auto i KJ_UNUSED: kj::zeroTo(count)) {
+    co_await ws.receive();
+  }
+}
+
+static void bench_websocket_send(benchmark::State& state) {
+  TestFixture fixture;
+  auto message = kj::str(kj::repeat('x', state.range(0)));
+
+  for (auto _ : state) {
+    fixture.runInIoContext([&](const TestFixture::Environment& env) {
+      auto pipe = kj::newWebSocketPipe();
+      auto ws = jsg::alloc<api::WebSocket>(kj::mv(pipe.ends[0]), api::WebSocket::REMOTE);
+      ws->accept(env.js);
+      for (auto i KJ_UNUSED: kj::zeroTo(MESSAGES)) {
+        ws->send(env.js, kj::str(message));
+      }
+      KJ_ASSERT(ws->getBufferedAmount() == MESSAGES * message.size());
+      auto& peer = *pipe.ends[1];
+      return receiveMessages(peer, MESSAGES).attach(kj::mv(pipe.ends[1]));
+    });
+  }
+
+  state.counters["messages"] = benchmark::Counter(
+      MESSAGES, benchmark::Counter::kIsIterationInvariantRate);
+  state.SetBytesProcessed(state.iterations() * MESSAGES * message.size());
+}
+
+BENCHMARK(bench_websocket_send)->Arg(16)->Arg(1024)->Unit(benchmark::kMicrosecond);
+
+} // namespace
+} // namespace workerd
@@ -55,10 +55,49 @@ struct MockTimerChannel final: public TimerChannel {
   kj::Promise<void> afterLimitTimeout(kj::Duration t) override { return kj::NEVER_DONE; }
 };
 
+// Delivers subrequests to the kj::HttpService given in SetupParams::subrequestService.
+class HttpServiceWorkerInterface final: public WorkerInterface {
+public:
+  explicit HttpServiceWorkerInterface(kj::HttpService& service): service(service) {}
+
+  kj::Promise<void> request(
+      kj::HttpMethod method, kj::StringPtr url, const kj::HttpHeaders& headers,
+      kj::AsyncInputStream& requestBody, kj::HttpService::Response& response) override {
+    return service.request(method, url, headers, requestBody, response);
+  }
+
+  kj::Promise<void> connect(kj::StringPtr host, const kj::HttpHeaders& headers,
+      kj::AsyncIoStream& connection, ConnectResponse& response,
+      kj::HttpConnectSettings settings) override {
+    return service.connect(host, headers, connection, response, settings);
+  }
+
+  void prewarm(kj::StringPtr url) override {}
+
+  kj::Promise<ScheduledResult> runScheduled(kj::Date scheduledTime, kj::StringPtr cron) override {
+    KJ_FAIL_REQUIRE("NOT SUPPORTED");
+  }
+
+  kj::Promise<AlarmResult> runAlarm(kj::Date scheduledTime) override {
+    KJ_FAIL_REQUIRE("NOT SUPPORTED");
+  }
+
+  kj::Promise<CustomEvent::Result> customEvent(kj::Own<CustomEvent> event) override {
+    KJ_FAIL_REQUIRE("NOT SUPPORTED");
+  }
+
+private:
+  kj::HttpService& service;
+};
+
 struct DummyIoChannelFactory final: public IoChannelFactory {
-  DummyIoChannelFactory(TimerChannel& timer): timer(timer) {}
+  DummyIoChannelFactory(TimerChannel& timer, kj::Maybe<kj::HttpService&> subrequestService)
+      : timer(timer), subrequestService(subrequestService) {}
 
   kj::Own<WorkerInterface> startSubrequest(uint channel, SubrequestMetadata metadata) override {
+    KJ_IF_MAYBE(service, subrequestService) {
+      return kj::heap<HttpServiceWorkerInterface>(*service);
+    }
     KJ_FAIL_ASSERT("no subrequests");
   }
 
@@ -88,6 +127,7 @@ struct DummyIoChannelFactory final: public IoChannelFactory {
   }
 
   TimerChannel& timer;
+  kj::Maybe<kj::HttpService&> subrequestService;
 };
 
 static constexpr kj::StringPtr mainModuleSource = R"SCRIPT(
@@ -128,6 +168,8 @@ struct MockLimitEnforcer final: public LimitEnforcer {
   kj::Promise<void> limitDrain() override { return kj::NEVER_DONE; }
   kj::Promise<void> limitScheduled() override { return kj::NEVER_DONE; }
   size_t getBufferingLimit() override { return kj::maxValue; }
+  size_t getTeeBranchLagLimit() override { return kj::maxValue; }
+  void chargeCpuTime(kj::Duration cpuTime) override {}
   kj::Maybe<EventOutcome> getLimitsExceeded() override { return nullptr; }
   kj::Promise<void> onLimitsExceeded() override { return kj::NEVER_DONE; }
   void requireLimitsNotExceeded() override {}
@@ -230,6 +272,13 @@ struct MockResponse final: public kj::HttpService::Response {
   }
 };
 
+kj::Own<IsolateObserver> makeIsolateObserver(kj::Maybe<IsolateObserver&> observer) {
+  KJ_IF_MAYBE(o, observer) {
+    return kj::atomicAddRef(*o);
+  }
+  return kj::atomicRefcounted<IsolateObserver>();
+}
+
 struct MemoryInputStream final: public kj::AsyncInputStream {
   kj::ArrayPtr<const byte> data;
 
@@ -266,7 +315,7 @@ TestFixture::TestFixture(SetupParams params)
       kj::atomicRefcounted<IsolateObserver>())),
     workerIsolate(kj::atomicRefcounted<Worker::Isolate>(
       kj::mv(apiIsolate),
-      kj::atomicRefcounted<IsolateObserver>(),
+      makeIsolateObserver(params.isolateObserver),
       scriptId,
       kj::mv(isolateLimitEnforcer),
       Worker::Isolate::InspectorPolicy::DISALLOW)),
@@ -325,7 +374,8 @@ kj::Own<IoContext::IncomingRequest> TestFixture::createIncomingRequest() {
   auto context = kj::refcounted<IoContext>(
       threadContext, kj::atomicAddRef(*worker), nullptr, kj::heap<MockLimitEnforcer>());
   auto incomingRequest = kj::heap<IoContext::IncomingRequest>(
-      kj::addRef(*context), kj::heap<DummyIoChannelFactory>(*timerChannel),
+      kj::addRef(*context),
+      kj::heap<DummyIoChannelFactory>(*timerChannel, params.subrequestService),
       kj::refcounted<RequestObserver>(), nullptr);
   incomingRequest->delivered();
   return incomingRequest;
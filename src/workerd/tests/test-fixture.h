@@ -23,6 +23,10 @@ struct TestFixture {
     kj::Maybe<kj::WaitScope&> waitScope;
     kj::Maybe<CompatibilityFlags::Reader> featureFlags;
     kj::Maybe<kj::StringPtr> mainModuleSource;
+    // If set, used (with an added reference) as the observer of the worker's isolate.
+    kj::Maybe<IsolateObserver&> isolateObserver;
+    // If set, subrequests on every channel (such as a KV binding's) are delivered to this service.
+    kj::Maybe<kj::HttpService&> subrequestService;
   };
 
   TestFixture(SetupParams params = { });
@@ -0,0 +1,52 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+#include "base64.h"
+#include <kj/encoding.h>
+#include <kj/test.h>
+
+namespace workerd {
+namespace {
+
+KJ_TEST("encodeBase64Into matches kj::encodeBase64") {
+  kj::byte data[256];
+  for (auto i: kj::indices(data)) {
+    data[i] = i * 7 + 3;
+  }
+
+  for (size_t size: {0, 1, 2, 3, 4, 5, 6, 100, 255, 256}) {
+    auto input = kj::arrayPtr(data, size);
+    auto expected = kj::encodeBase64(input);
+    KJ_EXPECT(base64EncodedSize(size) == expected.size());
+
+    char buffer[400];
+    auto rest = encodeBase64Into(input, buffer);
+    auto written = kj::arrayPtr(buffer, rest.begin());
+    KJ_EXPECT(kj::str(written) == expected, size);
+    KJ_EXPECT(rest.size() == sizeof(buffer) - expected.size());
+  }
+}
+
+KJ_TEST("encodeBase64Into known values") {
+  auto encode = [](kj::StringPtr text) {
+    auto result = kj::heapString(base64EncodedSize(text.size()));
+    auto rest = encodeBase64Into(text.asBytes(), result);
+    KJ_EXPECT(rest.size() == 0);
+    return result;
+  };
+
+  KJ_EXPECT(encode("") == "");
+  KJ_EXPECT(encode("f") == "Zg==");
+  KJ_EXPECT(encode("fo") == "Zm8=");
+  KJ_EXPECT(encode("foo") == "Zm9v");
+  KJ_EXPECT(encode("foobar") == "Zm9vYmFy");
+}
+
+KJ_TEST("encodeBase64Into rejects a short buffer") {
+  char buffer[3];
+  KJ_EXPECT_THROW_MESSAGE("base64 output buffer too small",
+      encodeBase64Into("a"_kj.asBytes(), buffer));
+}
+
+}  // namespace
+}  // namespace workerd
@@ -0,0 +1,56 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+#include "base64.h"
+#include <kj/debug.h>
+
+namespace workerd {
+
+namespace {
+constexpr char BASE64_CHARS[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+}  // namespace
+
+kj::ArrayPtr<char> encodeBase64Into(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<char> output) {
+  auto encodedSize = base64EncodedSize(input.size());
+  KJ_REQUIRE(output.size() >= encodedSize, "base64 output buffer too small",
+      input.size(), output.size());
+
+  const kj::byte* in = input.begin();
+  const kj::byte* fullEnd = in + input.size() / 3 * 3;
+  char* out = output.begin();
+
+  for (; in < fullEnd; in += 3) {
+    uint32_t group = (uint32_t(in[0]) << 16) | (uint32_t(in[1]) << 8) | in[2];
+    out[0] = BASE64_CHARS[(group >> 18) & 0x3f];
+    out[1] = BASE64_CHARS[(group >> 12) & 0x3f];
+    out[2] = BASE64_CHARS[(group >> 6) & 0x3f];
+    out[3] = BASE64_CHARS[group & 0x3f];
+    out += 4;
+  }
+
+  switch (input.end() - in) {
+    case 1: {
+      uint32_t group = uint32_t(in[0]) << 16;
+      out[0] = BASE64_CHARS[(group >> 18) & 0x3f];
+      out[1] = BASE64_CHARS[(group >> 12) & 0x3f];
+      out[2] = '=';
+      out[3] = '=';
+      out += 4;
+      break;
+    }
+    case 2: {
+      uint32_t group = (uint32_t(in[0]) << 16) | (uint32_t(in[1]) << 8);
+      out[0] = BASE64_CHARS[(group >> 18) & 0x3f];
+      out[1] = BASE64_CHARS[(group >> 12) & 0x3f];
+      out[2] = BASE64_CHARS[(group >> 6) & 0x3f];
+      out[3] = '=';
+      out += 4;
+      break;
+    }
+  }
+
+  return output.slice(encodedSize, output.size());
+}
+
+}  // namespace workerd
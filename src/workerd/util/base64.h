@@ -0,0 +1,21 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+#pragma once
+
+#include <kj/common.h>
+
+namespace workerd {
+
+// Number of characters needed to hold the padded base64 encoding of `size` bytes.
+constexpr size_t base64EncodedSize(size_t size) {
+  return (size + 2) / 3 * 4;
+}
+
+// Encodes `input` as padded base64 (standard alphabet, no line breaks) directly into `output`,
+// which must be at least `base64EncodedSize(input.size())` characters long. Returns the part of
+// `output` following the encoded text, so that callers can assemble larger documents in a single
+// preallocated buffer. Unlike `kj::encodeBase64()`, this does not allocate.
+kj::ArrayPtr<char> encodeBase64Into(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<char> output);
+
+}  // namespace workerd
@@ -0,0 +1,89 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "object-arena.h"
+#include <kj/test.h>
+#include <kj/vector.h>
+
+namespace workerd {
+namespace {
+
+struct Counted {
+  Counted(uint& count, uint value): count(count), value(value) { ++count; }
+  ~Counted() noexcept(false) { --count; }
+  KJ_DISALLOW_COPY_AND_MOVE(Counted);
+
+  uint& count;
+  uint value;
+};
+
+struct Big {
+  kj::byte data[4096];
+};
+
+KJ_TEST("ObjectArena allocates and destroys objects") {
+  uint count = 0;
+  ObjectArena arena;
+  KJ_EXPECT(arena.getReservedBytes() == 0);
+
+  {
+    kj::Vector<kj::Own<Counted>> objects;
+    for (uint i = 0; i < 1000; i++) {
+      objects.add(arena.allocate<Counted>(count, i));
+    }
+    KJ_EXPECT(count == 1000);
+    for (uint i = 0; i < 1000; i++) {
+      KJ_EXPECT(objects[i]->value == i);
+    }
+  }
+  KJ_EXPECT(count == 0);
+
+  auto reserved = arena.getReservedBytes();
+  KJ_EXPECT(reserved > 0);
+
+  // Freed memory is reused, so allocating as many objects again takes no more memory.
+  {
+    kj::Vector<kj::Own<Counted>> objects;
+    for (uint i = 0; i < 1000; i++) {
+      objects.add(arena.allocate<Counted>(count, i));
+    }
+  }
+  KJ_EXPECT(arena.getReservedBytes() == reserved);
+
+  // Objects too big for the arena go on the heap.
+  auto big = arena.allocate<Big>();
+  big->data[4095] = 1;
+  KJ_EXPECT(arena.getReservedBytes() == reserved);
+}
+
+KJ_TEST("ObjectArena objects can be owned as their base type") {
+  struct Base {
+    virtual ~Base() noexcept(false) = default;
+  };
+  struct Derived: public Base {
+    Derived(bool& destroyed): destroyed(destroyed) {}
+    ~Derived() noexcept(false) { destroyed = true; }
+    bool& destroyed;
+  };
+
+  ObjectArena arena;
+  bool destroyed = false;
+  kj::Own<Base> object = arena.allocate<Derived>(destroyed);
+  object = nullptr;
+  KJ_EXPECT(destroyed);
+}
+
+KJ_TEST("ObjectArena releases the slot when a constructor throws") {
+  struct Throws {
+    Throws() { KJ_FAIL_REQUIRE("nope"); }
+  };
+
+  ObjectArena arena;
+  KJ_EXPECT_THROW_MESSAGE("nope", arena.allocate<Throws>());
+
+  // Otherwise, destroying the arena would complain that an object is still alive.
+}
+
+}  // namespace
+}  // namespace workerd
@@ -0,0 +1,80 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "object-arena.h"
+#include <kj/debug.h>
+#include <new>
+
+namespace workerd {
+
+struct ObjectArena::Chunk {
+  // Null if the arena was destroyed while objects in this chunk were still alive.
+  ObjectArena* arena;
+  Chunk* next;
+};
+
+ObjectArena::~ObjectArena() noexcept(false) {
+  if (liveObjects > 0) {
+    // Leak the chunks rather than free memory which is still in use, and leave the objects in
+    // them no arena to return to.
+    KJ_LOG(ERROR, "ObjectArena destroyed before the objects allocated from it", liveObjects,
+        kj::getStackTrace());
+    for (auto chunk = chunks; chunk != nullptr; chunk = chunk->next) {
+      chunk->arena = nullptr;
+    }
+    return;
+  }
+
+  while (chunks != nullptr) {
+    auto next = chunks->next;
+    ::operator delete(chunks, std::align_val_t(CHUNK_SIZE));
+    chunks = next;
+  }
+}
+
+void* ObjectArena::allocateSlot(size_t slotClass) {
+  static_assert(sizeof(Chunk) <= ALIGNMENT);
+  ++liveObjects;
+
+  auto& freeSlot = freeSlots[slotClass];
+  if (freeSlot != nullptr) {
+    auto result = freeSlot;
+    freeSlot = result->next;
+    return result;
+  }
+
+  auto size = slotClass * ALIGNMENT;
+  if (size_t(end - pos) < size) {
+    // Whatever is left of the current chunk is wasted, but chunks are much bigger than objects,
+    // so it's never much.
+    auto chunk = static_cast<Chunk*>(::operator new(CHUNK_SIZE, std::align_val_t(CHUNK_SIZE)));
+    chunk->arena = this;
+    chunk->next = chunks;
+    chunks = chunk;
+    reservedBytes += CHUNK_SIZE;
+
+    pos = reinterpret_cast<kj::byte*>(chunk) + ALIGNMENT;
+    end = reinterpret_cast<kj::byte*>(chunk) + CHUNK_SIZE;
+  }
+
+  auto result = pos;
+  pos += size;
+  return result;
+}
+
+void ObjectArena::release(void* pointer, size_t slotClass) {
+  auto chunk = reinterpret_cast<Chunk*>(
+      reinterpret_cast<uintptr_t>(pointer) & ~uintptr_t(CHUNK_SIZE - 1));
+  auto arena = chunk->arena;
+  if (arena == nullptr) {
+    return;
+  }
+
+  auto slot = static_cast<FreeSlot*>(pointer);
+  slot->next = arena->freeSlots[slotClass];
+  arena->freeSlots[slotClass] = slot;
+  --arena->liveObjects;
+}
+
+}  // namespace workerd
@@ -0,0 +1,105 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/memory.h>
+#include <kj/exception.h>
+
+namespace workerd {
+
+// Allocates small objects which are created and destroyed on one thread and mostly die together,
+// like the objects an IoContext owns. Objects are carved out of large chunks, memory freed by
+// individual objects is recycled through per-size free lists, and the chunks all go back to the
+// heap at once when the arena is destroyed.
+//
+// Objects must be destroyed on the arena's thread, before the arena is.
+class ObjectArena {
+public:
+  ObjectArena() = default;
+  ~ObjectArena() noexcept(false);
+  KJ_DISALLOW_COPY_AND_MOVE(ObjectArena);
+
+  // Like kj::heap<T>(), but allocates from the arena.
+  template <typename T, typename... Params>
+  kj::Own<T> allocate(Params&&... params) {
+    return kj::Own<T>(construct<T>(kj::fwd<Params>(params)...), disposer<T>());
+  }
+
+  // Allocates and constructs a T which must be disposed of by disposer<T>(), for callers which
+  // need to construct the kj::Own themselves. Objects too big for the arena go on the heap.
+  template <typename T, typename... Params>
+  T* construct(Params&&... params);
+
+  template <typename T>
+  static const kj::Disposer& disposer();
+
+  // Bytes of memory the arena has taken from the heap.
+  size_t getReservedBytes() const { return reservedBytes; }
+
+private:
+  static constexpr size_t ALIGNMENT = 16;
+  static constexpr size_t MAX_OBJECT_SIZE = 512;
+
+  // Chunks are aligned to their size, so an object can find its chunk, and from that its arena,
+  // without storing anything alongside it.
+  static constexpr size_t CHUNK_SIZE = 16384;
+
+  template <typename T>
+  static constexpr bool FITS = sizeof(T) <= MAX_OBJECT_SIZE && alignof(T) <= ALIGNMENT;
+
+  static constexpr size_t sizeClass(size_t size) { return (size + ALIGNMENT - 1) / ALIGNMENT; }
+
+  struct Chunk;
+  struct FreeSlot {
+    FreeSlot* next;
+  };
+
+  template <typename T>
+  class Disposer final: public kj::Disposer {
+  public:
+    static const Disposer instance;
+
+    void disposeImpl(void* pointer) const override {
+      static_cast<T*>(pointer)->~T();
+      release(pointer, sizeClass(sizeof(T)));
+    }
+  };
+
+  Chunk* chunks = nullptr;
+  kj::byte* pos = nullptr;
+  kj::byte* end = nullptr;
+  FreeSlot* freeSlots[MAX_OBJECT_SIZE / ALIGNMENT + 1] = {};
+  size_t reservedBytes = 0;
+  size_t liveObjects = 0;
+
+  void* allocateSlot(size_t slotClass);
+  static void release(void* pointer, size_t slotClass);
+};
+
+template <typename T, typename... Params>
+T* ObjectArena::construct(Params&&... params) {
+  if constexpr (FITS<T>) {
+    auto slot = static_cast<T*>(allocateSlot(sizeClass(sizeof(T))));
+    KJ_ON_SCOPE_FAILURE(release(slot, sizeClass(sizeof(T))));
+    kj::ctor(*slot, kj::fwd<Params>(params)...);
+    return slot;
+  } else {
+    return new T(kj::fwd<Params>(params)...);
+  }
+}
+
+template <typename T>
+const kj::Disposer& ObjectArena::disposer() {
+  if constexpr (FITS<T>) {
+    return Disposer<T>::instance;
+  } else {
+    return kj::_::HeapDisposer<T>::instance;
+  }
+}
+
+template <typename T>
+const ObjectArena::Disposer<T> ObjectArena::Disposer<T>::instance = ObjectArena::Disposer<T>();
+
+}  // namespace workerd
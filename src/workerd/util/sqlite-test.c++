@@ -202,6 +202,60 @@ KJ_TEST("SQLite backed by real disk") {
   }
 }
 
+KJ_TEST("SQLite KJ VFS on real disk with mmap and WAL") {
+  // Passing a LockManager forces the KJ filesystem code path even though the directory is on disk.
+  // That path serves reads through a memory mapping when `PRAGMA mmap_size` allows it.
+
+  TempDirOnDisk dir;
+  auto lockManager = SqliteDatabase::Vfs::newInProcessLockManager();
+  SqliteDatabase::Vfs vfs(*dir, *lockManager, { .mmapSize = 1 << 20, .walMode = true });
+
+  {
+    SqliteDatabase db(vfs, kj::Path({"foo"}), kj::WriteMode::CREATE | kj::WriteMode::MODIFY);
+
+    KJ_EXPECT(db.run("PRAGMA journal_mode;").getText(0) == "wal");
+    KJ_EXPECT(db.run("PRAGMA mmap_size;").getInt(0) == 1 << 20);
+
+    setupSql(db);
+    checkSql(db);
+
+    // Grow the file well past its size when it was first mapped, reading as we go.
+    db.run("CREATE TABLE blobs (id INTEGER PRIMARY KEY, value BLOB);");
+    for (auto i: kj::zeroTo(200)) {
+      db.run("INSERT INTO blobs VALUES (?, zeroblob(4000));", i);
+      KJ_EXPECT(db.run("SELECT COUNT(*) FROM blobs;").getInt(0) == i + 1);
+    }
+    db.run("PRAGMA wal_checkpoint;");
+    KJ_EXPECT(db.run("SELECT SUM(length(value)) FROM blobs;").getInt(0) == 200 * 4000);
+
+    {
+      // The WAL-index lives in the Lock, not in a -shm file.
+      auto files = dir->listNames();
+      KJ_ASSERT(files.size() == 2);
+      KJ_EXPECT(files[0] == "foo");
+      KJ_EXPECT(files[1] == "foo-wal");
+    }
+  }
+
+  // Open it again and make sure the data is still there.
+  {
+    SqliteDatabase db(vfs, kj::Path({"foo"}), kj::WriteMode::MODIFY);
+
+    checkSql(db);
+    KJ_EXPECT(db.run("SELECT SUM(length(value)) FROM blobs;").getInt(0) == 200 * 4000);
+  }
+}
+
+KJ_TEST("SQLite KJ VFS ignores mmap_size for in-memory files") {
+  auto dir = kj::newInMemoryDirectory(kj::nullClock());
+  SqliteDatabase::Vfs vfs(*dir, { .mmapSize = 1 << 20 });
+  SqliteDatabase db(vfs, kj::Path({"foo"}), kj::WriteMode::CREATE | kj::WriteMode::MODIFY);
+
+  KJ_EXPECT(db.run("PRAGMA mmap_size;").getInt(0) == 0);
+  setupSql(db);
+  checkSql(db);
+}
+
 // Tests that concurrent database clients don't clobber each other. This verifies that the
 // LockManager interface is able to protect concurrent access and that our default implementation
 // works.
@@ -364,6 +418,64 @@ KJ_TEST("SQLite onWrite callback") {
   KJ_EXPECT(sawWrite);
 }
 
+KJ_TEST("SQLite StatementCache") {
+  auto dir = kj::newInMemoryDirectory(kj::nullClock());
+  SqliteDatabase::Vfs vfs(*dir);
+  SqliteDatabase db(vfs, kj::Path({"foo"}), kj::WriteMode::CREATE | kj::WriteMode::MODIFY);
+  setupSql(db);
+
+  SqliteDatabase::Regulator regulator;
+  SqliteDatabase::StatementCache cache(db, regulator, 2);
+
+  auto getName = [&](int64_t id) {
+    auto& statement = KJ_ASSERT_NONNULL(cache.find("SELECT name FROM people WHERE id = ?"));
+    auto query = statement.getStatement().run(id);
+    return kj::str(query.getText(0));
+  };
+
+  KJ_EXPECT(getName(123) == "Bob");
+  KJ_EXPECT(getName(321) == "Alice");
+  KJ_EXPECT(cache.getMisses() == 1);
+  KJ_EXPECT(cache.getHits() == 1);
+
+  // While a query holds a reference to the statement, the caller is told to compile its own.
+  {
+    auto& statement = KJ_ASSERT_NONNULL(cache.find("SELECT COUNT(*) FROM people"));
+    auto ref = kj::addRef(statement);
+    auto query = statement.getStatement().run();
+    KJ_EXPECT(cache.find("SELECT COUNT(*) FROM people") == nullptr);
+  }
+  KJ_EXPECT(KJ_ASSERT_NONNULL(cache.find("SELECT COUNT(*) FROM people"))
+      .getStatement().run().getInt(0) == 2);
+  KJ_EXPECT(cache.getHits() == 2);
+  KJ_EXPECT(cache.getMisses() == 3);
+
+  // Multiple statements are never cached, and aren't executed by find().
+  KJ_EXPECT(cache.find("DELETE FROM people; SELECT COUNT(*) FROM people") == nullptr);
+  KJ_EXPECT(db.run("SELECT COUNT(*) FROM people").getInt(0) == 2);
+
+  // The least-recently-used statement was evicted to make room.
+  KJ_EXPECT(cache.size() == 2);
+  KJ_EXPECT(getName(123) == "Bob");
+  KJ_EXPECT(cache.getMisses() == 5);
+
+  // Cached statements survive schema changes.
+  db.run("ALTER TABLE people RENAME COLUMN name TO fullName");
+  KJ_EXPECT_THROW_MESSAGE("no such column: name", getName(123));
+  db.run("ALTER TABLE people RENAME COLUMN fullName TO name");
+  KJ_EXPECT(getName(123) == "Bob");
+
+  // Statements are prepared under the cache's regulator.
+  class NoPeople: public SqliteDatabase::Regulator {
+    bool isAllowedName(kj::StringPtr name) override { return name != "people"; }
+  };
+  NoPeople noPeople;
+  SqliteDatabase::StatementCache restricted(db, noPeople, 2);
+  KJ_EXPECT_THROW_MESSAGE("access to people.name is prohibited",
+      restricted.find("SELECT name FROM people"));
+  KJ_EXPECT(restricted.size() == 0);
+}
+
 struct RowCounts {
   uint64_t found;
   uint64_t read;
@@ -315,6 +315,7 @@ SqliteDatabase::SqliteDatabase(const Vfs& vfs, kj::PathPtr path) {
   KJ_ON_SCOPE_FAILURE(sqlite3_close_v2(db));
 
   setupSecurity();
+  applyOptions(vfs.options, false);
 }
 
 SqliteDatabase::SqliteDatabase(const Vfs& vfs, kj::PathPtr path, kj::WriteMode mode) {
@@ -343,6 +344,7 @@ SqliteDatabase::SqliteDatabase(const Vfs& vfs, kj::PathPtr path, kj::WriteMode m
   KJ_ON_SCOPE_FAILURE(sqlite3_close_v2(db));
 
   setupSecurity();
+  applyOptions(vfs.options, true);
 }
 
 SqliteDatabase::~SqliteDatabase() noexcept(false) {
@@ -395,6 +397,12 @@ kj::Own<sqlite3_stmt> SqliteDatabase::prepareSql(
             "A prepared SQL statement must contain only one statement.", tail);
         break;
 
+      case SINGLE_OR_NULL:
+        if (tail != sqlCode.end()) {
+          return nullptr;
+        }
+        break;
+
       case MULTI:
         if (tail != sqlCode.end()) {
           // There are more statements after this one, so execute this statement now.
@@ -762,11 +770,90 @@ void SqliteDatabase::setupSecurity() {
   // (handled in BUILD.sqlite3)
 }
 
+void SqliteDatabase::applyOptions(const VfsOptions& options, bool writable) {
+  if (options.mmapSize > 0) {
+    run(TRUSTED, kj::str("PRAGMA mmap_size=", options.mmapSize, ";"));
+  }
+  if (writable && options.walMode) {
+    run("PRAGMA journal_mode=WAL;");
+  }
+}
+
 SqliteDatabase::Statement SqliteDatabase::prepare(Regulator& regulator, kj::StringPtr sqlCode) {
   return Statement(*this, regulator,
       prepareSql(regulator, sqlCode, SQLITE_PREPARE_PERSISTENT, SINGLE));
 }
 
+kj::Maybe<SqliteDatabase::Statement> SqliteDatabase::tryPrepare(
+    Regulator& regulator, kj::StringPtr sqlCode) {
+  auto stmt = prepareSql(regulator, sqlCode, SQLITE_PREPARE_PERSISTENT, SINGLE_OR_NULL);
+  if (stmt.get() == nullptr) {
+    return nullptr;
+  }
+  return Statement(*this, regulator, kj::mv(stmt));
+}
+
+// =======================================================================================
+
+SqliteDatabase::StatementCache::StatementCache(
+    SqliteDatabase& db, Regulator& regulator, uint capacity)
+    : db(db), regulator(regulator), capacity(capacity) {
+  KJ_REQUIRE(capacity > 0);
+}
+
+SqliteDatabase::StatementCache::~StatementCache() noexcept(false) {
+  while (!lru.empty()) {
+    lru.remove(lru.front());
+  }
+}
+
+kj::Maybe<SqliteDatabase::CachedStatement&>
+    SqliteDatabase::StatementCache::find(kj::StringPtr sqlCode) {
+  KJ_IF_MAYBE(e, entries.find(sqlCode)) {
+    Entry& entry = **e;
+    lru.remove(entry);
+    lru.add(entry);
+
+    KJ_IF_MAYBE(statement, entry.statement) {
+      // SQLite only allows one query per statement at a time, so if an earlier query on this
+      // statement hasn't been destroyed yet, the caller has to compile the code afresh.
+      if (!(*statement)->isShared()) {
+        ++hits;
+        return **statement;
+      }
+    }
+    ++misses;
+    return nullptr;
+  }
+
+  ++misses;
+
+  // If preparation throws, we cache nothing, and the caller sees the same error it would have
+  // gotten from run().
+  auto entry = kj::heap<Entry>();
+  entry->sqlCode = kj::str(sqlCode);
+  auto prepared = db.tryPrepare(regulator, sqlCode);
+  KJ_IF_MAYBE(statement, prepared) {
+    entry->statement = kj::refcounted<CachedStatement>(kj::mv(*statement));
+  }
+
+  if (entries.size() >= capacity) {
+    Entry& oldest = lru.front();
+    lru.remove(oldest);
+    KJ_ASSERT(entries.erase(oldest.sqlCode));
+  }
+
+  Entry& ref = *entry;
+  lru.add(ref);
+  entries.insert(ref.sqlCode, kj::mv(entry));
+
+  KJ_IF_MAYBE(statement, ref.statement) {
+    return **statement;
+  } else {
+    return nullptr;
+  }
+}
+
 SqliteDatabase::Query::Query(SqliteDatabase& db, Regulator& regulator, Statement& statement,
                              kj::ArrayPtr<const ValuePtr> bindings)
     : db(db), regulator(regulator), statement(statement) {
@@ -1233,17 +1320,50 @@ struct SqliteDatabase::Vfs::FileImpl: public sqlite3_file {
   //
   // We leave this null if the file is not the main database file.
 
+  // Whether xFetch() may memory-map this file. See xFetch() for why only disk files qualify.
+  bool canMmap;
+
+  // Limit on the bytes that xFetch() may map, as set by `PRAGMA mmap_size`.
+  sqlite3_int64 mmapSizeMax = 0;
+
+  // Mapping of the start of the file, from which xFetch() hands out pages. Only the first
+  // `mappedSize` bytes are handed out; this may be less than the mapping's size after the file is
+  // truncated.
+  kj::Array<const byte> mapping;
+  sqlite3_int64 mappedSize = 0;
+
+  // Number of pages handed out by xFetch() and not yet returned to xUnfetch(). The mapping can
+  // only be replaced while this is zero.
+  uint fetchCount = 0;
+
   FileImpl(const Vfs& vfs, kj::Own<const kj::File> file, kj::Maybe<kj::Own<Lock>> lock)
       : sqlite3_file { .pMethods = &FILE_METHOD_TABLE },
         vfs(vfs),
         writableFile(*file),
         file(kj::mv(file)),
-        lock(kj::mv(lock)) {}
+        lock(kj::mv(lock)),
+        canMmap(isDiskFile(*this->file)) {}
   FileImpl(const Vfs& vfs, kj::Own<const kj::ReadableFile> file, kj::Maybe<kj::Own<Lock>> lock)
       : sqlite3_file { .pMethods = &FILE_METHOD_TABLE },
         vfs(vfs),
         file(kj::mv(file)),
-        lock(kj::mv(lock)) {}
+        lock(kj::mv(lock)),
+        canMmap(isDiskFile(*this->file)) {}
+
+  void unmap() {
+    KJ_ASSERT(fetchCount == 0);
+    mapping = nullptr;
+    mappedSize = 0;
+  }
+
+  static bool isDiskFile(const kj::ReadableFile& file) {
+#if _WIN32
+    // Windows can't truncate a file while it is mapped, so don't map at all.
+    return false;
+#else
+    return file.getFd() != nullptr;
+#endif
+  }
 
   static const sqlite3_io_methods FILE_METHOD_TABLE;
 };
@@ -1294,6 +1414,10 @@ const sqlite3_io_methods SqliteDatabase::Vfs::FileImpl::FILE_METHOD_TABLE = {
   .xTruncate = [](sqlite3_file* file, sqlite3_int64 size) noexcept -> int {
     WRAP_METHOD(SQLITE_IOERR_TRUNCATE, {
       KJ_REQUIRE_NONNULL(self.writableFile).truncate(size);
+
+      // Pages past the new end must not be handed out anymore. Pages that were already handed out
+      // stay mapped until returned; SQLite doesn't touch them.
+      self.mappedSize = kj::min(self.mappedSize, size);
       return SQLITE_OK;
     });
   },
@@ -1355,6 +1479,24 @@ const sqlite3_io_methods SqliteDatabase::Vfs::FileImpl::FILE_METHOD_TABLE = {
   },
 
   .xFileControl = [](sqlite3_file* file, int op, void *pArg) noexcept -> int {
+    if (op == SQLITE_FCNTL_MMAP_SIZE) {
+      // Sent by the pager when `PRAGMA mmap_size` sets its limit, and by the pragma itself to
+      // query the limit. The argument is the new limit, or negative to just query it; either way
+      // we return the old limit. Like the native VFS, we ignore changes while pages are handed
+      // out.
+      auto& self = *static_cast<FileImpl*>(file);
+      auto& limit = *reinterpret_cast<sqlite3_int64*>(pArg);
+      auto newLimit = limit;
+      limit = self.mmapSizeMax;
+      if (newLimit >= 0 && self.canMmap && self.fetchCount == 0) {
+        self.mmapSizeMax = newLimit;
+        if (self.mappedSize > newLimit) {
+          self.unmap();
+        }
+      }
+      return SQLITE_OK;
+    }
+
     // Apparently we can return SQLITE_NOTFOUND for controls we don't implement.
     return SQLITE_NOTFOUND;
   },
@@ -1431,19 +1573,54 @@ const sqlite3_io_methods SqliteDatabase::Vfs::FileImpl::FILE_METHOD_TABLE = {
   .xFetch = [](sqlite3_file* file, sqlite3_int64 iOfst, int iAmt, void **pp) noexcept -> int {
     // This is essentially requesting an mmap(). kj::File supports mmap(). Great, right?
     //
-    // Well, there's a problem. We mostly use this VFS implementation to wrap an in-memory
-    // `kj::File`. Such files support mmap by returning a pointer into the backing store. But
-    // while such a mapping exists, the backing store cannot be resized. So write()s that extend
-    // the file may fail. This does not work for SQLite's use case.
+    // Only for disk files. An in-memory `kj::File` supports mmap by returning a pointer into the
+    // backing store. But while such a mapping exists, the backing store cannot be resized. So
+    // write()s that extend the file may fail. This does not work for SQLite's use case, so for
+    // those files we act like we don't support this. Luckily, SQLite falls back to xRead() when
+    // we return null, which we also do whenever the request lies beyond what we can map.
     //
-    // So, alas, we must act like we don't support this. Luckily, SQLite has fallbacks for this.
+    // For disk files, like the native VFS, we keep one mapping of the start of the file, up to
+    // the `PRAGMA mmap_size` limit, and extend it when the file has grown and no pages are
+    // handed out.
     *pp = nullptr;
-    return SQLITE_OK;
+    WRAP_METHOD(SQLITE_IOERR_MMAP, {
+      auto end = iOfst + iAmt;
+      if (end > self.mmapSizeMax) {
+        return SQLITE_OK;
+      }
+
+      if (end > self.mappedSize && self.fetchCount == 0) {
+        self.unmap();
+        auto size = kj::min(static_cast<sqlite3_int64>(self.file->stat().size), self.mmapSizeMax);
+        if (size > 0) {
+          self.mapping = self.file->mmap(0, size);
+          self.mappedSize = size;
+        }
+      }
+
+      if (end > self.mappedSize) {
+        return SQLITE_OK;
+      }
+
+      ++self.fetchCount;
+      // const_cast OK because SQLite only reads through pages returned by xFetch().
+      *pp = const_cast<byte*>(self.mapping.begin() + iOfst);
+      return SQLITE_OK;
+    });
   },
   .xUnfetch = [](sqlite3_file* file, sqlite3_int64 iOfst, void *p) noexcept -> int {
-    // Shouldn't ever be called since xFetch() always produces null? But the native implementation
-    // return SQLITE_OK even when mmap is disabled so we will too.
-    return SQLITE_OK;
+    WRAP_METHOD(SQLITE_IOERR_MMAP, {
+      if (p != nullptr) {
+        // Returning a page handed out by xFetch().
+        KJ_ASSERT(self.fetchCount > 0);
+        --self.fetchCount;
+      } else if (self.fetchCount == 0) {
+        // SQLite asks to drop the whole mapping. The native implementation returns SQLITE_OK even
+        // when mmap is disabled so we will too.
+        self.unmap();
+      }
+      return SQLITE_OK;
+    });
   },
 #undef WRAP_METHOD
 };
@@ -1821,6 +1998,10 @@ private:
   };
 };
 
+kj::Own<SqliteDatabase::LockManager> SqliteDatabase::Vfs::newInProcessLockManager() {
+  return kj::heap<DefaultLockManager>();
+}
+
 SqliteDatabase::Vfs::Vfs(const kj::Directory& directory, Options options)
     : directory(directory),
       ownLockManager(kj::heap<DefaultLockManager>()),
@@ -5,6 +5,8 @@
 #pragma once
 
 #include <kj/filesystem.h>
+#include <kj/list.h>
+#include <kj/map.h>
 #include <kj/one-of.h>
 #include <utility>
 
@@ -34,6 +36,8 @@ public:
   class Lock;
   class LockManager;
   class Regulator;
+  class StatementCache;
+  class CachedStatement;
   struct VfsOptions;
 
   SqliteDatabase(const Vfs& vfs, kj::PathPtr path);
@@ -103,17 +107,22 @@ private:
 
   void close();
 
-  enum Multi { SINGLE, MULTI };
+  enum Multi { SINGLE, SINGLE_OR_NULL, MULTI };
 
   // Helper to call sqlite3_prepare_v3().
   //
   // In SINGLE mode, an exception is thrown if `sqlCode` contains multiple statements.
   //
+  // SINGLE_OR_NULL mode is like SINGLE, but returns null instead of throwing.
+  //
   // In MULTI mode, if `sqlCode` contains multiple statements, each statement before the last one
   // is executed immediately. The returned object represents the last statement.
   kj::Own<sqlite3_stmt> prepareSql(
       Regulator& regulator, kj::StringPtr sqlCode, uint prepFlags, Multi multi);
 
+  // Like prepare(), but returns null if `sqlCode` contains multiple statements.
+  kj::Maybe<Statement> tryPrepare(Regulator& regulator, kj::StringPtr sqlCode);
+
   // Implements SQLite authorizer callback, see sqlite3_set_authorizer().
   bool isAuthorized(int actionCode,
       kj::Maybe<kj::StringPtr> param1, kj::Maybe<kj::StringPtr> param2,
@@ -125,6 +134,10 @@ private:
       Regulator &regulator);
 
   void setupSecurity();
+
+  // Applies the parts of VfsOptions that are implemented as pragmas. `writable` is false for
+  // databases opened read-only.
+  void applyOptions(const VfsOptions& options, bool writable);
 };
 
 // Class which regulates a SQL query, especially to control how queries created in JavaScript
@@ -201,6 +214,75 @@ private:
   friend class SqliteDatabase;
 };
 
+// A statement kept by a StatementCache, along with anything the cache's user wants to derive from
+// it once and reuse, such as the statement's column names converted to some other form.
+class SqliteDatabase::CachedStatement final: public kj::Refcounted {
+public:
+  explicit CachedStatement(Statement statement): statement(kj::mv(statement)) {}
+
+  Statement& getStatement() { return statement; }
+
+  class Attachment {
+  public:
+    virtual ~Attachment() noexcept(false) {}
+  };
+
+  // Owned by the cache's user, who knows the concrete type. Destroyed with the statement.
+  kj::Maybe<kj::Own<Attachment>> attachment;
+
+private:
+  Statement statement;
+};
+
+// Keeps prepared statements for SQL code that is run over and over, so that callers which only
+// have the code in hand -- such as applications calling `sql.exec()` in a loop -- don't pay to
+// compile it every time. Statements are keyed by their code and the least-recently-used one is
+// dropped once the cache is full.
+//
+// All statements are prepared under the regulator passed to the constructor. Entries don't need
+// to be dropped when the schema changes: SQLite notices that the next time the statement runs,
+// and re-prepares it, consulting the same regulator.
+class SqliteDatabase::StatementCache {
+public:
+  StatementCache(SqliteDatabase& db, Regulator& regulator, uint capacity);
+  ~StatementCache() noexcept(false);
+  KJ_DISALLOW_COPY_AND_MOVE(StatementCache);
+
+  // Returns the statement for `sqlCode`, preparing and caching it if needed. Queries run on the
+  // statement should hold a reference from `kj::addRef()` until they are destroyed; the entry can
+  // be evicted meanwhile.
+  //
+  // Returns null if the caller should use `SqliteDatabase::run()` instead: either `sqlCode`
+  // contains multiple statements, or the cached statement is still referenced by an earlier query.
+  kj::Maybe<CachedStatement&> find(kj::StringPtr sqlCode);
+
+  size_t size() const { return entries.size(); }
+  uint64_t getHits() const { return hits; }
+  uint64_t getMisses() const { return misses; }
+
+private:
+  struct Entry {
+    kj::String sqlCode;
+
+    // Null if `sqlCode` contains multiple statements, so that we don't try to prepare it again.
+    kj::Maybe<kj::Own<CachedStatement>> statement;
+
+    kj::ListLink<Entry> link;
+  };
+
+  SqliteDatabase& db;
+  Regulator& regulator;
+  uint capacity;
+
+  kj::HashMap<kj::StringPtr, kj::Own<Entry>> entries;
+
+  // Least-recently-used first.
+  kj::List<Entry, &Entry::link> lru;
+
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+};
+
 // Represents one SQLite query.
 //
 // Only one Query can exist at a time, for a given database. It should probably be allocated on
@@ -348,6 +430,20 @@ struct SqliteDatabase::VfsOptions {
   // will fall back to the native VFS implementation. In that case, the options you set here will
   // be ORed with the ones set by the underlying VFS.
   int deviceCharacteristics = 0x00001000;  // = SQLITE_FCNTL_POWERSAFE_OVERWRITE
+
+  // If non-zero, every database opened through this VFS sets `PRAGMA mmap_size` to this many
+  // bytes, so that SQLite reads pages of the main database file through a memory mapping instead
+  // of copying them with read(). A database can still change this with its own PRAGMA.
+  //
+  // The native VFS supports this on any disk file. The KJ-backed VFS supports it only for files
+  // that are backed by a real disk file (see `Vfs::newInProcessLockManager()`); for in-memory
+  // files the setting is accepted but reads keep using read().
+  uint64_t mmapSize = 0;
+
+  // If true, every database opened for writing through this VFS is switched to WAL mode, as if
+  // by `PRAGMA journal_mode=WAL`. With the KJ-backed VFS, the WAL-index and WAL locks are
+  // provided by the `LockManager`'s `Lock` objects rather than by a `-shm` file.
+  bool walMode = false;
 };
 
 // Implements a SQLite VFS based on a KJ directory.
@@ -391,6 +487,16 @@ public:
 
   ~Vfs() noexcept(false);
 
+  // Returns a LockManager which coordinates only between clients using the same LockManager in
+  // this process. This is what the first constructor uses when the directory is not a disk
+  // directory.
+  //
+  // Passing one to the second constructor along with a disk directory makes the Vfs use the KJ
+  // filesystem APIs on real disk files, which is useful when no other process will open the
+  // database: SQLite's native locking and `-shm` file are skipped, while reads can still be
+  // memory-mapped (see `VfsOptions::mmapSize`).
+  static kj::Own<LockManager> newInProcessLockManager();
+
   // Unfortunately, all SQLite VFSes must be registered in a global list with unique names, and
   // then the _name_ must be passed to sqlite3_open_v2() to use it when opening a database. This is
   // dumb, you should instead be able to simply pass the sqlite3_vfs* when opening the database,
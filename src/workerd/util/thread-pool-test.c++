@@ -0,0 +1,103 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "thread-pool.h"
+#include <kj/test.h>
+
+namespace workerd {
+namespace {
+
+KJ_TEST("ThreadPool runs functions off the calling thread") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  ThreadPool pool({ .threadCount = 2 });
+
+  static thread_local bool isCallerThread = false;
+  isCallerThread = true;
+  KJ_EXPECT(!ThreadPool::onPoolThread());
+  auto promise = pool.run([]() {
+    KJ_EXPECT(!isCallerThread);
+    KJ_EXPECT(ThreadPool::onPoolThread());
+    return kj::str("done");
+  });
+  KJ_EXPECT(promise.wait(ws) == "done");
+
+  pool.run([]() {}).wait(ws);
+
+  auto failed = pool.run([]() -> int { KJ_FAIL_REQUIRE("oops"); });
+  KJ_EXPECT_THROW_MESSAGE("oops", failed.wait(ws));
+}
+
+KJ_TEST("ThreadPool runs functions inline when the queue is full") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  ThreadPool pool({ .threadCount = 1, .maxQueued = 1 });
+
+  // Park the only worker so that nothing is dequeued.
+  kj::MutexGuarded<bool> release(false);
+  kj::MutexGuarded<bool> started(false);
+  auto blocker = pool.run([&]() {
+    *started.lockExclusive() = true;
+    release.when([](bool r) { return r; }, [](bool&) {});
+  });
+  started.when([](bool s) { return s; }, [](bool&) {});
+
+  uint ran = 0;
+  auto queued = pool.run([&]() {
+    KJ_EXPECT(ThreadPool::onPoolThread());
+    ++ran;
+  });
+  auto inlined = pool.run([&]() {
+    KJ_EXPECT(!ThreadPool::onPoolThread());
+    ++ran;
+  });
+
+  // The second call found the queue full and ran before returning.
+  KJ_EXPECT(ran == 1);
+
+  *release.lockExclusive() = true;
+  blocker.wait(ws);
+  queued.wait(ws);
+  inlined.wait(ws);
+  KJ_EXPECT(ran == 2);
+}
+
+KJ_TEST("ThreadPool skips functions whose promise was dropped") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  ThreadPool pool({ .threadCount = 1 });
+
+  kj::MutexGuarded<bool> release(false);
+  kj::MutexGuarded<bool> started(false);
+  auto blocker = pool.run([&]() {
+    *started.lockExclusive() = true;
+    release.when([](bool r) { return r; }, [](bool&) {});
+  });
+  started.when([](bool s) { return s; }, [](bool&) {});
+
+  bool ran = false;
+  {
+    auto dropped = pool.run([&]() { ran = true; });
+  }
+
+  *release.lockExclusive() = true;
+  blocker.wait(ws);
+
+  // The worker handles tasks in order, so it has reached the canceled one by the time this one
+  // completes.
+  pool.run([]() {}).wait(ws);
+  KJ_EXPECT(!ran);
+}
+
+KJ_TEST("threadCpuTime() advances while the thread is busy") {
+  auto start = threadCpuTime();
+  volatile uint64_t sink = 0;
+  while (threadCpuTime() - start < 10 * kj::MILLISECONDS) {
+    for (auto i: kj::zeroTo(10000)) sink = sink + i;
+  }
+  KJ_EXPECT(threadCpuTime() > start);
+}
+
+}  // namespace
+}  // namespace workerd
@@ -0,0 +1,94 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "thread-pool.h"
+#include <kj/debug.h>
+
+#if _WIN32
+#include <kj/win32-api-version.h>
+#include <windows.h>
+#include <kj/windows-sanity.h>
+#else
+#include <time.h>
+#endif
+
+namespace workerd {
+
+namespace {
+thread_local bool isPoolThread = false;
+}  // namespace
+
+ThreadPool::ThreadPool(Options options): maxQueued(options.maxQueued) {
+  KJ_REQUIRE(options.threadCount > 0, "a thread pool needs at least one thread");
+  auto builder = kj::heapArrayBuilder<kj::Own<kj::Thread>>(options.threadCount);
+  for (auto i KJ_UNUSED: kj::zeroTo(options.threadCount)) {
+    builder.add(kj::heap<kj::Thread>([this]() { workerLoop(); }));
+  }
+  threads = builder.finish();
+}
+
+ThreadPool::~ThreadPool() noexcept(false) {
+  std::deque<kj::Own<Task>> dropped;
+  {
+    auto lock = state.lockExclusive();
+    lock->shuttingDown = true;
+    dropped = kj::mv(lock->queue);
+  }
+
+  // Destroy the unstarted tasks outside the lock; their fulfillers reject the callers' promises.
+  dropped.clear();
+
+  // kj::Thread's destructor joins.
+  threads = nullptr;
+}
+
+bool ThreadPool::tryEnqueue(kj::Own<Task>& task) {
+  auto lock = state.lockExclusive();
+  KJ_REQUIRE(!lock->shuttingDown);
+  if (lock->queue.size() >= maxQueued) return false;
+  lock->queue.push_back(kj::mv(task));
+  return true;
+}
+
+bool ThreadPool::onPoolThread() {
+  return isPoolThread;
+}
+
+void ThreadPool::workerLoop() {
+  isPoolThread = true;
+  for (;;) {
+    kj::Maybe<kj::Own<Task>> next = state.when([](const State& s) {
+      return s.shuttingDown || !s.queue.empty();
+    }, [](State& s) -> kj::Maybe<kj::Own<Task>> {
+      if (s.shuttingDown) return nullptr;
+      auto task = kj::mv(s.queue.front());
+      s.queue.pop_front();
+      return kj::mv(task);
+    });
+
+    KJ_IF_MAYBE(task, next) {
+      (*task)->run();
+    } else {
+      return;
+    }
+  }
+}
+
+kj::Duration threadCpuTime() {
+#if _WIN32
+  FILETIME creation, exit, kernel, user;
+  KJ_WIN32(GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user));
+  auto toTicks = [](const FILETIME& t) {
+    return (static_cast<uint64_t>(t.dwHighDateTime) << 32) | t.dwLowDateTime;
+  };
+  // FILETIME counts 100ns ticks.
+  return (toTicks(kernel) + toTicks(user)) * 100 * kj::NANOSECONDS;
+#else
+  struct timespec ts;
+  KJ_SYSCALL(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts));
+  return ts.tv_sec * kj::SECONDS + ts.tv_nsec * kj::NANOSECONDS;
+#endif
+}
+
+}  // namespace workerd
@@ -0,0 +1,126 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/async.h>
+#include <kj/mutex.h>
+#include <kj/thread.h>
+#include <kj/time.h>
+#include <deque>
+
+namespace workerd {
+
+using kj::uint;
+
+// A fixed set of worker threads that run CPU-bound functions away from the calling thread, with
+// each result delivered back to the caller's event loop as a promise.
+//
+// The queue of pending functions is bounded. When it is full, run() executes the function inline
+// on the calling thread instead, so a burst of work degrades to the behavior of not having a pool
+// rather than queueing without limit.
+//
+// Functions run on arbitrary threads, so they must own everything they touch: no references to
+// objects owned by the caller's thread, and in particular nothing belonging to a V8 isolate.
+class ThreadPool {
+public:
+  struct Options {
+    uint threadCount;
+
+    // Maximum number of functions waiting for a thread before run() falls back to running them
+    // inline.
+    size_t maxQueued = 256;
+  };
+
+  explicit ThreadPool(Options options);
+
+  // Drops every function that hasn't started yet, whose promises then reject, and waits for the
+  // running ones to finish.
+  ~ThreadPool() noexcept(false);
+
+  KJ_DISALLOW_COPY_AND_MOVE(ThreadPool);
+
+  // Runs `func` on one of the pool's threads and returns a promise for its result, which must be
+  // awaited on the calling thread's event loop. Exceptions thrown by `func` reject the promise. If
+  // the promise is dropped before a thread picks `func` up, `func` never runs.
+  template <typename Func>
+  kj::Promise<kj::_::ReturnType<Func, void>> run(Func&& func);
+
+  // Returns true when called on one of the threads of any ThreadPool. A function passed to run()
+  // can use this to tell whether it was run inline instead.
+  static bool onPoolThread();
+
+private:
+  class Task {
+  public:
+    virtual ~Task() noexcept(false) {}
+
+    // Must not throw.
+    virtual void run() = 0;
+  };
+
+  template <typename T, typename Func>
+  class TaskImpl;
+
+  struct State {
+    std::deque<kj::Own<Task>> queue;
+    bool shuttingDown = false;
+  };
+
+  const size_t maxQueued;
+  kj::MutexGuarded<State> state;
+  kj::Array<kj::Own<kj::Thread>> threads;
+
+  // Adds `task` to the queue and returns true, or returns false without taking it if the queue is
+  // full.
+  bool tryEnqueue(kj::Own<Task>& task);
+
+  void workerLoop();
+};
+
+// Returns the CPU time consumed so far by the calling thread.
+kj::Duration threadCpuTime();
+
+// =======================================================================================
+// inline implementation details
+
+template <typename T, typename Func>
+class ThreadPool::TaskImpl final: public Task {
+public:
+  TaskImpl(Func&& func, kj::Own<kj::CrossThreadPromiseFulfiller<T>> fulfiller)
+      : func(kj::fwd<Func>(func)), fulfiller(kj::mv(fulfiller)) {}
+
+  void run() override {
+    // Skip the work entirely if the caller has already given up on the result.
+    if (!fulfiller->isWaiting()) return;
+
+    KJ_IF_MAYBE(exception, kj::runCatchingExceptions([&]() {
+      if constexpr (kj::isSameType<T, void>()) {
+        func();
+        fulfiller->fulfill();
+      } else {
+        fulfiller->fulfill(func());
+      }
+    })) {
+      fulfiller->reject(kj::mv(*exception));
+    }
+  }
+
+private:
+  kj::Decay<Func> func;
+  kj::Own<kj::CrossThreadPromiseFulfiller<T>> fulfiller;
+};
+
+template <typename Func>
+kj::Promise<kj::_::ReturnType<Func, void>> ThreadPool::run(Func&& func) {
+  using T = kj::_::ReturnType<Func, void>;
+  auto paf = kj::newPromiseAndCrossThreadFulfiller<T>();
+  kj::Own<Task> task = kj::heap<TaskImpl<T, Func>>(kj::fwd<Func>(func), kj::mv(paf.fulfiller));
+  if (!tryEnqueue(task)) {
+    task->run();
+  }
+  return kj::mv(paf.promise);
+}
+
+}  // namespace workerd
@@ -0,0 +1,148 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "timer-wheel.h"
+#include <kj/test.h>
+#include <kj/vector.h>
+#include <map>
+#include <random>
+
+namespace workerd {
+namespace {
+
+struct Timer: public TimerWheel::Entry {
+  uint id = 0;
+};
+
+constexpr kj::Date START = kj::UNIX_EPOCH + 1'700'000'000'000 * kj::MILLISECONDS;
+
+uint popId(TimerWheel& wheel) {
+  auto& entry = KJ_ASSERT_NONNULL(wheel.pop());
+  return static_cast<Timer&>(entry).id;
+}
+
+KJ_TEST("TimerWheel pops entries in deadline order") {
+  TimerWheel wheel;
+  KJ_EXPECT(wheel.front() == nullptr);
+  KJ_EXPECT(wheel.pop() == nullptr);
+
+  // Deadlines which land in every level of the wheel and in the overflow list.
+  kj::Duration delays[] = {
+    100 * kj::SECONDS, 5 * kj::MILLISECONDS, 3 * kj::HOURS, 1 * kj::MILLISECONDS,
+    70 * kj::MILLISECONDS, 5 * kj::MILLISECONDS, 10 * kj::DAYS, 5 * kj::SECONDS,
+    5 * kj::MICROSECONDS,
+  };
+  Timer timers[kj::size(delays)];
+  for (auto i: kj::indices(delays)) {
+    timers[i].id = i;
+    wheel.insert(timers[i], START + delays[i]);
+  }
+  KJ_EXPECT(wheel.size() == kj::size(delays));
+  KJ_EXPECT(&KJ_ASSERT_NONNULL(wheel.front()) == &timers[8]);
+
+  // Entries with equal deadlines come out in the order they were inserted.
+  uint expected[] = { 8, 3, 1, 5, 4, 7, 0, 2, 6 };
+  for (auto id: expected) {
+    KJ_EXPECT(popId(wheel) == id);
+    KJ_EXPECT(!timers[id].isScheduled());
+  }
+  KJ_EXPECT(wheel.size() == 0);
+  KJ_EXPECT(wheel.pop() == nullptr);
+}
+
+KJ_TEST("TimerWheel removes entries") {
+  TimerWheel wheel;
+  Timer timers[4];
+  for (auto i: kj::indices(timers)) {
+    timers[i].id = i;
+    wheel.insert(timers[i], START + int64_t(i) * kj::MINUTES);
+  }
+
+  wheel.remove(timers[0]);
+  KJ_EXPECT(!timers[0].isScheduled());
+  KJ_EXPECT(&KJ_ASSERT_NONNULL(wheel.front()) == &timers[1]);
+
+  wheel.remove(timers[2]);
+  KJ_EXPECT(wheel.size() == 2);
+
+  {
+    // Entries unschedule themselves when destroyed.
+    Timer early;
+    wheel.insert(early, START);
+    KJ_EXPECT(&KJ_ASSERT_NONNULL(wheel.front()) == &early);
+  }
+  KJ_EXPECT(wheel.size() == 2);
+
+  KJ_EXPECT(popId(wheel) == 1);
+  KJ_EXPECT(popId(wheel) == 3);
+  KJ_EXPECT(wheel.pop() == nullptr);
+}
+
+KJ_TEST("TimerWheel accepts deadlines before ones it already popped") {
+  TimerWheel wheel;
+  Timer a, b, c, d;
+  a.id = 0; b.id = 1; c.id = 2; d.id = 3;
+
+  wheel.insert(a, START + 10 * kj::SECONDS);
+  wheel.insert(b, START + 20 * kj::SECONDS);
+  KJ_EXPECT(popId(wheel) == 0);
+
+  wheel.insert(c, START + 5 * kj::SECONDS);
+  wheel.insert(d, START);
+  KJ_EXPECT(popId(wheel) == 3);
+  KJ_EXPECT(popId(wheel) == 2);
+  KJ_EXPECT(popId(wheel) == 1);
+}
+
+KJ_TEST("TimerWheel agrees with an ordered map") {
+  std::mt19937 rng(1234);
+  TimerWheel wheel;
+  kj::Vector<kj::Own<Timer>> timers;
+  std::map<std::pair<kj::Date, uint>, Timer*> expected;
+  kj::Date now = START;
+
+  for (uint round = 0; round < 20'000; round++) {
+    switch (rng() % 4) {
+      case 0:
+      case 1: {
+        // Mostly short delays, with the occasional very long one, like real timers.
+        int64_t ms = rng() % 8 == 0 ? rng() % 100'000'000 : rng() % 5'000;
+        kj::Duration delay = ms * kj::MILLISECONDS;
+        auto timer = kj::heap<Timer>();
+        timer->id = timers.size();
+        wheel.insert(*timer, now + delay);
+        expected.insert({{now + delay, timer->id}, timer.get()});
+        timers.add(kj::mv(timer));
+        break;
+      }
+      case 2: {
+        if (expected.empty()) break;
+        auto iter = expected.begin();
+        auto& entry = KJ_ASSERT_NONNULL(wheel.pop());
+        KJ_ASSERT(&entry == iter->second, iter->second->id, static_cast<Timer&>(entry).id);
+        now = kj::max(now, entry.getDeadline());
+        expected.erase(iter);
+        break;
+      }
+      case 3: {
+        if (timers.empty()) break;
+        auto& timer = *timers[rng() % timers.size()];
+        if (timer.isScheduled()) {
+          expected.erase({timer.getDeadline(), timer.id});
+          wheel.remove(timer);
+        }
+        break;
+      }
+    }
+    KJ_ASSERT(wheel.size() == expected.size());
+  }
+
+  for (auto& [key, timer]: expected) {
+    KJ_ASSERT(&KJ_ASSERT_NONNULL(wheel.pop()) == timer);
+  }
+  KJ_EXPECT(wheel.pop() == nullptr);
+}
+
+}  // namespace
+}  // namespace workerd
@@ -0,0 +1,222 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "timer-wheel.h"
+#include <kj/debug.h>
+
+namespace workerd {
+
+TimerWheel::Entry::~Entry() noexcept(false) {
+  if (wheel != nullptr) {
+    wheel->remove(*this);
+  }
+}
+
+TimerWheel::~TimerWheel() noexcept(false) {
+  // Leave any remaining entries unscheduled, so they don't refer back to us.
+  auto release = [](List& list) {
+    for (auto entry = list.head; entry != nullptr; entry = entry->next) {
+      entry->wheel = nullptr;
+    }
+  };
+  for (auto& list: lists) release(list);
+  release(overflow);
+}
+
+void TimerWheel::insert(Entry& entry, kj::Date deadline) {
+  KJ_REQUIRE(entry.wheel == nullptr, "timer wheel entry is already scheduled");
+
+  if (lists == nullptr) {
+    lists = kj::heapArray<List>(LEVELS * SLOTS);
+  }
+
+  entry.wheel = this;
+  entry.deadline = deadline;
+  entry.sequence = nextSequence++;
+  entry.tick = (deadline - kj::UNIX_EPOCH) / kj::MILLISECONDS;
+
+  if (count++ == 0) {
+    // Nothing else is scheduled, so the wheel can jump straight to this entry.
+    baseTick = entry.tick;
+  }
+  place(entry);
+
+  if (cachedFrontValid && (cachedFront == nullptr || isBefore(entry, *cachedFront))) {
+    cachedFront = &entry;
+  }
+}
+
+void TimerWheel::remove(Entry& entry) {
+  KJ_REQUIRE(entry.wheel == this, "timer wheel entry is not scheduled in this wheel");
+
+  unlink(entry);
+  entry.wheel = nullptr;
+  --count;
+
+  if (cachedFront == &entry) {
+    cachedFront = nullptr;
+    cachedFrontValid = count == 0;
+  }
+}
+
+kj::Maybe<TimerWheel::Entry&> TimerWheel::front() const {
+  if (!cachedFrontValid) {
+    cachedFront = findFront();
+    cachedFrontValid = true;
+  }
+  if (cachedFront == nullptr) {
+    return nullptr;
+  } else {
+    return *cachedFront;
+  }
+}
+
+kj::Maybe<TimerWheel::Entry&> TimerWheel::pop() {
+  KJ_IF_MAYBE(entry, front()) {
+    if (entry->tick > baseTick) {
+      advanceTo(entry->tick);
+    }
+    remove(*entry);
+    return *entry;
+  } else {
+    return nullptr;
+  }
+}
+
+bool TimerWheel::isBefore(const Entry& a, const Entry& b) {
+  if (a.deadline != b.deadline) return a.deadline < b.deadline;
+  return a.sequence < b.sequence;
+}
+
+TimerWheel::List& TimerWheel::getList(uint level, uint slot) {
+  if (level == OVERFLOW_LEVEL) {
+    return overflow;
+  } else {
+    return lists[level * SLOTS + slot];
+  }
+}
+
+void TimerWheel::place(Entry& entry) {
+  // An entry due before the wheel's current position goes in the current slot, where sorting puts
+  // it ahead of the rest.
+  auto tick = kj::max(entry.tick, baseTick);
+
+  for (uint level = 0; level < LEVELS; level++) {
+    auto blockShift = SLOT_BITS * (level + 1);
+    if ((tick >> blockShift) == (baseTick >> blockShift)) {
+      link(entry, level, (tick >> (SLOT_BITS * level)) & (SLOTS - 1));
+      return;
+    }
+  }
+
+  link(entry, OVERFLOW_LEVEL, 0);
+}
+
+void TimerWheel::link(Entry& entry, uint level, uint slot) {
+  entry.level = level;
+  entry.slot = slot;
+  auto& list = getList(level, slot);
+
+  // Only entries in the same millisecond are kept sorted; other slots are searched when they
+  // hold the front, and sorted as they cascade down. Entries are usually inserted in deadline
+  // order, so the search from the tail is usually short.
+  Entry* after = list.tail;
+  if (level == 0) {
+    while (after != nullptr && isBefore(entry, *after)) {
+      after = after->prev;
+    }
+  }
+
+  entry.prev = after;
+  if (after == nullptr) {
+    entry.next = list.head;
+    list.head = &entry;
+  } else {
+    entry.next = after->next;
+    after->next = &entry;
+  }
+  if (entry.next == nullptr) {
+    list.tail = &entry;
+  } else {
+    entry.next->prev = &entry;
+  }
+
+  if (level < LEVELS) {
+    occupied[level] |= uint64_t(1) << slot;
+  }
+}
+
+void TimerWheel::unlink(Entry& entry) {
+  auto& list = getList(entry.level, entry.slot);
+
+  if (entry.prev == nullptr) {
+    list.head = entry.next;
+  } else {
+    entry.prev->next = entry.next;
+  }
+  if (entry.next == nullptr) {
+    list.tail = entry.prev;
+  } else {
+    entry.next->prev = entry.prev;
+  }
+  entry.prev = nullptr;
+  entry.next = nullptr;
+
+  if (list.head == nullptr && entry.level < LEVELS) {
+    occupied[entry.level] &= ~(uint64_t(1) << entry.slot);
+  }
+}
+
+void TimerWheel::advanceTo(int64_t tick) {
+  // Nothing is due before `tick`, so every slot the wheel skips over is empty. What's left is to
+  // move entries down out of the slots `tick` now falls in, starting with the widest, so that
+  // they can cascade all the way down.
+  auto oldTick = baseTick;
+  baseTick = tick;
+
+  if ((tick >> (SLOT_BITS * LEVELS)) != (oldTick >> (SLOT_BITS * LEVELS))) {
+    replaceAll(overflow);
+  }
+  for (uint level = LEVELS - 1; level > 0; level--) {
+    replaceAll(getList(level, (tick >> (SLOT_BITS * level)) & (SLOTS - 1)));
+  }
+}
+
+void TimerWheel::replaceAll(List& list) {
+  auto entry = list.head;
+  while (entry != nullptr) {
+    auto next = entry->next;
+    unlink(*entry);
+    place(*entry);
+    entry = next;
+  }
+}
+
+TimerWheel::Entry* TimerWheel::findFront() const {
+  if (count == 0) return nullptr;
+
+  // Each level only holds the rest of the current slot of the level above, so the lowest occupied
+  // slot of the lowest occupied level holds the front.
+  const List* list = &overflow;
+  uint level = OVERFLOW_LEVEL;
+  for (uint l = 0; l < LEVELS; l++) {
+    if (occupied[l] != 0) {
+      level = l;
+      list = &lists[l * SLOTS + __builtin_ctzll(occupied[l])];
+      break;
+    }
+  }
+
+  if (level == 0) {
+    return list->head;
+  }
+
+  Entry* result = list->head;
+  for (auto entry = result->next; entry != nullptr; entry = entry->next) {
+    if (isBefore(*entry, *result)) result = entry;
+  }
+  return result;
+}
+
+}  // namespace workerd
@@ -0,0 +1,106 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/array.h>
+#include <kj/time.h>
+
+namespace workerd {
+
+using kj::uint;
+
+// A hierarchical timing wheel: a queue of entries ordered by deadline, with O(1) insertion and
+// removal. It suits large sets of timers most of which are canceled or fire soon, like the ones
+// created by setTimeout() and setInterval().
+//
+// Deadlines are bucketed by millisecond. The wheel has LEVELS levels of SLOTS slots each. Level k's
+// slots are SLOTS^k milliseconds wide and cover the rest of the current level-(k+1) slot, so
+// placing an entry takes one comparison per level. Entries beyond the top level are kept in an
+// overflow list. As the wheel advances, entries cascade down into narrower slots, so each moves
+// at most LEVELS times. Entries within one millisecond are kept sorted, so entries come out in
+// deadline order, and entries with equal deadlines come out in the order they were inserted.
+class TimerWheel {
+public:
+  // An entry in the wheel. Embed this in the object which represents a timer.
+  class Entry {
+  public:
+    Entry() = default;
+    ~Entry() noexcept(false);
+    KJ_DISALLOW_COPY_AND_MOVE(Entry);
+
+    bool isScheduled() const { return wheel != nullptr; }
+    kj::Date getDeadline() const { return deadline; }
+
+  private:
+    TimerWheel* wheel = nullptr;
+    Entry* prev = nullptr;
+    Entry* next = nullptr;
+    kj::Date deadline = kj::UNIX_EPOCH;
+    uint64_t sequence = 0;
+    int64_t tick = 0;
+    uint level = 0;
+    uint slot = 0;
+
+    friend class TimerWheel;
+  };
+
+  TimerWheel() = default;
+  ~TimerWheel() noexcept(false);
+  KJ_DISALLOW_COPY_AND_MOVE(TimerWheel);
+
+  // Schedules `entry`, which must not already be scheduled, for `deadline`.
+  void insert(Entry& entry, kj::Date deadline);
+
+  // Unschedules `entry`, which must be scheduled in this wheel.
+  void remove(Entry& entry);
+
+  size_t size() const { return count; }
+
+  // Returns the entry with the earliest deadline. This is cached, so it's cheap to call
+  // repeatedly.
+  kj::Maybe<Entry&> front() const;
+
+  // Removes and returns front(), advancing the wheel to its deadline.
+  kj::Maybe<Entry&> pop();
+
+private:
+  static constexpr uint SLOT_BITS = 6;
+  static constexpr uint SLOTS = 1u << SLOT_BITS;
+  static constexpr uint LEVELS = 4;
+  static constexpr uint OVERFLOW_LEVEL = LEVELS;
+
+  struct List {
+    Entry* head = nullptr;
+    Entry* tail = nullptr;
+  };
+
+  // LEVELS * SLOTS lists, allocated on first use.
+  kj::Array<List> lists;
+  List overflow;
+
+  // Bit i of occupied[k] is set if slot i of level k is non-empty.
+  uint64_t occupied[LEVELS] = {};
+
+  // The millisecond the wheel has advanced to. All entries are due at or after it, except those
+  // inserted with earlier deadlines, which sort to the front of its slot.
+  int64_t baseTick = 0;
+
+  size_t count = 0;
+  uint64_t nextSequence = 0;
+
+  mutable Entry* cachedFront = nullptr;
+  mutable bool cachedFrontValid = true;
+
+  static bool isBefore(const Entry& a, const Entry& b);
+  List& getList(uint level, uint slot);
+  void place(Entry& entry);
+  void link(Entry& entry, uint level, uint slot);
+  void unlink(Entry& entry);
+  void advanceTo(int64_t tick);
+  void replaceAll(List& list);
+  Entry* findFront() const;
+};
+
+}  // namespace workerd